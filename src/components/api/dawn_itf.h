@@ -19,6 +19,7 @@
 
 
 #include <api/components.h>
+#include <api/kvindex_itf.h>
 #include <api/kvstore_itf.h>
 namespace Component
 {
@@ -32,8 +33,15 @@ public:
   // clang-format off
   DECLARE_INTERFACE_UUID(0x33af1b99,0xbc51,0x49ff,0xa27b,0xd4,0xe8,0x19,0x03,0xbb,0x02);
   // clang-format on
-  
+
 public:
+  struct Opaque_async_handle { /* base for implementation operation state */
+    virtual ~Opaque_async_handle() {} /* destruction invokes derived destructor */
+  };
+
+  using async_handle_t = Opaque_async_handle *;
+
+  static constexpr async_handle_t ASYNC_HANDLE_INIT = nullptr;
   
 
   /** 
@@ -163,7 +171,219 @@ public:
                               void* out_value,
                               size_t& out_value_len,
                               IKVStore::memory_handle_t handle = IKVStore::HANDLE_NONE) = 0;
-  
+
+  enum class Batch_op_type {
+    PUT,
+    GET,
+  };
+
+  /**
+   * Element of a batched (multi-key) IO operation
+   */
+  struct Batch_op {
+    Batch_op_type type;
+    std::string   key;
+    std::string   value;  /*< [in] value for PUT, [out] value for GET */
+    status_t      status; /*< [out] per-element result */
+  };
+
+  /**
+   * Perform a batch of put and/or get operations on a pool.  Elements are
+   * packed into as few network messages as possible and executed by the
+   * server in order. Values too large for a batch message are reported
+   * with IKVStore::E_TOO_LARGE and should be retrieved with get.
+   *
+   * @param pool Pool handle
+   * @param ops [in-out] Operations; status and GET values are filled in
+   *
+   * @return S_OK or error code (per-element result is in Batch_op::status)
+   */
+  virtual status_t batch(const IKVStore::pool_t pool,
+                         std::vector<Batch_op>& ops) = 0;
+
+  /**
+   * Update an existing value by applying a vector of operations on the
+   * server (IKVStore::Operation_write, Operation_zero,
+   * Operation_increment_uint64, Operation_cas_uint64).  The vector is
+   * applied as one transaction in a single round trip, without
+   * transferring the value.  Results of increment and compare-and-swap
+   * operations are written back into the operation objects.
+   *
+   * @param pool Pool handle
+   * @param key Object key
+   * @param op_vector Operation vector
+   * @param take_lock Ignored; the server always locks the value
+   *
+   * @return S_OK, IKVStore::E_BAD_OFFSET if an operation is outside the
+   * value, or other error code
+   */
+  virtual status_t atomic_update(const IKVStore::pool_t pool,
+                                 const std::string& key,
+                                 const std::vector<IKVStore::Operation *>& op_vector,
+                                 bool take_lock = true) = 0;
+
+  /**
+   * Asynchronous put.  The request is issued without waiting for the
+   * response, so that several operations can be in flight on the same
+   * connection (up to the configured queue depth).  Each handle must be
+   * completed with async_poll or async_wait.
+   *
+   * @param pool Pool handle
+   * @param key Object key
+   * @param value Value data (copied before the call returns)
+   * @param value_len Size of value in bytes
+   * @param out_handle [out] Handle for the outstanding operation
+   *
+   * @return S_OK or error code
+   */
+  virtual status_t async_put(const IKVStore::pool_t pool,
+                             const std::string& key,
+                             const void * value,
+                             const size_t value_len,
+                             async_handle_t& out_handle) = 0;
+
+  /**
+   * Asynchronous get.  out_value and out_value_len are written when the
+   * operation completes and must remain valid until then.
+   *
+   * @param pool Pool handle
+   * @param key Object key
+   * @param out_value [out] Value data (release with free_memory() API)
+   * @param out_value_len [out] Size of value in bytes
+   * @param out_handle [out] Handle for the outstanding operation
+   *
+   * @return S_OK or error code
+   */
+  virtual status_t async_get(const IKVStore::pool_t pool,
+                             const std::string& key,
+                             void*& out_value,
+                             size_t& out_value_len,
+                             async_handle_t& out_handle) = 0;
+
+  /**
+   * Asynchronous put from memory registered with register_direct_memory.
+   * The value is sent from the registered memory without being copied,
+   * so it must not be modified until the operation completes.
+   *
+   * @param pool Pool handle
+   * @param key Object key
+   * @param value Value data (within the registered region)
+   * @param value_len Size of value in bytes
+   * @param handle Memory handle from register_direct_memory
+   * @param out_handle [out] Handle for the outstanding operation
+   *
+   * @return S_OK or error code
+   */
+  virtual status_t async_put_direct(const IKVStore::pool_t pool,
+                                    const std::string& key,
+                                    const void * value,
+                                    const size_t value_len,
+                                    IKVStore::memory_handle_t handle,
+                                    async_handle_t& out_handle) = 0;
+
+  /**
+   * Asynchronous get into memory registered with register_direct_memory.
+   * out_value_len is the size of the buffer on entry and is set to the
+   * size of the value on completion; it must remain valid until then.
+   *
+   * @param pool Pool handle
+   * @param key Object key
+   * @param out_value Buffer for value (within the registered region)
+   * @param out_value_len [in-out] Size of buffer, then size of value
+   * @param handle Memory handle from register_direct_memory
+   * @param out_handle [out] Handle for the outstanding operation
+   *
+   * @return S_OK or error code; the operation completes with
+   * E_INSUFFICIENT_SPACE if the buffer is too small
+   */
+  virtual status_t async_get_direct(const IKVStore::pool_t pool,
+                                    const std::string& key,
+                                    void* out_value,
+                                    size_t& out_value_len,
+                                    IKVStore::memory_handle_t handle,
+                                    async_handle_t& out_handle) = 0;
+
+  /**
+   * Asynchronous erase
+   *
+   * @param pool Pool handle
+   * @param key Object key
+   * @param out_handle [out] Handle for the outstanding operation
+   *
+   * @return S_OK or error code
+   */
+  virtual status_t async_erase(const IKVStore::pool_t pool,
+                               const std::string& key,
+                               async_handle_t& out_handle) = 0;
+
+  /**
+   * Check for completion of an asynchronous operation without blocking.
+   * On completion the handle is released and set to ASYNC_HANDLE_INIT.
+   *
+   * @param handle [in-out] Handle from an async_xxx call
+   * @param out_status [out] Result of the operation (valid on completion)
+   *
+   * @return True if the operation has completed
+   */
+  virtual bool async_poll(async_handle_t& handle, status_t& out_status) = 0;
+
+  /**
+   * Wait for completion of an asynchronous operation.  The handle is
+   * released and set to ASYNC_HANDLE_INIT.
+   *
+   * @param handle [in-out] Handle from an async_xxx call
+   *
+   * @return Result of the operation
+   */
+  virtual status_t async_wait(async_handle_t& handle) = 0;
+
+  /**
+   * Flush write-combined PUTs.  With write-combining enabled
+   * (DAWN_CLIENT_WRITE_COMBINE), put returns once the value is staged;
+   * staged PUTs are sent as batches when a message fills, when the
+   * oldest has waited for the combining period, before any other
+   * operation on the connection, and on flush.  Failures of PUTs sent
+   * since the last flush are reported here.
+   *
+   * @param pool Pool handle
+   * @param out_errors [out] Key and status of each failed PUT
+   *
+   * @return S_OK, or E_FAIL if any PUT failed
+   */
+  virtual status_t flush(const IKVStore::pool_t pool,
+                         std::vector<std::pair<std::string, status_t>>& out_errors) = 0;
+
+  /**
+   * List the keys of a pool, a page at a time.  The filter is evaluated
+   * by the shards, which page through the matching keys in key order
+   * (per shard) from the position of the previous call.  No snapshot is
+   * taken: keys added after that position may be listed.
+   *
+   * Backends have no ordered index to resume from, so every page walks
+   * all of the pool's keys (IKVStore::map) on the shard: listing N keys
+   * in pages of P costs O(N^2/P).  This suits occasional listings of
+   * modest pools; to export a large pool, use pages as large as a
+   * response holds (max_keys is capped to what fits).
+   *
+   * @param pool Pool handle
+   * @param expression Filter expression (unused for FIND_TYPE_NEXT)
+   * @param find_type FIND_TYPE_NEXT (all keys), FIND_TYPE_EXACT,
+   * FIND_TYPE_PREFIX or FIND_TYPE_REGEX
+   * @param cursor [in-out] 0 to start; then set for the next page, and
+   * to 0 once the scan is complete
+   * @param max_keys Maximum number of keys to return
+   * @param out_keys [out] Keys (appended)
+   *
+   * @return S_OK, E_INVAL for a bad cursor or expression, or
+   * IKVStore::E_NOT_SUPPORTED if the backend cannot enumerate keys
+   */
+  virtual status_t scan(const IKVStore::pool_t pool,
+                        const std::string& expression,
+                        IKVIndex::find_t find_type,
+                        uint64_t& cursor,
+                        size_t max_keys,
+                        std::vector<std::string>& out_keys) = 0;
+
   /** 
    * Perform a key search
    * 
@@ -224,6 +444,17 @@ public:
    */
   virtual void free_memory(void * p) = 0;
 
+  /**
+   * Get request statistics of the shard: operation counts, bytes and
+   * latency percentiles and histograms (by operation and value size
+   * class), queue depth histogram and IO buffer occupancy
+   *
+   * @param out_stats [out] Statistics as JSON
+   *
+   * @return S_OK or error code
+   */
+  virtual status_t get_statistics(std::string& out_stats) = 0;
+
   /** 
    * Debug routine
    * 
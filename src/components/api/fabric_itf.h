@@ -185,6 +185,21 @@ public:
    */
   virtual void unblock_completions() = 0;
 
+  /**
+   * Prepare to wait for completions of this and other endpoints in a
+   * single poll/epoll.  Appends the descriptors which become ready when
+   * a completion may be available.  Must be called before each wait.
+   *
+   * @param fds Descriptors to wait on (appended)
+   *
+   * @return false if completions may already be pending (or the
+   * endpoint has shut down), in which case the caller should poll
+   * completions instead of waiting
+   *
+   * @throw IFabric_runtime_error - ::fi_control fail
+   */
+  virtual bool prepare_wait(std::vector<int> &fds) = 0;
+
   /* Additional TODO:
      - support for completion and event counters
      - support for statistics collection
@@ -501,6 +516,21 @@ public:
    */
   virtual IFabric_server * get_new_connection() = 0;
 
+  /**
+   * As get_new_connection, but block until a new connection is
+   * available or the timeout expires.  Allows an otherwise idle
+   * thread to accept connections without polling.
+   *
+   * @param timeout Maximum time to wait
+   *
+   * @return New connection, or NULL if no new connection.
+   *
+   * @throw std::system_error, e.g. for locking
+   * @throw std::logic_error : unexpected event
+   * @throw std::system_error : read error on event pipe
+   */
+  virtual IFabric_server * wait_for_new_connection(std::chrono::milliseconds timeout) = 0;
+
   /**
    * Close connection and release any associated resources
    * 
@@ -123,6 +123,60 @@ public:
     const void * data() const noexcept { return _data; }
   };
 
+  class Operation_zero
+    : public Operation_sized
+  {
+  public:
+    Operation_zero(size_t offset, size_t len)
+      :  Operation_sized(Op_type::ZERO, offset, len)
+    {}
+  };
+
+  class Operation_increment_uint64
+    : public Operation
+  {
+    uint64_t _addend;
+    uint64_t _result;
+  public:
+    Operation_increment_uint64(size_t offset, uint64_t addend)
+      : Operation(Op_type::INCREMENT_UINT64, offset)
+      , _addend(addend)
+      , _result(0)
+    {}
+    uint64_t addend() const noexcept { return _addend; }
+    /* value before the increment, set by the implementation */
+    uint64_t result() const noexcept { return _result; }
+    void set_result(uint64_t result) noexcept { _result = result; }
+  };
+
+  class Operation_cas_uint64
+    : public Operation
+  {
+    uint64_t _expected;
+    uint64_t _desired;
+    uint64_t _result;
+    bool _swapped;
+  public:
+    Operation_cas_uint64(size_t offset, uint64_t expected, uint64_t desired)
+      : Operation(Op_type::CAS_UINT64, offset)
+      , _expected(expected)
+      , _desired(desired)
+      , _result(0)
+      , _swapped(false)
+    {}
+    uint64_t expected() const noexcept { return _expected; }
+    uint64_t desired() const noexcept { return _desired; }
+    /* value before the operation, set by the implementation */
+    uint64_t result() const noexcept { return _result; }
+    /* true if the update (transaction) was applied */
+    bool swapped() const noexcept { return _swapped; }
+    void set_result(uint64_t result, bool swapped) noexcept
+    {
+      _result = result;
+      _swapped = swapped;
+    }
+  };
+
   typedef enum {
     STORE_LOCK_READ=1,
     STORE_LOCK_WRITE=2,
@@ -291,6 +345,33 @@ public:
                               memory_handle_t handle = HANDLE_NONE) {
     return E_NOT_SUPPORTED;
   }
+
+  /**
+   * Read a batch of object values. Implementations may overlap the
+   * lookups; the default reads the keys one at a time with get().
+   *
+   * @param pool Pool handle
+   * @param keys Object keys
+   * @param out_values Value data and size, one per key; release each
+   * iov_base with free_memory(). {nullptr, 0} where the key is not read.
+   * @param out_status Status of each key: S_OK, E_KEY_NOT_FOUND or other error code
+   *
+   * @return S_OK or error code
+   */
+  virtual status_t get_batch(const pool_t pool,
+                             const std::vector<std::string>& keys,
+                             std::vector<::iovec>& out_values,
+                             std::vector<status_t>& out_status) {
+    out_values.assign(keys.size(), ::iovec{nullptr, 0});
+    out_status.assign(keys.size(), S_OK);
+    for (size_t i = 0; i < keys.size(); i++) {
+      void*  value     = nullptr;
+      size_t value_len = 0;
+      out_status[i]    = get(pool, keys[i], value, value_len);
+      if (out_status[i] == S_OK) out_values[i] = ::iovec{value, value_len};
+    }
+    return S_OK;
+  }
   
 
   /** 
@@ -366,8 +447,9 @@ public:
    * Update an existing value by applying a series of operations.
    * Together the set of operations make up an atomic transaction.
    * If the operation requires a result the operation type may provide
-   * a method to accept the result. No operation currently requires
-   * a result, but compare and swap probably would.
+   * a method to accept the result (Operation_increment_uint64 and
+   * Operation_cas_uint64 return the prior value).  If a compare and
+   * swap comparison fails, no operation in the vector is applied.
    * 
    * @param pool Pool handle
    * @param key Object key
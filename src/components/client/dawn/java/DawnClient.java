@@ -0,0 +1,67 @@
+/*
+ * Java binding for the Dawn client; the natives live in
+ * libcomanche-dawn-client.so (src/dawn_client_jni.cpp).
+ *
+ * Status-returning methods return 0 (S_OK) or a negative error code.
+ * Buffer methods take direct ByteBuffers, which are registered with the
+ * client on first use and stay registered until unregisterBuffer or
+ * clean.  A buffer cannot be unregistered (E_BUSY), or re-registered
+ * because it has grown, while asynchronous operations on it are
+ * outstanding.
+ */
+public class DawnClient {
+
+  static {
+    System.loadLibrary("comanche-dawn-client");
+  }
+
+  /** returned by asyncPoll while the operation is still outstanding */
+  public static final long ASYNC_PENDING = Long.MIN_VALUE;
+
+  public native void init(int debug, String user, String addr, String device);
+
+  public native int put(String table, String key, byte[] value, boolean direct);
+
+  public native int get(String table, String key, byte[] value, boolean direct);
+
+  public native int erase(String table, String key);
+
+  public native int registerBuffer(java.nio.ByteBuffer buffer);
+
+  public native int unregisterBuffer(java.nio.ByteBuffer buffer);
+
+  public native int putBuffer(String table, String key, java.nio.ByteBuffer value,
+                              int offset, int length);
+
+  /** @return value length, or a negative error code */
+  public native long getBuffer(String table, String key, java.nio.ByteBuffer value,
+                               int offset, int length);
+
+  /** @return operation handle, or 0 on failure */
+  public native long asyncPutBuffer(String table, String key, java.nio.ByteBuffer value,
+                                    int offset, int length);
+
+  /** @return operation handle, or 0 on failure */
+  public native long asyncGetBuffer(String table, String key, java.nio.ByteBuffer value,
+                                    int offset, int length);
+
+  /**
+   * Poll an asynchronous operation.  Once the result (value length for a
+   * get, otherwise status) has been returned the handle is freed and must
+   * not be used again.
+   *
+   * @return ASYNC_PENDING while outstanding, otherwise the result;
+   * E_INVAL for a 0 handle
+   */
+  public native long asyncPoll(long handle);
+
+  /**
+   * Wait for an asynchronous operation and free its handle.
+   *
+   * @return value length for a get, otherwise status; E_INVAL for a 0
+   * handle
+   */
+  public native long asyncWait(long handle);
+
+  public native int clean();
+}
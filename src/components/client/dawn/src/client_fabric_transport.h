@@ -5,6 +5,7 @@
 #include <common/exceptions.h>
 #include <common/utils.h>
 #include "dawn_client_config.h"
+#include "protocol.h"
 
 namespace Dawn
 {
@@ -20,8 +21,12 @@ class Fabric_transport {
   using buffer_t        = Buffer_manager<Transport>::buffer_t;
   using memory_region_t = Component::IFabric_memory_region *;
 
+  /* receive and send buffers for each in-flight request */
+  static constexpr size_t BUFFER_COUNT =
+      (2 * Dawn::Protocol::MAX_OUTSTANDING_REQUESTS) + 4;
+
   Fabric_transport(Component::IFabric_client *fabric_connection)
-      : _transport(fabric_connection), _bm(fabric_connection)
+      : _transport(fabric_connection), _bm(fabric_connection, BUFFER_COUNT)
   {
     _max_inject_size = _transport->max_inject_size();
   }
@@ -98,6 +103,26 @@ class Fabric_transport {
     _transport->post_recv(first, last, descriptors, context);
   }
 
+  inline void post_read(const ::iovec *first,
+                        const ::iovec *last,
+                        void **        descriptors,
+                        std::uint64_t  remote_addr,
+                        std::uint64_t  key,
+                        void *         context)
+  {
+    _transport->post_read(first, last, descriptors, remote_addr, key, context);
+  }
+
+  inline void post_write(const ::iovec *first,
+                         const ::iovec *last,
+                         void **        descriptors,
+                         std::uint64_t  remote_addr,
+                         std::uint64_t  key,
+                         void *         context)
+  {
+    _transport->post_write(first, last, descriptors, remote_addr, key, context);
+  }
+
   /**
    * Post send (one or two buffers) and wait for completion.
    *
@@ -106,6 +131,8 @@ class Fabric_transport {
    */
   void sync_send(buffer_t *iob, buffer_t *iob_extra = nullptr)
   {
+    consume_credit();
+
     if (iob_extra) {
       iovec v[2]   = {*iob->iov, *iob_extra->iov};
       void *desc[] = {iob->desc, iob_extra->desc};
@@ -120,6 +147,26 @@ class Fabric_transport {
     iob->reset_length();
   }
 
+  /**
+   * Send request followed by a value in registered memory, and wait
+   * for completion
+   *
+   * @param iob IO buffer holding the request
+   * @param value Value (within a registered region)
+   * @param value_desc Memory descriptor of the region
+   */
+  void sync_send(buffer_t *iob, const iovec &value, void *value_desc)
+  {
+    consume_credit();
+
+    iovec v[2]   = {*iob->iov, value};
+    void *desc[] = {iob->desc, value_desc};
+    post_send(&v[0], &v[2], desc, iob);
+
+    wait_for_completion(iob);
+    iob->reset_length();
+  }
+
   /**
    * Perform inject send (fast for small packets)
    *
@@ -127,6 +174,8 @@ class Fabric_transport {
    */
   void sync_inject_send(buffer_t *iob)
   {
+    consume_credit();
+
     auto len = iob->length();
     if (len <= _max_inject_size) {
       /* when this returns, iob is ready for immediate reuse */
@@ -174,6 +223,7 @@ class Fabric_transport {
     iob->reset_length();
     post_recv(iob->iov, iob->iov + 1, &iob->desc, iob);
     wait_for_completion(iob);
+    return_credits(iob);
   }
 
   void post_recv(buffer_t *iob)
@@ -215,13 +265,42 @@ class Fabric_transport {
     return S_OK;
   }
 
-  inline auto allocate() { return _bm.allocate(); }
+  /**
+   * Take a flow-control credit for sending a request; the server has
+   * a receive buffer posted for each credit
+   *
+   */
+  inline void consume_credit()
+  {
+    if (unlikely(_credits == 0))
+      throw Program_exception("no flow-control credit for request");
+    _credits--;
+  }
+
+  /**
+   * Add credits returned by the server in a response
+   *
+   * @param iob IO buffer holding the response
+   */
+  inline void return_credits(buffer_t *iob)
+  {
+    _credits +=
+        static_cast<const Dawn::Protocol::Message *>(iob->base())->credits;
+  }
+
+  inline unsigned credits() const { return _credits; }
+
+  inline auto allocate(size_t len = Buffer_manager<Transport>::BUFFER_LEN)
+  {
+    return _bm.allocate(len);
+  }
   inline void free_buffer(buffer_t *buffer) { _bm.free(buffer); }
 
  protected:
   Transport *               _transport;
   size_t                    _max_inject_size;
   Buffer_manager<Transport> _bm; /*< IO buffer manager */
+  unsigned                  _credits = 0; /*< granted in handshake */
 };
 
 }  // namespace Client
@@ -2,6 +2,7 @@
 #include <common/cycles.h>
 #include <common/utils.h>
 #include <unistd.h>
+#include <algorithm>
 
 #include "connection.h"
 #include "protocol.h"
@@ -19,6 +20,62 @@ Connection_handler::Connection_handler(Connection_base::Transport* connection)
   if (env && env[0] == '1') {
     _options.short_circuit_backend = true;
   }
+
+  /* number of requests in flight; requested as the flow-control credit
+     window in the handshake (the server may grant fewer) */
+  env = getenv("DAWN_CLIENT_QUEUE_DEPTH");
+  if (env) {
+    auto depth = std::strtoul(env, nullptr, 10);
+    if (depth < 1 || depth > Dawn::Protocol::MAX_OUTSTANDING_REQUESTS)
+      throw API_exception("DAWN_CLIENT_QUEUE_DEPTH should be 1-%u",
+                          Dawn::Protocol::MAX_OUTSTANDING_REQUESTS);
+    _options.queue_depth = depth;
+  }
+
+  /* GET reads values directly from server memory where it can (values
+     in pre-registered pool memory, e.g. hstore) */
+  env = getenv("DAWN_CLIENT_ONE_SIDED_GET");
+  if (env && env[0] == '1') {
+    _options.one_sided_get = true;
+  }
+
+  /* large values are streamed in segments, with up to the stream window
+     of segments in flight */
+  env = getenv("DAWN_CLIENT_STREAM_WINDOW");
+  if (env) {
+    auto window = std::strtoul(env, nullptr, 10);
+    if (window < 1 || window > Dawn::Protocol::MAX_OUTSTANDING_REQUESTS)
+      throw API_exception("DAWN_CLIENT_STREAM_WINDOW should be 1-%u",
+                          Dawn::Protocol::MAX_OUTSTANDING_REQUESTS);
+    _options.stream_window = window;
+  }
+
+  env = getenv("DAWN_CLIENT_SEGMENT_SIZE");
+  if (env) {
+    auto size = std::strtoul(env, nullptr, 10);
+    if (size < KiB(4) || size > Buffer_manager<Transport>::BUFFER_LEN)
+      throw API_exception("DAWN_CLIENT_SEGMENT_SIZE should be %lu-%lu",
+                          KiB(4), Buffer_manager<Transport>::BUFFER_LEN);
+    _options.segment_size = size;
+  }
+
+  /* small PUTs are staged and sent in batches; the value is the longest
+     a PUT may wait before it is sent */
+  env = getenv("DAWN_CLIENT_WRITE_COMBINE");
+  if (env) {
+    auto usec = std::strtoul(env, nullptr, 10);
+    if (usec < 1 || usec > 1000000)
+      throw API_exception(
+          "DAWN_CLIENT_WRITE_COMBINE should be 1-1000000 (usec)");
+    _options.combine_usec = usec;
+  }
+
+  /* identity presented to the shard, which may give the connection a
+     configured scheduling weight */
+  env = getenv("DAWN_CLIENT_AUTH_ID");
+  if (env) {
+    _options.auth_id = std::strtoull(env, nullptr, 0);
+  }
   _max_inject_size = connection->max_inject_size();
 }
 
@@ -27,6 +84,7 @@ Connection_handler::pool_t Connection_handler::open_pool(const std::string path,
                                                          unsigned int flags)
 {
   API_LOCK();
+  drain_async();
 
   PMAJOR("open pool: %s %s", path.c_str(), name.c_str());
 
@@ -66,6 +124,7 @@ Connection_handler::pool_t Connection_handler::create_pool(
     uint64_t          expected_obj_count)
 {
   API_LOCK();
+  drain_async();
   PMAJOR("create pool: %s %s (expected objs=%lu)", path.c_str(), name.c_str(),
          expected_obj_count);
 
@@ -102,12 +161,56 @@ Connection_handler::pool_t Connection_handler::create_pool(
 void Connection_handler::close_or_delete_pool(pool_t pool, int op)
 {
   API_LOCK();
+  drain_async();
+
+  for (auto i = _put_errors.begin(); i != _put_errors.end();) {
+    if (i->pool == pool) {
+      PWRN("put (%s) failed (%d) and was not flushed before close",
+           i->key.c_str(), i->status);
+      i = _put_errors.erase(i);
+    }
+    else
+      i++;
+  }
+
   /* send pool request message */
-  auto       iob = allocate();
+  auto       iob = allocate(sizeof(Dawn::Protocol::Message_pool_response));
   const auto msg = new (iob->base()) Dawn::Protocol::Message_pool_request(
       iob->length(), auth_id(), ++_request_id, op);
   msg->pool_id = pool;
 
+  /* pool regions are deregistered on close */
+  for (auto i = _locations.begin(); i != _locations.end();) {
+    if (i->first.first == pool)
+      i = _locations.erase(i);
+    else
+      i++;
+  }
+  _unlocatable.erase(pool);
+
+  iob->set_length(msg->msg_len);
+  sync_inject_send(iob);
+
+  sync_recv(iob);
+
+  auto response_msg = new (iob->base()) Dawn::Protocol::Message_pool_response();
+  if (response_msg->type_id != Dawn::Protocol::MSG_TYPE_POOL_RESPONSE)
+    throw Protocol_exception("expected POOL_RESPONSE message - got %x",
+                             response_msg->type_id);
+
+  free_buffer(iob);
+}
+
+status_t Connection_handler::get_statistics(std::string& out_stats)
+{
+  API_LOCK();
+  drain_async();
+
+  /* report does not fit in a small buffer */
+  const auto iob = allocate();
+  const auto msg = new (iob->base()) Dawn::Protocol::Message_pool_request(
+      iob->length(), auth_id(), ++_request_id, Dawn::Protocol::OP_STATS);
+
   iob->set_length(msg->msg_len);
   sync_inject_send(iob);
 
@@ -118,7 +221,11 @@ void Connection_handler::close_or_delete_pool(pool_t pool, int op)
     throw Protocol_exception("expected POOL_RESPONSE message - got %x",
                              response_msg->type_id);
 
+  const status_t status = response_msg->status;
+  if (status == S_OK) out_stats.assign(response_msg->data);
+
   free_buffer(iob);
+  return status;
 }
 
 void Connection_handler::close_pool(pool_t pool)
@@ -151,10 +258,24 @@ status_t Connection_handler::put(const pool_t pool,
 {
   API_LOCK();
 
+  if (_options.combine_usec &&
+      stage_put(pool, key, key_len, value, value_len))
+    return S_OK;
+
+  drain_async();
+
   if (option_DEBUG)
     PINF("put: %.*s (key_len=%lu) (value_len=%lu)", (int) key_len, (char*) key,
          key_len, value_len);
 
+  forget_location(pool, std::string(static_cast<const char*>(key), key_len));
+
+  if ((key_len + value_len + sizeof(Dawn::Protocol::Message_IO_request)) >
+      Buffer_manager<Transport>::BUFFER_LEN) {
+    /* value will not fit in a message; stream it through IO buffers */
+    return two_stage_put(pool, key, key_len, value, value_len, nullptr);
+  }
+
   const auto iob = allocate();
 
   const auto msg = new (iob->base()) Dawn::Protocol::Message_IO_request(
@@ -187,26 +308,105 @@ status_t Connection_handler::put(const pool_t pool,
   return response_msg->status;
 }
 
-status_t Connection_handler::two_stage_put_direct(
-    const pool_t                         pool,
-    const void*                          key,
-    const size_t                         key_len,
-    const void*                          value,
-    const size_t                         value_len,
-    Component::IKVStore::memory_handle_t handle)
+bool Connection_handler::stage_put(const pool_t pool,
+                                   const void*  key,
+                                   const size_t key_len,
+                                   const void*  value,
+                                   const size_t value_len)
+{
+  using namespace Dawn::Protocol;
+
+  const size_t element_len =
+      batch_align(sizeof(Batch_request_element) + key_len + value_len);
+  const size_t message_len =
+      Buffer_manager<Transport>::BUFFER_LEN - sizeof(Message_IO_batch_request);
+  if (element_len > message_len) return false;
+
+  /* send what is staged if this PUT would not fit in the same message */
+  if (!_staged.empty() &&
+      (_staged_pool != pool || _staged_bytes + element_len > message_len))
+    flush_staged();
+
+  if (_staged.empty()) {
+    _staged_pool  = pool;
+    _staged_since = std::chrono::steady_clock::now();
+  }
+
+  const std::string k(static_cast<const char*>(key), key_len);
+  forget_location(pool, k);
+
+  _staged.push_back({Component::IDawn::Batch_op_type::PUT, k,
+                     std::string(static_cast<const char*>(value), value_len),
+                     E_FAIL});
+  _staged_bytes += element_len;
+
+  if (std::chrono::steady_clock::now() - _staged_since >= combine_period())
+    flush_staged();
+  return true;
+}
+
+void Connection_handler::flush_staged()
+{
+  if (_staged.empty()) return;
+
+  /* take the staged PUTs first; send_batch drains (and so flushes) */
+  std::vector<Component::IDawn::Batch_op> ops;
+  ops.swap(_staged);
+  _staged_bytes = 0;
+
+  if (option_DEBUG) PLOG("flushing %lu staged puts", ops.size());
+
+  send_batch(_staged_pool, ops);
+  for (auto& op : ops)
+    if (op.status != S_OK)
+      _put_errors.push_back({_staged_pool, std::move(op.key), op.status});
+}
+
+void Connection_handler::flush_expired()
+{
+  API_LOCK();
+  if (!_staged.empty() &&
+      std::chrono::steady_clock::now() - _staged_since >= combine_period())
+    flush_staged();
+}
+
+status_t Connection_handler::flush(
+    const pool_t                                   pool,
+    std::vector<std::pair<std::string, status_t>>& out_errors)
+{
+  API_LOCK();
+  drain_async();
+
+  status_t status = S_OK;
+  for (auto i = _put_errors.begin(); i != _put_errors.end();) {
+    if (i->pool == pool) {
+      out_errors.emplace_back(std::move(i->key), i->status);
+      status = E_FAIL;
+      i      = _put_errors.erase(i);
+    }
+    else
+      i++;
+  }
+  return status;
+}
+
+status_t Connection_handler::two_stage_put(const pool_t pool,
+                                           const void*  key,
+                                           const size_t key_len,
+                                           const void*  value,
+                                           const size_t value_len,
+                                           void*        desc)
 {
   using namespace Dawn;
 
   if (option_DEBUG)
-    PINF("multi_put_direct: key=(%.*s) key_len=%lu value=(%.20s...) "
-         "value_len=%lu handle=%p",
-         (int) key_len, (char*) key, key_len, (char*) value, value_len, handle);
-
-  assert(value_len <= _max_message_size);
+    PINF("two_stage_put: key=(%.*s) key_len=%lu value=(%.20s...) "
+         "value_len=%lu desc=%p",
+         (int) key_len, (char*) key, key_len, (char*) value, value_len, desc);
 
   const auto iob = allocate();
 
-  /* send advance message, this will be followed by partial puts */
+  /* send advance message; the response locates the value on the server */
   const auto request_id = ++_request_id;
   const auto msg        = new (iob->base())
       Protocol::Message_IO_request(iob->length(), auth_id(), request_id, pool,
@@ -214,20 +414,167 @@ status_t Connection_handler::two_stage_put_direct(
                                    key, key_len, value_len);
   iob->set_length(msg->msg_len);
   sync_inject_send(iob);
+
+  sync_recv(iob);
+
+  const auto response_msg =
+      new (iob->base()) Dawn::Protocol::Message_IO_response();
+  if (response_msg->type_id != Dawn::Protocol::MSG_TYPE_IO_RESPONSE)
+    throw Protocol_exception("expected IO_RESPONSE message - got %x",
+                             response_msg->type_id);
+
+  const status_t status = response_msg->status;
+  const auto     target = *response_msg->remote_target();
   free_buffer(iob);
 
-  /* send value, then wait for reply */
-  buffer_t* value_buffer = reinterpret_cast<buffer_t*>(handle);
-  value_buffer->set_length(value_len);
-  assert(value_buffer->check_magic());
+  if (status != S_OK) return status;
+
+  if (option_DEBUG) PLOG("two_stage_put: target=%lx", target.addr);
+
+  /* write value directly into server memory, then release it */
+  const status_t write_status =
+      write_remote_value(pool, value, value_len, desc, target);
+  const status_t release_status = release_remote_value(pool, target.addr);
+
+  return write_status == S_OK ? release_status : write_status;
+}
+
+void Connection_handler::post_segment(
+    std::deque<Segment>&                 segments,
+    const bool                           write,
+    void*                                value,
+    const size_t                         value_len,
+    void*                                desc,
+    const Dawn::Protocol::Remote_target& target,
+    size_t&                              offset)
+{
+  const size_t len = std::min(value_len - offset,
+                              std::min(_options.segment_size,
+                                       _max_message_size));
+  const auto   p   = static_cast<char*>(value) + offset;
+
+  Segment segment{{p, len}, desc, nullptr, offset};
+  if (desc == nullptr) {
+    segment.bounce = allocate();
+    segment.iov    = {segment.bounce->base(), len};
+    segment.desc   = segment.bounce->desc;
+    if (write) memcpy(segment.bounce->base(), p, len);
+  }
+
+  /* deque does not move elements on push_back; the iovec is the
+     completion context */
+  segments.push_back(segment);
+  auto& s = segments.back();
+  if (write)
+    post_write(&s.iov, (&s.iov) + 1, &s.desc, target.addr + offset,
+               target.key, &s.iov);
+  else
+    post_read(&s.iov, (&s.iov) + 1, &s.desc, target.addr + offset,
+              target.key, &s.iov);
+
+  offset += len;
+}
+
+status_t Connection_handler::write_remote_value(
+    const pool_t                         pool,
+    const void*                          value,
+    size_t                               value_len,
+    void*                                desc,
+    const Dawn::Protocol::Remote_target& target)
+{
+  using namespace Dawn::Protocol;
+
+  std::deque<Segment>    segments;
+  std::vector<Async_op*> acks;
+  size_t                 offset = 0;
+
+  while (offset < value_len || !segments.empty()) {
+    while (offset < value_len && segments.size() < _options.stream_window)
+      post_segment(segments, true, const_cast<void*>(value), value_len, desc,
+                   target, offset);
+
+    auto& s = segments.front();
+    wait_for_completion(&s.iov);
+    if (s.bounce) free_buffer(s.bounce);
+
+    /* segment has landed; hand it to the server for persistence */
+    Value_segment vs{target.addr, s.offset, s.iov.iov_len};
+
+    const auto iob = allocate(sizeof(Message_IO_request) + sizeof(vs) + 1);
+    const auto request_id = ++_request_id;
+    const auto msg        = new (iob->base())
+        Message_IO_request(iob->length(), auth_id(), request_id, pool,
+                           OP_PUT_SEGMENT, "", 0, &vs, sizeof(vs));
+    iob->set_length(msg->msg_len);
+    acks.push_back(post_async(iob, pool, request_id, OP_PUT_SEGMENT));
+
+    segments.pop_front();
+    progress_async();
+  }
+
+  drain_async();
+
+  status_t status = S_OK;
+  for (auto aop : acks) {
+    if (status == S_OK) status = aop->status;
+    delete aop;
+  }
 
   if (option_DEBUG)
-    PLOG("value_buffer: (iov_len=%lu, region=%p, desc=%p)",
-         value_buffer->iov->iov_len, value_buffer->region, value_buffer->desc);
+    PLOG("write_remote_value: %lu segments (status=%d)", acks.size(), status);
 
-  sync_send(value_buffer);  // client owns buffer
+  return status;
+}
 
-  return S_OK;
+void Connection_handler::read_remote_value(
+    void*                                value,
+    size_t                               value_len,
+    void*                                desc,
+    const Dawn::Protocol::Remote_target& target)
+{
+  std::deque<Segment> segments;
+  size_t              offset = 0;
+
+  while (offset < value_len || !segments.empty()) {
+    while (offset < value_len && segments.size() < _options.stream_window)
+      post_segment(segments, false, value, value_len, desc, target, offset);
+
+    auto& s = segments.front();
+    wait_for_completion(&s.iov);
+    if (s.bounce) {
+      memcpy(static_cast<char*>(value) + s.offset, s.bounce->base(),
+             s.iov.iov_len);
+      free_buffer(s.bounce);
+    }
+    segments.pop_front();
+  }
+}
+
+status_t Connection_handler::release_remote_value(const pool_t pool,
+                                                  uint64_t     addr)
+{
+  const auto iob =
+      allocate(sizeof(Dawn::Protocol::Message_IO_request) + sizeof(addr) + 1);
+  assert(iob);
+
+  const auto msg = new (iob->base()) Dawn::Protocol::Message_IO_request(
+      iob->length(), auth_id(), ++_request_id, pool, Dawn::Protocol::OP_RELEASE,
+      "", 0, &addr, sizeof(addr));
+
+  iob->set_length(msg->msg_len);
+  sync_inject_send(iob);
+
+  sync_recv(iob);
+
+  const auto response_msg =
+      new (iob->base()) Dawn::Protocol::Message_IO_response();
+  if (response_msg->type_id != Dawn::Protocol::MSG_TYPE_IO_RESPONSE)
+    throw Protocol_exception("expected IO_RESPONSE message - got %x",
+                             response_msg->type_id);
+
+  const status_t status = response_msg->status;
+  free_buffer(iob);
+  return status;
 }
 
 status_t Connection_handler::put_direct(
@@ -238,6 +585,9 @@ status_t Connection_handler::put_direct(
     Component::IKVStore::memory_handle_t handle)
 {
   API_LOCK();
+  drain_async();
+
+  forget_location(pool, key);
 
   assert(_max_message_size);
 
@@ -245,8 +595,15 @@ status_t Connection_handler::put_direct(
   if ((key_len + value_len + sizeof(Dawn::Protocol::Message_IO_request)) >
       Buffer_manager<Component::IFabric_client>::BUFFER_LEN) {
     /* for large puts, we use a two-stage protocol */
-    return two_stage_put_direct(pool, key.c_str(), key_len, value, value_len,
-                                handle);
+    if (handle == IKVStore::HANDLE_NONE)
+      throw API_exception("put_direct: memory handle should be provided");
+
+    buffer_t* value_buffer = reinterpret_cast<buffer_t*>(handle);
+    if (!value_buffer->check_magic())
+      throw General_exception("put_direct: memory handle is invalid");
+
+    return two_stage_put(pool, key.c_str(), key_len, value, value_len,
+                         value_buffer->desc);
   }
 
   if (option_DEBUG)
@@ -261,7 +618,6 @@ status_t Connection_handler::put_direct(
 
   value_buffer = reinterpret_cast<buffer_t*>(handle);
 
-  value_buffer->set_length(value_len);
   if (!value_buffer->check_magic())
     throw General_exception("put_direct: memory handle is invalid");
 
@@ -279,7 +635,10 @@ status_t Connection_handler::put_direct(
     msg->resvd |= Dawn::Protocol::MSG_RESVD_SCBE;
 
   iob->set_length(msg->msg_len);
-  sync_send(iob, value_buffer); /* send two concatentated buffers */
+  /* send two concatenated buffers; the value need not be at the start
+     of the registered region */
+  sync_send(iob, iovec{const_cast<void*>(value), value_len},
+            value_buffer->desc);
 
   sync_recv(
       iob); /* re-using iob; if we want to issue before, we'll have to rework */
@@ -301,6 +660,17 @@ status_t Connection_handler::get(const pool_t       pool,
                                  std::string&       value)
 {
   API_LOCK();
+  drain_async();
+
+  if (_options.one_sided_get) {
+    void*  p_value;
+    size_t p_value_len;
+    if (one_sided_get(pool, key, p_value, p_value_len)) {
+      value.assign(static_cast<const char*>(p_value), p_value_len);
+      ::free(p_value);
+      return S_OK;
+    }
+  }
 
   const auto iob = allocate();
   assert(iob);
@@ -334,29 +704,40 @@ status_t Connection_handler::get(const pool_t       pool,
   if (status == S_OK) {
     value.reserve(response_msg->data_len + 1);
     value.insert(0, response_msg->data, response_msg->data_len);
-    free_buffer(iob);
     assert(response_msg->data);
   }
 
+  free_buffer(iob);
+
+  if (status == S_OK && _options.one_sided_get) locate_value(pool, key);
   return status;
 }
 
 status_t Connection_handler::get(const pool_t       pool,
                                  const std::string& key,
                                  void*&             value,
-                                 size_t&            value_len)
+                                 size_t&            value_len,
+                                 Lease*             lease)
 {
   API_LOCK();
+  drain_async();
+
+  /* one-sided reads carry no version, so they cannot back a lease */
+  if (!lease && _options.one_sided_get &&
+      one_sided_get(pool, key, value, value_len))
+    return S_OK;
 
   const auto iob = allocate();
   assert(iob);
 
+  /* with a lease, the value length carries the cached version */
   const auto msg = new (iob->base()) Dawn::Protocol::Message_IO_request(
       iob->length(), auth_id(), ++_request_id, pool,
       Dawn::Protocol::OP_GET,  // op
-      key.c_str(), key.length(), 0);
+      key.c_str(), key.length(), lease ? lease->version : 0);
   if (_options.short_circuit_backend)
     msg->resvd |= Dawn::Protocol::MSG_RESVD_SCBE;
+  if (lease) msg->resvd |= Dawn::Protocol::MSG_RESVD_LEASE;
 
   iob->set_length(msg->msg_len);
   sync_inject_send(iob);
@@ -375,39 +756,220 @@ status_t Connection_handler::get(const pool_t       pool,
          response_msg->status, response_msg->request_id,
          response_msg->data_length());
 
-  if (msg->status != S_OK) return msg->status;
+  if (response_msg->status != S_OK) {
+    const status_t status = response_msg->status;
+    free_buffer(iob);
+    return status;
+  }
+
+  if (lease) {
+    lease->version      = response_msg->value_version;
+    lease->lease_ms     = response_msg->lease_ms;
+    lease->not_modified = response_msg->is_not_modified();
+
+    if (lease->not_modified) {
+      free_buffer(iob);
+      value     = nullptr;
+      value_len = 0;
+      return S_OK;
+    }
+  }
 
   if (option_DEBUG) PLOG("message value:(%s)", response_msg->data);
 
   if (response_msg->is_set_twostage_bit()) {
-    /* two-stage get */
-    const auto data_len = response_msg->data_length() + 1;
-    value               = ::aligned_alloc(MiB(2), data_len);
-    madvise(value, data_len, MADV_HUGEPAGE);
+    /* two-stage get; read value directly from server memory */
+    const auto data_len = response_msg->data_length();
+    const auto target   = *response_msg->remote_target();
+    free_buffer(iob);
 
-    auto region = register_memory(
-        value, data_len); /* we could have some pre-registered? */
-    auto desc = get_memory_descriptor(region);
+    /* streamed through IO buffers, rather than registering the value */
+    value = ::malloc(data_len + 1);
+    read_remote_value(value, data_len, nullptr, target);
 
-    iovec iov{value, data_len - 1};
-    post_recv(&iov, (&iov) + 1, &desc, &iov);
+    ((char*) value)[data_len] = '\0';
+    value_len                 = data_len;
 
-    /* synchronously wait for receive to complete */
-    wait_for_completion(&iov);
+    const status_t status = release_remote_value(pool, target.addr);
+    if (status == S_OK && !lease && _options.one_sided_get)
+      locate_value(pool, key);
+    return status;
+  }
+
+  /* copy off value from IO buffer */
+  value     = ::malloc(response_msg->data_len + 1);
+  value_len = response_msg->data_len;
+
+  memcpy(value, response_msg->data, response_msg->data_len);
+  ((char*) value)[response_msg->data_len] = '\0';
+
+  const status_t status = msg->status;
+  free_buffer(iob);
+
+  if (status == S_OK && !lease && _options.one_sided_get)
+    locate_value(pool, key);
+  return status;
+}
 
-    deregister_memory(region);
+bool Connection_handler::one_sided_get(const pool_t       pool,
+                                       const std::string& key,
+                                       void*&             value,
+                                       size_t&            value_len)
+{
+  auto entry = _locations.find(std::make_pair(pool, key));
+  if (entry == _locations.end()) return false;
+
+  const auto location = entry->second;
+  const auto iob      = allocate();
+  const auto version_buffer = static_cast<char*>(iob->base()) + location.len;
+  assert(location.len + sizeof(uint64_t) <= iob->length()); /* see locate_value */
+
+  uint64_t version = 0;
+  try {
+    read_remote_value(iob->base(), location.len, iob->desc,
+                      Dawn::Protocol::Remote_target{location.addr, location.key});
+
+    /* the version word is read only after the value read has completed,
+       so an unchanged version means no write or erase began before the
+       value was read */
+    read_remote_value(version_buffer, sizeof(version), iob->desc,
+                      Dawn::Protocol::Remote_target{location.version_addr,
+                                                    location.version_key});
+    memcpy(&version, version_buffer, sizeof(version));
+  }
+  catch (...) {
+    /* the server may have deregistered the memory, e.g. when the pool
+       was closed or deleted; caller falls back to two-sided get */
+    PWRN("one-sided get: RDMA read failed (%s)", key.c_str());
+    _locations.erase(entry);
+    free_buffer(iob);
+    return false;
   }
-  else {
-    /* copy off value from IO buffer */
-    value     = ::malloc(response_msg->data_len + 1);
-    value_len = response_msg->data_len;
 
-    memcpy(value, response_msg->data, response_msg->data_len);
-    ((char*) value)[response_msg->data_len] = '\0';
+  if (version != location.version ||
+      Dawn::Protocol::value_checksum(iob->base(), location.len) !=
+          location.checksum) {
+    /* value has changed or been erased; caller falls back to two-sided
+       get */
+    if (option_DEBUG) PLOG("one-sided get: stale location (%s)", key.c_str());
+    _locations.erase(entry);
+    free_buffer(iob);
+    return false;
   }
 
+  value     = ::malloc(location.len + 1);
+  value_len = location.len;
+  memcpy(value, iob->base(), location.len);
+  ((char*) value)[location.len] = '\0';
+
   free_buffer(iob);
-  return msg->status;
+  return true;
+}
+
+void Connection_handler::locate_value(const pool_t pool, const std::string& key)
+{
+  if (_unlocatable.count(pool)) return;
+
+  const auto iob = allocate(sizeof(Dawn::Protocol::Message_IO_request) +
+                            key.length() + 1);
+  assert(iob);
+
+  const auto msg = new (iob->base()) Dawn::Protocol::Message_IO_request(
+      iob->length(), auth_id(), ++_request_id, pool, Dawn::Protocol::OP_LOCATE,
+      key.c_str(), key.length(), 0);
+
+  iob->set_length(msg->msg_len);
+  sync_inject_send(iob);
+
+  sync_recv(iob);
+
+  const auto response_msg =
+      new (iob->base()) Dawn::Protocol::Message_IO_response();
+  if (response_msg->type_id != Dawn::Protocol::MSG_TYPE_IO_RESPONSE)
+    throw Protocol_exception("expected IO_RESPONSE message - got %x",
+                             response_msg->type_id);
+
+  /* values that cannot be read into an IO buffer are not cached; nor
+     are values the server cannot locate (e.g. not in pool memory) */
+  if (response_msg->status == S_OK) {
+    Dawn::Protocol::Value_location location;
+    memcpy(&location, response_msg->data, sizeof(location));
+
+    if (location.len + sizeof(location.version) <=
+        Buffer_manager<Transport>::BUFFER_LEN) {
+      if (_locations.size() >= LOCATION_CACHE_SIZE)
+        _locations.erase(_locations.begin());
+      _locations[std::make_pair(pool, key)] = location;
+    }
+  }
+  else if (response_msg->status == IKVStore::E_NOT_SUPPORTED) {
+    /* pool memory is not pre-registered; stop asking */
+    _unlocatable.insert(pool);
+  }
+  else if (option_DEBUG) {
+    PLOG("locate failed: status=%d", response_msg->status);
+  }
+
+  free_buffer(iob);
+}
+
+status_t Connection_handler::scan(const pool_t                      pool,
+                                  const std::string&                expression,
+                                  const Component::IKVIndex::find_t find_type,
+                                  uint64_t&                         cursor,
+                                  const size_t                      max_keys,
+                                  std::vector<std::string>&         out_keys)
+{
+  API_LOCK();
+  drain_async();
+
+  Dawn::Protocol::Scan_request request;
+  request.cursor   = cursor;
+  request.max_keys = std::min(max_keys, size_t(UINT32_MAX));
+  request.filter   = find_type;
+
+  const auto iob = allocate();
+  assert(iob);
+
+  const auto msg = new (iob->base()) Dawn::Protocol::Message_IO_request(
+      iob->length(), auth_id(), ++_request_id, pool, Dawn::Protocol::OP_SCAN,
+      expression.c_str(), expression.length(), &request, sizeof(request));
+
+  iob->set_length(msg->msg_len);
+  sync_send(iob);
+
+  sync_recv(iob);
+
+  const auto response_msg =
+      new (iob->base()) Dawn::Protocol::Message_IO_response();
+  if (response_msg->type_id != Dawn::Protocol::MSG_TYPE_IO_RESPONSE)
+    throw Protocol_exception("expected IO_RESPONSE message - got %x",
+                             response_msg->type_id);
+
+  const status_t status = response_msg->status;
+  if (status == S_OK) {
+    const auto page =
+        reinterpret_cast<const Dawn::Protocol::Scan_page*>(response_msg->data);
+    const auto end = response_msg->data + response_msg->data_length();
+    auto       p   = page->data;
+    for (uint32_t i = 0; i < page->count; i++) {
+      uint32_t key_len;
+      if (p + sizeof(key_len) > end)
+        throw Protocol_exception("truncated scan page");
+      memcpy(&key_len, p, sizeof(key_len));
+      p += sizeof(key_len);
+      if (p + key_len > end) throw Protocol_exception("truncated scan page");
+      out_keys.emplace_back(p, key_len);
+      p += key_len;
+    }
+    cursor = page->cursor;
+
+    if (option_DEBUG)
+      PLOG("scan: %u keys (next cursor=0x%lx)", page->count, cursor);
+  }
+
+  free_buffer(iob);
+  return status;
 }
 
 status_t Connection_handler::get_direct(
@@ -418,6 +980,7 @@ status_t Connection_handler::get_direct(
     Component::IKVStore::memory_handle_t handle)
 {
   API_LOCK();
+  drain_async();
 
   if (!value || out_value_len == 0)
     throw API_exception("get_direct bad parameters");
@@ -449,47 +1012,832 @@ status_t Connection_handler::get_direct(
          response_msg->status, response_msg->request_id,
          response_msg->data_length());
 
-  if (msg->status != S_OK) return msg->status;
+  if (response_msg->status != S_OK) {
+    const status_t status = response_msg->status;
+    free_buffer(iob);
+    return status;
+  }
 
   if (option_DEBUG) PLOG("value:(%s)", response_msg->data);
 
   if (response_msg->is_set_twostage_bit()) {
-    /* two-stage get */
-    post_recv(value_iob);
+    /* two-stage get; read value directly from server memory */
+    const auto data_len = response_msg->data_length();
+    const auto target   = *response_msg->remote_target();
+    free_buffer(iob);
 
-    /* synchronously wait for receive to complete */
-    wait_for_completion(value_iob);
-  }
-  else {
-    /* copy off value from IO buffer */
-    if (out_value_len < response_msg->data_len) {
-      assert(0);
-      free_buffer(iob);
-      return E_INSUFFICIENT_SPACE;
+    status_t status = S_OK;
+    if (out_value_len < data_len) {
+      status = E_INSUFFICIENT_SPACE;
+    }
+    else {
+      read_remote_value(value, data_len, value_iob->desc, target);
+      out_value_len = data_len;
     }
 
-    out_value_len = response_msg->data_len;
+    const auto release_status = release_remote_value(pool, target.addr);
+    return status == S_OK ? release_status : status;
+  }
 
-    memcpy(value, response_msg->data, response_msg->data_len);
+  /* copy off value from IO buffer */
+  if (out_value_len < response_msg->data_len) {
+    free_buffer(iob);
+    return E_INSUFFICIENT_SPACE;
   }
 
+  out_value_len = response_msg->data_len;
+
+  memcpy(value, response_msg->data, response_msg->data_len);
+
   free_buffer(iob);
   return msg->status;
 }
 
-int Connection_handler::tick()
+status_t Connection_handler::batch(
+    const pool_t                             pool,
+    std::vector<Component::IDawn::Batch_op>& ops)
 {
-  using namespace Dawn::Protocol;
+  API_LOCK();
+  return send_batch(pool, ops);
+}
 
-  switch (_state) {
-    case INITIALIZE: {
-      set_state(HANDSHAKE_SEND);
-      break;
-    }
-    case HANDSHAKE_SEND: {
-      PMAJOR("client : HANDSHAKE_SEND");
-      auto iob = allocate();
-      auto msg = new (iob->base()) Dawn::Protocol::Message_handshake(0, 1);
+status_t Connection_handler::multi_batch(
+    const std::vector<Connection_handler*>&               connections,
+    const std::vector<pool_t>&                            pools,
+    std::vector<std::vector<Component::IDawn::Batch_op>>& ops)
+{
+#ifdef THREAD_SAFE_CLIENT
+  /* always taken in the caller's (shard) order */
+  std::vector<std::unique_lock<std::mutex>> locks;
+  for (auto c : connections) locks.emplace_back(c->_api_lock);
+#endif
+
+  std::vector<Batch> batches;
+  for (size_t i = 0; i < connections.size(); i++) {
+    connections[i]->begin_batch(pools[i], ops[i]);
+    batches.push_back(Batch{pools[i], &ops[i]});
+  }
+
+  /* a request outstanding on every connection, then gather responses */
+  for (bool posted = true; posted;) {
+    posted = false;
+    for (size_t i = 0; i < connections.size(); i++)
+      posted |= connections[i]->post_batch(batches[i]);
+
+    for (size_t i = 0; i < connections.size(); i++)
+      if (batches[i].response) connections[i]->complete_batch(batches[i]);
+  }
+
+  return S_OK;
+}
+
+status_t Connection_handler::send_batch(
+    const pool_t                             pool,
+    std::vector<Component::IDawn::Batch_op>& ops)
+{
+  begin_batch(pool, ops);
+
+  Batch batch{pool, &ops};
+  while (post_batch(batch)) complete_batch(batch);
+
+  return S_OK;
+}
+
+void Connection_handler::begin_batch(
+    const pool_t                                   pool,
+    const std::vector<Component::IDawn::Batch_op>& ops)
+{
+  drain_async();
+
+  for (auto& op : ops)
+    if (op.type == Component::IDawn::Batch_op_type::PUT)
+      forget_location(pool, op.key);
+}
+
+bool Connection_handler::post_batch(Batch& batch)
+{
+  using namespace Dawn::Protocol;
+  using Batch_op_type = Component::IDawn::Batch_op_type;
+
+  auto& ops = *batch.ops;
+  while (batch.next < ops.size()) {
+    const auto iob = allocate();
+    assert(iob);
+
+    const auto request_id = ++_request_id;
+    const auto msg        = new (iob->base()) Message_IO_batch_request(
+        iob->length(), auth_id(), request_id, batch.pool);
+
+    if (_options.short_circuit_backend) msg->resvd |= MSG_RESVD_SCBE;
+
+    /* pack as many elements as will fit */
+    size_t end = batch.next;
+    for (; end < ops.size(); end++) {
+      auto& op = ops[end];
+      bool  added;
+      if (op.type == Batch_op_type::PUT)
+        added = msg->add_element(iob->length(), OP_PUT, op.key.c_str(),
+                                 op.key.length(), op.value.c_str(),
+                                 op.value.length());
+      else
+        added = msg->add_element(iob->length(), OP_GET, op.key.c_str(),
+                                 op.key.length());
+      if (!added) break;
+    }
+
+    if (end == batch.next) { /* single element is larger than a message */
+      ops[batch.next].status = IKVStore::E_TOO_LARGE;
+      batch.next++;
+      free_buffer(iob);
+      continue;
+    }
+
+    if (option_DEBUG)
+      PLOG("batch: sending elements %lu-%lu (msg_len=%u)", batch.next,
+           end - 1, msg->msg_len);
+
+    /* post receive for the response before sending the request */
+    batch.response = allocate();
+    post_recv(batch.response);
+
+    iob->set_length(msg->msg_len);
+    sync_send(iob);
+    free_buffer(iob);
+
+    batch.end        = end;
+    batch.request_id = request_id;
+    return true;
+  }
+  return false;
+}
+
+void Connection_handler::complete_batch(Batch& batch)
+{
+  using namespace Dawn::Protocol;
+  using Batch_op_type = Component::IDawn::Batch_op_type;
+
+  const auto iob = batch.response;
+  wait_for_completion(iob);
+  return_credits(iob);
+
+  const auto response_msg =
+      new (iob->base()) Dawn::Protocol::Message_IO_batch_response();
+  if (response_msg->type_id != MSG_TYPE_IO_BATCH_RESPONSE)
+    throw Protocol_exception("expected IO_BATCH_RESPONSE message - got %x",
+                             response_msg->type_id);
+
+  if (response_msg->request_id != batch.request_id)
+    throw Protocol_exception(
+        "batch response for request %lu, expected request %lu",
+        response_msg->request_id, batch.request_id);
+
+  if (response_msg->count == 0 ||
+      response_msg->count > (batch.end - batch.next))
+    throw Protocol_exception("unexpected batch response count (%lu)",
+                             response_msg->count);
+
+  /* unpack results; any elements not executed are re-issued */
+  auto element = response_msg->first_element();
+  for (uint64_t i = 0; i < response_msg->count;
+       i++, element = response_msg->next_element(element)) {
+    auto& op  = (*batch.ops)[batch.next + i];
+    op.status = element->status;
+    if (op.type == Batch_op_type::GET && element->status == S_OK)
+      op.value.assign(element->data, element->val_len);
+  }
+  batch.next += response_msg->count;
+
+  free_buffer(iob);
+  batch.response = nullptr;
+}
+
+status_t Connection_handler::erase(const pool_t pool, const std::string& key)
+{
+  API_LOCK();
+  drain_async();
+
+  forget_location(pool, key);
+
+  const auto iob = allocate();
+  assert(iob);
+
+  const auto msg = new (iob->base()) Dawn::Protocol::Message_IO_request(
+      iob->length(), auth_id(), ++_request_id, pool, Dawn::Protocol::OP_ERASE,
+      key.c_str(), key.length(), 0);
+
+  if (_options.short_circuit_backend)
+    msg->resvd |= Dawn::Protocol::MSG_RESVD_SCBE;
+
+  iob->set_length(msg->msg_len);
+  sync_inject_send(iob);
+
+  sync_recv(iob);
+
+  const auto response_msg =
+      new (iob->base()) Dawn::Protocol::Message_IO_response();
+  if (response_msg->type_id != Dawn::Protocol::MSG_TYPE_IO_RESPONSE)
+    throw Protocol_exception("expected IO_RESPONSE message - got %x",
+                             response_msg->type_id);
+
+  const status_t status = response_msg->status;
+  free_buffer(iob);
+  return status;
+}
+
+status_t Connection_handler::atomic_update(
+    const pool_t                                        pool,
+    const std::string&                                  key,
+    const std::vector<Component::IKVStore::Operation*>& op_vector)
+{
+  using namespace Dawn::Protocol;
+  using IKVStore = Component::IKVStore;
+
+  API_LOCK();
+  drain_async();
+
+  forget_location(pool, key);
+
+  const auto iob = allocate();
+  assert(iob);
+
+  const auto msg = new (iob->base()) Message_IO_request(
+      iob->length(), auth_id(), ++_request_id, pool, OP_ATOMIC_UPDATE,
+      key.c_str(), key.length(), 0);
+
+  /* encode operation vector into the value area */
+  const size_t value_offset = sizeof(Message_IO_request) + key.length() + 1;
+  size_t       val_len      = 0;
+
+  for (auto op : op_vector) {
+    uint8_t code;
+    size_t  len;
+    switch (op->type()) {
+      case IKVStore::Op_type::WRITE:
+        code = ATOMIC_OP_WRITE;
+        len  = static_cast<IKVStore::Operation_write*>(op)->size();
+        break;
+      case IKVStore::Op_type::ZERO:
+        code = ATOMIC_OP_ZERO;
+        len  = static_cast<IKVStore::Operation_zero*>(op)->size();
+        break;
+      case IKVStore::Op_type::INCREMENT_UINT64:
+        code = ATOMIC_OP_INCREMENT_UINT64;
+        len  = sizeof(uint64_t);
+        break;
+      case IKVStore::Op_type::CAS_UINT64:
+        code = ATOMIC_OP_CAS_UINT64;
+        len  = sizeof(uint64_t);
+        break;
+      default:
+        free_buffer(iob);
+        return IKVStore::E_NOT_SUPPORTED;
+    }
+
+    Atomic_update_element header = {code, {0}, op->offset(), len};
+    if (value_offset + val_len + header.size() > iob->length()) {
+      free_buffer(iob);
+      return IKVStore::E_TOO_LARGE;
+    }
+
+    auto e = reinterpret_cast<Atomic_update_element*>(
+        static_cast<char*>(iob->base()) + value_offset + val_len);
+    memset(e, 0, header.size());
+    memcpy(e, &header, sizeof(header));
+
+    switch (op->type()) {
+      case IKVStore::Op_type::WRITE:
+        memcpy(e->data, static_cast<IKVStore::Operation_write*>(op)->data(),
+               len);
+        break;
+      case IKVStore::Op_type::INCREMENT_UINT64: {
+        const uint64_t addend =
+            static_cast<IKVStore::Operation_increment_uint64*>(op)->addend();
+        memcpy(e->data, &addend, sizeof(addend));
+        break;
+      }
+      case IKVStore::Op_type::CAS_UINT64: {
+        auto           cas = static_cast<IKVStore::Operation_cas_uint64*>(op);
+        const uint64_t operand[2] = {cas->expected(), cas->desired()};
+        memcpy(e->data, operand, sizeof(operand));
+        break;
+      }
+      default:
+        break;
+    }
+    val_len += header.size();
+  }
+
+  msg->val_len = val_len;
+  msg->msg_len = value_offset + val_len;
+
+  if (_options.short_circuit_backend) msg->resvd |= MSG_RESVD_SCBE;
+
+  iob->set_length(msg->msg_len);
+  sync_inject_send(iob);
+
+  sync_recv(iob);
+
+  const auto response_msg = new (iob->base()) Message_IO_response();
+  if (response_msg->type_id != MSG_TYPE_IO_RESPONSE)
+    throw Protocol_exception("expected IO_RESPONSE message - got %x",
+                             response_msg->type_id);
+
+  const status_t status = response_msg->status;
+
+  /* prior values of increment and compare-and-swap operations */
+  if (status == S_OK && !_options.short_circuit_backend) {
+    std::vector<uint64_t> results(response_msg->data_length() /
+                                  sizeof(uint64_t));
+    memcpy(results.data(), response_msg->data,
+           results.size() * sizeof(uint64_t));
+
+    bool   swapped = true;
+    size_t i       = 0;
+    for (auto op : op_vector) {
+      if (op->type() == IKVStore::Op_type::CAS_UINT64 &&
+          (i >= results.size() ||
+           results[i] !=
+               static_cast<IKVStore::Operation_cas_uint64*>(op)->expected()))
+        swapped = false;
+      if (op->type() == IKVStore::Op_type::INCREMENT_UINT64 ||
+          op->type() == IKVStore::Op_type::CAS_UINT64)
+        i++;
+    }
+
+    i = 0;
+    for (auto op : op_vector) {
+      if (i >= results.size()) break;
+      if (op->type() == IKVStore::Op_type::INCREMENT_UINT64)
+        static_cast<IKVStore::Operation_increment_uint64*>(op)->set_result(
+            results[i++]);
+      else if (op->type() == IKVStore::Op_type::CAS_UINT64)
+        static_cast<IKVStore::Operation_cas_uint64*>(op)->set_result(
+            results[i++], swapped);
+    }
+  }
+
+  free_buffer(iob);
+  return status;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// ASYNCHRONOUS OPERATIONS
+//
+// Each asynchronous request has a receive posted for its response before
+// the request is sent.  The server responds in request order but
+// responses are matched on request id, so no ordering is assumed here.
+
+status_t Connection_handler::async_put(
+    const pool_t                      pool,
+    const std::string&                key,
+    const void*                       value,
+    const size_t                      value_len,
+    Component::IDawn::async_handle_t& out_handle)
+{
+  API_LOCK();
+  flush_staged(); /* ordered after staged PUTs */
+
+  forget_location(pool, key);
+
+  const auto iob        = allocate();
+  const auto request_id = ++_request_id;
+  const auto msg        = new (iob->base()) Dawn::Protocol::Message_IO_request(
+      iob->length(), auth_id(), request_id, pool, Dawn::Protocol::OP_PUT,
+      key.c_str(), key.length(), value, value_len);
+
+  if (_options.short_circuit_backend)
+    msg->resvd |= Dawn::Protocol::MSG_RESVD_SCBE;
+
+  iob->set_length(msg->msg_len);
+
+  out_handle = post_async(iob, pool, request_id, Dawn::Protocol::OP_PUT);
+  return S_OK;
+}
+
+status_t Connection_handler::async_get(
+    const pool_t                      pool,
+    const std::string&                key,
+    void*&                            out_value,
+    size_t&                           out_value_len,
+    Component::IDawn::async_handle_t& out_handle)
+{
+  API_LOCK();
+  flush_staged(); /* ordered after staged PUTs */
+
+  const auto iob        = allocate();
+  const auto request_id = ++_request_id;
+  const auto msg        = new (iob->base()) Dawn::Protocol::Message_IO_request(
+      iob->length(), auth_id(), request_id, pool, Dawn::Protocol::OP_GET,
+      key.c_str(), key.length(), 0);
+
+  if (_options.short_circuit_backend)
+    msg->resvd |= Dawn::Protocol::MSG_RESVD_SCBE;
+
+  iob->set_length(msg->msg_len);
+
+  auto aop = post_async(iob, pool, request_id, Dawn::Protocol::OP_GET);
+  aop->out_value     = &out_value;
+  aop->out_value_len = &out_value_len;
+
+  out_handle = aop;
+  return S_OK;
+}
+
+status_t Connection_handler::async_put_direct(
+    const pool_t                         pool,
+    const std::string&                   key,
+    const void*                          value,
+    const size_t                         value_len,
+    Component::IKVStore::memory_handle_t handle,
+    Component::IDawn::async_handle_t&    out_handle)
+{
+  API_LOCK();
+  flush_staged(); /* ordered after staged PUTs */
+
+  auto value_buffer = reinterpret_cast<buffer_t*>(handle);
+  if (handle == IKVStore::HANDLE_NONE || !value_buffer->check_magic())
+    throw API_exception("async_put_direct: memory handle is invalid");
+
+  forget_location(pool, key);
+
+  const auto key_len = key.length();
+  if ((key_len + value_len + sizeof(Dawn::Protocol::Message_IO_request)) >
+      Buffer_manager<Component::IFabric_client>::BUFFER_LEN) {
+    /* large values are written to server memory in segments, which is
+       not overlapped with the caller; the handle is already complete */
+    auto aop      = new Async_op();
+    aop->pool     = pool;
+    aop->op       = Dawn::Protocol::OP_PUT;
+    aop->status   = two_stage_put(pool, key.c_str(), key_len, value, value_len,
+                                value_buffer->desc);
+    aop->complete = true;
+    out_handle    = aop;
+    return S_OK;
+  }
+
+  const auto iob        = allocate();
+  const auto request_id = ++_request_id;
+  const auto msg        = new (iob->base()) Dawn::Protocol::Message_IO_request(
+      iob->length(), auth_id(), request_id, pool, Dawn::Protocol::OP_PUT,
+      key.c_str(), key_len, value_len);
+
+  if (_options.short_circuit_backend)
+    msg->resvd |= Dawn::Protocol::MSG_RESVD_SCBE;
+
+  iob->set_length(msg->msg_len);
+
+  /* value is sent straight from the application's registered memory */
+  const ::iovec value_iov{const_cast<void*>(value), value_len};
+  out_handle = post_async(iob, pool, request_id, Dawn::Protocol::OP_PUT, false,
+                          &value_iov, value_buffer->desc);
+  return S_OK;
+}
+
+status_t Connection_handler::async_get_direct(
+    const pool_t                         pool,
+    const std::string&                   key,
+    void*                                out_value,
+    size_t&                              out_value_len,
+    Component::IKVStore::memory_handle_t handle,
+    Component::IDawn::async_handle_t&    out_handle)
+{
+  API_LOCK();
+  flush_staged(); /* ordered after staged PUTs */
+
+  auto value_buffer = reinterpret_cast<buffer_t*>(handle);
+  if (handle == IKVStore::HANDLE_NONE || !value_buffer->check_magic())
+    throw API_exception("async_get_direct: memory handle is invalid");
+
+  if (!out_value || out_value_len == 0)
+    throw API_exception("async_get_direct: bad parameters");
+
+  const auto iob        = allocate();
+  const auto request_id = ++_request_id;
+  const auto msg        = new (iob->base()) Dawn::Protocol::Message_IO_request(
+      iob->length(), auth_id(), request_id, pool, Dawn::Protocol::OP_GET,
+      key.c_str(), key.length(), 0);
+
+  if (_options.short_circuit_backend)
+    msg->resvd |= Dawn::Protocol::MSG_RESVD_SCBE;
+
+  iob->set_length(msg->msg_len);
+
+  auto aop = post_async(iob, pool, request_id, Dawn::Protocol::OP_GET);
+  aop->out_value_len = &out_value_len;
+  aop->direct_value  = out_value;
+  aop->direct_desc   = value_buffer->desc;
+
+  out_handle = aop;
+  return S_OK;
+}
+
+status_t Connection_handler::async_erase(
+    const pool_t                      pool,
+    const std::string&                key,
+    Component::IDawn::async_handle_t& out_handle)
+{
+  API_LOCK();
+  flush_staged(); /* ordered after staged PUTs */
+
+  forget_location(pool, key);
+
+  const auto iob        = allocate();
+  const auto request_id = ++_request_id;
+  const auto msg        = new (iob->base()) Dawn::Protocol::Message_IO_request(
+      iob->length(), auth_id(), request_id, pool, Dawn::Protocol::OP_ERASE,
+      key.c_str(), key.length(), 0);
+
+  if (_options.short_circuit_backend)
+    msg->resvd |= Dawn::Protocol::MSG_RESVD_SCBE;
+
+  iob->set_length(msg->msg_len);
+
+  out_handle = post_async(iob, pool, request_id, Dawn::Protocol::OP_ERASE);
+  return S_OK;
+}
+
+bool Connection_handler::async_poll(Component::IDawn::async_handle_t& handle,
+                                    status_t& out_status)
+{
+  API_LOCK();
+
+  auto aop = Async_op::from_handle(handle);
+  if (aop == nullptr) throw API_exception("async_poll: invalid handle");
+
+  if (!aop->complete) progress_async();
+  if (!aop->complete) return false;
+
+  out_status = aop->status;
+  delete aop;
+  handle = IDawn::ASYNC_HANDLE_INIT;
+  return true;
+}
+
+status_t Connection_handler::async_wait(
+    Component::IDawn::async_handle_t& handle)
+{
+  API_LOCK();
+
+  auto aop = Async_op::from_handle(handle);
+  if (aop == nullptr) throw API_exception("async_wait: invalid handle");
+
+  while (!aop->complete) progress_async();
+
+  const status_t status = aop->status;
+  delete aop;
+  handle = IDawn::ASYNC_HANDLE_INIT;
+  return status;
+}
+
+Connection_handler::Async_op* Connection_handler::post_async(
+    buffer_t*      iob,
+    const pool_t   pool,
+    const uint64_t request_id,
+    const int      op,
+    const bool     internal,
+    const ::iovec* value,
+    void*          value_desc)
+{
+  /* wait for a flow-control credit */
+  while (_credits == 0) {
+    if (_inflight.empty())
+      throw Program_exception("no flow-control credit for request");
+    progress_async();
+  }
+  consume_credit();
+
+  /* post receive for the response before sending the request */
+  const auto response_iob = allocate();
+  post_recv(response_iob);
+  _async_recvs.push_back(response_iob);
+
+  if (value) {
+    /* request followed by value from registered memory */
+    const ::iovec v[2]    = {*iob->iov, *value};
+    void*         desc[2] = {iob->desc, value_desc};
+    _async_sends.push_back(iob);
+    post_send(&v[0], &v[2], desc, iob);
+  }
+  else if (iob->length() <= _max_inject_size) {
+    _transport->inject_send(iob->base(), iob->length());
+    free_buffer(iob);
+  }
+  else {
+    _async_sends.push_back(iob);
+    post_send(iob->iov, iob->iov + 1, &iob->desc, iob);
+  }
+
+  auto aop        = new Async_op();
+  aop->request_id = request_id;
+  aop->pool       = pool;
+  aop->op         = op;
+  aop->internal   = internal;
+
+  _inflight[request_id] = aop;
+
+  if (option_DEBUG)
+    PLOG("post_async: request_id=%lu op=%d (inflight=%lu)", request_id, op,
+         _inflight.size());
+
+  return aop;
+}
+
+IFabric_op_completer::cb_acceptance
+Connection_handler::async_completion_callback(void*         context,
+                                              status_t      st,
+                                              std::uint64_t completion_flags,
+                                              std::size_t   len,
+                                              void*         error_data,
+                                              void*         param)
+{
+  auto pThis = static_cast<Connection_handler*>(param);
+
+  if (unlikely(st != S_OK))
+    throw Program_exception(
+        "poll_completions failed unexpectedly (st=%d) (cf=%lx)", st,
+        completion_flags);
+
+  auto& recvs = pThis->_async_recvs;
+  auto  r     = std::find(recvs.begin(), recvs.end(), context);
+  if (r != recvs.end()) {
+    recvs.erase(r);
+    pThis->_completed_recvs.push_back(static_cast<buffer_t*>(context));
+    return IFabric_op_completer::cb_acceptance::ACCEPT;
+  }
+
+  auto& sends = pThis->_async_sends;
+  auto  s     = std::find(sends.begin(), sends.end(), context);
+  if (s != sends.end()) {
+    sends.erase(s);
+    pThis->free_buffer(static_cast<buffer_t*>(context));
+    return IFabric_op_completer::cb_acceptance::ACCEPT;
+  }
+
+  auto& reads = pThis->_async_reads;
+  auto  d     = std::find(reads.begin(), reads.end(), context);
+  if (d != reads.end()) {
+    reads.erase(d);
+    pThis->_completed_reads.push_back(static_cast<Async_op*>(context));
+    return IFabric_op_completer::cb_acceptance::ACCEPT;
+  }
+
+  return IFabric_op_completer::cb_acceptance::DEFER;
+}
+
+void Connection_handler::progress_async()
+{
+  _transport->poll_completions_tentative(async_completion_callback, this);
+
+  /* completion handling may issue new requests, which can recurse
+     back into here; work on local copies */
+  std::vector<buffer_t*> recvs;
+  recvs.swap(_completed_recvs);
+  for (auto iob : recvs) {
+    complete_async_response(iob);
+    free_buffer(iob);
+  }
+
+  std::vector<Async_op*> reads;
+  reads.swap(_completed_reads);
+  for (auto aop : reads) complete_async_read(aop);
+}
+
+void Connection_handler::complete_async_response(buffer_t* iob)
+{
+  using namespace Dawn::Protocol;
+
+  const auto response_msg = new (iob->base()) Message_IO_response();
+  if (response_msg->type_id != MSG_TYPE_IO_RESPONSE)
+    throw Protocol_exception("expected IO_RESPONSE message - got %x",
+                             response_msg->type_id);
+
+  return_credits(iob);
+
+  auto i = _inflight.find(response_msg->request_id);
+  if (i == _inflight.end())
+    throw Protocol_exception("unexpected response (request_id=%lu)",
+                             response_msg->request_id);
+
+  auto aop = i->second;
+  _inflight.erase(i);
+
+  if (option_DEBUG)
+    PLOG("async response: request_id=%lu status=%d", aop->request_id,
+         response_msg->status);
+
+  if (aop->internal) {
+    if (response_msg->status != S_OK)
+      PWRN("async release failed (request_id=%lu)", aop->request_id);
+    delete aop;
+    return;
+  }
+
+  aop->status = response_msg->status;
+
+  if (aop->op == OP_GET && aop->status == S_OK) {
+    const auto data_len = response_msg->data_length();
+
+    if (response_msg->is_set_twostage_bit()) {
+      /* read value from server memory; completes in complete_async_read */
+      const auto target = *response_msg->remote_target();
+
+      if (aop->direct_value) {
+        if (*aop->out_value_len < data_len) {
+          aop->status   = E_INSUFFICIENT_SPACE;
+          aop->complete = true;
+          post_async_release(aop->pool, target.addr);
+          return;
+        }
+        aop->value = aop->direct_value;
+        aop->desc  = aop->direct_desc;
+      }
+      else {
+        aop->value = ::aligned_alloc(MiB(2), data_len + 1);
+        madvise(aop->value, data_len + 1, MADV_HUGEPAGE);
+        aop->region = register_memory(aop->value, data_len + 1);
+        aop->desc   = get_memory_descriptor(aop->region);
+      }
+      aop->value_len   = data_len;
+      aop->iov         = {aop->value, data_len};
+      aop->remote_addr = target.addr;
+
+      _inflight[aop->request_id] = aop;
+      _async_reads.push_back(aop);
+      post_read(&aop->iov, (&aop->iov) + 1, &aop->desc, target.addr,
+                target.key, aop);
+      return;
+    }
+
+    if (aop->direct_value) {
+      if (*aop->out_value_len < data_len) {
+        aop->status = E_INSUFFICIENT_SPACE;
+      }
+      else {
+        memcpy(aop->direct_value, response_msg->data, data_len);
+        *aop->out_value_len = data_len;
+      }
+      aop->complete = true;
+      return;
+    }
+
+    auto value = ::malloc(data_len + 1);
+    memcpy(value, response_msg->data, data_len);
+    ((char*) value)[data_len] = '\0';
+
+    *aop->out_value     = value;
+    *aop->out_value_len = data_len;
+  }
+
+  aop->complete = true;
+}
+
+void Connection_handler::complete_async_read(Async_op* aop)
+{
+  using namespace Dawn::Protocol;
+
+  if (aop->direct_value == nullptr) {
+    deregister_memory(aop->region);
+    ((char*) aop->value)[aop->value_len] = '\0';
+    *aop->out_value = aop->value;
+  }
+  *aop->out_value_len = aop->value_len;
+
+  _inflight.erase(aop->request_id);
+
+  /* release the value lock on the server */
+  post_async_release(aop->pool, aop->remote_addr);
+
+  aop->complete = true;
+}
+
+void Connection_handler::post_async_release(const pool_t pool, uint64_t target)
+{
+  using namespace Dawn::Protocol;
+
+  const auto iob        = allocate();
+  const auto request_id = ++_request_id;
+  const auto msg        = new (iob->base()) Message_IO_request(
+      iob->length(), auth_id(), request_id, pool, OP_RELEASE, "", 0, &target,
+      sizeof(target));
+  iob->set_length(msg->msg_len);
+  post_async(iob, pool, request_id, OP_RELEASE, true);
+}
+
+int Connection_handler::tick()
+{
+  using namespace Dawn::Protocol;
+
+  switch (_state) {
+    case INITIALIZE: {
+      set_state(HANDSHAKE_SEND);
+      break;
+    }
+    case HANDSHAKE_SEND: {
+      PMAJOR("client : HANDSHAKE_SEND");
+      auto iob = allocate();
+      auto msg = new (iob->base())
+          Dawn::Protocol::Message_handshake(_options.auth_id, 1,
+                                            _options.queue_depth);
 
       iob->set_length(msg->msg_len);
       post_send(iob->iov, iob->iov + 1, &iob->desc, iob);
@@ -513,10 +1861,18 @@ int Connection_handler::tick()
         throw Protocol_exception(
             "client: expecting handshake reply got type_id=%u len=%lu",
             msg->type_id, msg->msg_len);
+      if (msg->version != PROTOCOL_VERSION)
+        throw Protocol_exception(
+            "client: protocol version mismatch (client=%x server=%x)",
+            PROTOCOL_VERSION, msg->version);
 
-      PMAJOR("client : HANDSHAKE_GET_RESPONSE (max_message_size=%lu MiB)",
-             REDUCE_MiB(msg->max_message_size));
+      PMAJOR("client : HANDSHAKE_GET_RESPONSE (max_message_size=%lu MiB) "
+             "(credits=%u)",
+             REDUCE_MiB(msg->max_message_size), msg->credits);
       _max_message_size = msg->max_message_size;
+      _credits          = msg->credits;
+      if (_credits == 0)
+        throw Protocol_exception("client: handshake granted no credits");
       free_buffer(iob);
       break;
     }
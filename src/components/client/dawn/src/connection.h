@@ -1,14 +1,18 @@
 #ifndef __DAWN_CLIENT_HANDLER_H__
 #define __DAWN_CLIENT_HANDLER_H__
 
+#include <api/dawn_itf.h>
 #include <api/fabric_itf.h>
 #include <common/exceptions.h>
 #include <common/utils.h>
 #include <sys/mman.h>
 #include <sys/uio.h>
 #include <unistd.h>
+#include <chrono>
+#include <deque>
 #include <map>
 #include <set>
+#include <vector>
 
 #include "buffer_manager.h"
 #include "dawn_client_config.h"
@@ -55,6 +59,45 @@ class Connection_handler : public Connection_base {
 
   ~Connection_handler() { PLOG("Connection_handler::dtor (%p)", this); }
 
+  /**
+   * Outstanding asynchronous operation; handed out to the application
+   * as an IDawn::async_handle_t
+   */
+  struct Async_op : public Component::IDawn::Opaque_async_handle {
+    uint64_t request_id;
+    uint64_t pool;
+    int      op;
+    void**   out_value     = nullptr; /*< async_get only */
+    size_t*  out_value_len = nullptr;
+    status_t status        = E_FAIL;
+    bool     complete      = false;
+    bool     internal      = false; /*< no application handle (OP_RELEASE) */
+
+    /* two-stage get; value is read from server memory with RDMA */
+    void*           value     = nullptr;
+    size_t          value_len = 0;
+    memory_region_t region    = nullptr;
+    ::iovec         iov;
+    void*           desc;
+    uint64_t        remote_addr = 0;
+
+    /* async_get_direct; value lands in application registered memory */
+    void* direct_value = nullptr;
+    void* direct_desc  = nullptr;
+
+    /**
+     * Get the operation behind an application handle
+     *
+     * @param handle Handle from one of the async_ calls
+     *
+     * @return Operation, or nullptr for a null handle
+     */
+    static Async_op* from_handle(Component::IDawn::async_handle_t handle)
+    {
+      return static_cast<Async_op*>(handle);
+    }
+  };
+
  private:
   enum State {
     INITIALIZE,
@@ -81,6 +124,7 @@ class Connection_handler : public Connection_base {
 
   void shutdown()
   {
+    drain_async();
     set_state(SHUTDOWN);
     while (tick() > 0) sleep(1);
   }
@@ -118,10 +162,34 @@ class Connection_handler : public Connection_base {
 
   status_t get(const pool_t pool, const std::string& key, std::string& value);
 
+  /**
+   * Read lease on a value, for the client read cache
+   *
+   */
+  struct Lease {
+    uint64_t version      = 0; /*< in: cached version (0 for none) */
+    uint32_t lease_ms     = 0; /*< out: validity of the value */
+    bool     not_modified = false; /*< out: cached version is current */
+  };
+
+  /**
+   * Get value
+   *
+   * @param pool Pool identifier
+   * @param key Key
+   * @param value [out] Value (release with free()); nullptr if the lease
+   * reports that the cached version is current
+   * @param value_len [out] Value length
+   * @param lease [in/out] If set, request a lease on the value and
+   * revalidate the version given
+   *
+   * @return S_OK or error code
+   */
   status_t get(const pool_t       pool,
                const std::string& key,
                void*&             value,
-               size_t&            value_len);
+               size_t&            value_len,
+               Lease*             lease = nullptr);
 
   status_t get_direct(const pool_t                         pool,
                       const std::string&                   key,
@@ -130,6 +198,108 @@ class Connection_handler : public Connection_base {
                       Component::IKVStore::memory_handle_t handle =
                           Component::IKVStore::HANDLE_NONE);
 
+  /**
+   * Send staged (write-combined) PUTs and collect the failures of those
+   * sent since the last flush
+   *
+   * @param pool Pool identifier
+   * @param out_errors [out] Key and status of failed PUTs (appended)
+   *
+   * @return S_OK, or E_FAIL if any PUT failed
+   */
+  status_t flush(const pool_t                                   pool,
+                 std::vector<std::pair<std::string, status_t>>& out_errors);
+
+  /**
+   * Send staged PUTs once the oldest has waited for the combining
+   * period; called periodically
+   *
+   */
+  void flush_expired();
+
+  /**
+   * Get write-combining period
+   *
+   * @return Period, zero if write-combining is disabled
+   */
+  std::chrono::microseconds combine_period() const
+  {
+    return std::chrono::microseconds(_options.combine_usec);
+  }
+
+  /**
+   * Get a page of keys from the shard (see IDawn::scan)
+   *
+   */
+  status_t scan(const pool_t                      pool,
+                const std::string&                expression,
+                const Component::IKVIndex::find_t find_type,
+                uint64_t&                         cursor,
+                const size_t                      max_keys,
+                std::vector<std::string>&         out_keys);
+
+  status_t batch(const pool_t                             pool,
+                 std::vector<Component::IDawn::Batch_op>& ops);
+
+  /**
+   * Execute batches on several connections concurrently: a request is
+   * sent on every connection before any response is waited for
+   *
+   * @param connections Connections (distinct; locked in this order)
+   * @param pools Pool identifier for each connection
+   * @param ops Batch elements for each connection
+   *
+   * @return S_OK; element status is set in each element
+   */
+  static status_t multi_batch(
+      const std::vector<Connection_handler*>&               connections,
+      const std::vector<pool_t>&                            pools,
+      std::vector<std::vector<Component::IDawn::Batch_op>>& ops);
+
+  status_t erase(const pool_t pool, const std::string& key);
+
+  status_t atomic_update(
+      const pool_t                                        pool,
+      const std::string&                                  key,
+      const std::vector<Component::IKVStore::Operation*>& op_vector);
+
+  status_t async_put(const pool_t                      pool,
+                     const std::string&                key,
+                     const void*                       value,
+                     const size_t                      value_len,
+                     Component::IDawn::async_handle_t& out_handle);
+
+  status_t async_get(const pool_t                      pool,
+                     const std::string&                key,
+                     void*&                            out_value,
+                     size_t&                           out_value_len,
+                     Component::IDawn::async_handle_t& out_handle);
+
+  status_t async_put_direct(const pool_t                         pool,
+                            const std::string&                   key,
+                            const void*                          value,
+                            const size_t                         value_len,
+                            Component::IKVStore::memory_handle_t handle,
+                            Component::IDawn::async_handle_t&    out_handle);
+
+  status_t async_get_direct(const pool_t                         pool,
+                            const std::string&                   key,
+                            void*                                out_value,
+                            size_t&                              out_value_len,
+                            Component::IKVStore::memory_handle_t handle,
+                            Component::IDawn::async_handle_t&    out_handle);
+
+  status_t async_erase(const pool_t                      pool,
+                       const std::string&                key,
+                       Component::IDawn::async_handle_t& out_handle);
+
+  bool async_poll(Component::IDawn::async_handle_t& handle,
+                  status_t&                         out_status);
+
+  status_t async_wait(Component::IDawn::async_handle_t& handle);
+
+  status_t get_statistics(std::string& out_stats);
+
   uint64_t key_hash(const void* key, const size_t key_len);
 
   uint64_t auth_id() const { return ((uint64_t) this); }
@@ -161,15 +331,100 @@ class Connection_handler : public Connection_base {
    * @param key_len Key length
    * @param value Value
    * @param value_len Value length
+   * @param desc Memory descriptor for value, or nullptr to copy the
+   * value through IO buffers
    *
    * @return
    */
-  status_t two_stage_put_direct(const pool_t                         pool,
-                                const void*                          key,
-                                const size_t                         key_len,
-                                const void*                          value,
-                                const size_t                         value_len,
-                                Component::IKVStore::memory_handle_t handle);
+  status_t two_stage_put(const pool_t pool,
+                         const void*  key,
+                         const size_t key_len,
+                         const void*  value,
+                         const size_t value_len,
+                         void*        desc);
+
+  /**
+   * Stream a value into locked server memory.  The value is written in
+   * segments with up to the stream window of RDMA writes in flight; each
+   * segment is announced with OP_PUT_SEGMENT as it lands, so that the
+   * server persists it while later segments are still in transfer.
+   *
+   * @param pool Pool identifier
+   * @param value Value
+   * @param value_len Length of value in bytes
+   * @param desc Memory descriptor for value, or nullptr to copy the
+   * value through IO buffers
+   * @param target Location of value on the server
+   *
+   * @return S_OK or first segment error from server
+   */
+  status_t write_remote_value(const pool_t                         pool,
+                              const void*                          value,
+                              size_t                               value_len,
+                              void*                                desc,
+                              const Dawn::Protocol::Remote_target& target);
+
+  /**
+   * Read a two-stage value from server memory.  The value is read in
+   * segments with up to the stream window of RDMA reads in flight.
+   *
+   * @param value Local memory to read into
+   * @param value_len Length of value in bytes
+   * @param desc Memory descriptor for local memory, or nullptr to read
+   * through IO buffers
+   * @param target Location of value on the server
+   */
+  void read_remote_value(void*                                value,
+                         size_t                               value_len,
+                         void*                                desc,
+                         const Dawn::Protocol::Remote_target& target);
+
+  /**
+   * Release a value locked by a two-stage operation
+   *
+   * @param pool Pool identifier
+   * @param addr Remote address of the value
+   *
+   * @return Status from server
+   */
+  status_t release_remote_value(const pool_t pool, uint64_t addr);
+
+  /**
+   * Get a value with a one-sided RDMA read from a cached location
+   *
+   * @param pool Pool identifier
+   * @param key Key
+   * @param value [out] Value (release with free())
+   * @param value_len [out] Value length in bytes
+   *
+   * @return True if the value was read; false if there is no cached
+   * location, the value has changed since it was located, or the read
+   * failed (e.g. the server deregistered the memory)
+   */
+  bool one_sided_get(const pool_t       pool,
+                     const std::string& key,
+                     void*&             value,
+                     size_t&            value_len);
+
+  /**
+   * Ask the server for the location of a value and cache it for
+   * one-sided reads
+   *
+   * @param pool Pool identifier
+   * @param key Key
+   */
+  void locate_value(const pool_t pool, const std::string& key);
+
+  /**
+   * Drop cached location of a value, e.g. when it is written
+   *
+   * @param pool Pool identifier
+   * @param key Key
+   */
+  inline void forget_location(const pool_t pool, const std::string& key)
+  {
+    if (!_locations.empty()) _locations.erase(std::make_pair(pool, key));
+  }
 
   /**
    * Close or delete a pool helper
@@ -179,19 +434,210 @@ class Connection_handler : public Connection_base {
    */
   void close_or_delete_pool(pool_t pool, int op);
 
+  /**
+   * Issue request message for an asynchronous operation.  The receive
+   * for the response is posted before the request is sent.  Blocks
+   * while the queue depth is exhausted.
+   *
+   * @param iob IO buffer holding the request (ownership is taken)
+   * @param pool Pool identifier
+   * @param request_id Request identifier used to match the response
+   * @param op Operation
+   * @param internal Set if the operation has no application handle
+   * @param value Value sent from registered memory after the request
+   * (put_direct), or nullptr
+   * @param value_desc Memory descriptor of value
+   *
+   * @return New outstanding operation
+   */
+  Async_op* post_async(buffer_t*      iob,
+                       const pool_t   pool,
+                       const uint64_t request_id,
+                       const int      op,
+                       const bool     internal   = false,
+                       const ::iovec* value      = nullptr,
+                       void*          value_desc = nullptr);
+
+  /**
+   * Release the server's lock on a value read with two-stage get,
+   * without waiting for the response
+   *
+   * @param pool Pool identifier
+   * @param target Address of value in server memory
+   */
+  void post_async_release(const pool_t pool, uint64_t target);
+
+  /**
+   * Make progress on outstanding asynchronous operations
+   *
+   */
+  void progress_async();
+
+  /**
+   * Complete all outstanding asynchronous operations.  This must be
+   * called before synchronous operations so that their responses do not
+   * land in receive buffers posted for asynchronous ones.  Staged PUTs
+   * are then sent, so that they are ordered before the operation.
+   *
+   */
+  void drain_async()
+  {
+    while (!_inflight.empty() || !_async_sends.empty()) progress_async();
+    flush_staged();
+  }
+
+  /**
+   * Stage a PUT for write-combining
+   *
+   * @param pool Pool identifier
+   * @param key Key
+   * @param key_len Key length
+   * @param value Value
+   * @param value_len Value length
+   *
+   * @return False if the PUT is too large to combine
+   */
+  bool stage_put(const pool_t pool,
+                 const void*  key,
+                 const size_t key_len,
+                 const void*  value,
+                 const size_t value_len);
+
+  /**
+   * Send staged PUTs as batch requests, recording failures for flush()
+   *
+   */
+  void flush_staged();
+
+  /**
+   * Execute batch; caller holds the API lock
+   *
+   */
+  status_t send_batch(const pool_t                             pool,
+                      std::vector<Component::IDawn::Batch_op>& ops);
+
+  /* batch in progress; elements are sent a message at a time */
+  struct Batch {
+    pool_t                                   pool;
+    std::vector<Component::IDawn::Batch_op>* ops;
+    size_t                                   next = 0; /*< first unsent */
+    size_t                                   end  = 0; /*< end of request */
+    uint64_t                                 request_id = 0;
+    buffer_t*                                response = nullptr; /*< posted */
+  };
+
+  /**
+   * Prepare connection for a batch; caller holds the API lock
+   *
+   */
+  void begin_batch(const pool_t                                   pool,
+                   const std::vector<Component::IDawn::Batch_op>& ops);
+
+  /**
+   * Send request for the next elements of a batch, with the receive
+   * for its response posted
+   *
+   * @param batch Batch
+   *
+   * @return False if no elements remain
+   */
+  bool post_batch(Batch& batch);
+
+  /**
+   * Wait for the response to the request sent by post_batch and set
+   * the status (and value) of the elements it executed
+   *
+   * @param batch Batch
+   */
+  void complete_batch(Batch& batch);
+
+  void complete_async_response(buffer_t* iob);
+
+  void complete_async_read(Async_op* aop);
+
+  static Component::IFabric_op_completer::cb_acceptance
+  async_completion_callback(void*         context,
+                            status_t      st,
+                            std::uint64_t completion_flags,
+                            std::size_t   len,
+                            void*         error_data,
+                            void*         param);
+
  private:
 #ifdef THREAD_SAFE_CLIENT
   std::mutex _api_lock;
 #endif
 
+  static constexpr unsigned DEFAULT_STREAM_WINDOW = 4;
+
   bool     _exit             = false;
   uint64_t _request_id       = 0;
   size_t   _max_message_size = 0;
   size_t   _max_inject_size  = 0;
 
   struct {
-    bool short_circuit_backend = false;
+    bool     short_circuit_backend = false;
+    unsigned queue_depth = Dawn::Protocol::MAX_OUTSTANDING_REQUESTS;
+    bool     one_sided_get         = false;
+    unsigned stream_window         = DEFAULT_STREAM_WINDOW;
+    size_t   segment_size = Buffer_manager<Transport>::BUFFER_LEN;
+    unsigned combine_usec          = 0; /*< write-combining period */
+    uint64_t auth_id               = 0; /*< sent in handshake */
   } _options;
+
+  /* write-combined PUTs, all to one pool, not yet sent */
+  struct Put_error {
+    pool_t      pool;
+    std::string key;
+    status_t    status;
+  };
+
+  std::vector<Component::IDawn::Batch_op> _staged;
+  pool_t                                  _staged_pool  = 0;
+  size_t                                  _staged_bytes = 0;
+  std::chrono::steady_clock::time_point   _staged_since;
+  std::vector<Put_error>                  _put_errors; /*< since flush() */
+
+  /* segment of a streamed (two-stage) value transfer */
+  struct Segment {
+    ::iovec   iov;
+    void*     desc;
+    buffer_t* bounce; /*< IO buffer for unregistered memory */
+    size_t    offset;
+  };
+
+  /**
+   * Issue RDMA transfer of the next segment of a streamed value
+   *
+   * @param segments Segments in flight (new segment is appended)
+   * @param write Set for write, clear for read
+   * @param value Local value
+   * @param value_len Length of value in bytes
+   * @param desc Memory descriptor for value or nullptr
+   * @param target Location of value on the server
+   * @param offset [in/out] Offset of next segment
+   */
+  void post_segment(std::deque<Segment>&                 segments,
+                    const bool                           write,
+                    void*                                value,
+                    const size_t                         value_len,
+                    void*                                desc,
+                    const Dawn::Protocol::Remote_target& target,
+                    size_t&                              offset);
+
+  /* value locations for one-sided get */
+  static constexpr size_t LOCATION_CACHE_SIZE = 65536;
+  std::map<std::pair<pool_t, std::string>, Dawn::Protocol::Value_location>
+      _locations;
+  std::set<pool_t> _unlocatable; /*< pools without pre-registered memory */
+
+  /* asynchronous operation state */
+  std::map<uint64_t, Async_op*> _inflight; /*< keyed on request id */
+  std::vector<buffer_t*>        _async_recvs;
+  std::vector<buffer_t*>        _async_sends;
+  std::vector<Async_op*>        _async_reads;
+  std::vector<buffer_t*>        _completed_recvs;
+  std::vector<Async_op*>        _completed_reads;
 };
 
 }  // namespace Client
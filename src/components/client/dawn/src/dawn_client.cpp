@@ -5,8 +5,11 @@
 #include <api/fabric_itf.h>
 #include <city.h>
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <regex>
+#include <sstream>
 
 using namespace Component;
 
@@ -27,94 +30,233 @@ Dawn_client::Dawn_client(unsigned           debug_level,
 
   Dawn::Global::debug_level = debug_level;
 
-  smatch m;
+  /* e.g. 10.0.0.21:11911 (verbs)
+     9.1.75.6:11911:sockets (sockets)
+     10.0.0.21:11911-11914 (four shards)
+     10.0.0.21:11911,10.0.0.22:11911 (two shards)
+  */
+  const regex r("([[:digit:]]+[.][[:digit:]]+[.][[:digit:]]+[.][[:digit:]]+)"
+                "[:]([[:digit:]]+)(?:-([[:digit:]]+))?(?:[:]([[:alnum:]]+))?");
+
+  std::vector<std::pair<std::string, int>> shards;
+  std::string                              provider;
+
+  std::stringstream ss(addr_port_str);
+  std::string       shard_str;
+  while (getline(ss, shard_str, ',')) {
+    smatch m;
+    if (!regex_search(shard_str, m, r))
+      throw API_exception("invalid parameter (%s)", shard_str.c_str());
+
+    const std::string ip_addr = m[1].str();
+    const int port = (int) strtoul(m[2].str().c_str(), nullptr, 10);
+    const int last_port =
+        m[3].matched ? (int) strtoul(m[3].str().c_str(), nullptr, 10) : port;
+    const std::string shard_provider =
+        m[4].matched ? m[4].str() : "verbs"; /* default provider */
+
+    if (last_port < port)
+      throw API_exception("invalid port range (%s)", shard_str.c_str());
+    if (!provider.empty() && provider != shard_provider)
+      throw API_exception("shards must use the same provider");
+    provider = shard_provider;
+
+    for (int p = port; p <= last_port; p++) shards.emplace_back(ip_addr, p);
+  }
 
-  try {
-    /* e.g. 10.0.0.21:11911 (verbs)
-       9.1.75.6:11911:sockets (sockets)
-    */
-    regex r("([[:digit:]]+[.][[:digit:]]+[.][[:digit:]]+[.][[:digit:]]+)[:]([[:"
-            "digit:]]+)(?:[:]([[:alnum:]]+))?");
-    regex_search(addr_port_str, m, r);
+  if (shards.empty()) throw API_exception("invalid parameter");
+
+  /* connections per shard, shared out between application threads */
+  char* env = getenv("DAWN_CLIENT_CONNECTIONS");
+  if (env) {
+    auto lanes = std::strtoul(env, nullptr, 10);
+    if (lanes < 1 || lanes > MAX_LANES)
+      throw API_exception("DAWN_CLIENT_CONNECTIONS should be 1-%u",
+                          MAX_LANES);
+    _lane_count = lanes;
   }
-  catch (...) {
-    throw API_exception("invalid parameter");
+
+  /* read cache budget */
+  env = getenv("DAWN_CLIENT_CACHE_MB");
+  if (env) {
+    const auto mb = std::strtoul(env, nullptr, 10);
+    if (mb > 0) _cache.reset(new Dawn::Client::Read_cache(MB(mb)));
   }
 
-  const std::string ip_addr = m[1].str();
-  char*             end;
-  const int         port = (int) strtoul(m[2].str().c_str(), &end, 10);
-  const std::string provider =
-      m[3].matched ? m[3].str() : "verbs"; /* default provider */
+  open_transport(device, provider);
+
+  _shard_count = shards.size();
+  for (unsigned s = 0; s < _shard_count; s++)
+    _ring.add_shard(s,
+                    shards[s].first + ":" + std::to_string(shards[s].second));
+
+  for (unsigned lane = 0; lane < _lane_count; lane++) {
+    for (auto& shard : shards) {
+      PMAJOR("Dawn-client protocol session: %p (%s) (%d) (%s) lane %u", this,
+             shard.first.c_str(), shard.second, provider.c_str(), lane);
+      open_connection(shard.first, shard.second);
+    }
+  }
 
-  PMAJOR("Dawn-client protocol session: %p (%s) (%d) (%s)", this,
-         ip_addr.c_str(), port, provider.c_str());
+  const auto period = _connections[0]->combine_period();
+  if (period.count() > 0)
+    _flusher = std::thread(&Dawn_client::flush_loop, this, period);
+}
 
-  open_transport(device, ip_addr, port, provider);
+Dawn_client::~Dawn_client()
+{
+  if (_flusher.joinable()) {
+    _flusher_exit = true;
+    _flusher.join();
+  }
+  close_transport();
 }
 
-Dawn_client::~Dawn_client() { close_transport(); }
+void Dawn_client::flush_loop(std::chrono::microseconds period)
+{
+  while (!_flusher_exit) {
+    std::this_thread::sleep_for(period);
+    for (auto connection : _connections) connection->flush_expired();
+  }
+}
 
 void Dawn_client::open_transport(const std::string& device,
-                                 const std::string& ip_addr,
-                                 const int          port,
                                  const std::string& provider)
 {
-  {
-    IBase* comp = load_component("libcomanche-fabric.so", net_fabric_factory);
-    assert(comp);
-    _factory = static_cast<IFabric_factory*>(
-        comp->query_interface(IFabric_factory::iid()));
-    assert(_factory);
-
-    /* The libfabric 1.6 sockets provider requires a "BASIC" specfication, which
-     * is supposedly obsolete after libfabric 1.4.
-     */
-    const std::string mr_mode =
-        provider == "sockets" ? "[ \"FI_MR_BASIC\" ]"
-                              : "[ \"FI_MR_LOCAL\", \"FI_MR_VIRT_ADDR\", "
-                                "\"FI_MR_ALLOCATED\", \"FI_MR_PROV_KEY\" ]";
-
-    const std::string fabric_spec{"{ \"fabric_attr\" : { \"prov_name\" : \"" +
-                                  provider +
-                                  "\" },"
-                                  " \"domain_attr\" : "
-                                  "{ \"mr_mode\" : " +
-                                  mr_mode + " , \"name\" : \"" + device +
-                                  "\" }"
-                                  ","
-                                  " \"ep_attr\" : { \"type\" : \"FI_EP_MSG\" }"
-                                  "}"};
-
-    _fabric = _factory->make_fabric(fabric_spec);
-    const std::string client_spec{"{}"};
-    _transport = _fabric->open_client(client_spec, ip_addr, port);
-    assert(_transport);
-  }
-
-  assert(_transport);
-  _connection = new Dawn::Client::Connection_handler(_transport);
-  _connection->bootstrap();
+  IBase* comp = load_component("libcomanche-fabric.so", net_fabric_factory);
+  assert(comp);
+  _factory = static_cast<IFabric_factory*>(
+      comp->query_interface(IFabric_factory::iid()));
+  assert(_factory);
+
+  /* The libfabric 1.6 sockets provider requires a "BASIC" specfication, which
+   * is supposedly obsolete after libfabric 1.4.
+   */
+  const std::string mr_mode =
+      provider == "sockets" ? "[ \"FI_MR_BASIC\" ]"
+                            : "[ \"FI_MR_LOCAL\", \"FI_MR_VIRT_ADDR\", "
+                              "\"FI_MR_ALLOCATED\", \"FI_MR_PROV_KEY\" ]";
+
+  const std::string fabric_spec{"{ \"fabric_attr\" : { \"prov_name\" : \"" +
+                                provider +
+                                "\" },"
+                                " \"domain_attr\" : "
+                                "{ \"mr_mode\" : " +
+                                mr_mode + " , \"name\" : \"" + device +
+                                "\" }"
+                                ","
+                                " \"ep_attr\" : { \"type\" : \"FI_EP_MSG\" }"
+                                "}"};
+
+  _fabric = _factory->make_fabric(fabric_spec);
+}
+
+void Dawn_client::open_connection(const std::string& ip_addr, const int port)
+{
+  const std::string client_spec{"{}"};
+  auto transport = _fabric->open_client(client_spec, ip_addr, port);
+  assert(transport);
+  _transports.push_back(transport);
+
+  auto connection = new Connection_handler(transport);
+  _connections.push_back(connection);
+  connection->bootstrap();
 }
 
 void Dawn_client::close_transport()
 {
   PLOG("Dawn_client: closing fabric transport (%p)", this);
 
-  if (_connection) {
-    _connection->shutdown();
+  for (auto connection : _connections) {
+    connection->shutdown();
+    delete connection;
   }
 
-  delete _connection;
-  delete _transport;
+  for (auto transport : _transports) delete transport;
+
   delete _fabric;
   _factory->release_ref();
   PLOG("Dawn_client: closed fabric transport.");
 }
 
+unsigned Dawn_client::lane() const
+{
+  if (_lane_count == 1) return 0;
+
+  static std::atomic<unsigned> next_thread{0};
+  static thread_local unsigned thread_index = next_thread++;
+  return thread_index % _lane_count;
+}
+
+Dawn_client::shard_pools_t Dawn_client::shard_pools(const pool_t pool)
+{
+  Common::RWLock_guard g(_pools_lock);
+  auto                 i = _pools.find(pool);
+  if (i == _pools.end()) throw API_exception("invalid pool handle");
+  return i->second;
+}
+
+Dawn_client::Connection_handler* Dawn_client::route(const pool_t       pool,
+                                                    const std::string& key,
+                                                    pool_t& shard_pool)
+{
+  if (!mapped()) {
+    shard_pool = pool;
+    return _connections[0];
+  }
+
+  const auto index = connection_index(_ring.shard(key));
+  {
+    Common::RWLock_guard g(_pools_lock);
+    auto                 i = _pools.find(pool);
+    if (i == _pools.end()) throw API_exception("invalid pool handle");
+    shard_pool = i->second[index];
+  }
+  return _connections[index];
+}
+
+Dawn_client::Connection_handler* Dawn_client::route(
+    const pool_t       pool,
+    const std::string& key,
+    memory_handle_t    handle,
+    pool_t&            shard_pool,
+    memory_handle_t&   shard_handle)
+{
+  auto connection = route(pool, key, shard_pool);
+
+  if (!mapped() || handle == HANDLE_NONE) {
+    shard_handle = handle;
+  }
+  else {
+    const auto index =
+        std::find(_connections.begin(), _connections.end(), connection) -
+        _connections.begin();
+    shard_handle =
+        reinterpret_cast<Shard_memory_handles*>(handle)->handles[index];
+  }
+  return connection;
+}
+
+IKVStore::pool_t Dawn_client::add_pool(const shard_pools_t& pools)
+{
+  Common::RWLock_guard g(_pools_lock, Common::RWLock_guard::WRITE);
+  const auto           pool = _next_pool++;
+  _pools[pool]              = pools;
+  return pool;
+}
+
+IDawn::async_handle_t Dawn_client::wrap_async(Connection_handler* connection,
+                                              async_handle_t      handle)
+{
+  if (!mapped()) return handle;
+  return new Shard_async_handle(connection, handle);
+}
+
 int Dawn_client::thread_safety() const
 {
-  return IKVStore::THREAD_MODEL_SINGLE_PER_POOL;
+  /* with lanes, threads may share a pool and proceed in parallel */
+  return _lane_count > 1 ? IKVStore::THREAD_MODEL_MULTI_PER_POOL
+                         : IKVStore::THREAD_MODEL_SINGLE_PER_POOL;
 }
 
 IKVStore::pool_t Dawn_client::create_pool(const std::string& path,
@@ -123,26 +265,104 @@ IKVStore::pool_t Dawn_client::create_pool(const std::string& path,
                                           unsigned int       flags,
                                           uint64_t           expected_obj_count)
 {
-  return _connection->create_pool(path, name, size, flags, expected_obj_count);
+  if (!mapped())
+    return _connections[0]->create_pool(path, name, size, flags,
+                                        expected_obj_count);
+
+  /* pool spans all shards; size and object count are divided between
+     them.  The pool is created on the first lane and opened on the
+     others. */
+  const auto    shard_count = _shard_count;
+  shard_pools_t pools;
+  auto          undo = [&]() {
+    for (unsigned i = pools.size(); i > shard_count; i--)
+      _connections[i - 1]->close_pool(pools[i - 1]);
+    for (unsigned i = 0; i < std::min<size_t>(pools.size(), shard_count); i++)
+      _connections[i]->delete_pool(pools[i]);
+  };
+
+  try {
+    for (unsigned i = 0; i < _connections.size(); i++) {
+      const auto p =
+          i < shard_count
+              ? _connections[i]->create_pool(
+                    path, name, (size + shard_count - 1) / shard_count, flags,
+                    (expected_obj_count + shard_count - 1) / shard_count)
+              : _connections[i]->open_pool(path, name, flags);
+      if (p == IKVStore::POOL_ERROR) {
+        undo();
+        return IKVStore::POOL_ERROR;
+      }
+      pools.push_back(p);
+    }
+  }
+  catch (...) {
+    undo();
+    throw;
+  }
+  return add_pool(pools);
 }
 
 IKVStore::pool_t Dawn_client::open_pool(const std::string& path,
                                         const std::string& name,
                                         unsigned int       flags)
 {
-  return _connection->open_pool(path, name, flags);
+  if (!mapped()) return _connections[0]->open_pool(path, name, flags);
+
+  /* the pool is only usable if every shard has it */
+  shard_pools_t pools;
+  auto          undo = [&]() {
+    for (unsigned i = 0; i < pools.size(); i++)
+      _connections[i]->close_pool(pools[i]);
+  };
+
+  try {
+    for (auto connection : _connections) {
+      const auto p = connection->open_pool(path, name, flags);
+      if (p == IKVStore::POOL_ERROR) {
+        undo();
+        return IKVStore::POOL_ERROR;
+      }
+      pools.push_back(p);
+    }
+  }
+  catch (...) {
+    undo();
+    throw;
+  }
+  return add_pool(pools);
 }
 
 void Dawn_client::close_pool(const IKVStore::pool_t pool)
 {
   assert(pool);
-  _connection->close_pool(pool);
+  if (_cache) _cache->erase_pool(pool);
+  if (!mapped()) return _connections[0]->close_pool(pool);
+
+  const auto pools = shard_pools(pool);
+  for (unsigned i = 0; i < pools.size(); i++)
+    _connections[i]->close_pool(pools[i]);
+
+  Common::RWLock_guard g(_pools_lock, Common::RWLock_guard::WRITE);
+  _pools.erase(pool);
 }
 
 void Dawn_client::delete_pool(const IKVStore::pool_t pool)
 {
   assert(pool);
-  _connection->delete_pool(pool);
+  if (_cache) _cache->erase_pool(pool);
+  if (!mapped()) return _connections[0]->delete_pool(pool);
+
+  /* a pool open on another connection cannot be deleted; close it on
+     the other lanes first */
+  const auto pools = shard_pools(pool);
+  for (unsigned i = _shard_count; i < pools.size(); i++)
+    _connections[i]->close_pool(pools[i]);
+  for (unsigned i = 0; i < _shard_count; i++)
+    _connections[i]->delete_pool(pools[i]);
+
+  Common::RWLock_guard g(_pools_lock, Common::RWLock_guard::WRITE);
+  _pools.erase(pool);
 }
 
 status_t Dawn_client::put(const IKVStore::pool_t pool,
@@ -150,7 +370,11 @@ status_t Dawn_client::put(const IKVStore::pool_t pool,
                           const void*            value,
                           const size_t           value_len)
 {
-  return _connection->put(pool, key, value, value_len);
+  pool_t shard_pool;
+  auto   connection = route(pool, key, shard_pool);
+  const auto status = connection->put(shard_pool, key, value, value_len);
+  invalidate(pool, key);
+  return status;
 }
 
 status_t Dawn_client::put_direct(const pool_t       pool,
@@ -159,7 +383,13 @@ status_t Dawn_client::put_direct(const pool_t       pool,
                                  const size_t       value_len,
                                  memory_handle_t    handle)
 {
-  return _connection->put_direct(pool, key, value, value_len, handle);
+  pool_t          shard_pool;
+  memory_handle_t shard_handle;
+  auto connection = route(pool, key, handle, shard_pool, shard_handle);
+  const auto status = connection->put_direct(shard_pool, key, value,
+                                             value_len, shard_handle);
+  invalidate(pool, key);
+  return status;
 }
 
 status_t Dawn_client::get(const IKVStore::pool_t pool,
@@ -167,7 +397,53 @@ status_t Dawn_client::get(const IKVStore::pool_t pool,
                           void*&  out_value, /* release with free() */
                           size_t& out_value_len)
 {
-  return _connection->get(pool, key, out_value, out_value_len);
+  if (_cache) return cached_get(pool, key, out_value, out_value_len);
+
+  pool_t shard_pool;
+  auto   connection = route(pool, key, shard_pool);
+  return connection->get(shard_pool, key, out_value, out_value_len);
+}
+
+status_t Dawn_client::cached_get(const IKVStore::pool_t pool,
+                                 const std::string&     key,
+                                 void*&                 out_value,
+                                 size_t&                out_value_len)
+{
+  using Dawn::Client::Read_cache;
+
+  Connection_handler::Lease lease;
+  if (_cache->lookup(pool, key, out_value, out_value_len, lease.version))
+    return S_OK;
+
+  pool_t     shard_pool;
+  auto       connection = route(pool, key, shard_pool);
+  const auto cached     = lease.version;
+
+  /* the lease runs from before the request, so that it cannot outlast
+     the server's; a write by another thread after this point keeps the
+     value out of the cache */
+  const auto generation = _cache->generation();
+  const auto issued     = Read_cache::clock_t::now();
+  auto       status =
+      connection->get(shard_pool, key, out_value, out_value_len, &lease);
+
+  if (status == S_OK && lease.not_modified) {
+    if (_cache->renew(pool, key, cached, lease.lease_ms, issued, out_value,
+                      out_value_len))
+      return S_OK;
+
+    /* entry evicted since the lookup; fetch the value */
+    lease.version = 0;
+    status = connection->get(shard_pool, key, out_value, out_value_len, &lease);
+  }
+
+  if (status == S_OK)
+    _cache->insert(pool, key, out_value, out_value_len, lease.version,
+                   lease.lease_ms, issued, generation);
+  else if (status == E_NOT_FOUND)
+    _cache->erase(pool, key);
+
+  return status;
 }
 
 status_t Dawn_client::get_direct(const pool_t       pool,
@@ -176,24 +452,49 @@ status_t Dawn_client::get_direct(const pool_t       pool,
                                  size_t&            out_value_len,
                                  memory_handle_t    handle)
 {
-  return _connection->get_direct(pool, key, out_value, out_value_len, handle);
+  pool_t          shard_pool;
+  memory_handle_t shard_handle;
+  auto connection = route(pool, key, handle, shard_pool, shard_handle);
+  return connection->get_direct(shard_pool, key, out_value, out_value_len,
+                                shard_handle);
 }
 
 Component::IKVStore::memory_handle_t Dawn_client::register_direct_memory(
     void*  vaddr,
     size_t len)
 {
-  return _connection->register_direct_memory(vaddr, len);
+  if (!mapped())
+    return _connections[0]->register_direct_memory(vaddr, len);
+
+  /* memory is registered with each connection */
+  auto h = new Shard_memory_handles;
+  for (auto connection : _connections)
+    h->handles.push_back(connection->register_direct_memory(vaddr, len));
+  return reinterpret_cast<memory_handle_t>(h);
 }
 
 status_t Dawn_client::unregister_direct_memory(IKVStore::memory_handle_t handle)
 {
-  return _connection->unregister_direct_memory(handle);
+  if (!mapped())
+    return _connections[0]->unregister_direct_memory(handle);
+
+  auto     h      = reinterpret_cast<Shard_memory_handles*>(handle);
+  status_t status = S_OK;
+  for (unsigned i = 0; i < h->handles.size(); i++) {
+    auto rc = _connections[i]->unregister_direct_memory(h->handles[i]);
+    if (status == S_OK) status = rc;
+  }
+  delete h;
+  return status;
 }
 
 status_t Dawn_client::erase(const IKVStore::pool_t pool, const std::string& key)
 {
-  return 0;
+  pool_t shard_pool;
+  auto   connection = route(pool, key, shard_pool);
+  const auto status = connection->erase(shard_pool, key);
+  invalidate(pool, key);
+  return status;
 }
 
 size_t Dawn_client::count(const IKVStore::pool_t pool) { return 0; }
@@ -222,6 +523,247 @@ IKVStore::pool_t Dawn_client::open_pool(const std::string& pool_name,
   return 0;
 }
 
+status_t Dawn_client::batch(const IKVStore::pool_t        pool,
+                            std::vector<IDawn::Batch_op>& ops)
+{
+  const auto status = mapped() ? batch_multi_shard(pool, ops)
+                               : _connections[0]->batch(pool, ops);
+  for (auto& op : ops)
+    if (op.type == IDawn::Batch_op_type::PUT) invalidate(pool, op.key);
+  return status;
+}
+
+status_t Dawn_client::batch_multi_shard(const IKVStore::pool_t        pool,
+                                        std::vector<IDawn::Batch_op>& ops)
+{
+  const auto pools = shard_pools(pool);
+
+  /* scatter elements to their shards, preserving order within a shard */
+  std::vector<std::vector<IDawn::Batch_op>> shard_ops(_shard_count);
+  std::vector<std::vector<size_t>>          shard_index(_shard_count);
+  for (size_t i = 0; i < ops.size(); i++) {
+    const auto shard = _ring.shard(ops[i].key);
+    shard_ops[shard].push_back(std::move(ops[i]));
+    shard_index[shard].push_back(i);
+  }
+
+  /* sub-batches are issued to all shards at once */
+  std::vector<Connection_handler*>           connections;
+  std::vector<Connection_handler::pool_t>    connection_pools;
+  std::vector<std::vector<IDawn::Batch_op>>  connection_ops;
+  std::vector<unsigned>                      connection_shards;
+  for (unsigned s = 0; s < _shard_count; s++) {
+    if (shard_ops[s].empty()) continue;
+
+    const auto index = connection_index(s);
+    connections.push_back(_connections[index]);
+    connection_pools.push_back(pools[index]);
+    connection_ops.push_back(std::move(shard_ops[s]));
+    connection_shards.push_back(s);
+  }
+
+  const auto status = Connection_handler::multi_batch(
+      connections, connection_pools, connection_ops);
+
+  /* gather results back into the caller's vector */
+  for (size_t c = 0; c < connection_ops.size(); c++) {
+    const auto& index = shard_index[connection_shards[c]];
+    for (size_t j = 0; j < connection_ops[c].size(); j++)
+      ops[index[j]] = std::move(connection_ops[c][j]);
+  }
+  return status;
+}
+
+status_t Dawn_client::atomic_update(
+    const IKVStore::pool_t                   pool,
+    const std::string&                       key,
+    const std::vector<IKVStore::Operation*>& op_vector,
+    bool                                     take_lock)
+{
+  pool_t shard_pool;
+  auto   connection = route(pool, key, shard_pool);
+  const auto status = connection->atomic_update(shard_pool, key, op_vector);
+  invalidate(pool, key);
+  return status;
+}
+
+status_t Dawn_client::async_put(const IKVStore::pool_t pool,
+                                const std::string&     key,
+                                const void*            value,
+                                const size_t           value_len,
+                                async_handle_t&        out_handle)
+{
+  pool_t     shard_pool;
+  auto       connection = route(pool, key, shard_pool);
+  const auto status =
+      connection->async_put(shard_pool, key, value, value_len, out_handle);
+  invalidate(pool, key);
+  if (status == S_OK) out_handle = wrap_async(connection, out_handle);
+  return status;
+}
+
+status_t Dawn_client::async_get(const IKVStore::pool_t pool,
+                                const std::string&     key,
+                                void*&                 out_value,
+                                size_t&                out_value_len,
+                                async_handle_t&        out_handle)
+{
+  pool_t     shard_pool;
+  auto       connection = route(pool, key, shard_pool);
+  const auto status     = connection->async_get(shard_pool, key, out_value,
+                                            out_value_len, out_handle);
+  if (status == S_OK) out_handle = wrap_async(connection, out_handle);
+  return status;
+}
+
+status_t Dawn_client::async_put_direct(const IKVStore::pool_t pool,
+                                       const std::string&     key,
+                                       const void*            value,
+                                       const size_t           value_len,
+                                       memory_handle_t        handle,
+                                       async_handle_t&        out_handle)
+{
+  pool_t          shard_pool;
+  memory_handle_t shard_handle;
+  auto connection = route(pool, key, handle, shard_pool, shard_handle);
+  const auto status = connection->async_put_direct(
+      shard_pool, key, value, value_len, shard_handle, out_handle);
+  invalidate(pool, key);
+  if (status == S_OK) out_handle = wrap_async(connection, out_handle);
+  return status;
+}
+
+status_t Dawn_client::async_get_direct(const IKVStore::pool_t pool,
+                                       const std::string&     key,
+                                       void*                  out_value,
+                                       size_t&                out_value_len,
+                                       memory_handle_t        handle,
+                                       async_handle_t&        out_handle)
+{
+  pool_t          shard_pool;
+  memory_handle_t shard_handle;
+  auto connection = route(pool, key, handle, shard_pool, shard_handle);
+  const auto status = connection->async_get_direct(
+      shard_pool, key, out_value, out_value_len, shard_handle, out_handle);
+  if (status == S_OK) out_handle = wrap_async(connection, out_handle);
+  return status;
+}
+
+status_t Dawn_client::async_erase(const IKVStore::pool_t pool,
+                                  const std::string&     key,
+                                  async_handle_t&        out_handle)
+{
+  pool_t     shard_pool;
+  auto       connection = route(pool, key, shard_pool);
+  const auto status = connection->async_erase(shard_pool, key, out_handle);
+  invalidate(pool, key);
+  if (status == S_OK) out_handle = wrap_async(connection, out_handle);
+  return status;
+}
+
+bool Dawn_client::async_poll(async_handle_t& handle, status_t& out_status)
+{
+  if (!mapped()) return _connections[0]->async_poll(handle, out_status);
+
+  auto h = static_cast<Shard_async_handle*>(handle);
+  if (h == nullptr) throw API_exception("async_poll: invalid handle");
+  if (!h->connection->async_poll(h->handle, out_status)) return false;
+
+  delete h;
+  handle = ASYNC_HANDLE_INIT;
+  return true;
+}
+
+status_t Dawn_client::async_wait(async_handle_t& handle)
+{
+  if (!mapped()) return _connections[0]->async_wait(handle);
+
+  auto h = static_cast<Shard_async_handle*>(handle);
+  if (h == nullptr) throw API_exception("async_wait: invalid handle");
+  const auto status = h->connection->async_wait(h->handle);
+
+  delete h;
+  handle = ASYNC_HANDLE_INIT;
+  return status;
+}
+
+status_t Dawn_client::flush(
+    const IKVStore::pool_t                         pool,
+    std::vector<std::pair<std::string, status_t>>& out_errors)
+{
+  if (!mapped()) return _connections[0]->flush(pool, out_errors);
+
+  /* PUTs may be staged on any lane */
+  const auto pools  = shard_pools(pool);
+  status_t   status = S_OK;
+  for (unsigned i = 0; i < pools.size(); i++)
+    if (_connections[i]->flush(pools[i], out_errors) != S_OK) status = E_FAIL;
+  return status;
+}
+
+status_t Dawn_client::scan(const IKVStore::pool_t    pool,
+                           const std::string&        expression,
+                           IKVIndex::find_t          find_type,
+                           uint64_t&                 cursor,
+                           size_t                    max_keys,
+                           std::vector<std::string>& out_keys)
+{
+  if (!mapped())
+    return _connections[0]->scan(pool, expression, find_type, cursor,
+                                 max_keys, out_keys);
+
+  /* shards are scanned in turn, on the first lane (a scan position is
+     kept by the connection that started it); the cursor holds the
+     shard index in its top bits */
+  const auto pools = shard_pools(pool);
+  unsigned   shard = cursor >> SCAN_SHARD_SHIFT;
+  uint64_t shard_cursor = cursor & ((uint64_t(1) << SCAN_SHARD_SHIFT) - 1);
+
+  if (shard >= _shard_count || max_keys == 0) return E_INVAL;
+
+  const auto count = out_keys.size();
+  for (;;) {
+    const auto status = _connections[shard]->scan(
+        pools[shard], expression, find_type, shard_cursor,
+        max_keys - (out_keys.size() - count), out_keys);
+    if (status != S_OK) return status;
+
+    /* shard complete; move to the next */
+    if (shard_cursor == 0 && ++shard == _shard_count) {
+      cursor = 0;
+      return S_OK;
+    }
+    if (shard_cursor != 0 || out_keys.size() - count >= max_keys) break;
+  }
+
+  cursor = (uint64_t(shard) << SCAN_SHARD_SHIFT) | shard_cursor;
+  return S_OK;
+}
+
+status_t Dawn_client::get_statistics(std::string& out_stats)
+{
+  if (_shard_count == 1) {
+    const auto status = _connections[0]->get_statistics(out_stats);
+    if (status != S_OK) return status;
+  }
+  else {
+    /* array with an element for each shard (from the first lane) */
+    out_stats = "[";
+    for (unsigned i = 0; i < _shard_count; i++) {
+      std::string stats;
+      const auto  status = _connections[i]->get_statistics(stats);
+      if (status != S_OK) return status;
+      out_stats += (i ? "," : "") + stats;
+    }
+    out_stats += "]";
+  }
+
+  if (_cache)
+    out_stats = "{\"shards\":" + out_stats +
+                ",\"client_cache\":" + _cache->report() + "}";
+  return S_OK;
+}
+
 std::string Dawn_client::find(const std::string& key_expression,
                               IKVIndex::offset_t begin_position,
                               IKVIndex::find_t find_type,
@@ -18,9 +18,18 @@
 #include <api/kvstore_itf.h>
 #include <api/kvindex_itf.h>
 #include <api/dawn_itf.h>
+#include <common/rwlock.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #include "connection.h"
 #include "dawn_client_config.h"
+#include "read_cache.h"
+#include "shard_ring.h"
 
 class Dawn_client : public Component::IKVStore,
                     public Component::IDawn
@@ -32,8 +41,20 @@ class Dawn_client : public Component::IKVStore,
 
  protected:
   /**
-   * Constructor
-   *
+   * Constructor.  The address is a shard, or a comma-separated list of
+   * shards, each ip:port[-last_port][:provider], e.g.
+   * 10.0.0.21:11911-11914.  With more than one shard, keys are routed
+   * to shards by consistent hashing and each pool spans all shards.
+   * Setting DAWN_CLIENT_CONNECTIONS opens that many connections to each
+   * shard (lanes); each application thread uses its own lane, so that
+   * threads sharing the client do not serialize on one connection.
+   * Setting DAWN_CLIENT_CACHE_MB enables a read cache of that size;
+   * cached values are leased from the server and may be stale for up
+   * to the lease period with respect to writes from other clients.
+   * Setting DAWN_CLIENT_WRITE_COMBINE (usec) stages small PUTs and
+   * sends them in batches; see IDawn::flush.
+   * DAWN_CLIENT_AUTH_ID is the identity presented to shards, which may
+   * be configured to give it a larger share of the shard (weight).
    *
    */
   Dawn_client(unsigned           debug_level,
@@ -135,6 +156,62 @@ class Dawn_client : public Component::IKVStore,
   virtual pool_t open_pool(const std::string& pool_name,
                            unsigned int flags = 0) override;
 
+  virtual status_t batch(const pool_t pool,
+                         std::vector<Component::IDawn::Batch_op>& ops) override;
+
+  virtual status_t atomic_update(const pool_t                     pool,
+                                 const std::string&               key,
+                                 const std::vector<Operation*>&   op_vector,
+                                 bool take_lock = true) override;
+
+  virtual status_t async_put(const pool_t       pool,
+                             const std::string& key,
+                             const void*        value,
+                             const size_t       value_len,
+                             async_handle_t&    out_handle) override;
+
+  virtual status_t async_get(const pool_t       pool,
+                             const std::string& key,
+                             void*&             out_value,
+                             size_t&            out_value_len,
+                             async_handle_t&    out_handle) override;
+
+  virtual status_t async_put_direct(const pool_t       pool,
+                                    const std::string& key,
+                                    const void*        value,
+                                    const size_t       value_len,
+                                    memory_handle_t    handle,
+                                    async_handle_t&    out_handle) override;
+
+  virtual status_t async_get_direct(const pool_t       pool,
+                                    const std::string& key,
+                                    void*              out_value,
+                                    size_t&            out_value_len,
+                                    memory_handle_t    handle,
+                                    async_handle_t&    out_handle) override;
+
+  virtual status_t async_erase(const pool_t       pool,
+                               const std::string& key,
+                               async_handle_t&    out_handle) override;
+
+  virtual bool async_poll(async_handle_t& handle,
+                          status_t&       out_status) override;
+
+  virtual status_t async_wait(async_handle_t& handle) override;
+
+  virtual status_t flush(
+      const pool_t                                   pool,
+      std::vector<std::pair<std::string, status_t>>& out_errors) override;
+
+  virtual status_t get_statistics(std::string& out_stats) override;
+
+  virtual status_t scan(const pool_t                pool,
+                        const std::string&          expression,
+                        Component::IKVIndex::find_t find_type,
+                        uint64_t&                   cursor,
+                        size_t                      max_keys,
+                        std::vector<std::string>&   out_keys) override;
+
   virtual std::string find(const std::string& key_expression,
                            Component::IKVIndex::offset_t begin_position,
                            Component::IKVIndex::find_t find_type,
@@ -142,18 +219,179 @@ class Dawn_client : public Component::IKVStore,
 
   
  private:
+  using Connection_handler = Dawn::Client::Connection_handler;
+
+  static constexpr unsigned MAX_LANES = 64;
+
+  /* scan cursor bits holding the shard index */
+  static constexpr unsigned SCAN_SHARD_SHIFT = 56;
+
+  /* pool opened on every connection, indexed as _connections */
+  using shard_pools_t = std::vector<pool_t>;
+
+  /* direct memory registered with each connection */
+  struct Shard_memory_handles {
+    std::vector<memory_handle_t> handles;
+  };
+
+  /* asynchronous operation issued on a shard's connection */
+  struct Shard_async_handle : public Opaque_async_handle {
+    Shard_async_handle(Connection_handler* connection, async_handle_t handle)
+        : connection(connection), handle(handle)
+    {
+    }
 
-  Component::IFabric_factory* _factory;
-  Component::IFabric*         _fabric;
-  Component::IFabric_client*  _transport;
+    Connection_handler* connection;
+    async_handle_t      handle;
+  };
 
-  Dawn::Client::Connection_handler* _connection;
+  Component::IFabric_factory*             _factory;
+  Component::IFabric*                     _fabric;
+  std::vector<Component::IFabric_client*> _transports;
+  std::vector<Connection_handler*>        _connections; /*< lane by shard */
+  unsigned                                _shard_count = 0;
+  unsigned                                _lane_count  = 1;
+
+  Dawn::Client::Shard_ring        _ring;
+  Common::RWLock                  _pools_lock;
+  std::map<pool_t, shard_pools_t> _pools; /*< logical pool to shard pools */
+  pool_t                          _next_pool = 1;
+
+  std::unique_ptr<Dawn::Client::Read_cache> _cache; /*< optional */
+
+  std::thread       _flusher; /*< sends staged PUTs that have waited */
+  std::atomic<bool> _flusher_exit{false};
 
  private:
-  void open_transport(const std::string& device,
-                      const std::string& ip_addr,
-                      const int          port,
-                      const std::string& provider);
+  /* pool and memory handles are mapped if there is more than one
+     connection (multiple shards or lanes) */
+  inline bool mapped() const { return _connections.size() > 1; }
+
+  /**
+   * Get lane of calling thread.  Threads are assigned lanes round-robin
+   * on first use and keep them, so a thread's requests stay in order on
+   * one connection.
+   *
+   * @return Lane index
+   */
+  unsigned lane() const;
+
+  /**
+   * Get connection to a shard in the calling thread's lane
+   *
+   * @param shard Shard index
+   *
+   * @return Index into _connections
+   */
+  inline unsigned connection_index(unsigned shard) const
+  {
+    return lane() * _shard_count + shard;
+  }
+
+  /**
+   * Get shard pools of a logical pool
+   *
+   * @param pool Logical pool handle
+   *
+   * @return Pool handle of each shard
+   */
+  shard_pools_t shard_pools(const pool_t pool);
+
+  /**
+   * Route a key to its shard, on the calling thread's lane
+   *
+   * @param pool Pool handle
+   * @param key Key
+   * @param shard_pool [out] Pool handle on the shard
+   *
+   * @return Connection to the shard
+   */
+  Connection_handler* route(const pool_t       pool,
+                            const std::string& key,
+                            pool_t&            shard_pool);
+
+  /**
+   * Route a key and direct memory handle to its shard
+   *
+   * @param pool Pool handle
+   * @param key Key
+   * @param handle Memory handle from register_direct_memory
+   * @param shard_pool [out] Pool handle on the shard
+   * @param shard_handle [out] Memory handle for the shard's connection
+   *
+   * @return Connection to the shard
+   */
+  Connection_handler* route(const pool_t       pool,
+                            const std::string& key,
+                            memory_handle_t    handle,
+                            pool_t&            shard_pool,
+                            memory_handle_t&   shard_handle);
+
+  /**
+   * Drop a key from the read cache, after writing it
+   *
+   * @param pool Pool handle
+   * @param key Key
+   */
+  inline void invalidate(const pool_t pool, const std::string& key)
+  {
+    if (_cache) _cache->erase(pool, key);
+  }
+
+  /**
+   * Get value through the read cache
+   *
+   */
+  status_t cached_get(const pool_t       pool,
+                      const std::string& key,
+                      void*&             out_value,
+                      size_t&            out_value_len);
+
+  /**
+   * Record a pool created or opened on every connection
+   *
+   * @param pools Pool handle of each connection
+   *
+   * @return Logical pool handle
+   */
+  pool_t add_pool(const shard_pools_t& pools);
+
+  /**
+   * Wrap a connection's asynchronous handle, so that it can be polled
+   * without routing (from any thread)
+   *
+   * @param connection Connection the operation was issued on
+   * @param handle Handle from the connection
+   *
+   * @return Handle for the application
+   */
+  async_handle_t wrap_async(Connection_handler* connection,
+                            async_handle_t      handle);
+
+  /**
+   * Scatter batch elements to their shards (on the calling thread's
+   * lane) and gather the results
+   *
+   */
+  status_t batch_multi_shard(const pool_t pool, std::vector<Batch_op>& ops);
+
+  /**
+   * Periodically send write-combined PUTs that have waited for the
+   * combining period
+   *
+   * @param period Combining period
+   */
+  void flush_loop(std::chrono::microseconds period);
+
+  void open_transport(const std::string& device, const std::string& provider);
+
+  /**
+   * Connect to a shard
+   *
+   * @param ip_addr Server address
+   * @param port Shard port
+   */
+  void open_connection(const std::string& ip_addr, const int port);
 
   void close_transport();
 };
@@ -1,6 +1,7 @@
 #include "dawn_client_jni.h"
 #if defined JNIEXPORT
 #include <api/components.h>
+#include <api/dawn_itf.h>
 #include <api/kvstore_itf.h>
 #include <common/cpu.h>
 #include <common/str_utils.h>
@@ -10,12 +11,47 @@
 #include <sys/mman.h>
 #include <boost/program_options.hpp>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
 
 using namespace Component;
 using namespace Common;
 using namespace std;
 
 Component::IKVStore *client;
+Component::IDawn *   dawn;
+
+/* direct ByteBuffers registered with the client, keyed on address */
+struct Registration {
+  size_t                               len;
+  Component::IKVStore::memory_handle_t handle;
+  unsigned pending; /*< outstanding asynchronous operations */
+};
+
+static std::mutex                                   registry_lock;
+static std::map<void *, Registration>               registry;
+static std::map<string, Component::IKVStore::pool_t> pools;
+
+/* returned by asyncPoll while the operation is outstanding; must match
+   DawnClient.ASYNC_PENDING */
+static constexpr jlong ASYNC_PENDING = std::numeric_limits<jlong>::min();
+
+/* outstanding asynchronous operation handed to Java as a long; freed
+   once asyncPoll or asyncWait has returned its result */
+struct Jni_async {
+  Component::IDawn::async_handle_t handle = Component::IDawn::ASYNC_HANDLE_INIT;
+  void *                           buffer    = nullptr; /*< registry key */
+  size_t                           value_len = 0; /*< in-out for get */
+  bool                             get       = false;
+  status_t                         status    = E_FAIL;
+
+  /* value length for a get, otherwise status */
+  jlong result() const
+  {
+    return (status == S_OK && get) ? jlong(value_len) : jlong(status);
+  }
+};
 
 string get_string(JNIEnv *env, jstring jstr)
 {
@@ -43,6 +79,246 @@ JNIEXPORT void JNICALL Java_DawnClient_init(JNIEnv *env,
 
   client = fact->create(debug, username, address, dev);
   fact->release_ref();
+
+  dawn = static_cast<IDawn *>(client->query_interface(IDawn::iid()));
+}
+
+/**
+ * Get pool for a table, opening or creating it on first use.  Pools
+ * stay open (until clean) so that asynchronous operations can be left
+ * outstanding on them.
+ */
+static Component::IKVStore::pool_t get_pool(JNIEnv *env, jstring table)
+{
+  string p = get_string(env, table);
+
+  std::lock_guard<std::mutex> g(registry_lock);
+  auto                        i = pools.find(p);
+  if (i != pools.end()) return i->second;
+
+  Component::IKVStore::pool_t pool =
+      client->open_pool("/mnt/pmem0/dawn", p.c_str(), 0);
+
+  if (pool == Component::IKVStore::POOL_ERROR) {
+    /* ok, try to create pool instead */
+    pool = client->create_pool("/mnt/pmem0/dawn", p.c_str(), GB(1));
+  }
+  if (pool != Component::IKVStore::POOL_ERROR) pools[p] = pool;
+  return pool;
+}
+
+/**
+ * Get registration of a direct ByteBuffer, registering the whole buffer
+ * on first use.  Registration needs 64-byte alignment, so the region is
+ * extended down to the preceding boundary.  A buffer that has grown is
+ * re-registered, which is refused while asynchronous operations are
+ * outstanding on it.
+ *
+ * @param async Count an asynchronous operation against the buffer
+ * (see release_buffer)
+ *
+ * @return Memory handle, or HANDLE_NONE if not a direct buffer or it
+ * cannot be re-registered
+ */
+static Component::IKVStore::memory_handle_t lookup_buffer(JNIEnv * env,
+                                                          jobject  buffer,
+                                                          char *&  base,
+                                                          size_t & len,
+                                                          bool     async = false)
+{
+  base = static_cast<char *>(env->GetDirectBufferAddress(buffer));
+  if (base == nullptr) return Component::IKVStore::HANDLE_NONE;
+  len = env->GetDirectBufferCapacity(buffer);
+
+  std::lock_guard<std::mutex> g(registry_lock);
+  auto                        i = registry.find(base);
+  if (i != registry.end() && i->second.len >= len) {
+    if (async) i->second.pending++;
+    return i->second.handle;
+  }
+
+  if (i != registry.end()) { /* buffer re-allocated at the same address */
+    if (i->second.pending > 0) return Component::IKVStore::HANDLE_NONE;
+    client->unregister_direct_memory(i->second.handle);
+    registry.erase(i);
+  }
+
+  auto aligned = round_down(reinterpret_cast<addr_t>(base), 64);
+  auto handle  = client->register_direct_memory(
+      reinterpret_cast<void *>(aligned),
+      len + (reinterpret_cast<addr_t>(base) - aligned));
+  registry[base] = {len, handle, async ? 1U : 0U};
+  return handle;
+}
+
+/**
+ * Release a buffer counted against by lookup_buffer
+ */
+static void release_buffer(void *base)
+{
+  std::lock_guard<std::mutex> g(registry_lock);
+  auto                        i = registry.find(base);
+  if (i != registry.end() && i->second.pending > 0) i->second.pending--;
+}
+
+JNIEXPORT jint JNICALL Java_DawnClient_registerBuffer(JNIEnv *env,
+                                                      jobject obj,
+                                                      jobject buffer)
+{
+  char * base;
+  size_t len;
+  if (lookup_buffer(env, buffer, base, len) ==
+      Component::IKVStore::HANDLE_NONE)
+    return E_INVAL;
+  return S_OK;
+}
+
+JNIEXPORT jint JNICALL Java_DawnClient_unregisterBuffer(JNIEnv *env,
+                                                        jobject obj,
+                                                        jobject buffer)
+{
+  void *base = env->GetDirectBufferAddress(buffer);
+
+  std::lock_guard<std::mutex> g(registry_lock);
+  auto                        i = registry.find(base);
+  if (i == registry.end()) return E_INVAL;
+  if (i->second.pending > 0) return E_BUSY;
+
+  jint ret = client->unregister_direct_memory(i->second.handle);
+  registry.erase(i);
+  return ret;
+}
+
+JNIEXPORT jint JNICALL Java_DawnClient_putBuffer(JNIEnv *env,
+                                                 jobject obj,
+                                                 jstring table,
+                                                 jstring key,
+                                                 jobject value,
+                                                 jint    offset,
+                                                 jint    length)
+{
+  char * base;
+  size_t len;
+  auto   handle = lookup_buffer(env, value, base, len);
+  if (handle == Component::IKVStore::HANDLE_NONE || offset < 0 ||
+      length < 0 || size_t(offset) + length > len)
+    return E_INVAL;
+
+  auto pool = get_pool(env, table);
+  if (pool == Component::IKVStore::POOL_ERROR) return E_FAIL;
+
+  return client->put_direct(pool, get_string(env, key), base + offset,
+                            length, handle);
+}
+
+JNIEXPORT jlong JNICALL Java_DawnClient_getBuffer(JNIEnv *env,
+                                                  jobject obj,
+                                                  jstring table,
+                                                  jstring key,
+                                                  jobject value,
+                                                  jint    offset,
+                                                  jint    length)
+{
+  char * base;
+  size_t len;
+  auto   handle = lookup_buffer(env, value, base, len);
+  if (handle == Component::IKVStore::HANDLE_NONE || offset < 0 ||
+      length <= 0 || size_t(offset) + length > len)
+    return E_INVAL;
+
+  auto pool = get_pool(env, table);
+  if (pool == Component::IKVStore::POOL_ERROR) return E_FAIL;
+
+  size_t value_len = length;
+  auto   ret       = client->get_direct(pool, get_string(env, key),
+                                base + offset, value_len, handle);
+  return ret == S_OK ? jlong(value_len) : jlong(ret);
+}
+
+JNIEXPORT jlong JNICALL Java_DawnClient_asyncPutBuffer(JNIEnv *env,
+                                                       jobject obj,
+                                                       jstring table,
+                                                       jstring key,
+                                                       jobject value,
+                                                       jint    offset,
+                                                       jint    length)
+{
+  char * base;
+  size_t len;
+  auto   handle = lookup_buffer(env, value, base, len, true);
+  if (handle == Component::IKVStore::HANDLE_NONE) return 0;
+
+  auto pool = get_pool(env, table);
+  auto op   = new Jni_async;
+  op->buffer = base;
+  if (offset < 0 || length < 0 || size_t(offset) + length > len ||
+      pool == Component::IKVStore::POOL_ERROR ||
+      dawn->async_put_direct(pool, get_string(env, key), base + offset,
+                             length, handle, op->handle) != S_OK) {
+    release_buffer(base);
+    delete op;
+    return 0;
+  }
+  return reinterpret_cast<jlong>(op);
+}
+
+JNIEXPORT jlong JNICALL Java_DawnClient_asyncGetBuffer(JNIEnv *env,
+                                                       jobject obj,
+                                                       jstring table,
+                                                       jstring key,
+                                                       jobject value,
+                                                       jint    offset,
+                                                       jint    length)
+{
+  char * base;
+  size_t len;
+  auto   handle = lookup_buffer(env, value, base, len, true);
+  if (handle == Component::IKVStore::HANDLE_NONE) return 0;
+
+  auto pool     = get_pool(env, table);
+  auto op       = new Jni_async;
+  op->buffer    = base;
+  op->get       = true;
+  op->value_len = length;
+  if (offset < 0 || length <= 0 || size_t(offset) + length > len ||
+      pool == Component::IKVStore::POOL_ERROR ||
+      dawn->async_get_direct(pool, get_string(env, key), base + offset,
+                             op->value_len, handle, op->handle) != S_OK) {
+    release_buffer(base);
+    delete op;
+    return 0;
+  }
+  return reinterpret_cast<jlong>(op);
+}
+
+JNIEXPORT jlong JNICALL Java_DawnClient_asyncPoll(JNIEnv *env,
+                                                  jobject obj,
+                                                  jlong   handle)
+{
+  if (handle == 0) return E_INVAL;
+
+  auto op = reinterpret_cast<Jni_async *>(handle);
+  if (!dawn->async_poll(op->handle, op->status)) return ASYNC_PENDING;
+
+  const jlong ret = op->result();
+  release_buffer(op->buffer);
+  delete op;
+  return ret;
+}
+
+JNIEXPORT jlong JNICALL Java_DawnClient_asyncWait(JNIEnv *env,
+                                                  jobject obj,
+                                                  jlong   handle)
+{
+  if (handle == 0) return E_INVAL;
+
+  auto op    = reinterpret_cast<Jni_async *>(handle);
+  op->status = dawn->async_wait(op->handle);
+
+  const jlong ret = op->result();
+  release_buffer(op->buffer);
+  delete op;
+  return ret;
 }
 
 JNIEXPORT jint JNICALL Java_DawnClient_put(JNIEnv *   env,
@@ -138,7 +414,14 @@ JNIEXPORT jint JNICALL Java_DawnClient_erase(JNIEnv *env,
 
 JNIEXPORT jint JNICALL Java_DawnClient_clean(JNIEnv *env, jobject obj)
 {
+  std::lock_guard<std::mutex> g(registry_lock);
+  for (auto &r : registry) client->unregister_direct_memory(r.second.handle);
+  registry.clear();
+  for (auto &p : pools) client->close_pool(p.second);
+  pools.clear();
+
   client->release_ref();
+  return S_OK;
 }
 #else
 typedef int i; /* A C++ compiland needs at least one statement */
@@ -3,6 +3,7 @@
 
 #include <jni.h>
 
+/* native methods of DawnClient (see ../java/DawnClient.java) */
 #if defined JNIEXPORT
 JNIEXPORT void JNICALL
                Java_DawnClient_init(JNIEnv *, jobject, jint, jstring, jstring, jstring);
@@ -18,6 +19,31 @@ JNIEXPORT jint JNICALL Java_DawnClient_erase(JNIEnv *,
                                              jstring,
                                              jstring);
 
+/* zero-copy access through direct java.nio.ByteBuffers */
+JNIEXPORT jint JNICALL Java_DawnClient_registerBuffer(JNIEnv *,
+                                                      jobject,
+                                                      jobject);
+
+JNIEXPORT jint JNICALL Java_DawnClient_unregisterBuffer(JNIEnv *,
+                                                        jobject,
+                                                        jobject);
+
+JNIEXPORT jint JNICALL
+               Java_DawnClient_putBuffer(JNIEnv *, jobject, jstring, jstring, jobject, jint, jint);
+
+JNIEXPORT jlong JNICALL
+                Java_DawnClient_getBuffer(JNIEnv *, jobject, jstring, jstring, jobject, jint, jint);
+
+JNIEXPORT jlong JNICALL
+                Java_DawnClient_asyncPutBuffer(JNIEnv *, jobject, jstring, jstring, jobject, jint, jint);
+
+JNIEXPORT jlong JNICALL
+                Java_DawnClient_asyncGetBuffer(JNIEnv *, jobject, jstring, jstring, jobject, jint, jint);
+
+JNIEXPORT jlong JNICALL Java_DawnClient_asyncPoll(JNIEnv *, jobject, jlong);
+
+JNIEXPORT jlong JNICALL Java_DawnClient_asyncWait(JNIEnv *, jobject, jlong);
+
 JNIEXPORT jint JNICALL Java_DawnClient_clean(JNIEnv *, jobject);
 #endif
 #endif
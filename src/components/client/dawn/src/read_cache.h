@@ -0,0 +1,262 @@
+#ifndef __DAWN_CLIENT_READ_CACHE_H__
+#define __DAWN_CLIENT_READ_CACHE_H__
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+namespace Dawn
+{
+namespace Client
+{
+/**
+ * Bounded LRU cache of values read with OP_GET.  Each entry holds the
+ * version the server reported for the value and the expiry of the
+ * lease granted with it.  Within the lease a hit is served locally;
+ * once the lease has expired the entry is revalidated with the server,
+ * which only returns the value if its version has changed.  Writes from
+ * this client invalidate their entries; writes from other clients are
+ * seen at the latest when the lease expires.
+ *
+ * A value read concurrently with a write from this client (on another
+ * lane) may predate the write, so it is only inserted if there has been
+ * no invalidation since its request was sent (see generation).
+ */
+class Read_cache {
+ public:
+  using clock_t = std::chrono::steady_clock;
+
+  /**
+   * Constructor
+   *
+   * @param budget Maximum bytes of cached values
+   */
+  explicit Read_cache(size_t budget) : _budget(budget) {}
+
+  /**
+   * Look up a value
+   *
+   * @param pool Pool identifier
+   * @param key Key
+   * @param value [out] Copy of value (release with free()), on a hit
+   * @param value_len [out] Value length, on a hit
+   * @param version [out] Version of an expired entry to revalidate, or 0
+   *
+   * @return True on hit (entry within its lease)
+   */
+  bool lookup(uint64_t           pool,
+              const std::string& key,
+              void*&             value,
+              size_t&            value_len,
+              uint64_t&          version)
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    version = 0;
+
+    auto i = _entries.find(entry_key(pool, key));
+    if (i == _entries.end()) {
+      _misses++;
+      return false;
+    }
+
+    if (clock_t::now() >= i->second.expiry) {
+      version = i->second.version;
+      _misses++;
+      return false;
+    }
+
+    touch(i->second);
+    copy_out(i->second, value, value_len);
+    _hits++;
+    return true;
+  }
+
+  /**
+   * Extend the lease of an entry the server reported as current
+   *
+   * @param pool Pool identifier
+   * @param key Key
+   * @param version Version revalidated
+   * @param lease_ms New lease
+   * @param issued Time the revalidation request was sent
+   * @param value [out] Copy of value (release with free())
+   * @param value_len [out] Value length
+   *
+   * @return False if the entry has since been evicted or replaced
+   */
+  bool renew(uint64_t           pool,
+             const std::string& key,
+             uint64_t           version,
+             uint32_t           lease_ms,
+             clock_t::time_point issued,
+             void*&             value,
+             size_t&            value_len)
+  {
+    std::lock_guard<std::mutex> g(_lock);
+
+    auto i = _entries.find(entry_key(pool, key));
+    if (i == _entries.end() || i->second.version != version) return false;
+
+    i->second.expiry = issued + std::chrono::milliseconds(lease_ms);
+    touch(i->second);
+    copy_out(i->second, value, value_len);
+    _renewals++;
+    return true;
+  }
+
+  /**
+   * Get invalidation generation, to be passed to insert; taken before
+   * the request for the value is sent
+   *
+   * @return Generation
+   */
+  uint64_t generation() const
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    return _generation;
+  }
+
+  /**
+   * Insert (or replace) a value.  Values larger than an eighth of the
+   * budget are not cached, so that one value cannot flush the cache.
+   *
+   * @param pool Pool identifier
+   * @param key Key
+   * @param value Value
+   * @param value_len Value length
+   * @param version Version reported by the server
+   * @param lease_ms Lease reported by the server
+   * @param issued Time the request was sent; the lease runs from here
+   * @param generation Generation when the request was sent; the value is
+   * not cached if a key has been invalidated since
+   */
+  void insert(uint64_t            pool,
+              const std::string&  key,
+              const void*         value,
+              size_t              value_len,
+              uint64_t            version,
+              uint32_t            lease_ms,
+              clock_t::time_point issued,
+              uint64_t            generation)
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    const auto                  k = entry_key(pool, key);
+
+    remove(k);
+    if (lease_ms == 0 || value_len > _budget / 8) return;
+    if (generation != _generation) return; /* may predate a write */
+
+    while (_used + value_len > _budget && !_lru.empty()) {
+      remove(_lru.back());
+      _evictions++;
+    }
+
+    _lru.push_front(k);
+    auto& e   = _entries[k];
+    e.value   = std::string(static_cast<const char*>(value), value_len);
+    e.version = version;
+    e.expiry  = issued + std::chrono::milliseconds(lease_ms);
+    e.lru     = _lru.begin();
+    _used += value_len;
+  }
+
+  /**
+   * Invalidate a key
+   *
+   * @param pool Pool identifier
+   * @param key Key
+   */
+  void erase(uint64_t pool, const std::string& key)
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    _generation++;
+    remove(entry_key(pool, key));
+  }
+
+  /**
+   * Invalidate all keys of a pool
+   *
+   * @param pool Pool identifier
+   */
+  void erase_pool(uint64_t pool)
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    const auto                  prefix = entry_key(pool, std::string());
+    _generation++;
+    for (auto i = _lru.begin(); i != _lru.end();) {
+      auto k = i++;
+      if (k->compare(0, prefix.size(), prefix) == 0) remove(*k);
+    }
+  }
+
+  /**
+   * Format statistics as JSON
+   *
+   * @return JSON text
+   */
+  std::string report() const
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    std::stringstream           ss;
+    ss << "{\"hits\":" << _hits << ",\"misses\":" << _misses
+       << ",\"renewals\":" << _renewals << ",\"evictions\":" << _evictions
+       << ",\"entries\":" << _entries.size() << ",\"bytes\":" << _used
+       << ",\"budget\":" << _budget << "}";
+    return ss.str();
+  }
+
+ private:
+  struct Entry {
+    std::string                      value;
+    uint64_t                         version;
+    clock_t::time_point              expiry;
+    std::list<std::string>::iterator lru;
+  };
+
+  static std::string entry_key(uint64_t pool, const std::string& key)
+  {
+    return std::string(reinterpret_cast<const char*>(&pool), sizeof(pool)) +
+           key;
+  }
+
+  void touch(Entry& e) { _lru.splice(_lru.begin(), _lru, e.lru); }
+
+  static void copy_out(const Entry& e, void*& value, size_t& value_len)
+  {
+    value_len = e.value.size();
+    value     = ::malloc(value_len + 1);
+    memcpy(value, e.value.data(), value_len);
+    static_cast<char*>(value)[value_len] = '\0';
+  }
+
+  void remove(const std::string& k)
+  {
+    auto i = _entries.find(k);
+    if (i == _entries.end()) return;
+    _used -= i->second.value.size();
+    auto lru = i->second.lru;
+    _entries.erase(i); /* k may refer to the LRU element */
+    _lru.erase(lru);
+  }
+
+  const size_t                           _budget;
+  size_t                                 _used = 0;
+  std::list<std::string>                 _lru; /*< most recent first */
+  std::unordered_map<std::string, Entry> _entries;
+  mutable std::mutex                     _lock;
+  uint64_t                               _generation = 0; /*< invalidations */
+  uint64_t                               _hits      = 0;
+  uint64_t                               _misses    = 0;
+  uint64_t                               _renewals  = 0;
+  uint64_t                               _evictions = 0;
+};
+
+}  // namespace Client
+}  // namespace Dawn
+
+#endif  // __DAWN_CLIENT_READ_CACHE_H__
@@ -0,0 +1,64 @@
+#ifndef __DAWN_CLIENT_SHARD_RING_H__
+#define __DAWN_CLIENT_SHARD_RING_H__
+
+#include <city.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Dawn
+{
+namespace Client
+{
+/**
+ * Consistent hash ring used to route keys to shards.  Each shard is
+ * placed on the ring at a number of points derived from its name
+ * (ip:port), so that adding or removing a shard only moves the keys of
+ * its neighbours, and the mapping does not depend on the order in
+ * which shards are given.
+ */
+class Shard_ring {
+ public:
+  static constexpr unsigned VIRTUAL_NODES = 128; /*< points per shard */
+
+  /**
+   * Add shard to the ring
+   *
+   * @param index Shard index (returned by shard())
+   * @param name Shard name, e.g. ip:port
+   */
+  void add_shard(unsigned index, const std::string& name)
+  {
+    for (unsigned v = 0; v < VIRTUAL_NODES; v++) {
+      const std::string point = name + "#" + std::to_string(v);
+      _ring.emplace_back(CityHash64(point.c_str(), point.length()), index);
+    }
+    std::sort(_ring.begin(), _ring.end());
+  }
+
+  /**
+   * Get shard that owns a key
+   *
+   * @param key Key
+   *
+   * @return Shard index
+   */
+  unsigned shard(const std::string& key) const
+  {
+    if (_ring.size() <= VIRTUAL_NODES) return 0; /* single shard */
+
+    const auto h = CityHash64(key.c_str(), key.length());
+    auto       i = std::lower_bound(_ring.begin(), _ring.end(),
+                              std::make_pair(h, 0U));
+    return i == _ring.end() ? _ring.front().second : i->second;
+  }
+
+ private:
+  std::vector<std::pair<uint64_t, unsigned>> _ring; /*< sorted on hash */
+};
+
+}  // namespace Client
+}  // namespace Dawn
+
+#endif  // __DAWN_CLIENT_SHARD_RING_H__
@@ -1,5 +1,6 @@
 /* note: we do not include component source, only the API definition */
 #include <api/components.h>
+#include <api/dawn_itf.h>
 #include <api/kvstore_itf.h>
 #include <common/cpu.h>
 #include <common/str_utils.h>
@@ -23,6 +24,18 @@
 //#define TEST_PERF_LARGE_PUT_DIRECT
 //#define TEST_PERF_LARGE_GET_DIRECT
 //#define TEST_SCALE_IOPS
+//#define TEST_BATCH_PUT_AND_GET
+//#define TEST_ASYNC_PUT_AND_GET
+//#define TEST_ATOMIC_UPDATE
+//#define TEST_ONE_SIDED_GET /* run with DAWN_CLIENT_ONE_SIDED_GET=1 */
+//#define TEST_STREAMING_PUT_GET
+//#define TEST_STATISTICS
+//#define TEST_MULTI_SHARD /* run with a shard range, e.g. 10.0.0.21:11911-11912 */
+//#define TEST_ASYNC_DIRECT
+//#define TEST_CONNECTION_LANES /* run with DAWN_CLIENT_CONNECTIONS=4 */
+//#define TEST_READ_CACHE /* run with DAWN_CLIENT_CACHE_MB=16 */
+//#define TEST_WRITE_COMBINE /* run with DAWN_CLIENT_WRITE_COMBINE=1000 */
+//#define TEST_SCAN /* backend must support map, e.g. hstore */
 
 struct {
   std::string addr;
@@ -194,6 +207,595 @@ TEST_F(Dawn_client_test, BasicPutAndGet)
 }
 #endif
 
+#ifdef TEST_BATCH_PUT_AND_GET
+TEST_F(Dawn_client_test, BatchPutAndGet)
+{
+  ASSERT_TRUE(_dawn);
+
+  auto dawn = static_cast<Component::IDawn *>(
+      _dawn->query_interface(Component::IDawn::iid()));
+  ASSERT_TRUE(dawn);
+
+  auto pool =
+      _dawn->create_pool("/mnt/pmem0/dawn", Options.pool.c_str(), MB(32));
+
+  static constexpr unsigned COUNT = 1000;
+
+  std::vector<IDawn::Batch_op> puts(COUNT);
+  for (unsigned i = 0; i < COUNT; i++) {
+    puts[i].type  = IDawn::Batch_op_type::PUT;
+    puts[i].key   = "batch-" + std::to_string(i);
+    puts[i].value = Common::random_string(64);
+  }
+  ASSERT_TRUE(dawn->batch(pool, puts) == S_OK);
+  for (auto &op : puts) ASSERT_TRUE(op.status == S_OK);
+
+  std::vector<IDawn::Batch_op> gets(COUNT);
+  for (unsigned i = 0; i < COUNT; i++) {
+    gets[i].type = IDawn::Batch_op_type::GET;
+    gets[i].key  = puts[i].key;
+  }
+  ASSERT_TRUE(dawn->batch(pool, gets) == S_OK);
+  for (unsigned i = 0; i < COUNT; i++) {
+    ASSERT_TRUE(gets[i].status == S_OK);
+    ASSERT_TRUE(gets[i].value == puts[i].value);
+  }
+
+  _dawn->delete_pool(pool);
+}
+#endif
+
+#ifdef TEST_ASYNC_PUT_AND_GET
+TEST_F(Dawn_client_test, AsyncPutAndGet)
+{
+  ASSERT_TRUE(_dawn);
+
+  auto dawn = static_cast<Component::IDawn *>(
+      _dawn->query_interface(Component::IDawn::iid()));
+  ASSERT_TRUE(dawn);
+
+  auto pool =
+      _dawn->create_pool("/mnt/pmem0/dawn", Options.pool.c_str(), MB(32));
+
+  static constexpr unsigned COUNT = 1000;
+
+  std::vector<std::string>           values(COUNT);
+  std::vector<IDawn::async_handle_t> handles(COUNT);
+  for (unsigned i = 0; i < COUNT; i++) {
+    values[i] = Common::random_string(64);
+    ASSERT_TRUE(dawn->async_put(pool, "async-" + std::to_string(i),
+                                values[i].c_str(), values[i].length(),
+                                handles[i]) == S_OK);
+  }
+  for (auto &h : handles) ASSERT_TRUE(dawn->async_wait(h) == S_OK);
+
+  std::vector<void *> out_values(COUNT);
+  std::vector<size_t> out_value_lens(COUNT);
+  for (unsigned i = 0; i < COUNT; i++) {
+    ASSERT_TRUE(dawn->async_get(pool, "async-" + std::to_string(i),
+                                out_values[i], out_value_lens[i],
+                                handles[i]) == S_OK);
+  }
+
+  /* poll out of order */
+  for (unsigned i = COUNT; i > 0; i--) {
+    status_t rc;
+    while (!dawn->async_poll(handles[i - 1], rc))
+      ;
+    ASSERT_TRUE(rc == S_OK);
+    ASSERT_TRUE(out_value_lens[i - 1] == values[i - 1].length());
+    ASSERT_TRUE(memcmp(out_values[i - 1], values[i - 1].c_str(),
+                       out_value_lens[i - 1]) == 0);
+    dawn->free_memory(out_values[i - 1]);
+  }
+
+  IDawn::async_handle_t handle;
+  ASSERT_TRUE(dawn->async_erase(pool, "async-0", handle) == S_OK);
+  ASSERT_TRUE(dawn->async_wait(handle) == S_OK);
+
+  void * value = nullptr;
+  size_t value_len;
+  ASSERT_TRUE(_dawn->get(pool, "async-0", value, value_len) == E_NOT_FOUND);
+
+  _dawn->delete_pool(pool);
+}
+#endif
+
+#ifdef TEST_ATOMIC_UPDATE
+TEST_F(Dawn_client_test, AtomicUpdate)
+{
+  ASSERT_TRUE(_dawn);
+
+  auto dawn = static_cast<Component::IDawn *>(
+      _dawn->query_interface(Component::IDawn::iid()));
+  ASSERT_TRUE(dawn);
+
+  auto pool =
+      _dawn->create_pool("/mnt/pmem0/dawn", Options.pool.c_str(), MB(32));
+
+  uint64_t fields[2] = {10, 20};
+  ASSERT_TRUE(_dawn->put(pool, "counter", fields, sizeof(fields)) == S_OK);
+
+  IKVStore::Operation_increment_uint64 inc(0, 5);
+  IKVStore::Operation_cas_uint64       cas(sizeof(uint64_t), 20, 30);
+  ASSERT_TRUE(dawn->atomic_update(pool, "counter", {&inc, &cas}) == S_OK);
+  ASSERT_TRUE(inc.result() == 10);
+  ASSERT_TRUE(cas.result() == 20);
+  ASSERT_TRUE(cas.swapped());
+
+  /* failed comparison leaves the value unchanged */
+  IKVStore::Operation_increment_uint64 inc2(0, 1);
+  IKVStore::Operation_cas_uint64       cas2(sizeof(uint64_t), 20, 40);
+  ASSERT_TRUE(dawn->atomic_update(pool, "counter", {&inc2, &cas2}) == S_OK);
+  ASSERT_FALSE(cas2.swapped());
+
+  void * value = nullptr;
+  size_t value_len;
+  ASSERT_TRUE(_dawn->get(pool, "counter", value, value_len) == S_OK);
+  ASSERT_TRUE(value_len == sizeof(fields));
+  memcpy(fields, value, sizeof(fields));
+  ASSERT_TRUE(fields[0] == 15);
+  ASSERT_TRUE(fields[1] == 30);
+  _dawn->free_memory(value);
+
+  IKVStore::Operation_zero zero(0, sizeof(uint64_t) * 3);
+  ASSERT_TRUE(dawn->atomic_update(pool, "counter", {&zero}) ==
+              IKVStore::E_BAD_OFFSET);
+
+  _dawn->delete_pool(pool);
+}
+#endif
+
+#ifdef TEST_ONE_SIDED_GET
+TEST_F(Dawn_client_test, OneSidedGet)
+{
+  ASSERT_TRUE(_dawn);
+
+  auto pool =
+      _dawn->create_pool("/mnt/pmem0/dawn", Options.pool.c_str(), MB(32));
+
+  auto value = Common::random_string(256);
+  ASSERT_TRUE(_dawn->put(pool, "one-sided", value.c_str(), value.length()) ==
+              S_OK);
+
+  /* first get locates the value; the rest are read directly */
+  for (unsigned i = 0; i < 100; i++) {
+    void * out_value = nullptr;
+    size_t out_value_len;
+    ASSERT_TRUE(_dawn->get(pool, "one-sided", out_value, out_value_len) ==
+                S_OK);
+    ASSERT_TRUE(out_value_len == value.length());
+    ASSERT_TRUE(memcmp(out_value, value.c_str(), out_value_len) == 0);
+    _dawn->free_memory(out_value);
+  }
+
+  /* a new value must not be served from the old location */
+  auto new_value = Common::random_string(512);
+  ASSERT_TRUE(_dawn->put(pool, "one-sided", new_value.c_str(),
+                         new_value.length()) == S_OK);
+
+  void * out_value = nullptr;
+  size_t out_value_len;
+  ASSERT_TRUE(_dawn->get(pool, "one-sided", out_value, out_value_len) == S_OK);
+  ASSERT_TRUE(out_value_len == new_value.length());
+  ASSERT_TRUE(memcmp(out_value, new_value.c_str(), out_value_len) == 0);
+  _dawn->free_memory(out_value);
+
+  _dawn->delete_pool(pool);
+}
+#endif
+
+#ifdef TEST_STREAMING_PUT_GET
+TEST_F(Dawn_client_test, StreamingPutGet)
+{
+  ASSERT_TRUE(_dawn);
+
+  auto pool =
+      _dawn->create_pool("/mnt/pmem0/dawn", Options.pool.c_str(), GB(1));
+
+  /* values much larger than an IO buffer; the second is not a multiple
+     of the segment size */
+  for (size_t value_len : {MB(256), MB(64) + 12345}) {
+    auto value = static_cast<char *>(malloc(value_len));
+    ASSERT_TRUE(value);
+    for (size_t i = 0; i < value_len; i++) value[i] = (char) (i * 7);
+
+    ASSERT_TRUE(_dawn->put(pool, "streamed", value, value_len) == S_OK);
+
+    void * out_value = nullptr;
+    size_t out_value_len;
+    ASSERT_TRUE(_dawn->get(pool, "streamed", out_value, out_value_len) ==
+                S_OK);
+    ASSERT_TRUE(out_value_len == value_len);
+    ASSERT_TRUE(memcmp(out_value, value, value_len) == 0);
+    _dawn->free_memory(out_value);
+
+    ASSERT_TRUE(_dawn->erase(pool, "streamed") == S_OK);
+    free(value);
+  }
+
+  _dawn->delete_pool(pool);
+}
+#endif
+
+#ifdef TEST_STATISTICS
+TEST_F(Dawn_client_test, Statistics)
+{
+  ASSERT_TRUE(_dawn);
+
+  auto dawn = static_cast<Component::IDawn *>(
+      _dawn->query_interface(Component::IDawn::iid()));
+  ASSERT_TRUE(dawn);
+
+  auto pool =
+      _dawn->create_pool("/mnt/pmem0/dawn", Options.pool.c_str(), MB(32));
+
+  auto value = Common::random_string(128);
+  for (unsigned i = 0; i < 100; i++) {
+    ASSERT_TRUE(_dawn->put(pool, "stats" + std::to_string(i), value.c_str(),
+                           value.length()) == S_OK);
+  }
+
+  std::string stats;
+  ASSERT_TRUE(dawn->get_statistics(stats) == S_OK);
+  PINF("stats: %s", stats.c_str());
+  ASSERT_TRUE(stats.find("\"op\":\"put\"") != std::string::npos);
+
+  _dawn->delete_pool(pool);
+}
+#endif
+
+#ifdef TEST_MULTI_SHARD
+TEST_F(Dawn_client_test, MultiShard)
+{
+  ASSERT_TRUE(_dawn);
+
+  auto dawn = static_cast<Component::IDawn *>(
+      _dawn->query_interface(Component::IDawn::iid()));
+  ASSERT_TRUE(dawn);
+
+  auto pool =
+      _dawn->create_pool("/mnt/pmem0/dawn", Options.pool.c_str(), MB(32));
+
+  /* keys are spread over the shards */
+  static constexpr unsigned COUNT = 1000;
+  for (unsigned i = 0; i < COUNT; i++) {
+    auto value = "value-" + std::to_string(i);
+    ASSERT_TRUE(_dawn->put(pool, "shard-" + std::to_string(i), value.c_str(),
+                           value.length()) == S_OK);
+  }
+
+  for (unsigned i = 0; i < COUNT; i++) {
+    void * out_value = nullptr;
+    size_t out_value_len;
+    ASSERT_TRUE(_dawn->get(pool, "shard-" + std::to_string(i), out_value,
+                           out_value_len) == S_OK);
+    ASSERT_TRUE(std::string((char *) out_value, out_value_len) ==
+                "value-" + std::to_string(i));
+    _dawn->free_memory(out_value);
+  }
+
+  /* batch elements are scattered to shards and gathered in order */
+  std::vector<IDawn::Batch_op> gets(COUNT);
+  for (unsigned i = 0; i < COUNT; i++) {
+    gets[i].type = IDawn::Batch_op_type::GET;
+    gets[i].key  = "shard-" + std::to_string(i);
+  }
+  ASSERT_TRUE(dawn->batch(pool, gets) == S_OK);
+  for (unsigned i = 0; i < COUNT; i++) {
+    ASSERT_TRUE(gets[i].status == S_OK);
+    ASSERT_TRUE(gets[i].value == "value-" + std::to_string(i));
+  }
+
+  IDawn::async_handle_t handle;
+  ASSERT_TRUE(dawn->async_erase(pool, "shard-0", handle) == S_OK);
+  ASSERT_TRUE(dawn->async_wait(handle) == S_OK);
+
+  _dawn->delete_pool(pool);
+}
+#endif
+
+#ifdef TEST_ASYNC_DIRECT
+TEST_F(Dawn_client_test, AsyncDirect)
+{
+  ASSERT_TRUE(_dawn);
+
+  auto dawn = static_cast<Component::IDawn *>(
+      _dawn->query_interface(Component::IDawn::iid()));
+  ASSERT_TRUE(dawn);
+
+  auto pool =
+      _dawn->create_pool("/mnt/pmem0/dawn", Options.pool.c_str(), MB(64));
+
+  /* one registration; values at offsets within it, one of them too
+     large to send inline */
+  static constexpr unsigned COUNT      = 16;
+  static constexpr size_t   VALUE_LEN  = KB(4);
+  static constexpr size_t   LARGE_LEN  = MB(4);
+  const size_t              region_len = COUNT * VALUE_LEN + LARGE_LEN;
+
+  char *region = static_cast<char *>(aligned_alloc(MB(2), region_len));
+  ASSERT_TRUE(region);
+  auto handle = _dawn->register_direct_memory(region, region_len);
+
+  for (size_t i = 0; i < region_len; i++) region[i] = 'a' + (i % 26);
+
+  std::vector<IDawn::async_handle_t> handles(COUNT + 1);
+  for (unsigned i = 0; i < COUNT; i++)
+    ASSERT_TRUE(dawn->async_put_direct(pool, "direct-" + std::to_string(i),
+                                       region + i * VALUE_LEN + i,
+                                       VALUE_LEN - i, handle,
+                                       handles[i]) == S_OK);
+  ASSERT_TRUE(dawn->async_put_direct(pool, "direct-large",
+                                     region + COUNT * VALUE_LEN, LARGE_LEN,
+                                     handle, handles[COUNT]) == S_OK);
+  for (auto &h : handles) ASSERT_TRUE(dawn->async_wait(h) == S_OK);
+
+  char *out = static_cast<char *>(aligned_alloc(MB(2), region_len));
+  ASSERT_TRUE(out);
+  memset(out, 0, region_len);
+  auto out_handle = _dawn->register_direct_memory(out, region_len);
+
+  std::vector<size_t> lens(COUNT + 1, VALUE_LEN);
+  lens[COUNT] = LARGE_LEN;
+  for (unsigned i = 0; i < COUNT; i++)
+    ASSERT_TRUE(dawn->async_get_direct(pool, "direct-" + std::to_string(i),
+                                       out + i * VALUE_LEN, lens[i],
+                                       out_handle, handles[i]) == S_OK);
+  ASSERT_TRUE(dawn->async_get_direct(pool, "direct-large",
+                                     out + COUNT * VALUE_LEN, lens[COUNT],
+                                     out_handle, handles[COUNT]) == S_OK);
+
+  for (unsigned i = 0; i <= COUNT; i++) {
+    status_t rc;
+    while (!dawn->async_poll(handles[i], rc))
+      ;
+    ASSERT_TRUE(rc == S_OK);
+  }
+
+  for (unsigned i = 0; i < COUNT; i++) {
+    ASSERT_TRUE(lens[i] == VALUE_LEN - i);
+    ASSERT_TRUE(memcmp(out + i * VALUE_LEN, region + i * VALUE_LEN + i,
+                       lens[i]) == 0);
+  }
+  ASSERT_TRUE(lens[COUNT] == LARGE_LEN);
+  ASSERT_TRUE(memcmp(out + COUNT * VALUE_LEN, region + COUNT * VALUE_LEN,
+                     LARGE_LEN) == 0);
+
+  /* buffer too small */
+  size_t short_len = VALUE_LEN / 2;
+  ASSERT_TRUE(dawn->async_get_direct(pool, "direct-0", out, short_len,
+                                     out_handle, handles[0]) == S_OK);
+  ASSERT_TRUE(dawn->async_wait(handles[0]) == E_INSUFFICIENT_SPACE);
+
+  _dawn->unregister_direct_memory(out_handle);
+  _dawn->unregister_direct_memory(handle);
+  free(out);
+  free(region);
+  _dawn->delete_pool(pool);
+}
+#endif
+
+#ifdef TEST_CONNECTION_LANES
+TEST_F(Dawn_client_test, ConnectionLanes)
+{
+  ASSERT_TRUE(_dawn);
+  ASSERT_TRUE(_dawn->thread_safety() == IKVStore::THREAD_MODEL_MULTI_PER_POOL);
+
+  auto pool =
+      _dawn->create_pool("/mnt/pmem0/dawn", Options.pool.c_str(), MB(32));
+
+  static constexpr unsigned THREADS = 8;
+  static constexpr unsigned COUNT   = 1000;
+
+  std::vector<std::thread> threads;
+  std::atomic<unsigned>    errors{0};
+  const auto               start = std::chrono::high_resolution_clock::now();
+
+  for (unsigned t = 0; t < THREADS; t++) {
+    threads.emplace_back([&, t]() {
+      for (unsigned i = 0; i < COUNT; i++) {
+        const std::string key =
+            "lane-" + std::to_string(t) + "-" + std::to_string(i);
+        const std::string value = Common::random_string(64);
+        if (_dawn->put(pool, key, value.c_str(), value.length()) != S_OK) {
+          errors++;
+          continue;
+        }
+        void * out_value = nullptr;
+        size_t out_value_len;
+        if (_dawn->get(pool, key, out_value, out_value_len) != S_OK ||
+            out_value_len != value.length() ||
+            memcmp(out_value, value.c_str(), out_value_len) != 0)
+          errors++;
+        _dawn->free_memory(out_value);
+      }
+    });
+  }
+  for (auto &t : threads) t.join();
+
+  const auto secs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::high_resolution_clock::now() - start)
+                        .count() /
+                    1000.0;
+  PINF("%u threads: %.0f put+get/sec", THREADS, THREADS * COUNT / secs);
+
+  ASSERT_TRUE(errors == 0);
+  _dawn->delete_pool(pool);
+}
+#endif
+
+#ifdef TEST_READ_CACHE
+TEST_F(Dawn_client_test, ReadCache)
+{
+  ASSERT_TRUE(_dawn);
+
+  auto pool =
+      _dawn->create_pool("/mnt/pmem0/dawn", Options.pool.c_str(), MB(32));
+
+  static constexpr unsigned COUNT = 100;
+  static constexpr unsigned READS = 100;
+
+  for (unsigned i = 0; i < COUNT; i++) {
+    const std::string key   = "cache-" + std::to_string(i);
+    const std::string value = Common::random_string(64);
+    ASSERT_TRUE(_dawn->put(pool, key, value.c_str(), value.length()) == S_OK);
+  }
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  for (unsigned r = 0; r < READS; r++) {
+    for (unsigned i = 0; i < COUNT; i++) {
+      void * out_value = nullptr;
+      size_t out_value_len;
+      ASSERT_TRUE(_dawn->get(pool, "cache-" + std::to_string(i), out_value,
+                             out_value_len) == S_OK);
+      ASSERT_TRUE(out_value_len == 64);
+      _dawn->free_memory(out_value);
+    }
+  }
+  const auto secs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::high_resolution_clock::now() - start)
+                        .count() /
+                    1000.0;
+  PINF("cached gets: %.0f/sec", READS * COUNT / secs);
+
+  /* own writes are visible at once */
+  const std::string value = "updated";
+  ASSERT_TRUE(_dawn->put(pool, "cache-0", value.c_str(), value.length()) ==
+              S_OK);
+  void * out_value = nullptr;
+  size_t out_value_len;
+  ASSERT_TRUE(_dawn->get(pool, "cache-0", out_value, out_value_len) == S_OK);
+  ASSERT_TRUE(out_value_len == value.length());
+  ASSERT_TRUE(memcmp(out_value, value.c_str(), out_value_len) == 0);
+  _dawn->free_memory(out_value);
+
+  ASSERT_TRUE(_dawn->erase(pool, "cache-0") == S_OK);
+  ASSERT_TRUE(_dawn->get(pool, "cache-0", out_value, out_value_len) ==
+              E_NOT_FOUND);
+
+  /* revalidated once the lease expires */
+  usleep(200000);
+  ASSERT_TRUE(_dawn->get(pool, "cache-1", out_value, out_value_len) == S_OK);
+  _dawn->free_memory(out_value);
+
+  auto dawn = static_cast<Component::IDawn *>(
+      _dawn->query_interface(Component::IDawn::iid()));
+  std::string stats;
+  ASSERT_TRUE(dawn->get_statistics(stats) == S_OK);
+  PINF("%s", stats.c_str());
+  ASSERT_TRUE(stats.find("\"client_cache\"") != std::string::npos);
+  ASSERT_TRUE(stats.find("\"renewals\":0,") == std::string::npos);
+
+  _dawn->delete_pool(pool);
+}
+#endif
+
+#ifdef TEST_WRITE_COMBINE
+TEST_F(Dawn_client_test, WriteCombine)
+{
+  ASSERT_TRUE(_dawn);
+  auto dawn = static_cast<Component::IDawn *>(
+      _dawn->query_interface(Component::IDawn::iid()));
+  ASSERT_TRUE(dawn);
+
+  auto pool =
+      _dawn->create_pool("/mnt/pmem0/dawn", Options.pool.c_str(), MB(32));
+
+  static constexpr unsigned COUNT = 100000;
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  for (unsigned i = 0; i < COUNT; i++) {
+    const std::string key = "combine-" + std::to_string(i);
+    ASSERT_TRUE(_dawn->put(pool, key, key.c_str(), key.length()) == S_OK);
+  }
+
+  std::vector<std::pair<std::string, status_t>> errors;
+  ASSERT_TRUE(dawn->flush(pool, errors) == S_OK);
+  ASSERT_TRUE(errors.empty());
+
+  const auto secs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::high_resolution_clock::now() - start)
+                        .count() /
+                    1000.0;
+  PINF("combined puts: %.0f/sec", COUNT / secs);
+
+  /* staged PUTs are ordered before later operations */
+  ASSERT_TRUE(_dawn->put(pool, "combine-0", "new", 3) == S_OK);
+  void * out_value = nullptr;
+  size_t out_value_len;
+  ASSERT_TRUE(_dawn->get(pool, "combine-0", out_value, out_value_len) == S_OK);
+  ASSERT_TRUE(out_value_len == 3);
+  ASSERT_TRUE(memcmp(out_value, "new", 3) == 0);
+  _dawn->free_memory(out_value);
+
+  ASSERT_TRUE(_dawn->get(pool, "combine-" + std::to_string(COUNT - 1),
+                         out_value, out_value_len) == S_OK);
+  _dawn->free_memory(out_value);
+
+  /* sent by the flusher once the combining period has passed */
+  ASSERT_TRUE(_dawn->put(pool, "combine-late", "late", 4) == S_OK);
+  usleep(100000);
+  ASSERT_TRUE(dawn->flush(pool, errors) == S_OK);
+
+  _dawn->delete_pool(pool);
+}
+#endif
+
+#ifdef TEST_SCAN
+TEST_F(Dawn_client_test, Scan)
+{
+  ASSERT_TRUE(_dawn);
+  auto dawn = static_cast<Component::IDawn *>(
+      _dawn->query_interface(Component::IDawn::iid()));
+  ASSERT_TRUE(dawn);
+
+  auto pool =
+      _dawn->create_pool("/mnt/pmem0/dawn", Options.pool.c_str(), MB(32));
+
+  static constexpr unsigned COUNT = 1000;
+
+  for (unsigned i = 0; i < COUNT; i++) {
+    const std::string key = (i % 2 ? "odd-" : "even-") + std::to_string(i);
+    ASSERT_TRUE(_dawn->put(pool, key, "x", 1) == S_OK);
+  }
+
+  /* all keys, in small pages */
+  std::vector<std::string> keys;
+  uint64_t                 cursor = 0;
+  unsigned                 pages  = 0;
+  do {
+    const auto before = keys.size();
+    ASSERT_TRUE(dawn->scan(pool, "", IKVIndex::FIND_TYPE_NEXT, cursor, 64,
+                           keys) == S_OK);
+    ASSERT_TRUE(keys.size() - before <= 64);
+    pages++;
+  } while (cursor != 0);
+  ASSERT_TRUE(keys.size() == COUNT);
+  PINF("scanned %lu keys in %u pages", keys.size(), pages);
+
+  keys.clear();
+  do {
+    ASSERT_TRUE(dawn->scan(pool, "odd-", IKVIndex::FIND_TYPE_PREFIX, cursor,
+                           100, keys) == S_OK);
+  } while (cursor != 0);
+  ASSERT_TRUE(keys.size() == COUNT / 2);
+  for (auto &k : keys) ASSERT_TRUE(k.compare(0, 4, "odd-") == 0);
+
+  keys.clear();
+  do {
+    ASSERT_TRUE(dawn->scan(pool, "even-[0-9]?0", IKVIndex::FIND_TYPE_REGEX,
+                           cursor, 100, keys) == S_OK);
+  } while (cursor != 0);
+  ASSERT_TRUE(keys.size() == 10); /* even-0, even-10 .. even-90 */
+
+  ASSERT_TRUE(dawn->scan(pool, "(", IKVIndex::FIND_TYPE_REGEX, cursor, 100,
+                         keys) == E_INVAL);
+
+  _dawn->delete_pool(pool);
+}
+#endif
+
 #ifdef TEST_SCALE_IOPS
 
 struct record_t {
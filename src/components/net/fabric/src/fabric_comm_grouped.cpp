@@ -254,3 +254,8 @@ void Fabric_comm_grouped::unblock_completions()
 {
   return _conn.unblock_completions();
 }
+
+bool Fabric_comm_grouped::prepare_wait(std::vector<int> &fds_)
+{
+  return _conn.prepare_wait(fds_);
+}
@@ -139,6 +139,11 @@ public:
   void wait_for_next_completion(std::chrono::milliseconds timeout) override;
 
   void unblock_completions() override;
+
+  /*
+   * @throw fabric_runtime_error : std::runtime_error : ::fi_control fail
+   */
+  bool prepare_wait(std::vector<int> &fds) override;
   /* END Component::IFabric_communicator */
 
   fabric_types::addr_ep_t get_name() const;
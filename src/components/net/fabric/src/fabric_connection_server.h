@@ -100,6 +100,10 @@ public:
    */
   void wait_for_next_completion(std::chrono::milliseconds timeout) override { return Fabric_op_control::wait_for_next_completion(timeout); };
   void unblock_completions() override { return Fabric_op_control::unblock_completions(); };
+  /*
+   * @throw fabric_runtime_error : std::runtime_error : ::fi_control fail
+   */
+  bool prepare_wait(std::vector<int> &fds_) override { return Fabric_op_control::prepare_wait(fds_); };
   /* END IFabric_op_control */
   /**
    * @throw std::range_error - address already registered
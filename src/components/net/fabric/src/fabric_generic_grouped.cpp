@@ -148,6 +148,12 @@ void Fabric_generic_grouped::unblock_completions()
   return _cnxn.unblock_completions();
 }
 
+bool Fabric_generic_grouped::prepare_wait(std::vector<int> &fds_)
+{
+  std::lock_guard<std::mutex> k{_m_cnxn};
+  return _cnxn.prepare_wait(fds_);
+}
+
 void Fabric_generic_grouped::post_recv(
   const ::iovec *first_
   , const ::iovec *last_
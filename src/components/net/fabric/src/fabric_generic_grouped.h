@@ -139,6 +139,10 @@ public:
    */
   void wait_for_next_completion(std::chrono::milliseconds timeout) override;
   void unblock_completions() override;
+  /*
+   * @throw fabric_runtime_error : std::runtime_error : ::fi_control fail
+   */
+  bool prepare_wait(std::vector<int> &fds) override;
   /* END IFabric_active_endpoint_grouped (IFabric_op_completer) */
 
   /*
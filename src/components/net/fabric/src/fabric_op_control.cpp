@@ -488,6 +488,41 @@ void Fabric_op_control::unblock_completions()
   }
 }
 
+/**
+ * Prepare to wait for completions along with other endpoints
+ *
+ * @param fds_ Descriptors to wait on (appended)
+ *
+ * @return false if the caller should poll rather than wait
+ * @throw fabric_runtime_error - ::fi_control fail
+ */
+bool Fabric_op_control::prepare_wait(std::vector<int> &fds_)
+{
+  if ( _shut_down )
+  {
+    return false;
+  }
+#if USE_WAIT_SETS
+  /* not implemented for wait sets */
+  return false;
+#else
+  static constexpr unsigned cq_count = 2;
+  ::fid_t f[cq_count] = { _rxcq.fid(), _txcq.fid() };
+  /* arms the cqs, unless completions are already pending */
+  if ( fabric().trywait(f, cq_count) != FI_SUCCESS )
+  {
+    return false;
+  }
+  for ( unsigned i = 0; i != cq_count; ++i )
+  {
+    int fd;
+    CHECK_FI_ERR(::fi_control(f[i], FI_GETWAIT, &fd));
+    fds_.push_back(fd);
+  }
+  return true;
+#endif
+}
+
 auto Fabric_op_control::get_name() const -> fabric_types::addr_ep_t
 {
   auto it = static_cast<const char *>(_ep_info->src_addr);
@@ -45,6 +45,11 @@ Component::IFabric_server * Fabric_server_factory::get_new_connection()
   return static_cast<Fabric_server *>(Fabric_server_generic_factory::get_new_connection());
 }
 
+Component::IFabric_server * Fabric_server_factory::wait_for_new_connection(std::chrono::milliseconds timeout)
+{
+  return static_cast<Fabric_server *>(Fabric_server_generic_factory::wait_for_new_connection(timeout));
+}
+
 std::vector<Component::IFabric_server *> Fabric_server_factory::connections()
 {
   auto g = Fabric_server_generic_factory::connections();
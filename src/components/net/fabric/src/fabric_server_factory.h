@@ -56,6 +56,12 @@ public:
    */
   Component::IFabric_server* get_new_connection() override;
 
+  /*
+   * @throw std::logic_error : unexpected event
+   * @throw std::system_error : read error on event pipe
+   */
+  Component::IFabric_server* wait_for_new_connection(std::chrono::milliseconds timeout) override;
+
   void close_connection(Component::IFabric_server* connection) override;
 
   std::vector<Component::IFabric_server*> connections() override;
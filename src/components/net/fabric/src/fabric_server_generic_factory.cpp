@@ -268,7 +268,16 @@ void Fabric_server_generic_factory::listen_loop(
 
 Fabric_memory_control * Fabric_server_generic_factory::get_new_connection()
 {
-  auto c = _pending.remove();
+  return open_connection(_pending.remove());
+}
+
+Fabric_memory_control * Fabric_server_generic_factory::wait_for_new_connection(std::chrono::milliseconds timeout)
+{
+  return open_connection(_pending.remove(timeout));
+}
+
+Fabric_memory_control * Fabric_server_generic_factory::open_connection(Pending_cnxns::cnxn_t c)
+{
   if ( c )
   {
     std::static_pointer_cast<Fabric_op_control>(
@@ -27,6 +27,7 @@
 #include "pending_cnxns.h"
 #include "open_cnxns.h"
 
+#include <chrono>
 #include <cstdint> /* uint16_t */
 #include <memory> /* shared_ptr */
 #include <thread>
@@ -73,6 +74,12 @@ class Fabric_server_generic_factory
    * @throw fabric_bad_alloc : std::bad_alloc - libfabric out of memory
    */
   virtual std::shared_ptr<Fabric_memory_control> new_server(Fabric &fabric, event_producer &eq, ::fi_info &info) = 0;
+  /*
+   * Move a pending connection (if any) to the open set
+   *
+   * @throw std::logic_error : unexpected event
+   */
+  Fabric_memory_control* open_connection(Pending_cnxns::cnxn_t c);
 protected:
   ~Fabric_server_generic_factory();
 public:
@@ -105,6 +112,12 @@ public:
    */
   Fabric_memory_control* get_new_connection();
 
+  /*
+   * @throw std::logic_error : unexpected event
+   * @throw std::system_error : read error on event pipe
+   */
+  Fabric_memory_control* wait_for_new_connection(std::chrono::milliseconds timeout);
+
   void close_connection(Fabric_memory_control* connection);
 
   std::vector<Fabric_memory_control*> connections();
@@ -164,6 +164,10 @@ public:
    */
   void wait_for_next_completion(std::chrono::milliseconds timeout) override { return Fabric_connection_server::wait_for_next_completion(timeout); }
   void unblock_completions() override { return Fabric_connection_server::unblock_completions(); }
+  /*
+   * @throw fabric_runtime_error : std::runtime_error : ::fi_control fail
+   */
+  bool prepare_wait(std::vector<int> &fds_) override { return Fabric_connection_server::prepare_wait(fds_); }
   /* END IFabric_server_grouped (IFabric_op_completer) */
 
   /*
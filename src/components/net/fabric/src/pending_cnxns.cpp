@@ -28,8 +28,11 @@ Pending_cnxns::Pending_cnxns()
 
 void Pending_cnxns::push(cnxn_t c)
 {
-  guard g{_m};
-  _q.push(c);
+  {
+    guard g{_m};
+    _q.push(c);
+  }
+  _cv.notify_all();
 }
 
 auto Pending_cnxns::remove() -> cnxn_t
@@ -43,3 +46,15 @@ auto Pending_cnxns::remove() -> cnxn_t
   }
   return c;
 }
+
+auto Pending_cnxns::remove(std::chrono::milliseconds timeout) -> cnxn_t
+{
+  cnxn_t c;
+  std::unique_lock<std::mutex> g{_m};
+  if ( _cv.wait_for(g, timeout, [this] { return _q.size() != 0; }) )
+  {
+    c = _q.front();
+    _q.pop();
+  }
+  return c;
+}
@@ -17,6 +17,8 @@
 #ifndef _PENDING_CONNECTIONS_H_
 #define _PENDING_CONNECTIONS_H_
 
+#include <chrono>
+#include <condition_variable>
 #include <memory> /* shared_ptr */
 #include <mutex>
 #include <queue>
@@ -30,11 +32,14 @@ public:
 private:
   std::mutex _m; /* protects _q */
   using guard = std::lock_guard<std::mutex>;
+  std::condition_variable _cv; /* signalled on push */
   std::queue<cnxn_t> _q;
 public:
   Pending_cnxns();
   void push(cnxn_t c);
   cnxn_t remove();
+  /* as remove, but wait up to timeout for a connection to arrive */
+  cnxn_t remove(std::chrono::milliseconds timeout);
 };
 
 #endif
@@ -193,9 +193,36 @@ namespace
 	}
 }
 
+namespace
+{
+	int single_region_id(const std::vector<nupm::Devdax_manager::config_t> &dax_config_)
+	{
+		if ( dax_config_.empty() )
+		{
+			return -1;
+		}
+		for ( const auto &c : dax_config_ )
+		{
+			if ( c.region_id != dax_config_.front().region_id )
+			{
+				return -1;
+			}
+		}
+		return int(dax_config_.front().region_id);
+	}
+}
+
 Devdax_manager::Devdax_manager(
 	const std::string &dax_map
 	, bool force_reset
 )
-	: nupm::Devdax_manager(parse_devdax_string(dax_map), force_reset)
+	: Devdax_manager(parse_devdax_string(dax_map), force_reset)
+{}
+
+Devdax_manager::Devdax_manager(
+	const std::vector<nupm::Devdax_manager::config_t> &dax_config_
+	, bool force_reset
+)
+	: nupm::Devdax_manager(dax_config_, force_reset)
+	, _region_id(single_region_id(dax_config_))
 {}
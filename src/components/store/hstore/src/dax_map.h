@@ -15,14 +15,26 @@ struct iovec; /* required but not declared by nupm/dax_map.h */
 
 #include <string>
 
+#include <vector>
+
 class Devdax_manager
 	: public nupm::Devdax_manager
 {
+	int _region_id;
+	Devdax_manager(
+		const std::vector<nupm::Devdax_manager::config_t> &dax_config
+		, bool force_reset
+	);
 public:
 	Devdax_manager(
 		const std::string &dax_map
 		, bool force_reset = false
 	);
+	/*
+	 * The region_id (NUMA node) shared by all entries of the dax_map,
+	 * or -1 if the entries name more than one (or there are none).
+	 */
+	int region_id() const { return _region_id; }
 };
 
 #endif
@@ -22,6 +22,7 @@
 #include <stdexcept>
 #include <string>
 #include <utility> /* hash, pair */
+#include <vector>
 
 /* Inteded to implement Hopscotch hashing
  * http://mcg.cs.tau.ac.il/papers/disc2008-hopscotch.pdf
@@ -323,13 +324,26 @@ namespace impl
 
 			bucket_control_t _bc[_segment_capacity];
 
+			/* One byte of hash per bucket, in DRAM, rebuilt at open, to filter
+			 * key compares. Meaningful only for owned content. The first
+			 * owner::size-1 entries repeat past the end, so that the fingerprints
+			 * of any neighbourhood are contiguous.
+			 */
+			using fingerprint_t = std::uint8_t;
+			std::vector<fingerprint_t> _fingerprint;
+			static auto fingerprint(hash_result_t h) -> fingerprint_t;
+			void fingerprint_set(bix_t ix, hash_result_t h);
+			void fingerprint_copy(bix_t dst, bix_t src);
+			void fingerprint_extend();
+			/* bits of the neighbourhood at ix whose fingerprint is f */
+			auto fingerprint_match(bix_t ix, fingerprint_t f) const -> owner::value_type;
+
 			six_t segment_count() const override
 			{
 				return persist_controller_t::segment_count_actual();
 			}
 
 			auto bucket_ix(const hash_result_t h) const -> bix_t;
-			auto bucket_expanded_ix(const hash_result_t h) const -> bix_t;
 
 			auto nearest_free_bucket(segment_and_bucket_t bi) -> content_unique_lock_t;
 
@@ -338,15 +352,29 @@ namespace impl
 				, content_unique_lock_t bf
 			) -> content_unique_lock_t;
 
-			template <typename Lock>
+			template <typename Lock, typename K>
 				auto locate_key(
 					Lock &bi
-					, const key_type &k
+					, const K &k
 				) const -> std::tuple<bucket_t *, segment_and_bucket_t>;
 
-			void resize();
-			void resize_pass1();
-			void resize_pass2();
+			/* Owners split by each write while a resize is in progress. Enough
+			 * that a resize finishes long before the table could fill again.
+			 */
+			static constexpr bix_t resize_step_owners = 8U;
+			void resize_start(hash_result_t h);
+			void resize_unwrap();
+			void resize_step(bix_t owner_count);
+			void resize_split_through(hash_result_t h);
+			auto resize_is_split(bix_t ix_senior) const -> bool;
+			void resize_split_owner(bix_t ix_senior);
+			void resize_relocate(
+				owner_unique_lock_t &senior_owner_lk
+				, const segment_and_bucket_t &sb_src
+				, bix_t ix_junior
+			);
+			void resize_recover();
+			void settle(const segment_and_bucket_t &a, bool release);
 			auto locate_bucket_mutexes(
 				const segment_and_bucket_t &
 			) const -> bucket_mutexes_t &;
@@ -361,7 +389,8 @@ namespace impl
 				, unsigned bkwd
 			) const -> owner_unique_lock_t;
 
-			auto make_owner_shared_lock(const key_type &k) const -> owner_shared_lock_t;
+			template <typename K>
+				auto make_owner_shared_lock(const K &k) const -> owner_shared_lock_t;
 			auto make_owner_shared_lock(
 				const segment_and_bucket_t &
 			) const -> owner_shared_lock_t;
@@ -391,7 +420,8 @@ namespace impl
 
 			static auto locate_owner(const segment_and_bucket_t &a) -> const owner &;
 
-			auto bucket(const key_type &) const -> size_type;
+			template <typename K>
+				auto bucket(const K &) const -> size_type;
 			auto bucket_size(const size_type n) const -> size_type;
 
 			bool is_free_by_owner(const segment_and_bucket_t &a) const;
@@ -403,11 +433,13 @@ namespace impl
 			 */
 			auto distance_wrapped(bix_t first, bix_t last) -> unsigned;
 
+#if TRACK_LOCATE
 			unsigned _locate_key_call;
 			unsigned _locate_key_owned;
 			unsigned _locate_key_unowned;
 			unsigned _locate_key_match;
 			unsigned _locate_key_mismatch;
+#endif
 
 		public:
 			explicit table_base(
@@ -428,10 +460,26 @@ namespace impl
 			template <typename ... Args>
 				auto emplace(Args && ... args) -> std::pair<iterator, bool>;
 			auto insert(const value_type &value) -> std::pair<iterator, bool>;
-			auto erase(const key_type &key) -> size_type;
-			auto at(const key_type &key) -> mapped_type &;
-			auto at(const key_type &key) const -> const mapped_type &;
-			auto count(const key_type &k) const -> size_type;
+			/* Lookups accept a key_type, or any key K for which hasher::hf(K)
+			 * and key_equal()(key_type, K) are defined. The latter lets a
+			 * caller probe the table without constructing a key_type.
+			 */
+			template <typename K>
+				auto erase(const K &key) -> size_type;
+			template <typename K>
+				auto at(const K &key) -> mapped_type &;
+			template <typename K>
+				auto at(const K &key) const -> const mapped_type &;
+			template <typename K>
+				auto count(const K &k) const -> size_type;
+			/* As at, but returns nullptr rather than throwing if k is absent */
+			template <typename K>
+				auto find_mapped(const K &k) const -> const mapped_type *;
+			/* Start to load the home bucket of k and its fingerprints, for a
+			 * lookup of k to follow. Batched lookups overlap their misses this way.
+			 */
+			template <typename K>
+				void prefetch(const K &k) const;
 			auto begin() -> iterator
 			{
 				return iterator(make_segment_and_bucket(0U));
@@ -497,11 +545,14 @@ namespace impl
 			}
 
 			/* use trylock to attempt a shared lock */
-			auto lock_shared(const key_type &k) -> bool;
+			template <typename K>
+				auto lock_shared(const K &k) -> bool;
 			/* use trylock to attempt a unique lock */
-			auto lock_unique(const key_type &k) -> bool;
+			template <typename K>
+				auto lock_unique(const K &k) -> bool;
 			/* unlock (from write if write exists, else read */
-			void unlock(const key_type &key);
+			template <typename K>
+				void unlock(const K &key);
 			auto size() const -> size_type;
 
 #if TRACE_TABLE
@@ -651,42 +702,61 @@ template <
 		{
 			return base::insert(value);
 		}
-		auto erase(const key_type &key) -> size_type
-		{
-			return base::erase(key);
-		}
+		template <typename K>
+			auto erase(const K &key) -> size_type
+			{
+				return base::erase(key);
+			}
 
-		/* lookup */
-		auto at(const key_type &key) const -> const mapped_type &
-		{
-			return base::at(key);
-		}
+		/* lookup (K: key_type, or a key comparable to key_type; see table_base) */
+		template <typename K>
+			auto at(const K &key) const -> const mapped_type &
+			{
+				return base::at(key);
+			}
 
-		auto at(const key_type &key) -> mapped_type &
-		{
-			return base::at(key);
-		}
+		template <typename K>
+			auto at(const K &key) -> mapped_type &
+			{
+				return base::at(key);
+			}
 
-		auto count(const key_type &key) const -> size_type
-		{
-			return base::count(key);
-		}
+		template <typename K>
+			auto count(const K &key) const -> size_type
+			{
+				return base::count(key);
+			}
+
+		template <typename K>
+			auto find_mapped(const K &key) const -> const mapped_type *
+			{
+				return base::find_mapped(key);
+			}
+
+		template <typename K>
+			void prefetch(const K &key) const
+			{
+				base::prefetch(key);
+			}
 
 		/* locking */
-		auto lock_shared(const key_type &k) -> bool
-		{
-			return base::lock_shared(k);
-		}
+		template <typename K>
+			auto lock_shared(const K &k) -> bool
+			{
+				return base::lock_shared(k);
+			}
 
-		auto lock_unique(const key_type &k) -> bool
-		{
-			return base::lock_unique(k);
-		}
+		template <typename K>
+			auto lock_unique(const K &k) -> bool
+			{
+				return base::lock_unique(k);
+			}
 
-		void unlock(const key_type &key)
-		{
-			return base::unlock(key);
-		}
+		template <typename K>
+			void unlock(const K &key)
+			{
+				return base::unlock(key);
+			}
 
 		template <typename Table>
 			friend class impl::table_local_iterator_impl;
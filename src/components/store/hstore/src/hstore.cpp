@@ -56,6 +56,7 @@
 #endif
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cerrno>
 #include <cstring> /* strerror, memcpy */
@@ -108,6 +109,27 @@ using DEALLOC_T = typename ALLOC_T::deallocator_type;
 using KEY_T = persist_fixed_string<char, DEALLOC_T>;
 using MAPPED_T = persist_fixed_string<char, DEALLOC_T>;
 
+/*
+ * A key with which to probe the table. Unlike KEY_T it does not copy the
+ * key into the pool, so lookups do not allocate. It carries its hash, so
+ * a lookup followed by a lock hashes the key only once.
+ */
+class key_view
+{
+  const char *_data;
+  std::size_t _size;
+  std::uint64_t _hash;
+public:
+  explicit key_view(const std::string &k_)
+    : _data(k_.data())
+    , _size(k_.size())
+    , _hash(CityHash64(_data, _size))
+  {}
+  const char *data() const { return _data; }
+  std::size_t size() const { return _size; }
+  std::uint64_t hash() const { return _hash; }
+};
+
 struct pstr_hash
 {
   using argument_type = KEY_T;
@@ -116,6 +138,26 @@ struct pstr_hash
   {
     return CityHash64(s.data(), s.size());
   }
+  static result_type hf(const key_view &k)
+  {
+    return k.hash();
+  }
+};
+
+struct pstr_equal
+{
+  bool operator()(const KEY_T &a, const KEY_T &b) const
+  {
+    return a == b;
+  }
+  bool operator()(const KEY_T &a, const key_view &b) const
+  {
+    return
+      a.size() == b.size()
+      &&
+      std::equal(b.data(), b.data() + b.size(), a.data())
+    ;
+  }
 };
 
 using HASHER_T = pstr_hash;
@@ -134,7 +176,7 @@ using table_t =
   KEY_T
   , MAPPED_T
   , HASHER_T
-  , std::equal_to<KEY_T>
+  , pstr_equal
   , allocator_segment_t
   , hstore_shared_mutex
   >;
@@ -406,8 +448,7 @@ auto hstore::get(const pool_t pool,
   try
     {
       const auto &session = dynamic_cast<const session_t &>(locate_session(pool));
-      auto p_key = KEY_T(key.begin(), key.end(), session.allocator());
-      auto &v = session.map().at(p_key);
+      auto &v = session.map().at(key_view(key));
 
       if(out_value == nullptr || out_value_len == 0) {
         out_value_len = v.size();
@@ -434,9 +475,8 @@ auto hstore::get_direct(const pool_t pool,
                         Component::IKVStore::memory_handle_t) -> status_t
   try {
     const auto &session = dynamic_cast<const session_t &>(locate_session(pool));
-    auto p_key = KEY_T(key.begin(), key.end(), session.allocator());
 
-    auto &v = session.map().at(p_key);
+    auto &v = session.map().at(key_view(key));
 
     auto value_len = v.size();
     if (out_value_len < value_len)
@@ -473,6 +513,86 @@ auto hstore::get_direct(const pool_t pool,
     throw General_exception("get_direct failed unexpectedly");
   }
 
+auto hstore::get_batch(const pool_t pool,
+                       const std::vector<std::string> &keys,
+                       std::vector<::iovec> &out_values,
+                       std::vector<status_t> &out_status) -> status_t
+try {
+  const auto &session = dynamic_cast<const session_t &>(locate_session(pool));
+  const auto &map = session.map();
+
+  out_values.assign(keys.size(), ::iovec{nullptr, 0});
+  out_status.assign(keys.size(), E_KEY_NOT_FOUND);
+
+  /* Hash every key first */
+  std::vector<key_view> kv;
+  kv.reserve(keys.size());
+  for ( const auto &k : keys )
+    {
+      kv.emplace_back(k);
+    }
+
+  /* Then resolve the keys in groups, each stage of which issues the loads
+   * of the next stage for every key of the group before it uses any of
+   * them. A group's misses overlap, rather than each lookup's misses
+   * following the last.
+   */
+  constexpr std::size_t group_size = 16;
+  std::array<const typename table_t::mapped_type *, group_size> v;
+  for ( std::size_t base = 0; base < kv.size(); base += group_size )
+    {
+      const auto count = std::min(group_size, kv.size() - base);
+
+      /* stage 1: home buckets and their fingerprints */
+      for ( std::size_t i = 0; i != count; ++i )
+        {
+          map.prefetch(kv[base + i]);
+        }
+
+      /* stage 2: probe; value headers (which precede the data) */
+      for ( std::size_t i = 0; i != count; ++i )
+        {
+          v[i] = map.find_mapped(kv[base + i]);
+          if ( v[i] )
+            {
+              __builtin_prefetch(v[i]->data());
+            }
+        }
+
+      /* stage 3: copy out */
+      for ( std::size_t i = 0; i != count; ++i )
+        {
+          if ( v[i] )
+            {
+              const auto len = v[i]->size();
+              auto p = malloc(len);
+              if ( ! p )
+                {
+                  out_status[base + i] = E_FAIL;
+                  continue;
+                }
+              memcpy(p, v[i]->data(), len);
+              out_values[base + i] = ::iovec{p, len};
+              out_status[base + i] = S_OK;
+            }
+        }
+    }
+  return S_OK;
+}
+catch ( const std::bad_alloc & )
+  {
+    for ( auto &iov : out_values )
+      {
+        free(iov.iov_base);
+      }
+    out_values.clear();
+    out_status.clear();
+    return E_FAIL;
+  }
+catch (...) {
+  throw General_exception(PREFIX "failed unexpectedly", __func__);
+}
+
 #if 0
 namespace
 {
@@ -491,12 +611,12 @@ public:
 
 namespace
 {
-bool try_lock(table_t &map, hstore::lock_type_t type, const KEY_T &p_key)
+bool try_lock(table_t &map, hstore::lock_type_t type, const key_view &k)
 {
   return
     type == Component::IKVStore::STORE_LOCK_READ
-    ? map.lock_shared(p_key)
-    : map.lock_unique(p_key)
+    ? map.lock_shared(k)
+    : map.lock_unique(k)
     ;
 }
 }
@@ -508,12 +628,12 @@ auto hstore::lock(const pool_t pool,
                   std::size_t & out_value_len) -> key_t
 {
   auto &session = dynamic_cast<session_t &>(locate_session(pool));
-  const auto p_key = KEY_T(key.begin(), key.end(), session.allocator());
+  const key_view k(key);
 
   try
     {
-      MAPPED_T &val = session.map().at(p_key);
-      if ( ! try_lock(session.map(), type, p_key) )
+      MAPPED_T &val = session.map().at(k);
+      if ( ! try_lock(session.map(), type, k) )
         {
           return KEY_NONE;
         }
@@ -534,7 +654,7 @@ auto hstore::lock(const pool_t pool,
       auto r =
         session.map().emplace(
                               std::piecewise_construct
-                              , std::forward_as_tuple(p_key)
+                              , std::forward_as_tuple(key.begin(), key.end(), session.allocator())
                               , std::forward_as_tuple(out_value_len, session.allocator())
                               );
 
@@ -559,9 +679,8 @@ auto hstore::unlock(const pool_t pool,
     {
       try {
         auto &session = dynamic_cast<session_t &>(locate_session(pool));
-        auto p_key = KEY_T(key->begin(), key->end(), session.allocator());
 
-        session.map().unlock(p_key);
+        session.map().unlock(key_view(*key));
       }
       catch ( const std::out_of_range &e )
         {
@@ -579,12 +698,12 @@ auto hstore::unlock(const pool_t pool,
 class maybe_lock
 {
   table_t &_map;
-  const KEY_T &_key;
+  const key_view &_key;
   bool _taken;
 public:
-  maybe_lock(table_t &map_, const KEY_T &pkey_, bool take_)
+  maybe_lock(table_t &map_, const key_view &key_, bool take_)
     : _map(map_)
-    , _key(pkey_)
+    , _key(key_)
     , _taken(false)
   {
     if ( take_ )
@@ -615,10 +734,10 @@ auto hstore::apply(
 {
   auto &session = dynamic_cast<session_t &>(locate_session(pool));
   MAPPED_T *val;
-  auto p_key = KEY_T(key.begin(), key.end(), session.allocator());
+  const key_view k(key);
   try
     {
-      val = &session.map().at(p_key);
+      val = &session.map().at(k);
     }
   catch ( const std::out_of_range & )
     {
@@ -634,7 +753,7 @@ auto hstore::apply(
       auto r =
         session.map().emplace(
                               std::piecewise_construct
-                              , std::forward_as_tuple(p_key)
+                              , std::forward_as_tuple(key.begin(), key.end(), session.allocator())
                               , std::forward_as_tuple(object_size, session.allocator())
                               );
       if ( ! r.second )
@@ -647,7 +766,7 @@ auto hstore::apply(
   auto data = static_cast<char *>(val->data());
   auto data_len = val->size();
 
-  maybe_lock m(session.map(), p_key, take_lock);
+  maybe_lock m(session.map(), k, take_lock);
 
   functor(data, data_len);
 
@@ -660,9 +779,8 @@ auto hstore::erase(const pool_t pool,
 {
   try {
     auto &session = dynamic_cast<session_t &>(locate_session(pool));
-    auto p_key = KEY_T(key.begin(), key.end(), session.allocator());
     return
-      session.map().erase(p_key) == 0
+      session.map().erase(key_view(key)) == 0
       ? E_KEY_NOT_FOUND
       : S_OK
       ;
@@ -767,10 +885,11 @@ auto hstore::atomic_update(
     {
       auto &session = dynamic_cast<session_t &>(locate_session(pool));
 
-      auto p_key = KEY_T(key.begin(), key.end(), session.allocator());
-
-      maybe_lock m(session.map(), p_key, take_lock);
+      const key_view k(key);
+      maybe_lock m(session.map(), k, take_lock);
 
+      /* The persistent key is needed only by the update's redo record */
+      auto p_key = KEY_T(key.begin(), key.end(), session.allocator());
       return session.enter_update(p_key, op_vector.begin(), op_vector.end());
     }
   catch ( std::exception & )
@@ -120,6 +120,11 @@ public:
                       std::size_t& out_value_len,
                       Component::IKVStore::memory_handle_t handle) override;
 
+  status_t get_batch(pool_t pool,
+                     const std::vector<std::string> &keys,
+                     std::vector<::iovec> &out_values,
+                     std::vector<status_t> &out_status) override;
+
   key_t lock(pool_t pool,
                 const std::string &key,
                 lock_type_t type,
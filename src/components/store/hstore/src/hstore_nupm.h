@@ -125,10 +125,18 @@ private:
 
   bool debug() { return false; }
 public:
+  /* The NUMA node is the region_id of the dax_map when it names just
+   * one; otherwise, as before, the last character of the component name.
+   * It is not taken from pool names, which determine pool region IDs.
+   */
   hstore_nupm(const std::string &, const std::string &name_, std::unique_ptr<Devdax_manager> mgr_, bool debug_)
     : pool_manager(debug_)
     , _devdax_manager(std::move(mgr_))
-    , _numa_node(name_to_numa_node(name_))
+    , _numa_node(
+        _devdax_manager->region_id() < 0
+        ? name_to_numa_node(name_)
+        : unsigned(_devdax_manager->region_id())
+      )
   {}
 
   virtual ~hstore_nupm() {}
@@ -168,6 +176,15 @@ public:
       throw General_exception("failed to re-open region %s", path_.str().c_str());
     }
 
+    /* A region not initialized, or initialized with another persist_data_t
+     * layout, is usable only for deletion.
+     */
+    if ( ! pop->is_initialized() )
+    {
+      PWRN(PREFIX "in %s: region ID %" PRIx64 " has no map of this version", __func__, path_.str().c_str(), uuid);
+      return std::make_unique<open_pool<open_pool_handle>>(path_, std::move(pop));
+    }
+
     void *a = &pop->heap;
 
 #if USE_CC_HEAP == 3
@@ -41,7 +41,10 @@ using Persister = persister_pmem;
 
 namespace
 {
-  const char *REGION_NAME = "hstore-data";
+  /* The pmemobj layout name. Change it whenever the layout of persist_data_t
+   * changes, so that pmemobj_open refuses a pool written with the old layout.
+   */
+  const char *REGION_NAME = "hstore-data-2";
 
   struct root_anchors
   {
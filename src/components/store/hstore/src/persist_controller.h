@@ -25,17 +25,19 @@ namespace impl
 		{
 			persist_controller<Allocator> *_pc;
 		public:
-			persist_size_change(persist_controller<Allocator> &pc_)
-				: SizeChange(pc_.get_size_control())
+			/* bix_ is the content bucket whose ownership changes */
+			persist_size_change(persist_controller<Allocator> &pc_, std::size_t bix_)
+				: SizeChange(pc_.get_size_control(), bix_)
 				, _pc(&pc_)
 			{
-				_pc->size_destabilize();
+				_pc->persist_size();
 			}
 			persist_size_change(const persist_size_change &) = delete;
 			persist_size_change& operator=(const persist_size_change &) = delete;
 			~persist_size_change()
 			{
-				_pc->size_stabilize();
+				this->complete();
+				_pc->persist_size();
 			}
 		};
 
@@ -58,8 +60,13 @@ namespace impl
 			using bucket_allocator_t = typename persist_data_t::bucket_allocator_t;
 			persist_data_t *_persist;
 			std::size_t _bucket_count_cached;
+			/* DRAM copies of persist_data_t::resize_control, read by every lookup */
+			bix_t _resize_senior_count_cached;
+			bix_t _resize_first_cached;
+			bix_t _resize_split_cached;
 
 			void persist_segment_table(); /* Flush the bucket pointers (*_b) */
+			void persist_resize(); /* Flush the resize state */
 			void persist_internal(
 				const void *first
 				, const void *last
@@ -78,11 +85,23 @@ namespace impl
 				const persist_controller &
 			) -> persist_controller & = delete;
 
+			/* Resize, in three steps:
+			 *  prolog: allocate the new segment (not yet part of the table)
+			 *  expand: add the segment to the table; owners begin to split
+			 *  epilog: all senior owners have split
+			 */
 			auto resize_prolog() -> bucket_aligned_t *;
+			void resize_expand(bix_t first);
+			void resize_relocate_begin(bix_t src, bix_t dst);
+			void resize_split_advance();
 			void resize_epilog();
 
-			void size_stabilize();
-			void size_destabilize();
+			bool is_resizing() const { return _resize_senior_count_cached != 0; }
+			bix_t resize_senior_count() const { return _resize_senior_count_cached; }
+			bix_t resize_first() const { return _resize_first_cached; }
+			bix_t resize_split() const { return _resize_split_cached; }
+			bix_t resize_relocate_src() const { return _persist->_resize._relocate_src; }
+			bix_t resize_relocate_dst() const { return _persist->_resize._relocate_dst; }
 
 			void persist_owner(
 				const owner &b
@@ -113,6 +132,10 @@ namespace impl
 			{
 				return _persist->_size_control;
 			}
+			const size_control &get_size_control() const
+			{
+				return _persist->_size_control;
+			}
 
 			/* NOTE: this function returns an non-const iterator over _persist data,
 			 * allowing successive accesses to *_persist without intervening "ticks."
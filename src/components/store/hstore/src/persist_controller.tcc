@@ -24,6 +24,9 @@ template <typename Allocator>
 		: Allocator(av_)
 		, _persist(persist_)
 		, _bucket_count_cached(bucket_count_uncached())
+		, _resize_senior_count_cached(0)
+		, _resize_first_cached(0)
+		, _resize_split_cached(0)
 	{
 		assert(_persist->_segment_count._target <= _segment_capacity);
 		assert(1U <= _persist->_segment_count._target);
@@ -40,6 +43,15 @@ template <typename Allocator>
 		{
 			_persist->reconstitute(av_);
 		}
+		/* The resize state is meaningful only once the new segment is in the
+		 * table. Before that, the resize will be restarted.
+		 */
+		if ( _persist->_segment_count._actual == _persist->_segment_count._target )
+		{
+			_resize_senior_count_cached = _persist->_resize._senior_count;
+			_resize_first_cached = _persist->_resize._first;
+			_resize_split_cached = _persist->_resize._split;
+		}
 	}
 
 template <typename Allocator>
@@ -136,6 +148,16 @@ template <typename Allocator>
 		persist_internal(&sc[0], &sc[persist_data_t::_segment_capacity], "segments");
 	}
 
+template <typename Allocator>
+	void impl::persist_controller<Allocator>::persist_resize()
+	{
+		persist_internal(
+			&_persist->_resize
+			, &_persist->_resize+1U
+			, "resize"
+		);
+	}
+
 template <typename Allocator>
 	void impl::persist_controller<Allocator>::persist_size()
 	{
@@ -159,20 +181,6 @@ template <typename Allocator>
 		persist_size();
 	}
 
-template <typename Allocator>
-	void impl::persist_controller<Allocator>::size_destabilize()
-	{
-		_persist->_size_control.destabilize();
-		persist_size();
-	}
-
-template <typename Allocator>
-	void impl::persist_controller<Allocator>::size_stabilize()
-	{
-		_persist->_size_control.stabilize();
-		persist_size();
-	}
-
 template <typename Allocator>
 	auto impl::persist_controller<Allocator>::resize_prolog(
 	) -> bucket_aligned<hash_bucket<value_type>> * /* bucket_aligned_t */
@@ -183,12 +191,17 @@ template <typename Allocator>
 		using void_allocator_t =
 			typename bucket_allocator_t::template rebind<void>::other;
 
-		auto ptr =
-			bucket_allocator_t(*this).allocate(
-				bucket_count()
-				, typename void_allocator_t::const_pointer()
-				, "resize"
-			);
+		/* A resize interrupted before expand may have left a segment to reuse */
+		auto ptr = _persist->_sc[_persist->_segment_count._actual].bp;
+		if ( ! ptr )
+		{
+			ptr =
+				bucket_allocator_t(*this).allocate(
+					bucket_count()
+					, typename void_allocator_t::const_pointer()
+					, "resize"
+				);
+		}
 		new (&*ptr) typename persist_data_t::bucket_aligned_t[bucket_count()];
 		_persist->_sc[_persist->_segment_count._actual].bp = ptr;
 
@@ -199,9 +212,45 @@ template <typename Allocator>
 	}
 
 template <typename Allocator>
-	void impl::persist_controller<Allocator>::resize_epilog()
+	void impl::persist_controller<Allocator>::resize_expand(bix_t first_)
 	{
+		/* 1. record the split state, 2. add the segment to the table.
+		 * A crash between 1 and 2 restarts the resize.
+		 */
+		_persist->_resize._senior_count = bucket_count();
+		_persist->_resize._first = first_;
+		_persist->_resize._split = 0U;
+		_persist->_resize._relocate_src = 0U;
+		_persist->_resize._relocate_dst = 0U;
+		persist_resize();
 		_persist->_segment_count._actual = _persist->_segment_count._target;
-		_bucket_count_cached = bucket_count_uncached();
 		persist_segment_count();
+
+		_resize_senior_count_cached = bucket_count();
+		_resize_first_cached = first_;
+		_resize_split_cached = 0U;
+		_bucket_count_cached = bucket_count_uncached();
+	}
+
+template <typename Allocator>
+	void impl::persist_controller<Allocator>::resize_relocate_begin(bix_t src_, bix_t dst_)
+	{
+		_persist->_resize._relocate_src = src_;
+		_persist->_resize._relocate_dst = dst_;
+		persist_resize();
+	}
+
+template <typename Allocator>
+	void impl::persist_controller<Allocator>::resize_split_advance()
+	{
+		_persist->_resize._split = ++_resize_split_cached;
+		persist_resize();
+	}
+
+template <typename Allocator>
+	void impl::persist_controller<Allocator>::resize_epilog()
+	{
+		_persist->_resize._senior_count = 0U;
+		persist_resize();
+		_resize_senior_count_cached = 0U;
 	}
@@ -20,29 +20,48 @@ namespace impl
 	template <typename Allocator>
 		class persist_controller;
 
-	class size_control
+	/* Aligned so that both fields share a cache line: _in_flight is stored
+	 * before the unstable mark, and no persisted unstable mark can lack it.
+	 */
+	class alignas(2U * sizeof(std::size_t)) size_control
 	{
 		/* unstable == 0 implies that size is valid and persisted
-		 * if unstable != 0, restart must individually count the contents.
+		 * if unstable == 1, restart need examine only the in-flight bucket.
+		 * if unstable > 1, restart must individually count the contents.
 		 *
 		 * The size_and_unstable field is 2^N times the actual size,
 		 * and the lower N bits represents "unstable," not part of the size.
 		 */
 		persistent_atomic_t<std::size_t> _size_and_unstable;
+		/* While unstable, the content bucket whose ownership is changing,
+		 * times 2, plus 1 if the change is an insert.
+		 */
+		persistent_atomic_t<std::size_t> _in_flight;
 		static constexpr unsigned N = 8;
 		static constexpr std::size_t count_1 = 1U<<N;
 		std::size_t destable_count() const { return _size_and_unstable & (count_1-1U); }
 	public:
 		size_control()
 			: _size_and_unstable(0)
+			, _in_flight(0)
 		{}
 		void size_set_stable(std::size_t n) { _size_and_unstable = (n << N); }
 		std::size_t size() const { assert( is_stable() ); return _size_and_unstable >> N; }
-		void stabilize() { assert(destable_count() != 0); --_size_and_unstable; }
-		void destabilize() { ++_size_and_unstable; assert(destable_count() != 0); }
-		void decr() { _size_and_unstable -= count_1; }
-		void incr() { _size_and_unstable += count_1; }
+		/* the size before the in-flight change */
+		std::size_t size_unstable() const { return _size_and_unstable >> N; }
+		void destabilize(std::size_t bix, bool incr)
+		{
+			_in_flight = bix * 2U + ( incr ? 1U : 0U );
+			++_size_and_unstable;
+			assert(destable_count() != 0);
+		}
+		/* adjust the size and mark it stable, in a single store */
+		void stabilize_decr() { assert(destable_count() != 0); _size_and_unstable = _size_and_unstable - count_1 - 1U; }
+		void stabilize_incr() { assert(destable_count() != 0); _size_and_unstable = _size_and_unstable + count_1 - 1U; }
 		bool is_stable() const { return destable_count() == 0; }
+		bool is_in_flight_known() const { return destable_count() == 1U; }
+		std::size_t in_flight_bucket() const { return _in_flight / 2U; }
+		bool in_flight_is_incr() const { return ( _in_flight & 1U ) != 0U; }
 	};
 
 	/* Size change state as an object. Not for RIAA strictness, but to move a memory
@@ -56,14 +75,10 @@ namespace impl
 	protected:
 		size_control & get_size_control() const { return *_size_control; }
 	public:
-		size_change(size_control &ctl)
+		size_change(size_control &ctl, std::size_t bix, bool incr)
 			: _size_control(&ctl)
 		{
-			_size_control->destabilize();
-		}
-		~size_change()
-		{
-			_size_control->stabilize();
+			_size_control->destabilize(bix, incr);
 		}
 	};
 
@@ -71,12 +86,12 @@ namespace impl
 		: public size_change
 	{
 	public:
-		size_incr(size_control &ctl)
-			: size_change(ctl)
+		size_incr(size_control &ctl, std::size_t bix)
+			: size_change(ctl, bix, true)
 		{}
-		~size_incr()
+		void complete()
 		{
-			get_size_control().incr();
+			get_size_control().stabilize_incr();
 		}
 	};
 
@@ -84,12 +99,12 @@ namespace impl
 		: public size_change
 	{
 	public:
-		size_decr(size_control &ctl)
-			: size_change(ctl)
+		size_decr(size_control &ctl, std::size_t bix)
+			: size_change(ctl, bix, false)
 		{}
-		~size_decr()
+		void complete()
 		{
-			get_size_control().decr();
+			get_size_control().stabilize_decr();
 		}
 	};
 
@@ -130,6 +145,33 @@ namespace impl
 				}
 			};
 
+			/* State of an incremental resize. The resize makes the table
+			 * twice as large at once, then divides the content of each senior
+			 * owner (those present before the resize) between the owner and
+			 * its junior, owner + senior_count, a few owners at a time.
+			 */
+			struct resize_control
+			{
+				/* bucket count before the resize; 0 if no resize in progress */
+				persistent_atomic_t<bix_t> _senior_count;
+				/* the first senior owner to split */
+				persistent_atomic_t<bix_t> _first;
+				/* the number of senior owners, starting at _first, split */
+				persistent_atomic_t<bix_t> _split;
+				/* the source and destination of the latest relocation.
+				 * Settling them is harmless once the relocation is complete.
+				 */
+				persistent_atomic_t<bix_t> _relocate_src;
+				persistent_atomic_t<bix_t> _relocate_dst;
+				resize_control()
+					: _senior_count(0)
+					, _first(0)
+					, _split(0)
+					, _relocate_src(0)
+					, _relocate_dst(0)
+				{}
+			};
+
 			static constexpr six_t _segment_capacity = 32U;
 			static constexpr unsigned log2_base_segment_size =
 				segment_layout::log2_base_segment_size;
@@ -142,6 +184,8 @@ namespace impl
 
 			segment_control _sc[_segment_capacity];
 
+			resize_control _resize;
+
 		public:
 			persist_map(std::size_t n, Allocator av);
 			void do_initial_allocation(Allocator av);
@@ -21,6 +21,7 @@ template <typename Allocator>
 			((n*3U)/base_segment_size == 0 ? 1U : segment_layout::log2((3U * n)/base_segment_size))
 		)
 		, _sc{}
+		, _resize{}
 	{
 		do_initial_allocation(av_);
 	}
@@ -80,5 +81,12 @@ template <typename Allocator>
 				auto segment_size = base_segment_size<<(ix-1U);
 				av.reconstitute(segment_size, _sc[ix].bp);
 			}
+
+			/* a segment allocated by an unfinished resize, to be reused */
+			if ( _segment_count._actual != _segment_count._target && _sc[_segment_count._actual].bp )
+			{
+				auto ix = _segment_count._actual;
+				av.reconstitute(base_segment_size<<(ix-1U), _sc[ix].bp);
+			}
 		}
 	}
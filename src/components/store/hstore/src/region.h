@@ -5,7 +5,10 @@
 
 class region
 {
-  static constexpr std::uint64_t magic_value = 0xc74892d72eed493a;
+  /* Change magic_value whenever the layout of persist_data_t changes, so that
+   * a region written with the old layout is not opened as a map.
+   */
+  static constexpr std::uint64_t magic_value = 0xc74892d72eed493b;
   std::uint64_t magic;
 public:
   persist_data_t persist_data;
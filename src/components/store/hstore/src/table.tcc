@@ -16,6 +16,7 @@
 #include <algorithm>
 #include <cassert>
 #include <exception>
+#include <limits> /* numeric_limits */
 #if TRACE_PERISHABLE_EXPIRY
 #include <iostream> /* for perishable_expiry */
 #endif
@@ -25,6 +26,10 @@
 #include <sstream> /* ostringstream */
 #endif
 
+#if __SSE2__
+#include <immintrin.h>
+#endif
+
 /*
  * ===== table_base =====
  */
@@ -41,11 +46,14 @@ template <
     : table_allocator<Allocator>{av_}
     , persist_controller_t(av_, pc_, mode_)
     , _hasher{}
+    , _fingerprint(persist_controller_t::bucket_count() + owner::size - 1U)
+#if TRACK_LOCATE
     , _locate_key_call(0)
     , _locate_key_owned(0)
     , _locate_key_unowned(0)
     , _locate_key_match(0)
     , _locate_key_mismatch(0)
+#endif
   {
     const auto bp_src = persist_controller_t::bp_src();
     const auto bc_dst =
@@ -85,37 +93,182 @@ template <
       << " count_target " << persist_controller_t::segment_count_target() << "\n";
 #endif
 
+    /* Repairs of an interrupted operation touch only the buckets which the
+     * operation recorded. They precede the pass over the table below, which
+     * then sees no unresolved content.
+     *
+     * If table allocation is incomplete (perhaps in the middle of a resize op),
+     * there is nothing to repair: the changes are confined to the new segment,
+     * which is not yet part of the table. The next resize reuses the segment.
+     *
+     * An interrupted update or replace is redone by the atomic_controller,
+     * which the session constructs once the table exists.
+     */
+    const auto &sc = persist_controller_t::get_size_control();
+    const bool size_in_flight_known =
+      persist_controller_t::is_size_unstable() && sc.is_in_flight_known();
+    bool size_in_flight_owned = false;
+    if ( size_in_flight_known )
     {
-      /* ERROR: will this work if size is unstable? (Yes, because iterator no longer depends on size */
-      for ( iterator it = begin(); it != end(); ++it )
-      {
-        /* reconsititute key and value */
-        it->first.reconstitute(av_);
-        it->second.reconstitute(av_);
-      }
+      /* One insert or erase was interrupted. It took effect if and only
+       * if its content bucket ended up owned. Unowned content is marked
+       * free but not released: the heap has not yet learned of its
+       * allocation, and by not learning of it treats it as free.
+       */
+      const auto sb = make_segment_and_bucket(sc.in_flight_bucket());
+      size_in_flight_owned = ! is_free_by_owner(sb);
+      auto content_lk = make_content_unique_lock(sb);
+      content_lk.ref().state_set(size_in_flight_owned ? bucket_t::IN_USE : bucket_t::FREE);
+      persist_controller_t::persist_content(content_lk.ref(), "recover size in flight");
+    }
+
+    if ( persist_controller_t::is_resizing() )
+    {
+      /* A resize was splitting owners. Continue with the next write. */
+      resize_recover();
     }
 
-    /* If table allocation incomplete (perhaps in the middle of a resize op), resize until large enough. */
-    while ( persist_controller_t::segment_count_actual() != persist_controller_t::segment_count_target() )
+    /* The one pass over the table which open cannot avoid: the heap keeps
+     * its allocation state in DRAM, and must learn of every allocation in
+     * use. The same pass rebuilds the fingerprints and counts the content,
+     * so that neither costs a pass of its own.
+     */
+    size_type in_use = 0U;
     {
-      /* ERROR: reconstruction code for resize state not written. */
-      /* ERROR: reconstruction code for update/replace state not written. */
-      resize();
+      auto sb = make_segment_and_bucket(0U);
+      for ( bix_t ix = 0U; ix != bucket_count(); ++ix, sb.incr() )
+      {
+        if ( ! is_free(sb) )
+        {
+          const auto &c = sb.deref();
+          /* reconsititute key and value */
+          c.key().reconstitute(av_);
+          c.mapped().reconstitute(av_);
+          fingerprint_set(ix, _hasher.hf(c.key()));
+          ++in_use;
+        }
+      }
     }
 
     if ( persist_controller_t::is_size_unstable() )
     {
-      size_type s = 0U;
-      /* a slow way to find the table size, but we have no other way. */
-      for ( const auto i : *this )
+      if ( size_in_flight_known )
       {
-        (void)i;
-        ++s;
+        const auto s = sc.size_unstable();
+        persist_controller_t::size_set(
+          sc.in_flight_is_incr()
+          ? ( size_in_flight_owned ? s + 1U : s )
+          : ( size_in_flight_owned ? s : s - 1U )
+        );
       }
-      persist_controller_t::size_set(s);
+      else
+      {
+        persist_controller_t::size_set(in_use);
+      }
+    }
+  }
+
+template <
+  typename Key, typename T, typename Hash, typename Pred
+  , typename Allocator, typename SharedMutex
+>
+  auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::fingerprint(
+    const hash_result_t h_
+  ) -> fingerprint_t
+  {
+    /* The high bits: bucket_ix uses the low bits */
+    return
+      static_cast<fingerprint_t>(
+        h_ >> ( std::numeric_limits<hash_result_t>::digits - std::numeric_limits<fingerprint_t>::digits )
+      );
+  }
+
+template <
+  typename Key, typename T, typename Hash, typename Pred
+  , typename Allocator, typename SharedMutex
+>
+  void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::fingerprint_set(
+    const bix_t ix_
+    , const hash_result_t h_
+  )
+  {
+    const auto f = fingerprint(h_);
+    _fingerprint[ix_] = f;
+    if ( ix_ < owner::size - 1U )
+    {
+      _fingerprint[ix_ + bucket_count()] = f;
     }
   }
 
+template <
+  typename Key, typename T, typename Hash, typename Pred
+  , typename Allocator, typename SharedMutex
+>
+  void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::fingerprint_copy(
+    const bix_t dst_
+    , const bix_t src_
+  )
+  {
+    const auto f = _fingerprint[src_];
+    _fingerprint[dst_] = f;
+    if ( dst_ < owner::size - 1U )
+    {
+      _fingerprint[dst_ + bucket_count()] = f;
+    }
+  }
+
+template <
+  typename Key, typename T, typename Hash, typename Pred
+  , typename Allocator, typename SharedMutex
+>
+  void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::fingerprint_extend()
+  {
+    /* The old repeated entries are already those of the new segment's
+     * first buckets, which resize_unwrap copied from the table start.
+     */
+    _fingerprint.resize(bucket_count() + owner::size - 1U);
+    std::copy(
+      _fingerprint.begin()
+      , _fingerprint.begin() + (owner::size - 1U)
+      , _fingerprint.begin() + std::ptrdiff_t(bucket_count())
+    );
+  }
+
+template <
+  typename Key, typename T, typename Hash, typename Pred
+  , typename Allocator, typename SharedMutex
+>
+  auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::fingerprint_match(
+    const bix_t ix_
+    , const fingerprint_t f_
+  ) const -> owner::value_type
+  {
+    static_assert(owner::size == 32U, "fingerprint match expects a 32-bucket neighbourhood");
+    const auto p = &_fingerprint[ix_];
+#if __AVX2__
+    const auto m =
+      _mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))
+        , _mm256_set1_epi8(static_cast<char>(f_))
+      );
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+#elif __SSE2__
+    const auto fv = _mm_set1_epi8(static_cast<char>(f_));
+    const auto lo =
+      _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), fv));
+    const auto hi =
+      _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16)), fv));
+    return static_cast<std::uint32_t>(lo) | ( static_cast<owner::value_type>(hi) << 16U );
+#else
+    owner::value_type m = 0U;
+    for ( auto i = 0U; i != owner::size; ++i )
+    {
+      m |= owner::value_type( p[i] == f_ ) << i;
+    }
+    return m;
+#endif
+  }
+
 template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
@@ -226,32 +379,26 @@ template <
     const hash_result_t h_
   ) const -> bix_t
   {
+    /* During a resize, an owner which has not yet split keeps the keys
+     * which will belong to its junior.
+     */
+    if ( persist_controller_t::is_resizing() )
+    {
+      const auto ix_senior = h_ & ( persist_controller_t::resize_senior_count() - 1U );
+      if ( ! resize_is_split(ix_senior) )
+      {
 #if DEBUG_TRACE_BUCKET_IX
-    std::cerr << __func__ << " h_ " << h_
-      << " mask " << mask() << " -> " << ( h_ & mask() ) << "\n";
+        std::cerr << __func__ << " h_ " << h_
+          << " unsplit -> " << ix_senior << "\n";
 #endif
-    return h_ & mask();
-  }
-
-/* From a hash, return the index of the bucket (in seg_entry) to which it maps,
- * including a single new segment not in count.
- */
-template <
-  typename Key, typename T, typename Hash, typename Pred
-  , typename Allocator, typename SharedMutex
->
-  auto impl::table_base<
-    Key, T, Hash, Pred, Allocator, SharedMutex
-  >::bucket_expanded_ix(
-    const hash_result_t h_
-  ) const -> bix_t
-  {
-    auto mask_expanded = (mask() << 1U) + 1;
+        return ix_senior;
+      }
+    }
 #if DEBUG_TRACE_BUCKET_IX
     std::cerr << __func__ << " h_ " << h_
-      << " mask " << mask_expanded << " -> " << ( h_ & mask_expanded ) << "\n";
+      << " mask " << mask() << " -> " << ( h_ & mask() ) << "\n";
 #endif
-    return h_ & mask_expanded;
+    return h_ & mask();
   }
 
 /*
@@ -403,6 +550,7 @@ template <
       }
 #endif
       b_dst_lock_.ref().content_share(b_src_lock.ref());
+      fingerprint_copy(b_dst_lock_.index(), b_src_lock.index());
       /* The owner will
        *  a) lose at element at position p and
        *  b) gain the element at position b_dst_lock_ (relative to lock.index())
@@ -477,11 +625,13 @@ template <
         << make_table_dump(*this)
         << __func__ << " END LIST\n";
 #endif
+      resize_step(resize_step_owners);
     RETRY:
       /* convert the args to a value_type */
       auto v = value_type(std::forward<Args>(args)...);
+      const auto h = _hasher.hf(v.first);
       /* The bucket in which to place the new entry */
-      auto sbw = make_segment_and_bucket(bucket(v.first));
+      auto sbw = make_segment_and_bucket(bucket_ix(h));
       auto owner_lk = make_owner_unique_lock(sbw);
 
       /* If the key already exists, refuse to emplace */
@@ -508,6 +658,7 @@ template <
 
         b_dst.assert_clear(true, *this);
         b_dst.ref().content_construct(owner_lk.index(), std::move(v));
+        fingerprint_set(b_dst.index(), h);
 
         /* 4-step change to owner:
          *  1. mark the size "unstable"
@@ -521,10 +672,10 @@ template <
          *  4. mark the size as "stable"
          *   flush (8 bytes)
          */
-        b_dst.ref().state_set(bucket_t::IN_USE);
-        persist_controller_t::persist_content(b_dst.ref(), "content in use");
         {
-          persist_size_change<Allocator, size_incr> s(*this);
+          persist_size_change<Allocator, size_incr> s(*this, b_dst.index());
+          b_dst.ref().state_set(bucket_t::IN_USE);
+          persist_controller_t::persist_content(b_dst.ref(), "content in use");
           owner_lk.ref().insert(
             owner_lk.index()
             , distance_wrapped(owner_lk.index(), b_dst.index())
@@ -546,9 +697,14 @@ template <
 #if TRACE_MANY
         std::cerr << "1. before resize\n" << make_table_dump(*this) << "\n";
 #endif
+        if ( persist_controller_t::is_resizing() )
+        {
+          resize_split_through(h);
+          goto RETRY;
+        }
         if ( segment_count() < _segment_capacity )
         {
-          resize();
+          resize_start(h);
 #if TRACE_MANY
           std::cerr << "2. after resize\n" << make_table_dump(*this) << "\n";
 #endif
@@ -578,277 +734,317 @@ template <
     return emplace(v_);
   }
 
+/*
+ * Incremental resize.
+ *
+ * resize_start doubles the table at once: each senior bucket i gains a
+ * junior, i + senior_count. Until owner i has split, keys which will
+ * belong to its junior remain with i (see bucket_ix). Splitting i
+ * relocates those keys to the junior, sharing rather than copying key
+ * and value. Each write splits a few owners, so that no one operation
+ * pays for migrating the whole table.
+ *
+ * Positions are computed in the expanded table throughout. That agrees
+ * with the old table except for owners whose neighbourhood wrapped past
+ * the old end; resize_unwrap handles those before the expansion.
+ */
 template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
 >
-  void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize()
+  void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_start(
+    const hash_result_t h_
+  )
   {
-    _bc[segment_count()]._buckets = persist_controller_t::resize_prolog();
-    _bc[segment_count()]._next = &_bc[0];
-    _bc[segment_count()]._prev = &_bc[segment_count()-1];
-    _bc[segment_count()]._index = segment_count();
+    assert( ! persist_controller_t::is_resizing() );
+    /* split first the owner which ran out of space */
+    const auto first = bucket_ix(h_);
+    const auto six = segment_count();
+    _bc[six]._buckets = persist_controller_t::resize_prolog();
+    _bc[six]._next = &_bc[0];
+    _bc[six]._prev = &_bc[six-1];
+    _bc[six]._index = six;
     auto segment_size = bucket_count();
-    _bc[segment_count()]._bucket_mutexes = new bucket_mutexes_t[segment_size];
-    _bc[segment_count()]._buckets_end = _bc[segment_count()]._buckets + segment_size;
+    _bc[six]._bucket_mutexes = new bucket_mutexes_t[segment_size];
+    _bc[six]._buckets_end = _bc[six]._buckets + segment_size;
 
-    /* adjust count and everything which depends on it (size, mask) */
+    resize_unwrap();
 
-    /* PASS 1: copy content */
-    resize_pass1();
+    /* adjust count and everything which depends on it (size, mask) */
+    persist_controller_t::resize_expand(first);
+    fingerprint_extend();
 
-    /* PASS 2: remove old content, update owners. Some old content mave have been
-     * removed if pass 2 was restarted, so use the new (junior) content to drive
-     * the operations.
-     */
-    resize_pass2();
+    /* link in new segment in non-persistent circular list of segments */
+    _bc[six-1]._next = &_bc[six];
+    _bc[0]._prev = &_bc[six];
 
-    persist_controller_t::resize_epilog();
+    /* The senior copies of unwrapped content now have no owner */
+    for ( bix_t ix = 0U; ix != owner::size - 1U; ++ix )
+    {
+      settle(make_segment_and_bucket(ix), true);
+    }
+#if TRACE_MANY
+    std::cerr << __func__ << " bucket_count " << bucket_count()
+      << " first " << first << "\n";
+#endif
   }
 
 template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
 >
-  void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_pass1()
+  void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_unwrap()
   {
-    /* PASS 1: copy content */
-
-    bix_t ix_senior = 0U;
-    const auto sb_senior_end =
-      make_segment_and_bucket_for_iterator(bucket_count());
-#if TRACE_MANY
-      std::cerr << __func__
-        << " bucket_count " << bucket_count()
-        << " sb_senior_end " << sb_senior_end.si() << "," << sb_senior_end.bi()
-        << "\n";
-#endif
-    for (
-      auto sb_senior = make_segment_and_bucket(0U)
-      ; sb_senior != sb_senior_end
-      ; sb_senior.incr_without_wrap(), ++ix_senior
-    )
+    /* Content at the start of the table may belong to an owner near the end,
+     * whose neighbourhood wraps. In the expanded table, that owner's
+     * neighbourhood continues into the new segment, at the same offset.
+     * Copy the content there, so the owner's bits are correct in both the
+     * old and the expanded table.
+     */
+    auto &junior = _bc[segment_count()];
+    for ( bix_t ix = 0U; ix != owner::size - 1U; ++ix )
     {
-      auto senior_content_lk = make_content_unique_lock(sb_senior);
-
-      /* special locate, used to pre-fill new buckets */
-      content<value_type> &junior_content = _bc[segment_count()]._buckets[ix_senior];
-      if ( ! is_free(senior_content_lk.sb()) )
+      auto content_lk = make_content_unique_lock(make_segment_and_bucket(ix));
+      if ( ! is_free(content_lk.sb()) )
       {
-        /* examine hash(key) to determine whether to copy content */
-        auto hash = _hasher.hf(senior_content_lk.ref().key());
-        auto ix_owner = bucket_expanded_ix(hash);
-        /*
-         * [ix_owner, ix_owner + owner::size) is permissible range for content
-         */
-        if ( ix_owner <= ix_senior && ix_senior < ix_owner + owner::size )
+        const auto ix_owner = bucket_ix(_hasher.hf(content_lk.ref().key()));
+        if ( ix < ix_owner )
         {
-          /*
-           * content can stay where it is because bucket index index MSB is 0
-           */
+          content<value_type> &junior_content = junior._buckets[ix];
+          junior_content.content_share(content_lk.ref(), ix_owner);
+          junior_content.state_set(bucket_t::IN_USE);
 #if TRACE_MANY
-          std::cerr << __func__
-            << " " << ix_senior << " 1a no-relocate, owner " << bucket_ix(hash)
-            << " -> " << ix_owner << ": content " << ix_senior << "\n";
-#endif
-        }
-        else if (
-          ix_senior < owner::size
-          &&
-          bucket_count()*2U < ix_owner + owner::size
-        )
-        {
-          /* content can stay where it is because the owner wraps
-           * NOTE: this test is not exact, but is close enough if owner::size
-           * is equal to or less than half the minimum table size.
-           */
-#if TRACE_MANY
-          std::cerr << __func__
-            << " " << ix_senior << " 1b no-relocate, owner " << bucket_ix(hash)
-            << " -> " << ix_owner << ": content " << ix_senior << "\n";
-#endif
-        }
-        else
-        {
-          /* content must move */
-          junior_content.content_share(senior_content_lk.ref(), ix_owner);
-          senior_content_lk.ref().state_set(bucket_t::EXITING);
-          junior_content.state_set(bucket_t::ENTERING);
-#if TRACE_MANY
-          std::cerr << __func__
-            << " " << ix_senior << " 1c relocate, owner " << bucket_ix(hash) << " -> " << ix_owner
-            << ": content " << ix_senior << " -> "
-            << ix_senior + bucket_count() << "\n";
+          std::cerr << __func__ << " owner " << ix_owner << ": content "
+            << ix << " -> " << ix + bucket_count() << "\n";
 #endif
         }
       }
-      else
+    }
+    persist_controller_t::persist_new_segment("unwrap");
+  }
+
+template <
+  typename Key, typename T, typename Hash, typename Pred
+  , typename Allocator, typename SharedMutex
+>
+  void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_step(
+    bix_t owner_count_
+  )
+  {
+    for ( ; owner_count_ != 0 && persist_controller_t::is_resizing(); --owner_count_ )
+    {
+      const auto senior_count = persist_controller_t::resize_senior_count();
+      resize_split_owner(
+        ( persist_controller_t::resize_first() + persist_controller_t::resize_split() )
+        & ( senior_count - 1U )
+      );
+      persist_controller_t::resize_split_advance();
+      if ( persist_controller_t::resize_split() == senior_count )
       {
+        persist_controller_t::resize_epilog();
+      }
+    }
+  }
+
+template <
+  typename Key, typename T, typename Hash, typename Pred
+  , typename Allocator, typename SharedMutex
+>
+  void impl::table_base<
+    Key, T, Hash, Pred, Allocator, SharedMutex
+  >::resize_split_through(
+    const hash_result_t h_
+  )
+  {
+    /* An owner which has not split may be crowded: split owners through it.
+     * If it has split, the table as a whole is crowded: finish the resize.
+     */
+    const auto senior_count = persist_controller_t::resize_senior_count();
+    const auto ix_senior = h_ & ( senior_count - 1U );
+    resize_step(
+      resize_is_split(ix_senior)
+      ? senior_count
+      : (
+          ( ( ix_senior - persist_controller_t::resize_first() ) & ( senior_count - 1U ) )
+          - persist_controller_t::resize_split() + 1U
+        )
+    );
+  }
+
+template <
+  typename Key, typename T, typename Hash, typename Pred
+  , typename Allocator, typename SharedMutex
+>
+  auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_is_split(
+    const bix_t ix_senior_
+  ) const -> bool
+  {
+    return
+      ( ( ix_senior_ - persist_controller_t::resize_first() )
+        & ( persist_controller_t::resize_senior_count() - 1U )
+      )
+      < persist_controller_t::resize_split()
+      ;
+  }
+
+template <
+  typename Key, typename T, typename Hash, typename Pred
+  , typename Allocator, typename SharedMutex
+>
+  void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_split_owner(
+    const bix_t ix_senior_
+  )
+  {
+    const auto ix_junior = ix_senior_ + persist_controller_t::resize_senior_count();
+    auto sbc = make_segment_and_bucket(ix_senior_);
+    auto owner_lk = make_owner_unique_lock(sbc);
 #if TRACE_MANY
-        std::cerr << __func__ << " " << ix_senior << " 1d empty\n";
+    std::cerr << __func__ << " " << ix_senior_ << " "
+      << make_owner_print(*this, owner_lk) << "\n";
 #endif
+    for ( auto wv = owner_lk.ref().value(owner_lk); wv != 0; wv >>= 1U, sbc.incr() )
+    {
+      if ( ( wv & 1U ) && ( _hasher.hf(sbc.deref().key()) & mask() ) == ix_junior )
+      {
+        resize_relocate(owner_lk, sbc, ix_junior);
       }
     }
-
-    /* flush state_EXITING for old content */
-    persist_controller_t::persist_existing_segments("pass 1 owner+content seniors");
-    /* persist new content */
-    persist_controller_t::persist_new_segment("pass 1 copied content");
   }
 
 template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
 >
-  void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_pass2()
+  void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_relocate(
+    owner_unique_lock_t &senior_owner_lk_
+    , const segment_and_bucket_t &sb_src_
+    , const bix_t ix_junior_
+  )
   {
-    /* PASS 2: remove old content, update owners. Some old content mave have been
-     * removed if pass 2 was restarted, so use the new (junior) content to drive
-     * the operations.
+    auto junior_owner_lk = make_owner_unique_lock(make_segment_and_bucket(ix_junior_));
+    auto src_lk = make_content_unique_lock(sb_src_);
+
+    /* The junior already owns the content if a relocation was interrupted
+     * after the junior claimed it.
      */
-    bix_t ix_senior = 0U;
-    const auto sb_senior_end = make_segment_and_bucket_for_iterator(bucket_count());
-    for (
-      auto sb_senior = make_segment_and_bucket(0U)
-      ; sb_senior != sb_senior_end
-      ; sb_senior.incr_without_wrap(), ++ix_senior
-    )
+    const auto found = locate_key(junior_owner_lk, src_lk.ref().key());
+    auto dst_lk =
+      std::get<0>(found)
+      ? make_content_unique_lock(std::get<1>(found))
+      : make_space_for_insert(ix_junior_, nearest_free_bucket(junior_owner_lk.sb()))
+      ;
+
+    /* 5-step move between owners:
+     *  1. mark dst ENTERING and src EXITING
+     *   flush
+     *  2. the junior owner claims dst
+     *   flush
+     *  3. the senior owner disclaims src
+     *   flush
+     *  4. mark src FREE
+     *   flush
+     *  5. mark dst IN_USE
+     *   flush
+     * The size does not change.
+     */
+    if ( ! std::get<0>(found) )
     {
-      /* special locate, used before size has been updated
-       * to pre-fill new buckets
-       */
-      content_unique_lock_t
-        junior_content_lk(
-          _bc[segment_count()]._buckets[ix_senior]
-          , segment_and_bucket_t(&_bc[segment_count()], ix_senior)
-          , _bc[segment_count()]._bucket_mutexes[ix_senior]._m_content
-        );
+      persist_controller_t::resize_relocate_begin(src_lk.index(), dst_lk.index());
+      dst_lk.ref().content_share(src_lk.ref(), ix_junior_);
+      fingerprint_copy(dst_lk.index(), src_lk.index());
+      dst_lk.ref().state_set(bucket_t::ENTERING);
+      persist_controller_t::persist_content(dst_lk.ref(), "relocate entering");
+      src_lk.ref().state_set(bucket_t::EXITING);
+      persist_controller_t::persist_content(src_lk.ref(), "relocate exiting");
+
+      junior_owner_lk.ref().insert(
+        ix_junior_
+        , distance_wrapped(ix_junior_, dst_lk.index())
+        , junior_owner_lk
+      );
+      persist_controller_t::persist_owner(junior_owner_lk.ref(), "relocate junior owner");
+    }
 
-      auto senior_content_lk = make_content_unique_lock(sb_senior);
-      if ( junior_content_lk.ref().state_get() != bucket_t::FREE )
-      {
-        /* examine the key to locate old and new owners (owners) */
-        auto hash = _hasher.hf(junior_content_lk.ref().key());
-        auto ix_senior_owner = bucket_ix(hash);
-        auto ix_junior_owner = bucket_expanded_ix(hash);
+    senior_owner_lk_.ref().erase(
+      distance_wrapped(senior_owner_lk_.index(), src_lk.index())
+      , senior_owner_lk_
+    );
+    persist_controller_t::persist_owner(senior_owner_lk_.ref(), "relocate senior owner");
+
+    src_lk.ref().erase(); /* leaves a "FREE" mark in content */
+    persist_controller_t::persist_content(src_lk.ref(), "relocate free");
+    dst_lk.ref().state_set(bucket_t::IN_USE);
+    persist_controller_t::persist_content(dst_lk.ref(), "relocate in_use");
 #if TRACE_MANY
-        std::cerr << __func__ << ".2 content "
-          << ix_senior << " -> " << junior_content_lk.index()
-          << " owner " << ix_senior_owner << " -> " << ix_junior_owner
-          << "\n";
+    std::cerr << __func__ << " owner " << senior_owner_lk_.index()
+      << " -> " << ix_junior_ << ": content " << src_lk.index()
+      << " -> " << dst_lk.index() << "\n";
 #endif
-        if ( ix_senior_owner != ix_junior_owner )
-        {
-          auto senior_owner_sb = make_segment_and_bucket(ix_senior_owner);
-          auto senior_owner_lk = make_owner_unique_lock(senior_owner_sb);
-          owner_unique_lock_t
-            junior_owner_lk(
-              _bc[segment_count()]._buckets[ix_senior_owner]
-              , segment_and_bucket_t(&_bc[segment_count()], ix_senior_owner)
-              , _bc[segment_count()]._bucket_mutexes[ix_senior_owner]._m_owner
-            );
-
-          /* special locate, used before size has been updated
-           * to pre-fill new buckets
-           */
-          auto &junior_owner = _bc[segment_count()]._buckets[ix_senior_owner];
-          auto owner_pos = distance_wrapped(ix_senior_owner, ix_senior);
-          assert(owner_pos < owner::size);
-          junior_owner.insert(ix_junior_owner, owner_pos, junior_owner_lk);
-          senior_owner_lk.ref().erase(owner_pos, senior_owner_lk);
-          persist_controller_t::persist_owner(junior_owner_lk.ref(), "pass 2 junior owner");
-          persist_controller_t::persist_owner(senior_owner_lk.ref(), "pass 2 senior owner");
-        }
-        junior_content_lk.ref().state_set(bucket_t::IN_USE);
-        persist_controller_t::persist_content(junior_content_lk.ref());
-        senior_content_lk.ref().erase();
-        senior_content_lk.ref().state_set(bucket_t::FREE);
+  }
+
+template <
+  typename Key, typename T, typename Hash, typename Pred
+  , typename Allocator, typename SharedMutex
+>
+  void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_recover()
+  {
+    /* A relocation may have been interrupted. Settle the content it was
+     * moving. The owners need no repair: if both claim the key, the
+     * continued split of the senior owner completes the relocation.
+     * Unowned content here shares its key and value with an owned copy,
+     * but the reference count increment made by content_share was never
+     * persisted, so destroying the copy could free the owned key and
+     * value. The copy is marked free and not released; at worst an
+     * increment which did reach memory keeps the shared allocation alive
+     * after its last owner erases it.
+     */
+    settle(make_segment_and_bucket(persist_controller_t::resize_relocate_src()), false);
+    settle(make_segment_and_bucket(persist_controller_t::resize_relocate_dst()), false);
+    /* The crash may have followed resize_start before its final settle */
+    if ( persist_controller_t::resize_split() == 0U )
+    {
+      for ( bix_t ix = 0U; ix != owner::size - 1U; ++ix )
+      {
+        settle(make_segment_and_bucket(ix), false);
       }
-      else if ( senior_content_lk.ref().state_get() != bucket_t::FREE )
+    }
+  }
+
+/* Resolve the state of content left by an interrupted move: content is
+ * in use if and only if an owner claims it. Unowned content is destroyed
+ * only if release_: in recovery, its reference counts cannot be trusted.
+ */
+template <
+  typename Key, typename T, typename Hash, typename Pred
+  , typename Allocator, typename SharedMutex
+>
+  void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::settle(
+    const segment_and_bucket_t &a_
+    , const bool release_
+  )
+  {
+    auto content_lk = make_content_unique_lock(a_);
+    auto &c = content_lk.ref();
+    if ( c.state_get() != bucket_t::FREE )
+    {
+      if ( is_free_by_owner(a_) )
       {
-#if TRACK_OWNER
-        bool owner_update_owed = false;
-        if ( ix_senior < senior_content_lk.ref().owner() )
+        if ( release_ )
         {
-          /* Wrap. Should only occur where owner is near end of table and
-           * content is near beginning
-           */
-          assert(ix_senior < base_segment_size);
-          /* adjust the owner location (as kept in content) to reflect the
-           * new owner location
-           */
-          owner_update_owed = true;
+          c.erase();
         }
-#endif
-        /* examine the key to locate old and new owners (owners) */
-        auto hash = _hasher.hf(senior_content_lk.ref().key());
-        auto ix_senior_owner = bucket_ix(hash);
-        auto ix_junior_owner = bucket_expanded_ix(hash);
-        if ( ix_senior_owner != ix_junior_owner )
+        else
         {
-          /* content not moved, but owner changes (because content
-           * is near start of table and owner moves from near old end
-           * to near new end)
-           */
-          auto senior_owner_sb = make_segment_and_bucket(ix_senior_owner);
-          auto senior_owner_lk = make_owner_unique_lock(senior_owner_sb);
-          owner_unique_lock_t
-            junior_owner_lk(
-              _bc[segment_count()]._buckets[ix_senior_owner]
-              , segment_and_bucket_t(&_bc[segment_count()], ix_senior_owner)
-              , _bc[segment_count()]
-                ._bucket_mutexes[ix_senior_owner]._m_owner
-            );
-
-          /* special locate, used before size has been updated
-           * to pre-fill new buckets
-           */
-          auto &junior_owner = _bc[segment_count()]._buckets[ix_senior_owner];
-          auto owner_pos = distance_wrapped(ix_senior_owner, ix_senior);
-          assert(owner_pos < owner::size);
-          junior_owner.insert(ix_junior_owner, owner_pos, junior_owner_lk);
-          senior_owner_lk.ref().erase(owner_pos, senior_owner_lk);
-          assert(ix_senior < base_segment_size);
-#if TRACK_OWNER
-          /* adjust the owner location (as kept in content) to reflect the
-           * new owner location
-           */
-          senior_content_lk.ref().owner_update(bucket_count());
-          owner_update_owed = false;
-#endif
-          persist_controller_t::persist_owner(junior_owner_lk.ref(), "pass 2 junior owner");
-          persist_controller_t::persist_owner(senior_owner_lk.ref(), "pass 2 senior owner");
+          c.state_set(bucket_t::FREE);
         }
-#if TRACK_OWNER
-        assert(!owner_update_owed);
-#endif
+        persist_controller_t::persist_content(c, "settle free");
+      }
+      else if ( c.state_get() != bucket_t::IN_USE )
+      {
+        c.state_set(bucket_t::IN_USE);
+        persist_controller_t::persist_content(c, "settle in_use");
       }
     }
-    for (
-      auto ix_senior_owner = 0U
-      ; ix_senior_owner != bucket_count()
-      ; ++ix_senior_owner
-    )
-    {
-      /* special locate, used before size has been updated
-       * to pre-fill new buckets
-       */
-      owner_unique_lock_t
-        junior_owner_lk(
-          _bc[segment_count()]._buckets[ix_senior_owner]
-          , segment_and_bucket_t(&_bc[segment_count()], ix_senior_owner)
-          , _bc[segment_count()]._bucket_mutexes[ix_senior_owner]._m_owner
-        );
-    }
-
-    /* flush for state_set bucket_t::FREE in loop above. */
-    persist_controller_t::persist_existing_segments("pass 2 senior content");
-    /* flush for state_set owner::LIVE in loop above. */
-    persist_controller_t::persist_new_segment("pass 2 junior owner");
-
-    /* link in new segment in non-persistent circular list of segments */
-    _bc[segment_count()-1]._next = &_bc[segment_count()];
-    _bc[0]._prev = &_bc[segment_count()];
   }
 
 template <
@@ -994,14 +1190,15 @@ template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
 >
-  auto impl::table_base<
-    Key, T, Hash, Pred, Allocator, SharedMutex
-  >::make_owner_shared_lock(
-    const key_type &k_
-  ) const -> owner_shared_lock_t
-  {
-    return make_owner_shared_lock(make_segment_and_bucket(bucket(k_)));
-  }
+  template <typename K>
+    auto impl::table_base<
+      Key, T, Hash, Pred, Allocator, SharedMutex
+    >::make_owner_shared_lock(
+      const K &k_
+    ) const -> owner_shared_lock_t
+    {
+      return make_owner_shared_lock(make_segment_and_bucket(bucket(k_)));
+    }
 
 template <
   typename Key, typename T, typename Hash, typename Pred
@@ -1054,10 +1251,10 @@ template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
 >
-  template <typename Lock>
+  template <typename Lock, typename K>
     auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::locate_key(
       Lock &bi_
-      , const key_type &k_
+      , const K &k_
     ) const -> std::tuple<bucket_t *, segment_and_bucket_t>
     {
       /* Use the owner to filter key checks, a performance aid
@@ -1072,23 +1269,35 @@ template <
         << " value " << wv
         << "\n";
 #endif
+      /* Further filter by fingerprint, which is in DRAM and cheap to check */
+      if ( wv != 0 )
+      {
+        wv &= fingerprint_match(bi_.index(), fingerprint(_hasher.hf(k_)));
+      }
       auto bfp = bi_.sb();
+#if TRACK_LOCATE
       auto &t =
         *const_cast<table_base<Key, T, Hash, Pred, Allocator, SharedMutex> *>(this);
       ++t._locate_key_call;
+#endif
+      /* Once no owned bits remain, no later bucket can hold the key */
       for (
         auto content_offset = 0U
-        ; content_offset != owner::size
+        ; wv != 0 && content_offset != owner::size
         ; ++content_offset
       )
       {
         if ( ( wv & 1 ) == 1 )
         {
+#if TRACK_LOCATE
           ++t._locate_key_owned;
+#endif
           auto c = &bfp.deref();
           if ( key_equal()(c->key(), k_) )
           {
+#if TRACK_LOCATE
             ++t._locate_key_match;
+#endif
 #if TRACE_MANY
             std::cerr
               << __func__ << " returns (success) " << bfp.index() << "\n";
@@ -1096,14 +1305,19 @@ template <
             bucket_t *bb = static_cast<bucket_t *>(c);
             return std::tuple<bucket_t *, segment_and_bucket_t>(bb, bfp);
           }
+#if TRACK_LOCATE
           else
           {
             ++t._locate_key_mismatch;
           }
+#endif
         }
+#if TRACK_LOCATE
+        else
         {
           ++t._locate_key_unowned;
         }
+#endif
         bfp.incr();
         wv >>= 1U;
       }
@@ -1122,130 +1336,167 @@ template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
 >
-  auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::erase(
-    const key_type &k_
-  ) -> size_type
-  try
-  {
-    /* The bucket which owns the entry */
-    auto sbw = make_segment_and_bucket(bucket(k_));
-    auto owner_lk = make_owner_unique_lock(sbw);
-    const auto erase_ix = locate_key(owner_lk, k_);
-    if ( std::get<0>(erase_ix) == nullptr )
-    {
-      /* no such element */
-      return 0U;
-    }
-    else /* element found at bf */
+  template <typename K>
+    auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::erase(
+      const K &k_
+    ) -> size_type
+    try
     {
-      auto erase_src = make_content_unique_lock(std::get<1>(erase_ix));
-      /* 4-step owner erase:
-       *
-       * 1. mark size unstable
-       *  persist
-       * 2. disclaim owner ownership atomically
-       *  persist
-       * 3. mark content FREE (in erase)
-       *  persist
-       * 4. mark size stable
-       *  persist
-       */
-
-      persist_controller_t::persist_content(erase_src.ref(), "content erase exiting");
+      resize_step(resize_step_owners);
+      /* The bucket which owns the entry */
+      auto sbw = make_segment_and_bucket(bucket(k_));
+      auto owner_lk = make_owner_unique_lock(sbw);
+      const auto erase_ix = locate_key(owner_lk, k_);
+      if ( std::get<0>(erase_ix) == nullptr )
+      {
+        /* no such element */
+        return 0U;
+      }
+      else /* element found at bf */
       {
-        persist_size_change<Allocator, size_decr> s(*this);
-        owner_lk.ref().erase(
+        auto erase_src = make_content_unique_lock(std::get<1>(erase_ix));
+        /* 4-step owner erase:
+         *
+         * 1. mark size unstable
+         *  persist
+         * 2. disclaim owner ownership atomically
+         *  persist
+         * 3. mark content FREE (in erase)
+         *  persist
+         * 4. mark size stable
+         *  persist
+         */
+
+        persist_controller_t::persist_content(erase_src.ref(), "content erase exiting");
+        {
+          persist_size_change<Allocator, size_decr> s(*this, erase_src.index());
+          owner_lk.ref().erase(
 					static_cast<unsigned>(erase_src.index()-owner_lk.index())
 					, owner_lk
-        );
-        persist_controller_t::persist_owner(owner_lk.ref(), "owner erase");
-        erase_src.ref().erase(); /* leaves a "FREE" mark in content */
-        persist_controller_t::persist_content(erase_src.ref(), "content erase free");
+          );
+          persist_controller_t::persist_owner(owner_lk.ref(), "owner erase");
+          erase_src.ref().erase(); /* leaves a "FREE" mark in content */
+          persist_controller_t::persist_content(erase_src.ref(), "content erase free");
+        }
+        return 1U;
       }
-      return 1U;
     }
-  }
-  catch ( const perishable_expiry & )
-  {
+    catch ( const perishable_expiry & )
+    {
 #if TRACE_PERISHABLE_EXPIRY
-    std::cerr << "perishable expiry dump (erase)\n"
-      << make_table_dump(*this) << "\n";
+      std::cerr << "perishable expiry dump (erase)\n"
+        << make_table_dump(*this) << "\n";
 #endif
-    throw;
-  }
+      throw;
+    }
 
 template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
 >
-  auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::count(
-    const key_type &k_
-  ) const -> size_type
-  {
-    auto bi_lk = make_owner_shared_lock(k_);
-    const auto bf = locate_key(bi_lk, k_);
+  template <typename K>
+    auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::count(
+      const K &k_
+    ) const -> size_type
+    {
+      auto bi_lk = make_owner_shared_lock(k_);
+      const auto bf = locate_key(bi_lk, k_);
 #if TRACE_MANY
-    std::cerr << __func__
-      << " " << k_
-      << " starting at " << bi_lk.index()
-      << " "
-      << make_owner_print(*this, bi_lk)
-      << " found "
-      << *bf << "\n";
+      std::cerr << __func__
+        << " " << k_
+        << " starting at " << bi_lk.index()
+        << " "
+        << make_owner_print(*this, bi_lk)
+        << " found "
+        << *bf << "\n";
 #endif
-    return bf ? 1U : 0U;
-  }
+      return bf ? 1U : 0U;
+    }
 
 template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
 >
-  auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::at(
-    const key_type &k_
-  ) const -> const mapped_type &
-  {
-    /* The bucket which owns the entry */
-    auto bi_lk = make_owner_shared_lock(k_);
-    const auto bf = std::get<0>(locate_key(bi_lk, k_));
-    if ( ! bf )
+  template <typename K>
+    auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::at(
+      const K &k_
+    ) const -> const mapped_type &
+    {
+      /* The bucket which owns the entry */
+      auto bi_lk = make_owner_shared_lock(k_);
+      const auto bf = std::get<0>(locate_key(bi_lk, k_));
+      if ( ! bf )
+      {
+        /* no such element */
+        throw std::out_of_range("no such element");
+      }
+      /* element found at bf */
+      return bf->mapped();
+    }
+
+template <
+  typename Key, typename T, typename Hash, typename Pred
+  , typename Allocator, typename SharedMutex
+>
+  template <typename K>
+    auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::at(
+      const K &k_
+    ) -> mapped_type &
     {
-      /* no such element */
-      throw std::out_of_range("no such element");
+      /* Lock the entry owner */
+      auto bi_lk = make_owner_shared_lock(k_);
+      const auto bf = std::get<0>(locate_key(bi_lk, k_));
+      if ( ! bf )
+      {
+        /* no such element */
+        throw std::out_of_range("no such element");
+      }
+      /* element found at bf */
+      return bf->mapped();
     }
-    /* element found at bf */
-    return bf->mapped();
-  }
 
 template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
 >
-  auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::at(
-    const key_type &k_
-  ) -> mapped_type &
-  {
-    /* Lock the entry owner */
-    auto bi_lk = make_owner_shared_lock(k_);
-    const auto bf = std::get<0>(locate_key(bi_lk, k_));
-    if ( ! bf )
+  template <typename K>
+    auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::find_mapped(
+      const K &k_
+    ) const -> const mapped_type *
     {
-      /* no such element */
-      throw std::out_of_range("no such element");
+      auto bi_lk = make_owner_shared_lock(k_);
+      const auto bf = std::get<0>(locate_key(bi_lk, k_));
+      return bf ? &bf->mapped() : nullptr;
     }
-    /* element found at bf */
-    return bf->mapped();
-  }
 
 template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
 >
-  auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::bucket(
-    const key_type &k_
-  ) const -> size_type
-  {
-    return bucket_ix(_hasher.hf(k_));
-  }
+  template <typename K>
+    void impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::prefetch(
+      const K &k_
+    ) const
+    {
+      const auto ix = bucket(k_);
+      /* the owner, and the first content of the neighbourhood */
+      __builtin_prefetch(&make_segment_and_bucket(ix).deref());
+      /* the neighbourhood's fingerprints, which may span two lines */
+      __builtin_prefetch(&_fingerprint[ix]);
+      __builtin_prefetch(&_fingerprint[ix + owner::size - 1U]);
+    }
+
+template <
+  typename Key, typename T, typename Hash, typename Pred
+  , typename Allocator, typename SharedMutex
+>
+  template <typename K>
+    auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::bucket(
+      const K &k_
+    ) const -> size_type
+    {
+      return bucket_ix(_hasher.hf(k_));
+    }
 
 template <
   typename Key, typename T, typename Hash, typename Pred
@@ -1269,83 +1520,86 @@ template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
 >
-  auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::lock_shared(
-    const key_type &k_
-  ) -> bool
-  {
-    /* Lock the entry owner */
-    auto bi_lk = make_owner_shared_lock(k_);
-    const auto bf = locate_key(bi_lk, k_);
-
-    if ( std::get<0>(bf) == nullptr )
+  template <typename K>
+    auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::lock_shared(
+      const K &k_
+    ) -> bool
     {
-      /* no such element */
-      return false;
-    }
+      /* Lock the entry owner */
+      auto bi_lk = make_owner_shared_lock(k_);
+      const auto bf = locate_key(bi_lk, k_);
 
-    auto &m = locate_bucket_mutexes(std::get<1>(bf));
-    auto b = m._m_content.try_lock_shared();
-    if ( b )
-    {
-      m._state = bucket_mutexes_t::SHARED;
+      if ( std::get<0>(bf) == nullptr )
+      {
+        /* no such element */
+        return false;
+      }
+
+      auto &m = locate_bucket_mutexes(std::get<1>(bf));
+      auto b = m._m_content.try_lock_shared();
+      if ( b )
+      {
+        m._state = bucket_mutexes_t::SHARED;
+      }
+      return b;
     }
-    return b;
-  }
 
 template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
 >
-  auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::lock_unique(
-    const key_type &k_
-  ) -> bool
-  {
-    /* Lock the entry owner */
-    auto bi_lk = make_owner_shared_lock(k_);
-    const auto bf = locate_key(bi_lk, k_);
-
-    if ( std::get<0>(bf) == nullptr )
+  template <typename K>
+    auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::lock_unique(
+      const K &k_
+    ) -> bool
     {
-      /* no such element */
-      return false;
-    }
+      /* Lock the entry owner */
+      auto bi_lk = make_owner_shared_lock(k_);
+      const auto bf = locate_key(bi_lk, k_);
 
-    auto &m = locate_bucket_mutexes(std::get<1>(bf));
-    auto b = m._m_content.try_lock();
-    if ( b )
-    {
-      m._state = bucket_mutexes_t::UNIQUE;
+      if ( std::get<0>(bf) == nullptr )
+      {
+        /* no such element */
+        return false;
+      }
+
+      auto &m = locate_bucket_mutexes(std::get<1>(bf));
+      auto b = m._m_content.try_lock();
+      if ( b )
+      {
+        m._state = bucket_mutexes_t::UNIQUE;
+      }
+      return b;
     }
-    return b;
-  }
 
 template <
   typename Key, typename T, typename Hash, typename Pred
   , typename Allocator, typename SharedMutex
 >
-  auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::unlock(
-    const key_type &k_
-  ) -> void
-  {
-    /* Lock the entry owner */
-    auto bi_lk = make_owner_shared_lock(k_);
-    const auto bf = locate_key(bi_lk, k_);
-
-    if ( std::get<0>(bf) != nullptr )
+  template <typename K>
+    auto impl::table_base<Key, T, Hash, Pred, Allocator, SharedMutex>::unlock(
+      const K &k_
+    ) -> void
     {
-      /* found an element */
-      auto &m = locate_bucket_mutexes(std::get<1>(bf));
-      if ( m._state == bucket_mutexes_t::UNIQUE )
-      {
-        m._state = bucket_mutexes_t::SHARED;
-        m._m_content.unlock();
-      }
-      else
+      /* Lock the entry owner */
+      auto bi_lk = make_owner_shared_lock(k_);
+      const auto bf = locate_key(bi_lk, k_);
+
+      if ( std::get<0>(bf) != nullptr )
       {
-        m._m_content.unlock_shared();
+        /* found an element */
+        auto &m = locate_bucket_mutexes(std::get<1>(bf));
+        if ( m._state == bucket_mutexes_t::UNIQUE )
+        {
+          m._state = bucket_mutexes_t::SHARED;
+          m._m_content.unlock();
+        }
+        else
+        {
+          m._m_content.unlock_shared();
+        }
       }
     }
-  }
 
 template <
   typename Key, typename T, typename Hash, typename Pred
@@ -16,5 +16,7 @@
 /* Data to track which is not normally needed but us required by some TRACE */
 #define TRACK_OWNER (TRACE_OWNER || TRACE_CONTENT)
 #define TRACK_POS TRACE_OWNER
+/* locate_key statistics. Counted by readers, so costly when shared */
+#define TRACK_LOCATE TRACE_MANY
 
 #endif
@@ -356,6 +356,37 @@ TEST_F(KVStore_test, GetMany)
   }
 }
 
+TEST_F(KVStore_test, GetBatch)
+{
+  std::vector<std::string> keys;
+  for ( auto &kv : kvv )
+  {
+    keys.push_back(std::get<0>(kv));
+  }
+  /* and one key which is not present */
+  keys.push_back("NoSuchKey");
+
+  std::vector<::iovec> values;
+  std::vector<status_t> status;
+  auto r = _kvstore->get_batch(pool, keys, values, status);
+  EXPECT_EQ(S_OK, r);
+  ASSERT_EQ(keys.size(), values.size());
+  ASSERT_EQ(keys.size(), status.size());
+
+  std::size_t mismatch_count = 0;
+  for ( std::size_t i = 0; i != kvv.size(); ++i )
+  {
+    const auto &ev = std::get<1>(kvv[i]);
+    EXPECT_EQ(S_OK, status[i]);
+    EXPECT_EQ(ev.size(), values[i].iov_len);
+    mismatch_count += ( ev.size() != values[i].iov_len || 0 != memcmp(ev.data(), values[i].iov_base, ev.size()) );
+    _kvstore->free_memory(values[i].iov_base);
+  }
+  EXPECT_EQ(extant_count, mismatch_count);
+  EXPECT_EQ(Component::IKVStore::E_KEY_NOT_FOUND, status.back());
+  EXPECT_EQ(nullptr, values.back().iov_base);
+}
+
 TEST_F(KVStore_test, LockMany)
 {
   unsigned ct = 0;
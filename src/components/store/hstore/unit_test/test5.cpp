@@ -0,0 +1,317 @@
+#include "store_map.h"
+
+#include <gtest/gtest.h>
+#include <common/utils.h>
+#include <api/components.h>
+/* note: we do not include component source, only the API definition */
+#include <api/kvstore_itf.h>
+
+#include <city.h>
+
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace Component;
+
+/*
+ * Tests of the incremental resize: a table which starts at the smallest
+ * size grows through several doublings. Every key is read, erased and
+ * reinserted while splits are in progress, and the splits are interrupted
+ * by simulated crashes.
+ */
+
+namespace {
+
+// The fixture for testing class Foo.
+class KVStore_test : public ::testing::Test {
+ protected:
+
+  // If the constructor and destructor are not enough for setting up
+  // and cleaning up each test, you can define the following methods:
+
+  virtual void SetUp() {
+    // Code here will be called immediately after the constructor (right
+    // before each test).
+  }
+
+  virtual void TearDown() {
+    // Code here will be called immediately after each test (right
+    // before the destructor).
+  }
+
+  // Objects declared here can be used by all tests in the test case
+  /* persistent memory is effective (either real, indicated by no PMEM_IS_PMEM_FORCE or simulated by PMEM_IS_PMEM_FORCE 0 not 1 */
+  static bool pmem_effective;
+  static Component::IKVStore * _kvstore;
+
+  /* Smallest table, so that the keys cause several doublings */
+  static constexpr std::size_t estimated_object_count = 1;
+  static constexpr unsigned many_key_length = 8;
+  static constexpr unsigned many_value_length = 16;
+  /* keys inserted with checks after each insert */
+  static constexpr std::size_t grow_count = 400;
+  /* keys inserted under simulated crashes */
+  static constexpr std::size_t crash_count = 400;
+  /* one key in wrap_interval has its home in the last bucket. They all
+   * share that owner, so there must be fewer than its 32-bucket
+   * neighbourhood holds: here, 16.
+   */
+  static constexpr std::size_t wrap_interval = 50;
+  using kv_t = std::tuple<std::string, std::string>;
+  static std::vector<kv_t> kvv;
+
+  std::string pool_dir() const
+  {
+    return "/mnt/pmem0/pool/0/";
+  }
+
+  std::string pool_name() const
+  {
+    return "test5-" + store_map::impl->name + store_map::numa_zone() + ".pool";
+  }
+
+  static void check_get(Component::IKVStore::pool_t pool_, const kv_t &kv_)
+  {
+    const auto &key = std::get<0>(kv_);
+    const auto &ev = std::get<1>(kv_);
+    void * value = nullptr;
+    size_t value_len = 0;
+    auto r = _kvstore->get(pool_, key, value, value_len);
+    EXPECT_EQ(S_OK, r);
+    EXPECT_EQ(ev.size(), value_len);
+    if ( r == S_OK )
+    {
+      EXPECT_EQ(0, memcmp(ev.data(), value, ev.size()));
+    }
+    _kvstore->free_memory(value);
+  }
+};
+
+constexpr std::size_t KVStore_test::estimated_object_count;
+constexpr unsigned KVStore_test::many_key_length;
+constexpr unsigned KVStore_test::many_value_length;
+constexpr std::size_t KVStore_test::grow_count;
+constexpr std::size_t KVStore_test::crash_count;
+constexpr std::size_t KVStore_test::wrap_interval;
+
+bool KVStore_test::pmem_effective = ! getenv("PMEM_IS_PMEM_FORCE") || getenv("PMEM_IS_PMEM_FORCE") == std::string("0");
+Component::IKVStore * KVStore_test::_kvstore;
+std::vector<KVStore_test::kv_t> KVStore_test::kvv;
+
+TEST_F(KVStore_test, Instantiate)
+{
+  /* create object instance through factory */
+  auto link_library = "libcomanche-" + store_map::impl->name + ".so";
+  Component::IBase * comp = Component::load_component(link_library,
+                                                      store_map::impl->factory_id);
+
+  ASSERT_TRUE(comp);
+  auto fact = static_cast<IKVStore_factory *>(comp->query_interface(IKVStore_factory::iid()));
+
+  _kvstore = fact->create("owner", "name", store_map::location);
+
+  fact->release_ref();
+}
+
+class pool_open
+{
+  Component::IKVStore *_kvstore;
+  Component::IKVStore::pool_t _pool;
+public:
+  explicit pool_open(
+    Component::IKVStore *kvstore_
+    , const std::string& path_
+    , const std::string& name_
+    , unsigned int flags = 0
+  )
+    : _kvstore(kvstore_)
+    , _pool(_kvstore->open_pool(path_, name_, flags))
+  {
+    if ( int64_t(_pool) < 0 )
+    {
+      throw std::runtime_error("Failed to open pool code " + std::to_string(-_pool));
+    }
+  }
+  explicit pool_open(
+    Component::IKVStore *kvstore_
+    , const std::string& path_
+    , const std::string& name_
+    , const size_t size
+    , unsigned int flags = 0
+    , uint64_t expected_obj_count = 0
+  )
+    : _kvstore(kvstore_)
+    , _pool(_kvstore->create_pool(path_, name_, size, flags, expected_obj_count))
+  {}
+
+  ~pool_open()
+  {
+    _kvstore->close_pool(_pool);
+  }
+
+  Component::IKVStore::pool_t pool() const noexcept { return _pool; }
+};
+
+TEST_F(KVStore_test, RemoveOldPool)
+{
+  if ( _kvstore )
+  {
+    try
+    {
+      _kvstore->delete_pool(pool_dir(), pool_name());
+    }
+    catch ( Exception & )
+    {
+    }
+  }
+}
+
+TEST_F(KVStore_test, CreatePool)
+{
+  ASSERT_TRUE(_kvstore);
+  pool_open p(_kvstore, pool_dir(), pool_name(), MB(128UL), 0, estimated_object_count);
+  ASSERT_LT(0, int64_t(p.pool()));
+}
+
+TEST_F(KVStore_test, PopulateMany)
+{
+  /* hstore places a key in bucket CityHash64(key) modulo the (power of two)
+   * bucket count. A key whose low 16 hash bits are all ones has its home in
+   * the last bucket of every table size used here. Its neighbourhood wraps
+   * to the start of the table, so each doubling must unwrap its content,
+   * fingerprints included, and the split must relocate it to the new last
+   * bucket.
+   */
+  std::mt19937_64 r0{};
+  for ( std::size_t i = 0; i != grow_count + crash_count; ++i )
+  {
+    std::string key;
+    do
+    {
+      std::ostringstream s;
+      s << std::hex << r0();
+      key = s.str();
+      key.resize(many_key_length, '.');
+    } while (
+      i % wrap_interval == wrap_interval - 1U
+      && ( CityHash64(key.data(), key.size()) & 0xffffU ) != 0xffffU
+    );
+    auto value = std::to_string(i);
+    value.resize(many_value_length, '.');
+    kvv.emplace_back(key, value);
+  }
+}
+
+TEST_F(KVStore_test, PutGrow)
+{
+  /* Each insert advances the split in progress by a few owners. Check
+   * every key inserted so far after each insert, so that every key is
+   * seen, erased and reinserted while splits are part done.
+   */
+  pool_open p(_kvstore, pool_dir(), pool_name());
+  for ( std::size_t i = 0; i != grow_count; ++i )
+  {
+    const auto &kv = kvv[i];
+    auto r = _kvstore->put(p.pool(), std::get<0>(kv), std::get<1>(kv).data(), std::get<1>(kv).length());
+    ASSERT_EQ(S_OK, r);
+
+    for ( std::size_t j = 0; j <= i; ++j )
+    {
+      check_get(p.pool(), kvv[j]);
+    }
+
+    for ( std::size_t j = 0; j <= i; ++j )
+    {
+      const auto &key = std::get<0>(kvv[j]);
+      const auto &ev = std::get<1>(kvv[j]);
+      EXPECT_EQ(S_OK, _kvstore->erase(p.pool(), key));
+      void * value = nullptr;
+      size_t value_len = 0;
+      EXPECT_EQ(Component::IKVStore::E_KEY_NOT_FOUND, _kvstore->get(p.pool(), key, value, value_len));
+      _kvstore->free_memory(value);
+      EXPECT_EQ(S_OK, _kvstore->put(p.pool(), key, ev.data(), ev.length()));
+      check_get(p.pool(), kvv[j]);
+    }
+
+    EXPECT_EQ(i + 1U, _kvstore->count(p.pool()));
+  }
+}
+
+TEST_F(KVStore_test, PutCrash)
+{
+  /* As in hstore test2, simulate crashes at decreasingly frequent intervals
+   * (a Fibonacci series), so that inserts and the splits they drive are
+   * interrupted and recovered at each open.
+   */
+  bool finished = false;
+
+  _kvstore->debug(0, 0 /* enable */, 0);
+  unsigned p0 = 0;
+  unsigned p1 = 1;
+  for (
+    unsigned perishable_count = p0 + p1
+    ; ! finished
+    ; perishable_count = p0 + p1, p0 = p1, p1 = perishable_count
+    )
+  {
+    _kvstore->debug(0, 1 /* reset */, perishable_count);
+    _kvstore->debug(0, 0 /* enable */, true);
+    try
+    {
+      pool_open p(_kvstore, pool_dir(), pool_name());
+      for ( std::size_t i = grow_count; i != grow_count + crash_count; ++i )
+      {
+        const auto &kv = kvv[i];
+        /* A put interrupted on an earlier pass may have taken effect */
+        _kvstore->put(p.pool(), std::get<0>(kv), std::get<1>(kv).data(), std::get<1>(kv).length());
+      }
+      finished = true;
+      /* Done with forcing crashes */
+      _kvstore->debug(0, 0 /* enable */, false);
+    }
+    catch ( const std::runtime_error &e )
+    {
+      if ( e.what() != std::string("perishable timer expired") ) { throw; }
+    }
+  }
+}
+
+TEST_F(KVStore_test, GetMany)
+{
+  ASSERT_TRUE(_kvstore);
+  if ( pmem_effective )
+  {
+    pool_open p(_kvstore, pool_dir(), pool_name());
+    ASSERT_LT(0, int64_t(p.pool()));
+    EXPECT_EQ(kvv.size(), _kvstore->count(p.pool()));
+    for ( const auto &kv : kvv )
+    {
+      check_get(p.pool(), kv);
+    }
+    std::uint64_t count = 0;
+    _kvstore->debug(p.pool(), 2 /* COUNT_BY_BUCKET */, reinterpret_cast<std::uint64_t>(&count));
+    EXPECT_EQ(kvv.size(), count);
+  }
+}
+
+TEST_F(KVStore_test, DeletePool)
+{
+  if ( pmem_effective )
+  {
+    auto pool = _kvstore->open_pool(pool_dir(), pool_name());
+    ASSERT_LT(0, int64_t(pool));
+    _kvstore->delete_pool(pool);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  auto r = RUN_ALL_TESTS();
+
+  return r;
+}
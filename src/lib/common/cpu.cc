@@ -62,7 +62,8 @@ int set_cpu_affinity(unsigned long mask) {
 }
 
 /**
- * Convert comma separated list to cpu mask
+ * Convert comma separated list to cpu mask.  Each element is either a
+ * core number or an inclusive range (e.g., "0,4-7").
  *
  * @param def
  * @param mask
@@ -73,27 +74,24 @@ status_t string_to_mask(std::string def, cpu_mask_t &mask) {
   using namespace std;
   using namespace boost;
 
-  if (def.find(",") == std::string::npos) {
-    try {
-      mask.add_core(stoi(def));
-      return S_OK;
-    } catch (std::invalid_argument e) {
-      return E_INVAL;
-    }
-  }
-
   boost::char_separator<char> sep(",");
-  vector<string> v;
   boost::tokenizer<boost::char_separator<char>> tok(def, sep);
 
   try {
-    for_each(tok.begin(), tok.end(), [&](const string &s) {
-      try {
+    for (const string &s : tok) {
+      auto dash = s.find('-');
+      if (dash == string::npos) {
         mask.add_core(stoi(s));
-      } catch (std::invalid_argument e) {
-        PWRN("invalid token in cpu mask string version.");
+        continue;
       }
-    });
+
+      int first = stoi(s.substr(0, dash));
+      int last = stoi(s.substr(dash + 1));
+      if (first < 0 || last < first) return E_INVAL;
+      for (int core = first; core <= last; core++) mask.add_core(core);
+    }
+  } catch (std::invalid_argument e) {
+    return E_INVAL;
   } catch (...) {
     return E_FAIL;
   }
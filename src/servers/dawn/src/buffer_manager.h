@@ -6,10 +6,20 @@
 #include <api/components.h>
 #include <api/fabric_itf.h>
 #include <api/kvstore_itf.h>
+#include <numa.h>
+#include <sched.h>
 #include <sys/mman.h>
 
 namespace Dawn
 {
+/**
+ * IO buffer pool.  Buffers are carved out of hugepage-backed arenas
+ * allocated on the shard's NUMA node (or, if none is given, the node of
+ * the calling thread), with one memory registration per arena.  There
+ * are two size classes (small for control messages and large for
+ * anything else), and each grows by adding an arena when it runs out of
+ * buffers.
+ */
 template <class Transport>
 class Buffer_manager {
   static constexpr bool option_DEBUG = false;
@@ -17,6 +27,8 @@ class Buffer_manager {
  public:
   static constexpr size_t DEFAULT_BUFFER_COUNT = 8;
   static constexpr size_t BUFFER_LEN           = MiB(2);
+  static constexpr size_t SMALL_BUFFER_LEN     = KiB(4);
+  static constexpr size_t ARENA_ALIGNMENT      = MiB(2); /*< hugepage */
 
   enum {
     BUFFER_FLAGS_EXTERNAL = 1,
@@ -54,27 +66,61 @@ class Buffer_manager {
 
  public:
   Buffer_manager(Transport *transport,
-                 size_t     buffer_count = DEFAULT_BUFFER_COUNT)
-      : _buffer_count(buffer_count), _transport(transport)
+                 size_t     buffer_count = DEFAULT_BUFFER_COUNT,
+                 int        numa_node    = -1)
+      : _transport(transport), _buffer_count(buffer_count),
+        _numa_node(numa_node), _small(SMALL_BUFFER_LEN), _large(BUFFER_LEN)
   {
-    init();
+    grow(_large, _buffer_count);
+    grow(_small, ARENA_ALIGNMENT / SMALL_BUFFER_LEN);
   }
 
   ~Buffer_manager()
   {
-    for (auto b : _buffers) {
-      ::free(b->iov->iov_base);
-      delete b;
+    deregister_arenas();
+    for (auto b : _buffers) delete b;
+    for (auto &a : _arenas) ::munmap(a.iov.iov_base, a.iov.iov_len);
+  }
+
+  /**
+   * Deregister the arenas' memory.  Called by the owner if the
+   * transport is closed before the buffer manager is destroyed, since
+   * memory cannot be deregistered after that; no buffer may be used
+   * afterwards.
+   */
+  void deregister_arenas()
+  {
+    for (auto &a : _arenas) {
+      if (a.region) _transport->deregister_memory(a.region);
+      a.region = nullptr;
     }
   }
 
-  buffer_t *allocate()
+  /**
+   * Allocate a buffer from the smallest size class that fits.  The pool
+   * grows rather than fail when the size class is exhausted.
+   *
+   * @param len Minimum length of buffer in bytes
+   *
+   * @return IO buffer
+   */
+  buffer_t *allocate(size_t len = BUFFER_LEN)
   {
-    if (unlikely(_free.empty())) throw Program_exception("no buffers");
-    auto iob = _free.back();
+    if (unlikely(len > BUFFER_LEN))
+      throw API_exception("bm: buffer length (%lu) exceeds maximum", len);
+
+    auto &sc = (len <= SMALL_BUFFER_LEN) ? _small : _large;
+    if (unlikely(sc.free.empty())) {
+      if (option_DEBUG)
+        PLOG("bm: size class %lu exhausted (%lu buffers); growing", sc.len,
+             sc.count);
+      grow(sc, sc.count); /* double size class */
+    }
+
+    auto iob = sc.free.back();
     assert(iob->flags == 0);
-    _free.pop_back();
-    if (option_DEBUG) PLOG("bm: allocate : %p %lu", iob, _free.size());
+    sc.free.pop_back();
+    if (option_DEBUG) PLOG("bm: allocate : %p %lu", iob, sc.free.size());
     return iob;
   }
 
@@ -85,46 +131,109 @@ class Buffer_manager {
 
     if (option_DEBUG) PLOG("bm: free     : %p", iob);
     iob->reset_length();
-    _free.push_back(iob);
+    if (iob->original_length == SMALL_BUFFER_LEN)
+      _small.free.push_back(iob);
+    else
+      _large.free.push_back(iob);
+  }
+
+  /**
+   * Number of buffers currently allocated, i.e. posted or being
+   * processed
+   *
+   * @return Buffer count
+   */
+  size_t in_use() const
+  {
+    return _buffers.size() - _small.free.size() - _large.free.size();
   }
 
  private:
-  void init()
+  struct Size_class {
+    Size_class(size_t len_) : len(len_), count(0) {}
+
+    const size_t            len;
+    size_t                  count;
+    std::vector<buffer_t *> free;
+  };
+
+  /**
+   * Allocate arena memory; hugepages from the reserved pool if there
+   * are any, otherwise transparent hugepages
+   *
+   * @param len Length in bytes (multiple of ARENA_ALIGNMENT)
+   * @param numa_node NUMA node, or -1 for the node of the calling thread
+   *
+   * @return Pointer to zeroed memory
+   */
+  static void *allocate_arena(size_t len, int numa_node)
   {
-    auto alloc_iov = []() -> iovec * {
-      iovec *iov    = new iovec;
-      iov->iov_base = aligned_alloc(MiB(2), BUFFER_LEN);
-      iov->iov_len  = BUFFER_LEN;
-
-      assert(iov->iov_base);
-      madvise(iov->iov_base, iov->iov_len, MADV_HUGEPAGE);
-      memset(iov->iov_base, 0, iov->iov_len);
-      return iov;
-    };
-
-    for (unsigned i = 0; i < _buffer_count; i++) {
-      auto iov = alloc_iov();
-      auto region =
-          _transport->register_memory(iov->iov_base, iov->iov_len, 0, 0);
-      auto desc = _transport->get_memory_descriptor(region);
-
-      auto new_buffer    = new buffer_t(BUFFER_LEN);
+    void *p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p == MAP_FAILED) {
+      p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED)
+        throw General_exception("bm: mmap of buffer arena failed (len=%lu)",
+                                len);
+      madvise(p, len, MADV_HUGEPAGE);
+    }
+
+    /* bind before first touch, since memset faults the pages in */
+    if (numa_available() >= 0) {
+      if (numa_node < 0) {
+        int cpu = sched_getcpu();
+        if (cpu >= 0) numa_node = numa_node_of_cpu(cpu);
+      }
+      if (numa_node >= 0) numa_tonode_memory(p, len, numa_node);
+    }
+
+    memset(p, 0, len);
+    return p;
+  }
+
+  void grow(Size_class &sc, size_t count)
+  {
+    const size_t arena_len =
+        round_up(sc.len * (count ? count : 1), ARENA_ALIGNMENT);
+    count = arena_len / sc.len;
+
+    auto arena  = allocate_arena(arena_len, _numa_node);
+    auto region = _transport->register_memory(arena, arena_len, 0, 0);
+    auto desc   = _transport->get_memory_descriptor(region);
+    _arenas.push_back(Arena{iovec{arena, arena_len}, region});
+
+    for (size_t i = 0; i < count; i++) {
+      auto iov      = new iovec;
+      iov->iov_base = static_cast<char *>(arena) + (i * sc.len);
+      iov->iov_len  = sc.len;
+
+      auto new_buffer    = new buffer_t(sc.len);
       new_buffer->iov    = iov;
       new_buffer->region = region;
       new_buffer->desc   = desc;
 
       _buffers.push_back(new_buffer);
-      _free.push_back(new_buffer);
+      sc.free.push_back(new_buffer);
     }
+    sc.count += count;
   }
 
+  struct Arena {
+    iovec           iov;
+    memory_region_t region; /*< nullptr once deregistered */
+  };
+
   using pool_t = Component::IKVStore::pool_t;
   using key_t  = std::uint64_t;
 
   Transport *             _transport;
   const size_t            _buffer_count;
+  const int               _numa_node;
+  Size_class              _small;
+  Size_class              _large;
+  std::vector<Arena>      _arenas;
   std::vector<buffer_t *> _buffers;
-  std::vector<buffer_t *> _free;
 };
 
 }  // namespace Dawn
@@ -2,6 +2,7 @@
 #define __DAWN_CONFIG_FILE_H__
 
 #include <assert.h>
+#include <common/cpu.h>
 #include <common/exceptions.h>
 #include <rapidjson/document.h>
 #include <rapidjson/filereadstream.h>
@@ -9,6 +10,8 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <cstdlib>
+#include <map>
 #include <string>
 
 static const char* k_typenames[] = {"Null",  "False",  "True",  "Object",
@@ -59,10 +62,34 @@ class Config_file {
       throw General_exception("bad JSON: shard should be array");
 
     for (auto& m : _shards.GetArray()) {
-      if (!m["core"].IsInt())
+      if (m.HasMember("cores")) {
+        cpu_mask_t mask;
+        if (!m["cores"].IsString() ||
+            string_to_mask(m["cores"].GetString(), mask) != S_OK)
+          throw General_exception(
+              "bad JSON: optional shards::cores member not core list "
+              "(e.g. \"4-7\")");
+      }
+      else if (!m["core"].IsInt())
         throw General_exception("bad JSON: shards::core member not integer");
       if (!m["port"].IsInt())
         throw General_exception("bad JSON: shards::port member not integer");
+      if (m.HasMember("numa_node") && !m["numa_node"].IsUint())
+        throw General_exception(
+            "bad JSON: optional shards::numa_node member not unsigned integer");
+      if (m.HasMember("client_weights")) {
+        if (!m["client_weights"].IsObject())
+          throw General_exception(
+              "bad JSON: optional shards::client_weights member not object");
+        for (auto& w : m["client_weights"].GetObject()) {
+          char* end;
+          std::strtoull(w.name.GetString(), &end, 0);
+          if (*end != '\0' || !w.value.IsUint())
+            throw General_exception(
+                "bad JSON: shards::client_weights should map auth id to "
+                "unsigned weight (e.g. {\"42\" : 4})");
+        }
+      }
 
       if (!m["net"].IsNull())
         if (!m["net"].IsString())
@@ -71,8 +98,9 @@ class Config_file {
     }
     if (option_DEBUG) {
       for (unsigned i = 0; i < shard_count(); i++) {
-        PLOG("shard: core(%d) port(%d) net(%s)", get_shard_core(i),
-             get_shard_port(i), get_shard("net", i).c_str());
+        PLOG("shard: core(%d) cores(%s) port(%d) net(%s)", get_shard_core(i),
+             get_shard("cores", i).c_str(), get_shard_port(i),
+             get_shard("net", i).c_str());
       }
     }
   }
@@ -91,7 +119,12 @@ class Config_file {
     if (i > shard_count()) throw General_exception("get_shard out of bounds");
     assert(_shards[i].IsObject());
     auto shard = _shards[i].GetObject();
-    return shard["core"].GetUint();
+    if (shard.HasMember("core")) return shard["core"].GetUint();
+
+    /* otherwise, first core of the "cores" list */
+    cpu_mask_t mask;
+    string_to_mask(shard["cores"].GetString(), mask);
+    return mask.first_core();
   }
 
   unsigned int get_shard_port(rapidjson::SizeType i) const
@@ -102,6 +135,41 @@ class Config_file {
     return shard["port"].GetUint();
   }
 
+  /**
+   * Get NUMA node for a shard's memory
+   *
+   * @param i Shard index
+   *
+   * @return Configured node, or -1 if the node is to be auto-detected
+   */
+  int get_shard_numa_node(rapidjson::SizeType i) const
+  {
+    if (i > shard_count()) throw General_exception("get_shard out of bounds");
+    auto shard = get_shard(i);
+    if (!shard.HasMember("numa_node")) return -1;
+    return int(shard["numa_node"].GetUint());
+  }
+
+  /**
+   * Get scheduling weights of clients of a shard
+   *
+   * @param i Shard index
+   *
+   * @return Weights by client auth id
+   */
+  std::map<uint64_t, unsigned> get_shard_client_weights(
+      rapidjson::SizeType i) const
+  {
+    if (i > shard_count()) throw General_exception("get_shard out of bounds");
+    std::map<uint64_t, unsigned> result;
+    auto                         shard = get_shard(i);
+    if (!shard.HasMember("client_weights")) return result;
+    for (auto& w : shard["client_weights"].GetObject())
+      result[std::strtoull(w.name.GetString(), nullptr, 0)] =
+          w.value.GetUint();
+    return result;
+  }
+
   std::string get_shard(std::string name, rapidjson::SizeType i) const
   {
     if (i > shard_count()) throw General_exception("get_shard out of bounds");
@@ -149,6 +217,18 @@ class Config_file {
     return result;
   }
 
+  /**
+   * Get default network provider for shards that do not name one
+   *
+   * @return Provider (e.g. "verbs", "sockets") or empty string
+   */
+  std::string net_providers() const
+  {
+    if (!_doc.HasMember("net_providers") || !_doc["net_providers"].IsString())
+      return std::string();
+    return _doc["net_providers"].GetString();
+  }
+
   unsigned int debug_level() const
   {
     if (_doc["debug_level"].IsNull()) return 0;
@@ -28,40 +28,50 @@ int Connection_handler::tick()
 
   switch (_state) {
 
-    case POST_MSG_RECV: { /*< post buffer to receive new message */
+    case POST_MAX_RECVS: { /*< keep receive buffers posted for pipelining */
       if (option_DEBUG > 2)
-        PMAJOR("Shard State: %lu %p POST_MSG_RECV", _tick_count, this);
-      post_recv_buffer(allocate());
+        PMAJOR("Shard State: %lu %p POST_MAX_RECVS", _tick_count, this);
+      /* credits go back to the client with the next response */
+      _ungranted_credits += replenish_recvs();
       set_state(WAIT_NEW_MSG_RECV);
-      stall(); /* we can stall because we know that there will be a little while before the next request */
+      stall(); /* we can stall because we know that there will be a little
+                  while before the next request */
       break;
-    }      
+    }
     case WAIT_NEW_MSG_RECV: {
-      
-      if (check_for_posted_recv_complete()) { /*< check for recv completion */
-        
-        const auto     iob = posted_recv();
-        assert(iob);
+      buffer_t *iob = get_completed_recv(); /*< check for recv completion */
+
+      if (iob == nullptr) {
+        _stats.wait_msg_recv_misses++;
+        break;
+      }
+
+      /* drain all completed receives, in arrival order */
+      const uint64_t arrival = rdtsc();
+      for (; iob; iob = get_completed_recv()) {
         const Message *msg = static_cast<Message *>(iob->base());
         assert(msg);
 
         switch (msg->type_id) {
           case MSG_TYPE_IO_REQUEST: {
             if (option_DEBUG > 2) PMAJOR("Shard: IO_REQUEST");
-            _pending_msgs.push_back(iob);
-            set_state(POST_MSG_RECV);
+            _pending_msgs.push_back(Pending_msg{iob, arrival});
+            break;
+          }
+          case MSG_TYPE_IO_BATCH_REQUEST: {
+            if (option_DEBUG > 2) PMAJOR("Shard: IO_BATCH_REQUEST");
+            _pending_msgs.push_back(Pending_msg{iob, arrival});
             break;
           }
           case MSG_TYPE_CLOSE_SESSION: {
             if (option_DEBUG > 2) PMAJOR("Shard: CLOSE_SESSION!");
-            free_recv_buffer();
+            free_recv_buffer(iob);
             response = TICK_RESPONSE_CLOSE;
             break;
           }
           case MSG_TYPE_POOL_REQUEST: {
             if (option_DEBUG > 2) PMAJOR("Shard: POOL_REQUEST");
-            _pending_msgs.push_back(iob);
-            set_state(POST_MSG_RECV); /* move state to new message recv */
+            _pending_msgs.push_back(Pending_msg{iob, arrival});
             break;
           }
           default:
@@ -74,35 +84,9 @@ int Connection_handler::tick()
           PMAJOR("Shard State: %lu %p WAIT_MSG_RECV complete", _tick_count,
                  this);
       }
-      else {
-        _stats.wait_msg_recv_misses++;
-      }
-
-      break;
-    }
-    case WAIT_RECV_VALUE: {
 
-      if (check_for_posted_value_complete()) {
-        if (option_DEBUG > 2) {
-          PMAJOR("Shard State: %lu %p WAIT_RECV_VALUE ok", _tick_count, this);
-        }
-
-        /* add action to release lock */
-        // add_pending_action(action_t{ACTION_RELEASE_VALUE_LOCK,
-        //       _posted_value_buffer->base()});
-
-        delete _posted_value_buffer; /* delete descriptor */
-        _posted_value_buffer = nullptr;
-
-        if (option_DEBUG > 2)
-          PMAJOR("Shard State: %lu %p WAIT_RECV_VALUE_COMPLETE", _tick_count,
-                 this);
-
-        set_state(POST_MSG_RECV);
-        _stats.recv_msg_count++;
-      }
-      else
-        _stats.wait_recv_value_misses++;
+      /* replenish receive buffers */
+      if (response != TICK_RESPONSE_CLOSE) set_state(POST_MAX_RECVS);
       break;
     }
     case INITIALIZE: {
@@ -119,23 +103,35 @@ int Connection_handler::tick()
     }
     case WAIT_HANDSHAKE: {
         
-      if (check_for_posted_recv_complete()) {
+      if (auto iob = get_completed_recv()) {
         if (option_DEBUG > 2)
           PMAJOR("Shard State: %lu %p WAIT_HANDSHAKE complete", _tick_count,
                  this);
 
-        auto iob = posted_recv();
-
         Message_handshake *msg = static_cast<Message_handshake *>(iob->base());
         if (msg->type_id == Dawn::Protocol::MSG_TYPE_HANDSHAKE) {
-          auto reply_iob = allocate();
+          if (msg->version != PROTOCOL_VERSION)
+            throw Protocol_exception(
+                "handshake protocol version mismatch (client=%x server=%x)",
+                msg->version, PROTOCOL_VERSION);
+          _client_id = msg->auth_id;
+
+          /* grant the requested credit window (within our limit) and
+             post receives for it before the client learns of it */
+          _credit_window = std::max(
+              1U, std::min(msg->credits, MAX_OUTSTANDING_REQUESTS));
+          replenish_recvs();
+
+          auto reply_iob = allocate(sizeof(Message_handshake_reply));
           assert(reply_iob);
           auto reply_msg =
               new (reply_iob->base()) Dawn::Protocol::Message_handshake_reply(
-                  auth_id(), 1 /* seq */, max_message_size(), (uint64_t) this);
+                  auth_id(), 1 /* seq */, max_message_size(), (uint64_t) this,
+                  _credit_window);
           /* post response */
           reply_iob->set_length(reply_msg->msg_len);
           post_send_buffer(reply_iob);
+          free_recv_buffer(iob);
 
           set_state(WAIT_HANDSHAKE_RESPONSE_COMPLETION);
         }
@@ -153,7 +149,7 @@ int Connection_handler::tick()
           PMAJOR("Shard State: %lu %p WAIT_HANDSHAKE_RESPONSE_COMPLETION "
                  "complete.",
                  _tick_count, this);
-        set_state(POST_MSG_RECV);
+        set_state(POST_MAX_RECVS);
       }
       break;
     }
@@ -162,30 +158,4 @@ int Connection_handler::tick()
   return response;
 }
 
-void Connection_handler::set_pending_value(void *          target,
-                                           size_t          target_len,
-                                           memory_region_t region)
-{
-  assert(target);
-  assert(target_len);
-
-  if (option_DEBUG > 2)
-    PLOG("set_pending_value (target=%p, target_len=%lu)", target, target_len);
-
-  auto iov  = new ::iovec{target, target_len};
-  auto desc = get_memory_descriptor(region);
-  assert(desc);
-  _posted_value_buffer =
-      new buffer_t(target_len); /* allocate buffer descriptor */
-  _posted_value_buffer->iov    = iov;
-  _posted_value_buffer->region = region;
-  _posted_value_buffer->desc   = desc;
-  _posted_value_buffer->flags =
-      Buffer_manager<Fabric_connection_base>::BUFFER_FLAGS_EXTERNAL;
-  _posted_value_buffer_outstanding = true;
-
-  post_recv_value_buffer(_posted_value_buffer);
-  set_state(State::WAIT_RECV_VALUE);
-}
-
 }  // namespace Dawn
@@ -10,10 +10,14 @@
 #include <common/logging.h>
 #include <common/cycles.h>
 #include <sys/mman.h>
+#include <algorithm>
+#include <atomic>
 #include <map>
 #include <queue>
 #include <set>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "buffer_manager.h"
 #include "dawn_config.h"
@@ -60,19 +64,19 @@ class Connection_handler
     WAIT_HANDSHAKE,
     WAIT_HANDSHAKE_RESPONSE_COMPLETION,
     POST_MAX_RECVS,
-    POST_MSG_RECV,
     WAIT_NEW_MSG_RECV,
-    WAIT_RECV_VALUE,
   };
 
   State _state = State::INITIALIZE;
 
  public:
-  Connection_handler(Factory* factory, Connection* connection)
-      : Connection_base(factory, connection), Region_manager(connection)
+  using pool_t = Component::IKVStore::pool_t;
+
+  Connection_handler(Factory* factory, Connection* connection, int numa_node = -1)
+      : Connection_base(factory, connection, numa_node),
+        Region_manager(connection)
   {
     _pending_actions.reserve(Buffer_manager<Connection>::DEFAULT_BUFFER_COUNT);
-    _pending_msgs.reserve(Buffer_manager<Connection>::DEFAULT_BUFFER_COUNT);
     _freq_mhz = Common::get_rdtsc_frequency_mhz();
   }
 
@@ -105,37 +109,99 @@ class Connection_handler
    * Check for network completions
    *
    */
-  inline void check_network_completions()
-  {
-    if (poll_completions()) {
-      /* deferred unlocks */
-      if (_deferred_unlock) {
-        if (option_DEBUG > 2)
-          PLOG("adding action for deferred unlocking value @ %p",
-               _deferred_unlock);
-        add_pending_action(action_t{ACTION_RELEASE_VALUE_LOCK, _deferred_unlock});
-        _deferred_unlock = nullptr;
-      }
-    }
-  }
+  inline void check_network_completions() { poll_completions(); }
 
   /**
-   * Get pending message from the connection
+   * Get pending message from the connection.  Messages are returned in
+   * the order they were received; the buffer should be released with
+   * free_recv_buffer once the message has been processed.
    *
    * @param msg [out] Pointer to base protocol message
+   * @param arrival [out] Time (rdtsc) the message was taken off the network
    *
    * @return Pointer to buffer holding the message or null if there are none
    */
-  inline buffer_t* get_pending_msg(Dawn::Protocol::Message*& msg)
+  inline buffer_t* get_pending_msg(Dawn::Protocol::Message*& msg,
+                                   uint64_t&                 arrival)
   {
     if (_pending_msgs.empty()) return nullptr;
-    auto iob = _pending_msgs.back();
+    auto iob = _pending_msgs.front().iob;
+    arrival  = _pending_msgs.front().arrival;
     assert(iob);
-    _pending_msgs.pop_back();
+    _pending_msgs.pop_front();
     msg = static_cast<Dawn::Protocol::Message*>(iob->base());
     return iob;
   }
 
+  /**
+   * Number of received messages waiting to be processed
+   *
+   * @return Message count
+   */
+  inline size_t pending_msg_count() const { return _pending_msgs.size(); }
+
+  /**
+   * Identity the client presented in the handshake
+   *
+   * @return Client auth id
+   */
+  inline uint64_t client_id() const { return _client_id; }
+
+  /**
+   * Scheduling weight (quanta per round); zero until assigned by the
+   * shard
+   *
+   * @return Weight
+   */
+  inline unsigned weight() const { return _weight; }
+
+  inline void set_weight(unsigned weight) { _weight = weight; }
+
+  /**
+   * Deficit round robin credit, in message cost units.  It may go
+   * negative when a message costs more than the credit left.
+   *
+   */
+  inline int64_t& deficit() { return _deficit; }
+
+  /**
+   * Record a message taken off the pending queue for processing
+   *
+   * @param queue_cycles Time spent in the pending queue
+   * @param now Time (rdtsc) of dispatch
+   */
+  inline void record_dispatch(uint64_t queue_cycles, uint64_t now)
+  {
+    _last_dispatch = now;
+    auto& s = _sched_stats;
+    s.ops.store(s.ops.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+    s.queue_cycles.store(
+        s.queue_cycles.load(std::memory_order_relaxed) + queue_cycles,
+        std::memory_order_relaxed);
+    if (queue_cycles > s.queue_max_cycles.load(std::memory_order_relaxed))
+      s.queue_max_cycles.store(queue_cycles, std::memory_order_relaxed);
+  }
+
+  /**
+   * Scheduling statistics; written by the owning worker only, so they
+   * may be read from other threads without locking
+   *
+   */
+  struct Sched_stats {
+    std::atomic<uint64_t> ops{0};
+    std::atomic<uint64_t> queue_cycles{0};     /*< total */
+    std::atomic<uint64_t> queue_max_cycles{0}; /*< maximum */
+  };
+
+  inline const Sched_stats& sched_stats() const { return _sched_stats; }
+
+  /**
+   * Time (rdtsc) a message was last dispatched, or 0 if none has been
+   *
+   */
+  inline uint64_t last_dispatch() const { return _last_dispatch; }
+
   /**
    * Get deferrd action
    *
@@ -161,36 +227,152 @@ class Connection_handler
     _pending_actions.push_back(action);
   }
 
+  /**
+   * Post receive buffers up to the credit window
+   *
+   * @return Number of receive buffers posted
+   */
+  inline unsigned replenish_recvs()
+  {
+    unsigned count = 0;
+    while (posted_recv_count() < _credit_window) {
+      post_recv_buffer(allocate());
+      count++;
+    }
+    return count;
+  }
+
   /**
    * Post a response
    *
    * @param iob IO buffer to post
    */
-  inline void post_response(buffer_t* iob, buffer_t* val_iob = nullptr)
+  inline void post_response(buffer_t* iob)
   {
     assert(iob);
 
-    post_send_buffer(iob, val_iob);
-    if (val_iob) {
-      _posted_value_buffer = val_iob;
-    }
+    /* return credits for the receive consumed by the request (and any
+       re-posted since the last response) */
+    _ungranted_credits += replenish_recvs();
+    static_cast<Protocol::Message*>(iob->base())->credits =
+        _ungranted_credits;
+    _ungranted_credits = 0;
 
+    post_send_buffer(iob); /* don't wait for this, let it be picked up in
+                              the check_completions cycle */
     _stats.response_count++;
+  }
+
+  /**
+   * Record a value locked for a two-stage operation on this session.
+   * Its memory region (from get_region) is pinned until it is removed.
+   *
+   * @param pool Pool identifier
+   * @param key Lock handle from IKVStore::lock
+   * @param target Value address
+   * @param target_len Value length in bytes
+   */
+  inline void add_locked_value(const pool_t                     pool,
+                               const Component::IKVStore::key_t key,
+                               const void*                      target,
+                               const size_t                     target_len)
+  {
+    if (option_DEBUG > 2)
+      PLOG("locked value (target=%p len=%lu)", target, target_len);
+    if (_locked_values.find(target) == _locked_values.end())
+      pin_region(target);
+    _locked_values[target] = Locked_value{pool, key, target_len};
+  }
+
+  /**
+   * Get length of a locked value
+   *
+   * @param target Value address
+   *
+   * @return Length in bytes, or 0 if the value is not locked on this session
+   */
+  inline size_t locked_value_length(const void* target) const
+  {
+    auto i = _locked_values.find(target);
+    return i == _locked_values.end() ? 0 : i->second.len;
+  }
+
+  /**
+   * Remove record of a locked value
+   *
+   * @param target Value address, or nullptr for any locked value
+   * @param out_pool [out] Pool identifier
+   * @param out_key [out] Lock handle
+   *
+   * @return True if a locked value was found
+   */
+  inline bool remove_locked_value(const void*                 target,
+                                  pool_t&                     out_pool,
+                                  Component::IKVStore::key_t& out_key)
+  {
+    auto i = target ? _locked_values.find(target) : _locked_values.begin();
+    if (i == _locked_values.end()) return false;
+    out_pool = i->second.pool;
+    out_key  = i->second.key;
+    unpin_region(i->first);
+    _locked_values.erase(i);
+    return true;
+  }
 
-    set_state(POST_MSG_RECV); /* don't wait for this, let it be picked up in
-                                 the check_completions cycle */
+  /**
+   * Start tracking the position of an OP_SCAN for its later pages.  The
+   * oldest scan is dropped if the session has too many.
+   *
+   * @param pool Pool identifier
+   *
+   * @return Scan id (non-zero)
+   */
+  inline uint32_t add_scan(const pool_t pool)
+  {
+    if (_scans.size() >= MAX_SCANS) {
+      /* ids wrap, so the oldest is the one started first */
+      using entry_t = std::pair<const uint32_t, Scan>;
+      auto oldest   = std::min_element(
+          _scans.begin(), _scans.end(),
+          [](const entry_t& a, const entry_t& b) {
+            return a.second.started < b.second.started;
+          });
+      PWRN("dropping unfinished scan (%u)", oldest->first);
+      _scans.erase(oldest);
+    }
+
+    do {
+      _next_scan_id = (_next_scan_id + 1) & Protocol::SCAN_CURSOR_ID_MASK;
+    } while (_next_scan_id == 0 || _scans.count(_next_scan_id));
+
+    auto& scan   = _scans[_next_scan_id];
+    scan.pool    = pool;
+    scan.started = _scans_started++;
+    scan.position.clear();
+    return _next_scan_id;
+  }
+
+  /**
+   * Get position (last key returned) of a scan
+   *
+   * @param id Scan id
+   * @param pool Pool identifier
+   *
+   * @return Position, or nullptr if there is no such scan for the pool
+   */
+  inline std::string* scan_position(const uint32_t id, const pool_t pool)
+  {
+    auto i = _scans.find(id);
+    return (i == _scans.end() || i->second.pool != pool) ? nullptr
+                                                         : &i->second.position;
   }
 
   /**
-   * Set up for pending value send/recv
+   * Release a scan
    *
-   * @param target
-   * @param target_len
-   * @param region
+   * @param id Scan id
    */
-  void set_pending_value(void*  target,
-                         size_t target_len,
-                         Component::IFabric_connection::memory_region_t region);
+  inline void remove_scan(const uint32_t id) { _scans.erase(id); }
 
   inline uint64_t auth_id() const { return (uint64_t) this; /* temp */ }
 
@@ -210,7 +392,6 @@ class Connection_handler
   struct {
     uint64_t response_count               = 0;
     uint64_t recv_msg_count               = 0;
-    uint64_t wait_recv_value_misses       = 0;
     uint64_t wait_msg_recv_misses         = 0;
     uint64_t wait_respond_complete_misses = 0;
     uint64_t last_count                   = 0;
@@ -226,16 +407,46 @@ class Connection_handler
     PINF("NEW_MSG_RECV misses         : %lu", _stats.wait_msg_recv_misses);
     PINF("Recv message count          : %lu", _stats.recv_msg_count);
     PINF("Response count              : %lu", _stats.response_count);
-    PINF("WAIT_RECV_VALUE misses      : %lu", _stats.wait_recv_value_misses);
     PINF("WAIT_RESPOND_COMPLETE misses: %lu", _stats.wait_respond_complete_misses);
     PINF("-----------------------------------------");
   }
 
  private:
+  struct Locked_value {
+    pool_t                     pool;
+    Component::IKVStore::key_t key;
+    size_t                     len;
+  };
+
+  static constexpr size_t MAX_SCANS = 16; /*< unfinished scans per session */
+
+  struct Scan {
+    pool_t      pool;
+    uint64_t    started;  /*< start order */
+    std::string position; /*< last key returned */
+  };
+
+  struct Pending_msg {
+    buffer_t* iob;
+    uint64_t  arrival; /*< rdtsc */
+  };
+
   uint64_t               _tick_count __attribute((aligned(8))) = 0;
-  std::vector<buffer_t*> _pending_msgs;
+  std::deque<Pending_msg> _pending_msgs;
+  std::map<const void*, Locked_value>
+                         _locked_values;
   std::vector<action_t>  _pending_actions;
+  std::map<uint32_t, Scan> _scans; /*< unfinished OP_SCANs, by id */
+  uint32_t               _next_scan_id  = 0;
+  uint64_t               _scans_started = 0;
+  unsigned               _credit_window     = 0; /*< negotiated in handshake */
+  unsigned               _ungranted_credits = 0;
   float                  _freq_mhz;
+  uint64_t               _client_id = 0; /*< auth id from handshake */
+  unsigned               _weight    = 0;
+  int64_t                _deficit   = 0;
+  Sched_stats            _sched_stats;
+  uint64_t               _last_dispatch = 0; /*< rdtsc */
   char _padding[64];
   uint64_t               _stall_tick = 0;
 };
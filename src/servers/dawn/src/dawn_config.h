@@ -1,11 +1,16 @@
 #ifndef __DAWN_CONFIG_H__
 #define __DAWN_CONFIG_H__
 
+#include <atomic>
+
 namespace Dawn
 {
 namespace Global
 {
 extern unsigned debug_level;
+
+/* incremented (e.g. on SIGUSR1) to have each shard dump its statistics */
+extern std::atomic<unsigned> stats_dump_request;
 }
 }  // namespace Dawn
 
@@ -1,7 +1,13 @@
 #ifndef __FABRIC_CONNECTION_BASE_H__
 #define __FABRIC_CONNECTION_BASE_H__
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <vector>
+
 #include "dawn_config.h"
+#include "protocol.h"
 
 namespace Dawn
 {
@@ -19,6 +25,10 @@ class Fabric_connection_base {
   using buffer_t = Buffer_manager<Component::IFabric_server>::buffer_t;
   using pool_t   = Component::IKVStore::pool_t;
 
+  /* posted receives, plus a response buffer for each in-flight request */
+  static constexpr size_t BUFFER_COUNT =
+      (2 * Protocol::MAX_OUTSTANDING_REQUESTS) + 4;
+
   /* deferred actions */
   typedef struct {
     int   op;
@@ -30,10 +40,13 @@ class Fabric_connection_base {
    *
    * @param factory
    * @param fabric_connection
+   * @param numa_node NUMA node for IO buffers (-1 for calling thread's)
    */
   Fabric_connection_base(Component::IFabric_server_factory *factory,
-                         Component::IFabric_server *        fabric_connection)
-      : _factory(factory), _transport(fabric_connection), _bm(fabric_connection)
+                         Component::IFabric_server *        fabric_connection,
+                         int                                numa_node = -1)
+      : _bm(fabric_connection, BUFFER_COUNT, numa_node), _factory(factory),
+        _transport(fabric_connection)
   {
     assert(_transport);
     _max_message_size = _transport->max_message_size();
@@ -48,6 +61,7 @@ class Fabric_connection_base {
     for (auto r : _registered_regions) {
       _transport->deregister_memory(r);
     }
+    _bm.deregister_arenas();
 
     /* ERROR: RDMA and FABRIC disagree on the name (disconnect vs.
      * close_connection). Maybe RDMA's choice (disconnect) is better. One less
@@ -74,172 +88,117 @@ class Fabric_connection_base {
       throw Program_exception("RDMA operation failed unexpectedly (context=%p)",
                               context);
 
-    if (context == pThis->_posted_recv_buffer) {
-      assert(pThis->_posted_recv_buffer_outstanding);
+    buffer_t *iob = static_cast<buffer_t *>(context);
+
+    /* receives complete in the order they were posted */
+    auto &recvs = pThis->_posted_recv_buffers;
+    auto  i     = std::find(recvs.begin(), recvs.end(), iob);
+    if (i != recvs.end()) {
       if (option_DEBUG) PLOG("Posted recv complete (%p).", context);
-      pThis->_posted_recv_buffer_outstanding = false; /* signal recv completion */
+      recvs.erase(i);
+      pThis->_completed_recv_buffers.push_back(iob);
       return;
     }
-    else if (context == pThis->_posted_send_buffer) {
-      assert(pThis->_posted_send_buffer_outstanding);
+
+    auto &sends = pThis->_posted_send_buffers;
+    i           = std::find(sends.begin(), sends.end(), iob);
+    if (i != sends.end()) {
       if (option_DEBUG) PLOG("Posted send complete (%p).", context);
-      pThis->_posted_send_buffer_outstanding = false; /* signal send completion */
+      sends.erase(i);
+      pThis->free_buffer(iob);
       return;
     }
-    else if (context == pThis->_posted_value_buffer) {
-      assert(pThis->_posted_value_buffer_outstanding);
-      char *p = (char *) pThis->_posted_value_buffer->base();
-      if (option_DEBUG) {
-        PLOG("Posted value complete (%p) [%x %x %x...]", context,
-             0xff & (int) p[0], 0xff & (int) p[1], 0xff & (int) p[2]);
-      }
-      pThis->_posted_value_buffer_outstanding = false; /* signal value completion */
-    }
-    else {
-      throw Program_exception("unknown completion context (%p)", context);
-    }
+
+    throw Program_exception("unknown completion context (%p)", context);
   }
 
   inline bool check_for_posted_send_complete()
   {
-    if (_posted_send_buffer_outstanding) return false;
-
-    if (_posted_send_buffer) {
-      free_buffer(_posted_send_buffer);
-      _posted_send_buffer = nullptr;
-    }
-
-    return true;
+    return _posted_send_buffers.empty();
   }
 
-  inline bool check_for_posted_recv_complete()
+  /**
+   * Get the next completed receive buffer, in posting order
+   *
+   * @return Buffer holding the received message or null if none
+   */
+  inline buffer_t *get_completed_recv()
   {
-    /* don't free buffer (such as above); it will be used for response */
-    return _posted_recv_buffer_outstanding == false;
+    if (_completed_recv_buffers.empty()) return nullptr;
+    auto iob = _completed_recv_buffers.front();
+    _completed_recv_buffers.pop_front();
+    return iob;
   }
 
-  bool check_for_posted_value_complete(bool *added_deferred_unlock = nullptr)
+  inline size_t posted_recv_count() const
   {
-    if (_posted_value_buffer_outstanding) return false;
-
-    if (_posted_value_buffer) { /* release 'value buffer' from get_direct */
-      assert(_deferred_unlock == nullptr);
-      _deferred_unlock = _posted_value_buffer->base();
-      if (added_deferred_unlock) *added_deferred_unlock = true;
-      _posted_value_buffer = nullptr;
-    }
-
-    return true;
+    return _posted_recv_buffers.size();
   }
 
-  void free_recv_buffer()
+  void free_recv_buffer(buffer_t *buffer)
   {
-    assert(_posted_recv_buffer_outstanding == false);
-    assert(_posted_recv_buffer);
-
-    free_buffer(_posted_recv_buffer);
-    _posted_recv_buffer = nullptr;
+    assert(buffer);
+    free_buffer(buffer);
   }
 
   void post_recv_buffer(buffer_t *buffer)
   {
     assert(buffer);
-    assert(_posted_recv_buffer_outstanding == false);
-    _posted_recv_buffer             = buffer;
-    _posted_recv_buffer_outstanding = true;
-    _transport->post_recv(_posted_recv_buffer->iov,
-                          _posted_recv_buffer->iov + 1,
-                          &_posted_recv_buffer->desc, _posted_recv_buffer);
+    _posted_recv_buffers.push_back(buffer);
+    _transport->post_recv(buffer->iov, buffer->iov + 1, &buffer->desc, buffer);
   }
 
-  void post_send_buffer(buffer_t *buffer, buffer_t *val_buffer = nullptr)
+  void post_send_buffer(buffer_t *buffer)
   {
     assert(buffer);
-    assert(_posted_send_buffer_outstanding == false);
     const auto iov = buffer->iov;
 
-    if (!val_buffer) {
-      /* if packet is small enough use inject */
-      if (iov->iov_len <= _transport->max_inject_size()) {
-        _transport->inject_send(iov->iov_base, iov->iov_len);
-        free_buffer(
-            buffer); /* buffer can be immediately freed; see fi_inject */
-      }
-      else {
-        _posted_send_buffer             = buffer;
-        _posted_send_buffer_outstanding = true;
-
-        _transport->post_send(iov, iov + 1, &_posted_send_buffer->desc,
-                              _posted_send_buffer);
-      }
+    /* if packet is small enough use inject */
+    if (iov->iov_len <= _transport->max_inject_size()) {
+      _transport->inject_send(iov->iov_base, iov->iov_len);
+      free_buffer(buffer); /* buffer can be immediately freed; see fi_inject */
     }
     else {
-      _posted_send_buffer             = buffer;
-      _posted_send_buffer_outstanding = true;
-
-      iovec v[2]   = {*buffer->iov, *val_buffer->iov};
-      void *desc[] = {buffer->desc, val_buffer->desc};
-
-      if (option_DEBUG)
-        PLOG("posting .... value (%.*s) (len=%lu,ptr=%p)",
-             (int) val_buffer->iov->iov_len, (char *) val_buffer->iov->iov_base,
-             val_buffer->iov->iov_len, val_buffer->iov->iov_base);
-
-      _transport->post_send(&v[0], &v[2], desc, buffer);
+      _posted_send_buffers.push_back(buffer);
+      _transport->post_send(iov, iov + 1, &buffer->desc, buffer);
     }
   }
 
-  void post_send_value_buffer(buffer_t *buffer)
+  inline void poll_completions()
   {
-    if (buffer) {
-      assert(!_posted_value_buffer);
-      _posted_value_buffer = buffer;
+    if (!_posted_recv_buffers.empty() || !_posted_send_buffers.empty()) {
+      try {
+        _transport->poll_completions(completion_callback, this);
+      }
+      catch (std::logic_error e) {
+        throw General_exception("client disconnected");
+      }
     }
-    assert(_posted_value_buffer);
-    _posted_value_buffer_outstanding = true;
-    _transport->post_send(_posted_value_buffer->iov,
-                          _posted_value_buffer->iov + 1,
-                          &_posted_value_buffer->desc, _posted_value_buffer);
   }
 
-  void post_recv_value_buffer(buffer_t *buffer = nullptr)
+  /**
+   * Block until there is a completion to poll, the timeout expires or
+   * unblock_completions is called (from another thread)
+   *
+   * @param timeout Maximum time to wait
+   */
+  inline void wait_for_completion(std::chrono::milliseconds timeout)
   {
-    if (buffer) {
-      _posted_value_buffer = buffer;
-      /* PLOG("posting recv value buffer (%p)(base=%p,len=%lu)", */
-      /* 	   buffer, */
-      /* 	   _posted_value_buffer->iov->iov_base, */
-      /* 	   _posted_value_buffer->iov->iov_len); */
-    }
-    assert(_posted_value_buffer);
-    _posted_value_buffer_outstanding = true;
-    _transport->post_recv(_posted_value_buffer->iov,
-                          _posted_value_buffer->iov + 1,
-                          &_posted_value_buffer->desc, _posted_value_buffer);
+    _transport->wait_for_next_completion(timeout);
   }
 
-  inline buffer_t *posted_recv() const { return _posted_recv_buffer; }
-  inline buffer_t *posted_send() const { return _posted_send_buffer; }
+  inline void unblock_completions() { _transport->unblock_completions(); }
 
-  inline bool poll_completions()
+  /**
+   * Prepare to wait for completions along with other connections
+   *
+   * @param fds Descriptors to wait on (appended)
+   *
+   * @return False if completions may be pending and should be polled
+   */
+  inline bool prepare_wait(std::vector<int> &fds)
   {
-    if( _posted_recv_buffer_outstanding ||
-        _posted_send_buffer_outstanding ||
-        _posted_value_buffer_outstanding)
-      {       
-        bool added_deferred_unlock = false;
-        try {
-          _transport->poll_completions(completion_callback, this);
-          check_for_posted_send_complete();
-          check_for_posted_value_complete(&added_deferred_unlock);
-        }
-        catch (std::logic_error e) {
-          throw General_exception("client disconnected");
-        }
-
-        return added_deferred_unlock;
-      }
-    return false;
+    return _transport->prepare_wait(fds);
   }
 
   /**
@@ -262,10 +221,21 @@ class Fabric_connection_base {
     return _transport->get_memory_descriptor(region);
   }
 
-  inline auto allocate() { return _bm.allocate(); }
+  inline uint64_t get_memory_remote_key(memory_region_t region)
+  {
+    return _transport->get_memory_remote_key(region);
+  }
+
+  inline auto allocate(
+      size_t len = Buffer_manager<Component::IFabric_server>::BUFFER_LEN)
+  {
+    return _bm.allocate(len);
+  }
 
   inline void free_buffer(buffer_t *buffer) { _bm.free(buffer); }
 
+  inline size_t buffers_in_use() const { return _bm.in_use(); }
+
   inline size_t IO_buffer_size() const
   {
     return Buffer_manager<Component::IFabric_server>::BUFFER_LEN;
@@ -279,22 +249,12 @@ class Fabric_connection_base {
   Component::IFabric_server_factory *_factory;
   Component::IFabric_server *        _transport;
   std::vector<memory_region_t>       _registered_regions;
-  void *                             _deferred_unlock = nullptr;
-
-  /* xx_buffer_outstanding is the signal for completion,
-     xx_buffer is the buffer pointer that needs to be freed (and set to null)
-  */
-  buffer_t *_posted_recv_buffer             = nullptr;
-  bool      _posted_recv_buffer_outstanding = false;
 
-  buffer_t *_posted_send_buffer             = nullptr;
-  bool      _posted_send_buffer_outstanding = false;
-
-  /* value for two-phase get & put - assumes get and put don't happen
-     at the same time for the same FSM
-   */
-  buffer_t *_posted_value_buffer             = nullptr;
-  bool      _posted_value_buffer_outstanding = false;
+  /* receive buffers are posted up to the negotiated credit window so
+     that a client can pipeline requests */
+  std::vector<buffer_t *> _posted_recv_buffers;
+  std::deque<buffer_t *>  _completed_recv_buffers;
+  std::vector<buffer_t *> _posted_send_buffers;
 };
 
 }  // namespace Dawn
@@ -19,13 +19,15 @@ class Fabric_transport {
 
   Fabric_transport(const std::string provider,
                    const std::string device,
-                   unsigned          port)
+                   unsigned          port,
+                   int               numa_node = -1)
+      : _numa_node(numa_node)
   {
     option_DEBUG = Dawn::Global::debug_level > 1;
 
     if (option_DEBUG)
-      PLOG("fabric_transport: (provider=%s, device=%s, port=%u)",
-           provider.c_str(), device.c_str(), port);
+      PLOG("fabric_transport: (provider=%s, device=%s, port=%u, numa=%d)",
+           provider.c_str(), device.c_str(), port, numa_node);
 
     init(provider, device, port);
   }
@@ -34,9 +36,30 @@ class Fabric_transport {
   {
     auto connection = _server_factory->get_new_connection();
     if (!connection) return nullptr;
-    return new Connection_handler(_server_factory, connection);
+    return new Connection_handler(_server_factory, connection, _numa_node);
   }
 
+  /**
+   * Wait for a new connection
+   *
+   * @param timeout Maximum time to wait
+   *
+   * @return New connection handler, or nullptr on timeout
+   */
+  Connection_handler* wait_for_new_connection(std::chrono::milliseconds timeout)
+  {
+    auto connection = _server_factory->wait_for_new_connection(timeout);
+    if (!connection) return nullptr;
+    return new Connection_handler(_server_factory, connection, _numa_node);
+  }
+
+  /**
+   * NUMA node on which connection buffers are allocated
+   *
+   * @return Node, or -1 for the node of the accepting thread
+   */
+  int numa_node() const { return _numa_node; }
+
  private:
   void init(const std::string& provider,
             const std::string& device,
@@ -85,6 +108,7 @@ class Fabric_transport {
     i_fabric_factory->release_ref();
   }
 
+  const int                          _numa_node;
   Component::IFabric*                _fabric;
   Component::IFabric_server_factory* _server_factory;
 };
@@ -2,10 +2,12 @@
 #define __DAWN_LAUNCHER_H__
 
 #include <common/logging.h>
+#include <algorithm>
 #include <sstream>
 #include <string>
 
 #include "config_file.h"
+#include "numa_topology.h"
 #include "program_options.h"
 #include "shard.h"
 
@@ -18,23 +20,43 @@ class Shard_launcher : public Config_file {
   Shard_launcher(Program_options& options) : Config_file(options.config_file)
   {
     for (unsigned i = 0; i < shard_count(); i++) {
-      PMAJOR("launching shard: core(%d) port(%d) net(%s)", get_shard_core(i),
-             get_shard_port(i), get_shard("net", i).c_str());
+      /* provider: per shard, else configuration default, else verbs */
+      std::string provider = get_shard("provider", i);
+      if (provider.empty()) provider = net_providers();
+      if (provider.empty()) provider = DEFAULT_PROVIDER;
 
-      auto dax_config = get_shard_dax_config(i);
-      assert(dax_config.size() == 1);
-      std::stringstream ss;
-      ss << "[{\"region_id\":0,\"path\":\"" << dax_config[0].first
-         << "\",\"addr\":\"" << dax_config[0].second << "\"}]";
-      PLOG("DAX config %s", ss.str().c_str());
-      const std::string dax_config_json = ss.str();
+      PMAJOR("launching shard: core(%d) port(%d) net(%s) provider(%s)",
+             get_shard_core(i), get_shard_port(i), get_shard("net", i).c_str(),
+             provider.c_str());
+
+      const int numa_node = select_numa_node(i);
+
+      const auto client_weights = get_shard_client_weights(i);
+      for (auto& w : client_weights)
+        if (w.second < 1 || w.second > Shard::MAX_WEIGHT)
+          throw General_exception("client weight (%u) should be 1-%u",
+                                  w.second, Shard::MAX_WEIGHT);
+
+      /* only hstore needs dax configuration */
+      std::string dax_config_json;
+      if (get_shard(i).HasMember("dax_config")) {
+        auto dax_config = get_shard_dax_config(i);
+        assert(dax_config.size() == 1);
+        std::stringstream ss;
+        ss << "[{\"region_id\":" << std::max(numa_node, 0)
+           << ",\"path\":\"" << dax_config[0].first
+           << "\",\"addr\":\"" << dax_config[0].second << "\"}]";
+        PLOG("DAX config %s", ss.str().c_str());
+        dax_config_json = ss.str();
+      }
 
       _shards.push_back(new Dawn::Shard(
-          get_shard_core(i), get_shard_port(i), DEFAULT_PROVIDER,
+          get_shard_core(i), get_shard("cores", i), get_shard_port(i),
+          provider,
           get_shard("device", i), get_shard("net", i),
           get_shard("default_backend", i), get_shard("nvme_device", i),
-          get_shard("pm_path", i), dax_config_json, options.debug_level,
-          options.forced_exit));
+          get_shard("pm_path", i), dax_config_json, numa_node, client_weights,
+          options.debug_level, options.forced_exit));
     }
   }
 
@@ -57,6 +79,46 @@ class Shard_launcher : public Config_file {
   }
 
  private:
+  /**
+   * Choose the NUMA node for a shard's memory: the configured
+   * "numa_node", otherwise the node of the shard's core, otherwise the
+   * node of its network device.  Warn if the core, the device and the
+   * memory are not all on the same node.
+   *
+   * @param i Shard index
+   *
+   * @return Node, or -1 if unknown
+   */
+  int select_numa_node(unsigned i) const
+  {
+    const int core_node = Numa::node_of_core(get_shard_core(i));
+    const int net_node  = Numa::node_of_net_device(get_shard("net", i));
+
+    int numa_node = get_shard_numa_node(i);
+    if (numa_node < 0) numa_node = core_node >= 0 ? core_node : net_node;
+
+    /* device DAX memory cannot move; it is where the device is */
+    int mem_node = numa_node;
+    if (get_shard("default_backend", i) == "hstore" &&
+        get_shard(i).HasMember("dax_config")) {
+      auto dax_node =
+          Numa::node_of_dax_device(get_shard_dax_config(i)[0].first);
+      if (dax_node >= 0) mem_node = dax_node;
+    }
+
+    PLOG("shard %u: numa node %d (core=%d net=%d memory=%d)", i, numa_node,
+         core_node, net_node, mem_node);
+
+    auto differ = [](int a, int b) { return a >= 0 && b >= 0 && a != b; };
+    if (differ(core_node, net_node) || differ(core_node, mem_node) ||
+        differ(net_node, mem_node))
+      PWRN("shard %u: core (node %d), net (node %d) and memory (node %d) are "
+           "on different NUMA nodes",
+           i, core_node, net_node, mem_node);
+
+    return numa_node;
+  }
+
   std::vector<Dawn::Shard*> _shards;
 };
 }  // namespace Dawn
@@ -0,0 +1,103 @@
+#ifndef __DAWN_LEASE_TABLE_H__
+#define __DAWN_LEASE_TABLE_H__
+
+#include <city.h>
+#include <atomic>
+#include <ctime>
+
+namespace Dawn
+{
+/**
+ * Value versions backing client read leases and one-sided reads.  Keys
+ * are hashed onto a fixed number of slots, each holding a version that
+ * is bumped before and after every write or erase of a key in the slot.
+ * A client's copy is current while the version it was read at is
+ * unchanged; collisions only cause spurious invalidations.  Versions
+ * start from the server start time, so that they are not reused across
+ * restarts.  Pools are identified by name, not handle, so that a write
+ * through any session invalidates the copies read through every other.
+ *
+ * The slots are registered with the network transport, so that a client
+ * reading a value with one-sided RDMA can read its version word
+ * afterwards and detect that the value was overwritten or freed.
+ */
+class Lease_table {
+ public:
+  static constexpr size_t   SLOTS    = 1 << 16;
+  static constexpr unsigned LEASE_MS = 100; /*< lease granted to clients */
+
+  Lease_table()
+  {
+    const uint64_t epoch = uint64_t(::time(nullptr)) << 32;
+    for (auto& v : _versions) v.store(epoch, std::memory_order_relaxed);
+  }
+
+  /**
+   * Get version of a key; must be read before the value
+   *
+   * @param pool Pool identity (Pool_manager::pool_identity)
+   * @param key Key
+   * @param key_len Key length
+   *
+   * @return Version
+   */
+  inline uint64_t version(uint64_t pool, const char* key, size_t key_len) const
+  {
+    return _versions[slot(pool, key, key_len)].load(std::memory_order_acquire);
+  }
+
+  /**
+   * Get address of the version word of a key, for one-sided reads
+   *
+   * @param pool Pool identity (Pool_manager::pool_identity)
+   * @param key Key
+   * @param key_len Key length
+   *
+   * @return Address of version word
+   */
+  inline const void* version_addr(uint64_t    pool,
+                                  const char* key,
+                                  size_t      key_len) const
+  {
+    return &_versions[slot(pool, key, key_len)];
+  }
+
+  /**
+   * Get the version words, for registration with the network transport
+   *
+   * @return Base address; the length is size()
+   */
+  inline const void* base() const { return _versions; }
+
+  static constexpr size_t size() { return sizeof(_versions); }
+
+  /**
+   * Invalidate cached copies and located values of a key; must be
+   * called both before a write or erase (so that one-sided readers see
+   * the change before the value memory is reused) and after it has been
+   * applied (so that a version read concurrently is not current)
+   *
+   * @param pool Pool identity (Pool_manager::pool_identity)
+   * @param key Key
+   * @param key_len Key length
+   */
+  inline void bump(uint64_t pool, const char* key, size_t key_len)
+  {
+    _versions[slot(pool, key, key_len)].fetch_add(1, std::memory_order_release);
+  }
+
+ private:
+  static inline size_t slot(uint64_t pool, const char* key, size_t key_len)
+  {
+    return CityHash64WithSeed(key, key_len, pool) & (SLOTS - 1);
+  }
+
+  static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+                "version words are read remotely as plain words");
+
+  std::atomic<uint64_t> _versions[SLOTS];
+};
+
+}  // namespace Dawn
+
+#endif  // __DAWN_LEASE_TABLE_H__
@@ -1,3 +1,4 @@
+#include <signal.h>
 #include <boost/program_options.hpp>
 #include <iostream>
 
@@ -7,6 +8,11 @@
 
 Program_options g_options;
 
+static void stats_signal_handler(int)
+{
+  Dawn::Global::stats_dump_request++;
+}
+
 int main(int argc, char* argv[])
 {
   namespace po = boost::program_options;
@@ -43,6 +49,9 @@ int main(int argc, char* argv[])
     Dawn::Global::debug_level = g_options.debug_level =
         vm["debug"].as<unsigned>();
 
+    /* SIGUSR1 dumps shard statistics to the log */
+    signal(SIGUSR1, stats_signal_handler);
+
     /* launch shards */
     {
       Dawn::Shard_launcher launcher(g_options);
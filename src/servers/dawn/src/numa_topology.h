@@ -0,0 +1,94 @@
+#ifndef __DAWN_NUMA_TOPOLOGY_H__
+#define __DAWN_NUMA_TOPOLOGY_H__
+
+#include <numa.h>
+#include <fstream>
+#include <string>
+
+namespace Dawn
+{
+/**
+ * NUMA locality of the resources a shard uses.  All functions return
+ * -1 when the node cannot be determined (e.g. no NUMA support, or a
+ * device that sysfs does not associate with a node).
+ */
+namespace Numa
+{
+/**
+ * Read a node number from a sysfs "numa_node" attribute
+ *
+ * @param path Attribute path
+ *
+ * @return Node, or -1
+ */
+inline int read_sysfs_node(const std::string& path)
+{
+  std::ifstream ifs(path);
+  int           node = -1;
+  if (!(ifs >> node)) return -1;
+  return node;
+}
+
+/**
+ * Node of a CPU core
+ *
+ * @param core Core identifier
+ *
+ * @return Node, or -1
+ */
+inline int node_of_core(unsigned core)
+{
+  if (numa_available() < 0) return -1;
+  return numa_node_of_cpu(int(core));
+}
+
+/**
+ * Node of a network device, named either as an RDMA device (e.g.
+ * mlx5_0) or as a network interface (e.g. eth0)
+ *
+ * @param device Device name
+ *
+ * @return Node, or -1
+ */
+inline int node_of_net_device(const std::string& device)
+{
+  if (device.empty()) return -1;
+  int node =
+      read_sysfs_node("/sys/class/infiniband/" + device + "/device/numa_node");
+  if (node < 0)
+    node = read_sysfs_node("/sys/class/net/" + device + "/device/numa_node");
+  return node;
+}
+
+/**
+ * Node of a device DAX path (e.g. /dev/dax0.1)
+ *
+ * @param path Device path
+ *
+ * @return Node, or -1
+ */
+inline int node_of_dax_device(const std::string& path)
+{
+  const auto name = path.substr(path.find_last_of('/') + 1);
+  if (name.empty()) return -1;
+  int node = read_sysfs_node("/sys/bus/dax/devices/" + name + "/numa_node");
+  if (node < 0)
+    node = read_sysfs_node("/sys/class/dax/" + name + "/device/numa_node");
+  return node;
+}
+
+/**
+ * Make a thread's future allocations prefer a node.  Memory that is
+ * first touched by the thread (e.g. the mapstore heap) then lands on
+ * the node.
+ *
+ * @param node Node, or -1 to leave the default policy
+ */
+inline void prefer_node(int node)
+{
+  if (node >= 0 && numa_available() >= 0) numa_set_preferred(node);
+}
+}  // namespace Numa
+}  // namespace Dawn
+
+#endif  // __DAWN_NUMA_TOPOLOGY_H__
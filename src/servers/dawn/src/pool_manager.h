@@ -2,7 +2,10 @@
 #define __DAWN_POOL_MANAGER_H__
 
 #include <api/kvstore_itf.h>
+#include <city.h>
+#include <functional>
 #include <map>
+#include <mutex>
 #include "fabric_connection_base.h"
 
 namespace Dawn
@@ -10,7 +13,8 @@ namespace Dawn
 using Connection_base = Fabric_connection_base;
 
 /**
-   Pool_manager tracks open pool handles on a per-shard (single thread) basis
+   Pool_manager tracks the pool handles a connection has open (see
+   Pool_registry for the shard's open pools)
  */
 class Pool_manager {
  public:
@@ -48,6 +52,23 @@ class Pool_manager {
 
     _open_pools[pool] = 1;
     _name_map[path]   = pool;
+    _identities[pool] = CityHash64(path.data(), path.size());
+  }
+
+  /**
+   * Get identity of an open pool.  Unlike the handle, which a backend
+   * may issue per open session, it is the same for every connection
+   * that has the pool open (and across reopens), so it keys state that
+   * is shared between sessions such as value versions.
+   *
+   * @param pool Pool identifier
+   *
+   * @return Hash of the pool's path and name, or 0 if not open
+   */
+  uint64_t pool_identity(pool_t pool) const
+  {
+    auto i = _identities.find(pool);
+    return i == _identities.end() ? 0 : i->second;
   }
 
   void add_reference(pool_t pool)
@@ -73,7 +94,18 @@ class Pool_manager {
     if (i->second == 0)
       throw Logic_exception("invalid release, reference is already");
     i->second--;
-    return i->second == 0; /* return true if last reference */
+    if (i->second > 0) return false;
+
+    /* forget the handle; the backend may reuse it for another pool */
+    _open_pools.erase(i);
+    _identities.erase(pool);
+    for (auto n = _name_map.begin(); n != _name_map.end();) {
+      if (n->second == pool)
+        n = _name_map.erase(n);
+      else
+        n++;
+    }
+    return true; /* last reference */
   }
 
   /**
@@ -82,7 +114,11 @@ class Pool_manager {
    *
    * @param pool Pool identifier
    */
-  void blitz_pool_reference(pool_t pool) { _open_pools[pool] = 0; }
+  void blitz_pool_reference(pool_t pool)
+  {
+    _open_pools.erase(pool);
+    _identities.erase(pool);
+  }
 
   /**
    * Determine if pool is open and valid
@@ -107,8 +143,102 @@ class Pool_manager {
  private:
   std::map<pool_t, unsigned>    _open_pools;
   std::map<std::string, pool_t> _name_map;
-  std::map<pool_t, std::vector<Connection_base::memory_region_t>>
-      _memory_regions;
+  std::map<pool_t, uint64_t>    _identities; /*< see pool_identity */
+};
+
+/**
+   Pool_registry tracks the pools open on a shard, across all of its
+   connections.  A backend pool is opened once, by whichever connection
+   asks first, and every connection gets the same handle; it is closed
+   when the last reference, from any connection, is released.  Backends
+   need not (and hstore must not) open a pool that is already open.
+ */
+class Pool_registry {
+ public:
+  using pool_t = Component::IKVStore::pool_t;
+
+  /**
+   * Take a reference to a pool, opening it if it is not open
+   *
+   * @param name Pool path and name
+   * @param open Opens (or creates) the pool; called with the registry
+   * locked
+   *
+   * @return Pool handle, or POOL_ERROR if open failed
+   */
+  pool_t acquire(const std::string& name, const std::function<pool_t()>& open)
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    auto                        i = _by_name.find(name);
+    if (i != _by_name.end()) {
+      _pools.at(i->second).references++;
+      return i->second;
+    }
+
+    const auto pool = open();
+    if (pool == Component::IKVStore::POOL_ERROR) return pool;
+
+    _by_name[name] = pool;
+    _pools[pool]   = Entry{name, 1};
+    return pool;
+  }
+
+  /**
+   * Release a reference to a pool
+   *
+   * @param pool Pool handle
+   * @param close Closes the pool; called, with the registry locked, if
+   * this was the last reference
+   */
+  void release(pool_t pool, const std::function<void()>& close)
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    auto                        i = find(pool);
+    if (--i->second.references > 0) return;
+
+    close();
+    _by_name.erase(i->second.name);
+    _pools.erase(i);
+  }
+
+  /**
+   * Release the only reference to a pool, e.g. to delete it
+   *
+   * @param pool Pool handle
+   * @param remove Deletes the pool; called with the registry locked
+   *
+   * @return False, and nothing is released, if there are other
+   * references
+   */
+  bool release_only(pool_t pool, const std::function<void()>& remove)
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    auto                        i = find(pool);
+    if (i->second.references > 1) return false;
+
+    remove();
+    _by_name.erase(i->second.name);
+    _pools.erase(i);
+    return true;
+  }
+
+ private:
+  struct Entry {
+    std::string name;
+    unsigned    references;
+  };
+
+  std::map<pool_t, Entry>::iterator find(pool_t pool)
+  {
+    auto i = _pools.find(pool);
+    if (i == _pools.end())
+      throw Logic_exception("pool registry: pool (%lx) is not open", pool);
+    return i;
+  }
+
+  std::mutex                    _lock;
+  std::map<pool_t, Entry>       _pools;
+  std::map<std::string, pool_t> _by_name;
 };
 }  // namespace Dawn
 
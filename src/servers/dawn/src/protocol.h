@@ -5,9 +5,12 @@
 #include <common/exceptions.h>
 #include <common/logging.h>
 #include <common/utils.h>
+#include <city.h>
 #include <cstring>
 
-#define PROTOCOL_VERSION (0xFB)
+/* change whenever a message layout changes or an op is added, so that
+   a mismatched peer fails the handshake instead of misparsing */
+#define PROTOCOL_VERSION (0xFC)
 #define PROTOCOL_DEBUG
 
 namespace Dawn
@@ -15,14 +18,16 @@ namespace Dawn
 namespace Protocol
 {
 enum {
-  MSG_TYPE_HANDSHAKE       = 0x1,
-  MSG_TYPE_HANDSHAKE_REPLY = 0x2,
-  MSG_TYPE_CLOSE_SESSION   = 0x3,
-  MSG_TYPE_POOL_REQUEST    = 0x10,
-  MSG_TYPE_POOL_RESPONSE   = 0x11,
-  MSG_TYPE_IO_REQUEST      = 0x20,
-  MSG_TYPE_IO_RESPONSE     = 0x21,
-  MSG_TYPE_MAX             = 0xFF,
+  MSG_TYPE_HANDSHAKE         = 0x1,
+  MSG_TYPE_HANDSHAKE_REPLY   = 0x2,
+  MSG_TYPE_CLOSE_SESSION     = 0x3,
+  MSG_TYPE_POOL_REQUEST      = 0x10,
+  MSG_TYPE_POOL_RESPONSE     = 0x11,
+  MSG_TYPE_IO_REQUEST        = 0x20,
+  MSG_TYPE_IO_RESPONSE       = 0x21,
+  MSG_TYPE_IO_BATCH_REQUEST  = 0x22,
+  MSG_TYPE_IO_BATCH_RESPONSE = 0x23,
+  MSG_TYPE_MAX               = 0xFF,
 };
 
 enum {
@@ -31,27 +36,42 @@ enum {
 };
 
 enum {
-  MSG_RESVD_SCBE = 0x2,
+  MSG_RESVD_SCBE  = 0x2,
+  MSG_RESVD_LEASE = 0x4, /*< OP_GET: request lease; val_len is cached version */
 };
 
 enum {
-  OP_NONE        = 0,
-  OP_CREATE      = 1,
-  OP_OPEN        = 2,
-  OP_CLOSE       = 3,
-  OP_PUT         = 4,
-  OP_SET         = 4,
-  OP_GET         = 5,
-  OP_PUT_ADVANCE = 6,  // allocate space for subsequence put or partial put
-  OP_PUT_SEGMENT = 7,
-  OP_DELETE      = 8,
-  OP_PREPARE     = 9,  // prepare for immediately following operation
-  OP_INVALID     = 0xFE,
-  OP_MAX         = 0xFF
+  OP_NONE          = 0,
+  OP_CREATE        = 1,
+  OP_OPEN          = 2,
+  OP_CLOSE         = 3,
+  OP_PUT           = 4,
+  OP_SET           = 4,
+  OP_GET           = 5,
+  OP_PUT_ADVANCE   = 6,  // allocate space for subsequence put or partial put
+  OP_PUT_SEGMENT   = 7,
+  OP_DELETE        = 8,
+  OP_PREPARE       = 9,  // prepare for immediately following operation
+  OP_BATCH         = 10, // multiple put/get elements in one message
+  OP_RELEASE       = 11, // release value locked by a two-stage operation
+  OP_ERASE         = 12, // erase key
+  OP_ATOMIC_UPDATE = 13, // apply operation vector to existing value
+  OP_LOCATE        = 14, // get location of value for one-sided read
+  OP_STATS         = 15, // get shard request statistics (pool request)
+  OP_SCAN          = 16, // list keys matching a filter, a page at a time
+  OP_INVALID       = 0xFE,
+  OP_MAX           = 0xFF
 };
 
 enum { S_OK = 0, E_KEY_EXISTS = 1, STATUS_MAX = 0xFF };
 
+/* Flow control: a client may only send a request when it holds a
+   credit, i.e. the shard has a receive buffer posted for it.  The
+   credit window is negotiated in the handshake (at most
+   MAX_OUTSTANDING_REQUESTS) and each response returns the credits for
+   receive buffers the shard has re-posted since its last response. */
+static constexpr unsigned MAX_OUTSTANDING_REQUESTS = 8;
+
 enum {
   IO_READ      = 0x1,
   IO_WRITE     = 0x2,
@@ -66,6 +86,7 @@ struct Message {
       : auth_id(auth_id), type_id(type_id), version(PROTOCOL_VERSION)
   {
     status = S_OK;
+    resvd  = 0;
     assert(op_param);
     op = op_param;
     assert(this->op);
@@ -87,7 +108,10 @@ struct Message {
     uint8_t op;
     int8_t  status;
   };
-  uint8_t resvd;
+  union {
+    uint8_t resvd;   /*< requests: MSG_RESVD_XXX flags */
+    uint8_t credits; /*< responses: flow-control credits returned */
+  };
 } __attribute__((packed));
 
 static_assert(sizeof(Message) == 16, "Unexpected Message data structure size");
@@ -163,6 +187,22 @@ struct Message_pool_response : public Message {
     msg_len = sizeof(Message_pool_response);
   }
   Message_pool_response() { assert(this->version == PROTOCOL_VERSION); }
+
+  /**
+   * Append null-terminated text to the response (OP_STATS)
+   *
+   * @param buffer_size Size of buffer holding the message
+   * @param text Text to append
+   */
+  void set_data(size_t buffer_size, const std::string& text)
+  {
+    if (msg_len + text.length() + 1 > buffer_size)
+      throw API_exception("pool response data too large (%lu)",
+                          text.length());
+    memcpy(data, text.c_str(), text.length() + 1);
+    msg_len = sizeof(Message_pool_response) + text.length() + 1;
+  }
+
   uint64_t pool_id;
   char     data[];
 } __attribute__((packed));
@@ -317,14 +357,84 @@ struct Message_IO_request : public Message {
 
 } __attribute__((packed));
 
+/* Location of a value in server memory.  Values too large for an IO
+   buffer are transferred by the client with RDMA read/write against
+   this target, and then released with OP_RELEASE */
+struct Remote_target {
+  uint64_t addr;
+  uint64_t key;
+} __attribute__((packed));
+
+/* Segment of a locked value (OP_PUT_SEGMENT request).  Sent by the
+   client once the segment has been written with RDMA, so that the
+   server can persist it while later segments are still in flight */
+struct Value_segment {
+  uint64_t addr; /*< base of locked value */
+  uint64_t offset;
+  uint64_t len;
+} __attribute__((packed));
+
+/* Location of a value in pre-registered pool memory (OP_LOCATE
+   response).  The client may cache it and read the value with RDMA
+   without involving the server.  After reading the value the client
+   reads the version word; if it differs from 'version' the value has
+   since been overwritten or erased (and the memory possibly reused),
+   and the client falls back to OP_GET.  The checksum guards against
+   a torn read of a value being written in place */
+struct Value_location {
+  uint64_t addr;
+  uint64_t key;
+  uint64_t len;
+  uint64_t checksum;
+  uint64_t version_addr; /*< version word, bumped on overwrite and erase */
+  uint64_t version_key;
+  uint64_t version; /*< version word when located */
+} __attribute__((packed));
+
+/* OP_SCAN request, in the value area of a Message_IO_request whose key
+   is the filter expression (sent with every page).  Pages return the
+   matching keys in key order; the shard remembers the last key of each
+   unfinished scan and resumes after it, forgetting the scan once the
+   last page has been sent.  No snapshot is taken, so keys inserted
+   after the position are seen.  Each page walks the whole pool (see
+   IDawn::scan). */
+struct Scan_request {
+  uint64_t cursor;   /*< 0 to start, then from previous page */
+  uint32_t max_keys; /*< page size */
+  uint32_t filter;   /*< IKVIndex::find_t; FIND_TYPE_NEXT for all keys */
+} __attribute__((packed));
+
+/* Scan cursor: scan id; bits 0-31 are zero.  Bits 56-63 are always zero
+   and free for the client (e.g. to hold a shard index) */
+static constexpr unsigned SCAN_CURSOR_ID_SHIFT = 32;
+static constexpr uint64_t SCAN_CURSOR_ID_MASK  = (1ULL << 24) - 1;
+
+/* OP_SCAN response data.  Followed by 'count' keys, each a uint32_t
+   length and the key bytes */
+struct Scan_page {
+  uint64_t cursor; /*< for next page; 0 once the scan is complete */
+  uint32_t count;
+  uint32_t pad;
+  char     data[];
+} __attribute__((packed));
+
+inline uint64_t value_checksum(const void* value, size_t len)
+{
+  return CityHash64(static_cast<const char*>(value), len);
+}
+
 struct Message_IO_response : public Message {
-  static constexpr uint64_t BIT_TWOSTAGE = 1ULL << 63;
+  static constexpr uint64_t BIT_TWOSTAGE     = 1ULL << 63;
+  static constexpr uint64_t BIT_NOT_MODIFIED = 1ULL << 62;
 
   Message_IO_response(size_t buffer_size, uint64_t auth_id)
       : Message(auth_id, MSG_TYPE_IO_RESPONSE)
   {
-    data_len = 0;
-    msg_len  = sizeof(Message_IO_response);
+    data_len      = 0;
+    value_version = 0;
+    lease_ms      = 0;
+    pad           = 0;
+    msg_len       = sizeof(Message_IO_response);
   }
 
   Message_IO_response() {}
@@ -343,11 +453,317 @@ struct Message_IO_response : public Message {
 
   bool is_set_twostage_bit() const { return data_len & BIT_TWOSTAGE; }
 
-  size_t data_length() const { return data_len & (~BIT_TWOSTAGE); }
+  /* leased OP_GET: client's cached version is current, no data sent */
+  void set_not_modified() { data_len |= BIT_NOT_MODIFIED; }
+
+  bool is_not_modified() const { return data_len & BIT_NOT_MODIFIED; }
+
+  size_t data_length() const
+  {
+    return data_len & ~(BIT_TWOSTAGE | BIT_NOT_MODIFIED);
+  }
+
+  void set_remote_target(const void* addr, uint64_t key)
+  {
+    auto target  = reinterpret_cast<Remote_target*>(data);
+    target->addr = reinterpret_cast<uint64_t>(addr);
+    target->key  = key;
+    msg_len      = sizeof(Message_IO_response) + sizeof(Remote_target);
+  }
+
+  const Remote_target* remote_target() const
+  {
+    return reinterpret_cast<const Remote_target*>(data);
+  }
+
+  /* set length of data already written into data[] */
+  void set_data_length(size_t len)
+  {
+    data_len = len;
+    msg_len  = sizeof(Message_IO_response) + len;
+  }
+
+  // fields
+  uint64_t request_id;    /*< id or sender time stamp counter */
+  uint64_t data_len;      /* bit 63 is twostage flag, bit 62 not-modified */
+  uint64_t value_version; /*< leased OP_GET: version of value */
+  uint32_t lease_ms;      /*< leased OP_GET: validity of cached copy */
+  uint32_t pad;
+  char     data[];
+} __attribute__((packed));
+
+////////////////////////////////////////////////////////////////////////
+// ATOMIC UPDATE
+//
+// OP_ATOMIC_UPDATE carries a vector of operations in the value area of
+// a Message_IO_request.  Each element is followed by its operand
+// (WRITE: 'len' bytes of data; INCREMENT_UINT64: addend; CAS_UINT64:
+// expected then desired value; ZERO: none) and padded to 8 bytes.  The
+// server applies the vector to the existing value as one transaction.
+// The response data holds the prior value of each INCREMENT_UINT64 and
+// CAS_UINT64 element, in order.  If any CAS comparison fails, no
+// element is applied.
+
+enum {
+  ATOMIC_OP_WRITE            = 1,
+  ATOMIC_OP_ZERO             = 2,
+  ATOMIC_OP_INCREMENT_UINT64 = 3,
+  ATOMIC_OP_CAS_UINT64       = 4,
+};
+
+inline constexpr size_t atomic_align(size_t len)
+{
+  return (len + 7UL) & ~7UL;
+}
+
+struct Atomic_update_element {
+  uint8_t  op; /*< ATOMIC_OP_XXX */
+  uint8_t  resvd[7];
+  uint64_t offset; /*< offset in value */
+  uint64_t len;    /*< bytes of value modified */
+  char     data[]; /*< operand */
+
+  size_t operand_len() const
+  {
+    switch (op) {
+      case ATOMIC_OP_WRITE:
+        return len;
+      case ATOMIC_OP_INCREMENT_UINT64:
+        return sizeof(uint64_t);
+      case ATOMIC_OP_CAS_UINT64:
+        return 2 * sizeof(uint64_t);
+      default:
+        return 0;
+    }
+  }
+
+  bool has_result() const
+  {
+    return op == ATOMIC_OP_INCREMENT_UINT64 || op == ATOMIC_OP_CAS_UINT64;
+  }
+
+  size_t size() const
+  {
+    return atomic_align(sizeof(Atomic_update_element) + operand_len());
+  }
+} __attribute__((packed));
+
+static_assert(sizeof(Atomic_update_element) == 24,
+              "Unexpected Atomic_update_element size");
+
+////////////////////////////////////////////////////////////////////////
+// BATCHED IO OPERATIONS
+//
+// A batch carries N put/get elements for the same pool in a single
+// message.  Elements are packed back-to-back, each padded to 8 bytes.
+// The response carries one element per request element that was
+// executed, in request order.  If the response buffer fills before
+// all elements are executed, 'count' in the response is less than
+// 'count' in the request and the client must re-issue the remainder.
+
+inline constexpr size_t batch_align(size_t len) { return (len + 7UL) & ~7UL; }
+
+struct Batch_request_element {
+  uint8_t  op; /*< OP_PUT or OP_GET */
+  uint8_t  resvd[3];
+  uint32_t key_len;
+  uint64_t val_len; /*< value length for OP_PUT, 0 otherwise */
+  char     data[];  /*< key followed by value */
+
+  const char* key() const { return &data[0]; }
+  const char* value() const { return &data[key_len]; }
+
+  size_t size() const
+  {
+    return batch_align(sizeof(Batch_request_element) + key_len + val_len);
+  }
+} __attribute__((packed));
+
+struct Batch_response_element {
+  int32_t  status;
+  uint32_t resvd;
+  uint64_t val_len; /*< value length for OP_GET, 0 otherwise */
+  char     data[];
+
+  size_t size() const
+  {
+    return batch_align(sizeof(Batch_response_element) + val_len);
+  }
+} __attribute__((packed));
+
+static_assert(sizeof(Batch_request_element) == 16,
+              "Unexpected Batch_request_element size");
+static_assert(sizeof(Batch_response_element) == 16,
+              "Unexpected Batch_response_element size");
+
+struct Message_IO_batch_request : public Message {
+  Message_IO_batch_request(size_t   buffer_size,
+                           uint64_t auth_id,
+                           uint64_t request_id,
+                           uint64_t pool_id)
+      : Message(auth_id, MSG_TYPE_IO_BATCH_REQUEST, OP_BATCH),
+        pool_id(pool_id), request_id(request_id), count(0)
+  {
+    assert(buffer_size > sizeof(Message_IO_batch_request));
+    msg_len = sizeof(Message_IO_batch_request);
+  }
+
+  Message_IO_batch_request() { assert(version == PROTOCOL_VERSION); }
+
+  /**
+   * Append an element to the batch
+   *
+   * @param buffer_size Size of the buffer holding this message
+   * @param op OP_PUT or OP_GET
+   * @param key Key
+   * @param key_len Key length in bytes
+   * @param value Value (OP_PUT only)
+   * @param value_len Value length in bytes (OP_PUT only)
+   *
+   * @return False if the element does not fit in the remaining buffer
+   */
+  bool add_element(const size_t buffer_size,
+                   const uint8_t op,
+                   const void*   key,
+                   const size_t  key_len,
+                   const void*   value     = nullptr,
+                   const size_t  value_len = 0)
+  {
+    assert(op == OP_PUT || op == OP_GET);
+    const size_t val_len = (op == OP_PUT) ? value_len : 0;
+    const size_t len =
+        batch_align(sizeof(Batch_request_element) + key_len + val_len);
+
+    if (unlikely(msg_len + len > buffer_size)) return false;
+
+    auto element = reinterpret_cast<Batch_request_element*>(
+        reinterpret_cast<char*>(this) + msg_len);
+    element->op      = op;
+    element->key_len = key_len;
+    element->val_len = val_len;
+    memcpy(element->data, key, key_len);
+    if (val_len) memcpy(&element->data[key_len], value, val_len);
+
+    msg_len += len;
+    count++;
+    return true;
+  }
+
+  const Batch_request_element* first_element() const
+  {
+    return reinterpret_cast<const Batch_request_element*>(data);
+  }
+
+  const Batch_request_element* next_element(
+      const Batch_request_element* element) const
+  {
+    return reinterpret_cast<const Batch_request_element*>(
+        reinterpret_cast<const char*>(element) + element->size());
+  }
+
+  /**
+   * Check that all 'count' elements lie within msg_len, so that they
+   * can be walked with first_element/next_element
+   *
+   * @throw Protocol_exception on a bad element
+   */
+  void check_elements() const
+  {
+    size_t pos = sizeof(Message_IO_batch_request);
+    for (uint64_t i = 0; i < count; i++) {
+      if (msg_len < pos || msg_len - pos < sizeof(Batch_request_element))
+        throw Protocol_exception("batch element %lu: truncated", i);
+
+      auto e = reinterpret_cast<const Batch_request_element*>(
+          reinterpret_cast<const char*>(this) + pos);
+      const size_t space = msg_len - pos - sizeof(Batch_request_element);
+      if (e->key_len > space || e->val_len > space - e->key_len)
+        throw Protocol_exception(
+            "batch element %lu: bad lengths (key_len=%u val_len=%lu)", i,
+            e->key_len, e->val_len);
+      if (e->op != OP_PUT && e->op != OP_GET)
+        throw Protocol_exception("batch element %lu: bad operation (%u)", i,
+                                 e->op);
+
+      pos += e->size();
+    }
+  }
+
+  // fields
+  uint64_t pool_id;
+  uint64_t request_id; /*< id or sender timestamp counter */
+  uint64_t count;      /*< number of elements */
+  char     data[];
+
+} __attribute__((packed));
+
+struct Message_IO_batch_response : public Message {
+  Message_IO_batch_response(size_t buffer_size,
+                            uint64_t auth_id,
+                            uint64_t request_id)
+      : Message(auth_id, MSG_TYPE_IO_BATCH_RESPONSE), request_id(request_id),
+        count(0)
+  {
+    assert(buffer_size > sizeof(Message_IO_batch_response));
+    msg_len = sizeof(Message_IO_batch_response);
+  }
+
+  Message_IO_batch_response() {}
+
+  /**
+   * Largest value that can be returned in a single response element
+   *
+   * @param buffer_size Size of the buffer holding this message
+   */
+  static size_t max_value_len(const size_t buffer_size)
+  {
+    return buffer_size - sizeof(Message_IO_batch_response) -
+           sizeof(Batch_response_element) - 8;
+  }
+
+  /**
+   * Append a response element, leaving space for the value
+   *
+   * @param buffer_size Size of the buffer holding this message
+   * @param status Element status
+   * @param value_len Length of value to follow element header
+   *
+   * @return Pointer to new element or nullptr if there is insufficient space
+   */
+  Batch_response_element* append_element(const size_t  buffer_size,
+                                         const int32_t status,
+                                         const size_t  value_len = 0)
+  {
+    const size_t len =
+        batch_align(sizeof(Batch_response_element) + value_len);
+
+    if (unlikely(msg_len + len > buffer_size)) return nullptr;
+
+    auto element = reinterpret_cast<Batch_response_element*>(
+        reinterpret_cast<char*>(this) + msg_len);
+    element->status  = status;
+    element->val_len = value_len;
+
+    msg_len += len;
+    count++;
+    return element;
+  }
+
+  const Batch_response_element* first_element() const
+  {
+    return reinterpret_cast<const Batch_response_element*>(data);
+  }
+
+  const Batch_response_element* next_element(
+      const Batch_response_element* element) const
+  {
+    return reinterpret_cast<const Batch_response_element*>(
+        reinterpret_cast<const char*>(element) + element->size());
+  }
 
   // fields
   uint64_t request_id; /*< id or sender time stamp counter */
-  uint64_t data_len;   /* bit 63 is twostage flag */
+  uint64_t count;      /*< number of elements executed */
   char     data[];
 } __attribute__((packed));
 
@@ -355,9 +771,11 @@ struct Message_IO_response : public Message {
 // HANDSHAKE
 
 struct Message_handshake : public Message {
-  Message_handshake(uint64_t auth_id, uint64_t sequence)
+  Message_handshake(uint64_t auth_id,
+                    uint64_t sequence,
+                    uint32_t credits = MAX_OUTSTANDING_REQUESTS)
       : Message(auth_id, MSG_TYPE_HANDSHAKE), seq(sequence),
-        protocol(PROTOCOL_KV)
+        protocol(PROTOCOL_KV), credits(credits)
   {
     msg_len = sizeof(Message_handshake);
   }
@@ -366,6 +784,7 @@ struct Message_handshake : public Message {
   // fields
   uint64_t seq;
   uint8_t  protocol;
+  uint32_t credits; /*< requested credit window */
 
   void set_as_protocol() { protocol = PROTOCOL_AS; }
 
@@ -378,9 +797,10 @@ struct Message_handshake_reply : public Message {
   Message_handshake_reply(uint64_t auth_id,
                           uint64_t sequence,
                           uint64_t session_id,
-                          size_t   mms)
+                          size_t   mms,
+                          uint32_t credits)
       : Message(auth_id, MSG_TYPE_HANDSHAKE_REPLY), seq(sequence),
-        session_id(session_id), max_message_size(mms)
+        session_id(session_id), max_message_size(mms), credits(credits)
   {
     msg_len = sizeof(Message_handshake_reply);
   }
@@ -390,6 +810,7 @@ struct Message_handshake_reply : public Message {
   uint64_t seq;
   uint64_t session_id;
   size_t   max_message_size;
+  uint32_t credits; /*< granted credit window */
 
 } __attribute__((packed));
 
@@ -413,6 +834,10 @@ static_assert(sizeof(Message_IO_request) % 8 == 0,
               "Message_IO_request should be 64bit aligned");
 static_assert(sizeof(Message_IO_response) % 8 == 0,
               "Message_IO_request should be 64bit aligned");
+static_assert(sizeof(Message_IO_batch_request) % 8 == 0,
+              "Message_IO_batch_request should be 64bit aligned");
+static_assert(sizeof(Message_IO_batch_response) % 8 == 0,
+              "Message_IO_batch_response should be 64bit aligned");
 
 }  // namespace Protocol
 }  // namespace Dawn
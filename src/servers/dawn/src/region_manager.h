@@ -2,8 +2,11 @@
 #define __DAWN_REGION_MANAGER_H__
 
 #include <api/fabric_itf.h>
+#include <api/kvstore_itf.h>
+#include <list>
 #include <map>
 #include "connection_handler.h"
+#include "protocol.h"
 #include "types.h"
 
 namespace Dawn
@@ -11,50 +14,221 @@ namespace Dawn
 class Region_manager {
   static constexpr bool option_DEBUG = false;
 
+  /* on-demand registrations retained for backends that do not expose
+     fixed pool regions.  Regions of values locked for two-stage
+     operations are pinned, since the client holds their remote keys,
+     and are never evicted; the cache may exceed its size while more
+     values than this are locked */
+  static constexpr size_t ONDEMAND_CACHE_SIZE =
+      4 * Protocol::MAX_OUTSTANDING_REQUESTS;
+
+  using pool_t = Component::IKVStore::pool_t;
+
  public:
   Region_manager(Connection* conn) : _conn(conn) { assert(conn); }
 
+  ~Region_manager()
+  {
+    for (auto& r : _pool_regions) _conn->deregister_memory(r.second.region);
+    for (auto& r : _ondemand) _conn->deregister_memory(r.second.region);
+    for (auto& r : _pinned) _conn->deregister_memory(r.second);
+  }
+
   /**
-   * Register memory with network transport for direct IO.  Cache in map.
+   * Register the memory regions of a pool with the network transport,
+   * so that direct IO on the pool does not need on-demand registration.
+   * Registering an already registered pool is a no-op.
+   *
+   * @param pool Pool identifier
+   * @param regions Regions from IKVStore::get_pool_regions
+   */
+  void register_pool_regions(const pool_t                pool,
+                             const std::vector<::iovec>& regions)
+  {
+    for (auto& r : _pool_regions)
+      if (r.second.pool == pool) return;
+
+    for (auto& r : regions) {
+      auto region = _conn->register_memory(r.iov_base, r.iov_len, 0, 0);
+      _pool_regions[r.iov_base] = Pool_region{pool, r.iov_len, region};
+      if (option_DEBUG)
+        PLOG("registered pool region %p len=%lu", r.iov_base, r.iov_len);
+    }
+  }
+
+  /**
+   * Deregister the memory regions of a pool, e.g. on close
+   *
+   * @param pool Pool identifier
+   */
+  void deregister_pool_regions(const pool_t pool)
+  {
+    for (auto i = _pool_regions.begin(); i != _pool_regions.end();) {
+      if (i->second.pool == pool) {
+        _conn->deregister_memory(i->second.region);
+        i = _pool_regions.erase(i);
+      }
+      else
+        i++;
+    }
+  }
+
+  /**
+   * Get pre-registered pool region covering memory
+   *
+   * @param target Pointer to start of memory
+   * @param target_len Length in bytes
+   *
+   * @return Memory region handle or nullptr if not covered
+   */
+  memory_region_t get_preregistered(const void* target, size_t target_len)
+  {
+    auto i = _pool_regions.upper_bound(target);
+    if (i == _pool_regions.begin()) return nullptr;
+    --i;
+
+    auto base = static_cast<const char*>(i->first);
+    auto end  = static_cast<const char*>(target) + target_len;
+    if (end > base + i->second.len) return nullptr;
+
+    return i->second.region;
+  }
+
+  /**
+   * Get registration of memory that outlives the connection (e.g. shard
+   * tables read remotely by clients), registering it on first use.
+   * Pinned registrations are held until the connection closes.
+   *
+   * @param target Pointer to start of memory
+   * @param target_len Length in bytes
+   *
+   * @return Memory region handle
+   */
+  memory_region_t get_pinned(const void* target, size_t target_len)
+  {
+    auto entry = _pinned.find(target);
+    if (entry != _pinned.end()) return entry->second;
+
+    auto region = _conn->register_memory(target, target_len, 0, 0);
+    _pinned[target] = region;
+    return region;
+  }
+
+  /**
+   * Register memory with network transport for direct IO.  Registrations
+   * are cached, least recently used first out.
    *
    * @param target Pointer to start or region
    * @param target_len Region length in bytes
    *
    * @return Memory region handle
    */
-  auto ondemand_register(const void* target, size_t target_len)
+  memory_region_t ondemand_register(const void* target, size_t target_len)
   {
-    memory_region_t region;
-    auto            entry = _reg.find(target);
-    if (entry != _reg.end()) {
-      region = entry->second;
-      if (option_DEBUG)
-        PLOG("region already registered %p len=%lu", target, target_len);
-      return region;
+    auto entry = _ondemand.find(target);
+    if (entry != _ondemand.end()) {
+      if (entry->second.len >= target_len) {
+        if (option_DEBUG)
+          PLOG("region already registered %p len=%lu", target, target_len);
+        _lru.splice(_lru.begin(), _lru, entry->second.lru);
+        return entry->second.region;
+      }
+      /* value has grown in place; re-register.  A locked value cannot
+         grow, so the region is not pinned */
+      assert(entry->second.pins == 0);
+      _conn->deregister_memory(entry->second.region);
+      _lru.erase(entry->second.lru);
+      _ondemand.erase(entry);
     }
-    else {
-      region       = _conn->register_memory(target, target_len, 0, 0);
-      _reg[target] = region;
-      if (option_DEBUG)
-        PLOG("registering memory with fabric transport %p len=%lu", target,
-             target_len);
+
+    if (_ondemand.size() >= ONDEMAND_CACHE_SIZE) {
+      /* least recently used region that no client holds */
+      for (auto i = _lru.rbegin(); i != _lru.rend(); ++i) {
+        auto victim = _ondemand.find(*i);
+        assert(victim != _ondemand.end());
+        if (victim->second.pins == 0) {
+          _conn->deregister_memory(victim->second.region);
+          _lru.erase(victim->second.lru);
+          _ondemand.erase(victim);
+          break;
+        }
+      }
     }
+
+    auto region = _conn->register_memory(target, target_len, 0, 0);
+    _lru.push_front(target);
+    _ondemand[target] = Ondemand_region{target_len, region, _lru.begin(), 0};
+
+    if (option_DEBUG)
+      PLOG("registering memory with fabric transport %p len=%lu", target,
+           target_len);
+
     return region;
   }
 
-  // /**
-  //  * Get registered memory region if it exists
-  //  */
-  // Connection_base::memory_region_t get_preregistered(pool_t pool) {
-  //   auto i = _memory_regions.find(pool);
-  //   if(i == _memory_regions.end()) return nullptr;
-  //   assert(i->second.size() == 1);
-  //   return i->second[0]; /* for the moment return the first region handle */
-  // }
+  /**
+   * Pin the on-demand registration of memory, while a client holds its
+   * remote key; pre-registered pool regions need no pinning
+   *
+   * @param target Pointer to start of memory
+   */
+  void pin_region(const void* target)
+  {
+    auto entry = _ondemand.find(target);
+    if (entry != _ondemand.end()) entry->second.pins++;
+  }
+
+  /**
+   * Release a pin taken by pin_region
+   *
+   * @param target Pointer to start of memory
+   */
+  void unpin_region(const void* target)
+  {
+    auto entry = _ondemand.find(target);
+    if (entry != _ondemand.end() && entry->second.pins > 0)
+      entry->second.pins--;
+  }
+
+  /**
+   * Get registered memory region for direct IO, using a pre-registered
+   * pool region when one covers the memory
+   *
+   * @param target Pointer to start of memory
+   * @param target_len Length in bytes
+   *
+   * @return Memory region handle
+   */
+  memory_region_t get_region(const void* target, size_t target_len)
+  {
+    auto region = get_preregistered(target, target_len);
+    if (region) {
+      if (option_DEBUG)
+        PLOG("using pre-registered region (handle=%p)", region);
+      return region;
+    }
+    return ondemand_register(target, target_len);
+  }
 
  private:
+  struct Pool_region {
+    pool_t          pool;
+    size_t          len;
+    memory_region_t region;
+  };
+
+  struct Ondemand_region {
+    size_t                           len;
+    memory_region_t                  region;
+    std::list<const void*>::iterator lru;
+    unsigned                         pins; /*< locked values using it */
+  };
+
   Connection*                            _conn;
-  std::map<const void*, memory_region_t> _reg;
+  std::map<const void*, Pool_region>     _pool_regions; /*< keyed on base */
+  std::map<const void*, Ondemand_region> _ondemand;
+  std::list<const void*>                 _lru; /*< most recent first */
+  std::map<const void*, memory_region_t> _pinned;
 };
 }  // namespace Dawn
 
@@ -1,8 +1,15 @@
 //#define PROFILE
 
 #include <api/components.h>
+#include <api/kvindex_itf.h>
+#include <common/cycles.h>
 #include <common/dump_utils.h>
 #include <common/utils.h>
+#include <libpmem.h>
+#include <poll.h>
+#include <algorithm>
+#include <regex>
+#include <set>
 
 #ifdef PROFILE
 #include <gperftools/profiler.h>
@@ -17,7 +24,8 @@ namespace Dawn
 /* global parameters */
 namespace Global
 {
-unsigned debug_level = 0;
+unsigned              debug_level = 0;
+std::atomic<unsigned> stats_dump_request{0};
 }
 
 void Shard::initialize_components(const std::string& backend,
@@ -60,6 +68,8 @@ void Shard::initialize_components(const std::string& backend,
       if (dax_config.empty())
         throw General_exception("hstore backend requires dax configuration");
 
+      /* hstore takes its NUMA node from the region_id of the dax
+         configuration, which the launcher sets to the shard's node */
       _i_kvstore = fact->create("owner", "name", dax_config);
     }
     else if (backend == "nvmestore") {
@@ -79,7 +89,128 @@ void Shard::initialize_components(const std::string& backend,
   }
 }
 
-void Shard::main_loop()
+void Shard::thread_entry(const std::string& backend,
+                         const std::string& pci_addr,
+                         const std::string& dax_config,
+                         unsigned           debug_level)
+{
+  if (option_DEBUG > 2) PLOG("shard:%u worker thread entered.", _core);
+
+  cpu_mask_t mask;
+  if (!_cores.empty()) {
+    if (string_to_mask(_cores, mask) != S_OK || !mask.is_something_set())
+      throw General_exception("invalid shard cores (%s)", _cores.c_str());
+    _core = mask.first_core();
+  }
+  else {
+    mask.add_core(_core);
+  }
+
+  if (set_cpu_affinity(1UL << _core) != 0)
+    throw General_exception("unable to set cpu affinity (%lu)", _core);
+
+  /* backend memory allocated by shard threads goes to the shard's node */
+  Numa::prefer_node(numa_node());
+
+  initialize_components(backend, pci_addr, dax_config, debug_level);
+
+  _freq_mhz = Common::get_rdtsc_frequency_mhz();
+
+  /* first worker runs on the shard thread; additional workers are only
+     used when the backend allows concurrent access to a pool */
+  _workers.emplace_back(new Worker(_core));
+
+  if (mask.count() > 1) {
+    if (_i_kvstore->thread_safety() <
+        Component::IKVStore::THREAD_MODEL_RWLOCK_PER_POOL) {
+      PWRN("shard: backend is not thread-safe; using single core (%u)",
+           _core);
+    }
+    else {
+      for (unsigned core = _core + 1; core < CPU_SETSIZE; core++)
+        if (mask.check_core(core)) _workers.emplace_back(new Worker(core));
+    }
+  }
+
+  for (unsigned i = 1; i < _workers.size(); i++) {
+    auto w    = _workers[i].get();
+    w->thread = std::thread(&Shard::worker_entry, this, w);
+  }
+
+  _acceptor = std::thread(&Shard::accept_loop, this);
+
+  if (option_DEBUG > 1)
+    PMAJOR("shard:%u running %lu worker(s)", _core, _workers.size());
+
+  main_loop(_workers[0].get());
+
+  for (unsigned i = 1; i < _workers.size(); i++) _workers[i]->thread.join();
+  _acceptor.join();
+
+  if (option_DEBUG > 2) PLOG("shard:%u worker thread exited.", _core);
+}
+
+void Shard::worker_entry(Worker* worker)
+{
+  if (set_cpu_affinity(1UL << worker->core) != 0)
+    throw General_exception("unable to set cpu affinity (%u)", worker->core);
+
+  Numa::prefer_node(numa_node());
+
+  main_loop(worker);
+
+  if (option_DEBUG > 2) PLOG("shard:%u worker (%u) exited.", _core, worker->core);
+}
+
+status_t Shard::release_locked_value(Connection_handler* handler,
+                                     const void*         target)
+{
+  pool_t                     pool;
+  Component::IKVStore::key_t key;
+
+  if (!handler->remove_locked_value(target, pool, key)) {
+    PWRN("bad target to unlock value (%p)", target);
+    return E_INVAL;
+  }
+
+  _i_kvstore->unlock(pool, key);
+
+  if (option_DEBUG > 2) PLOG("unlocked value: %p", target);
+
+  return S_OK;
+}
+
+status_t Shard::persist_segment(Connection_handler* handler,
+                                const void*         target,
+                                const uint64_t      offset,
+                                const uint64_t      len)
+{
+  const size_t target_len = handler->locked_value_length(target);
+
+  if (target_len == 0 || offset > target_len || len > target_len - offset) {
+    PWRN("bad segment (target=%p offset=%lu len=%lu)", target, offset, len);
+    return E_INVAL;
+  }
+
+  /* the segment has already landed (RDMA writes complete before the
+     client sends the segment request); volatile backends have nothing
+     further to do */
+  auto segment = static_cast<const char*>(target) + offset;
+  if (pmem_is_pmem(segment, len)) pmem_persist(segment, len);
+
+  return S_OK;
+}
+
+void Shard::release_all_locked_values(Connection_handler* handler)
+{
+  pool_t                     pool;
+  Component::IKVStore::key_t key;
+
+  while (handler->remove_locked_value(nullptr, pool, key))
+    _i_kvstore->unlock(pool, key);
+}
+
+void Shard::main_loop(Worker* worker)
 {
   using namespace Dawn::Protocol;
 
@@ -89,27 +220,76 @@ void Shard::main_loop()
   ProfilerStart("shard_main_loop");
 #endif
 
-  uint64_t                  tick __attribute__((aligned(8))) = 0;
-  static constexpr uint64_t CHECK_CONNECTION_INTERVAL        = 10000000;
+  const uint64_t spin_cycles  = SPIN_IDLE_USEC * _freq_mhz;
+  const uint64_t block_cycles = BLOCK_IDLE_USEC * _freq_mhz;
+  const uint64_t steal_cycles = STEAL_IDLE_USEC * _freq_mhz;
+
+  uint64_t last_busy  = rdtsc();
+  uint64_t last_steal = last_busy;
+  auto&    handlers   = worker->handlers;
+  auto&    stats      = worker->stats;
 
   Connection_handler::action_t                            action;
   std::vector<std::vector<Connection_handler*>::iterator> pending_close;
 
   while (unlikely(_thread_exit == false)) {
-    /* check for new connections - but not too often */
-    if (tick % CHECK_CONNECTION_INTERVAL == 0) check_for_new_connections();
+    /* adopt connections handed over by the acceptor or stolen */
+    if (unlikely(!worker->incoming.empty())) {
+      std::lock_guard<std::mutex> g(worker->incoming_lock);
+      std::lock_guard<std::mutex> h(worker->handlers_lock);
+      handlers.insert(handlers.end(), worker->incoming.begin(),
+                      worker->incoming.end());
+      worker->incoming.clear();
+    }
+
+    /* give a connection to an idle worker that asked for one; handlers
+       are only ever touched by their owning worker, so the hand over
+       happens here between ticks.  The connection given is the one
+       that has been quiet longest, so that a client in the middle of a
+       burst is not moved; if all have been active within the last
+       BLOCK_IDLE_USEC, none is given */
+    if (unlikely(worker->thief.load() != nullptr)) {
+      auto thief = worker->thief.exchange(nullptr);
+      auto quiet = handlers.end();
+      if (thief && handlers.size() > 1) {
+        const auto now = rdtsc();
+        for (auto i = handlers.begin(); i != handlers.end(); i++)
+          if (now - (*i)->last_dispatch() >= block_cycles &&
+              (quiet == handlers.end() ||
+               (*i)->last_dispatch() < (*quiet)->last_dispatch()))
+            quiet = i;
+      }
+      if (quiet != handlers.end()) {
+        Connection_handler* handler = *quiet;
+        {
+          std::lock_guard<std::mutex> h(worker->handlers_lock);
+          handlers.erase(quiet);
+        }
+        worker->connection_count--;
+        if (option_DEBUG > 1)
+          PLOG("shard: worker %u gives connection %p to worker %u",
+               worker->core, handler, thief->core);
+        give_connection(thief, handler);
+      }
+    }
+
+    bool   busy           = false;
+    size_t buffers_in_use = 0;
 
     /* iterate connection handlers (each connection is a client session) */
     for (std::vector<Connection_handler*>::iterator handler_iter =
-             _handlers.begin();
-         handler_iter != _handlers.end(); handler_iter++) {
+             handlers.begin();
+         handler_iter != handlers.end(); handler_iter++) {
       const auto handler = *handler_iter;
 
       /* issue tick, unless we are stalling */
       uint64_t tick_response;
       if(handler->stall_tick() == 0)
         tick_response = handler->tick();
-      else continue;
+      else {
+        busy = true; /* a post is in flight */
+        continue;
+      }
     
       /* close session */
       if (tick_response == Dawn::Connection_handler::TICK_RESPONSE_CLOSE) {
@@ -123,48 +303,60 @@ void Shard::main_loop()
           case Connection_handler::ACTION_RELEASE_VALUE_LOCK:
             if (option_DEBUG > 2)
               PLOG("releasing value lock (%p)", action.parm);
-            release_locked_value(action.parm);
+            release_locked_value(handler, action.parm);
             break;
           default:
             throw Logic_exception("unknown action type");
         }
       }
 
-      /* collect ALL available messages */
-      buffer_t*          iob;
-      Protocol::Message* p_msg = nullptr;
-      while ((iob = handler->get_pending_msg(p_msg)) != nullptr) {
-        assert(p_msg);
-        switch (p_msg->type_id) {
-          case MSG_TYPE_IO_REQUEST:
-            process_message_IO_request(
-                handler, static_cast<Protocol::Message_IO_request*>(p_msg));
-            break;
-          case MSG_TYPE_POOL_REQUEST:
-            process_message_pool_request(
-                handler, static_cast<Protocol::Message_pool_request*>(p_msg));
-            break;
-          default:
-            throw General_exception("unrecognizable message type");
-        }
-        handler->free_recv_buffer();
+      /* process this round's share of the waiting messages; any left
+         over keep the worker busy */
+      if (handler->pending_msg_count() > 0) {
+        process_pending_msgs(worker, handler);
+        busy = true;
       }
+
+      buffers_in_use += handler->buffers_in_use();
     }  // handler iter
 
+    stats.record_buffers(buffers_in_use);
+
     /* handle pending close sessions */
     if (unlikely(!pending_close.empty())) {
-      for (auto& h : pending_close) {
-        if (option_DEBUG > 1) PLOG("Deleting handler (%p)", *h);
-        delete *h;
-        _handlers.erase(h);
+      std::lock_guard<std::mutex> g(worker->handlers_lock);
+      /* erase from the back so that earlier iterators remain valid */
+      for (auto h = pending_close.rbegin(); h != pending_close.rend(); h++) {
+        if (option_DEBUG > 1) PLOG("Deleting handler (%p)", **h);
+        release_all_locked_values(**h);
+        delete **h;
+        handlers.erase(*h);
+        worker->connection_count--;
 
         if (option_DEBUG > 1)
-          PLOG("# remaining handlers (%lu)", _handlers.size());
+          PLOG("# remaining handlers (%lu)", handlers.size());
       }
       pending_close.clear();
     }
 
-    tick++;
+    /* spin while there is traffic; once idle back off to yielding and
+       then to blocking, so that idle shards do not burn their cores */
+    const auto now = rdtsc();
+    if (busy) {
+      last_busy = last_steal = now;
+      continue;
+    }
+
+    /* an idle worker tries to take load from a busier one */
+    if (_workers.size() > 1 && now - last_steal >= steal_cycles) {
+      request_steal(worker);
+      last_steal = now;
+    }
+
+    if (now - last_busy >= block_cycles)
+      idle_wait(worker);
+    else if (now - last_busy >= spin_cycles)
+      std::this_thread::yield();
   }
 
   if (option_DEBUG > 1) PMAJOR("Shard (%p) exited", this);
@@ -175,14 +367,83 @@ void Shard::main_loop()
 #endif
 }
 
+void Shard::process_pending_msgs(Worker* worker, Connection_handler* handler)
+{
+  using namespace Dawn::Protocol;
+
+  auto& stats = worker->stats;
+  stats.record_queue_depth(handler->pending_msg_count());
+
+  /* weight is looked up once the client has identified itself in the
+     handshake, which precedes any message */
+  if (unlikely(handler->weight() == 0))
+    handler->set_weight(client_weight(handler->client_id()));
+
+  /* deficit round robin; a connection that overdrew its allowance (with
+     a batch) makes up for it in the next round(s) */
+  auto& deficit = handler->deficit();
+  deficit += SCHED_QUANTUM * handler->weight();
+
+  buffer_t*          iob;
+  Protocol::Message* p_msg = nullptr;
+  uint64_t           arrival;
+  while (deficit > 0 &&
+         (iob = handler->get_pending_msg(p_msg, arrival)) != nullptr) {
+    assert(p_msg);
+
+    const auto start = rdtsc();
+    const auto op    = p_msg->op;
+    size_t     bytes = 0;
+
+    stats.record_queue_delay(start - arrival);
+    handler->record_dispatch(start - arrival, start);
+
+    switch (p_msg->type_id) {
+      case MSG_TYPE_IO_REQUEST:
+        deficit--;
+        bytes = process_message_IO_request(
+            handler, static_cast<Protocol::Message_IO_request*>(p_msg));
+        break;
+      case MSG_TYPE_IO_BATCH_REQUEST: {
+        auto batch = static_cast<Protocol::Message_IO_batch_request*>(p_msg);
+        if (batch->msg_len > iob->original_length)
+          throw Protocol_exception("batch message length (%u) exceeds buffer",
+                                   batch->msg_len);
+        deficit -= std::max(1U, unsigned(batch->count));
+        bytes = process_message_IO_batch_request(handler, batch);
+        break;
+      }
+      case MSG_TYPE_POOL_REQUEST:
+        deficit--;
+        process_message_pool_request(
+            handler, static_cast<Protocol::Message_pool_request*>(p_msg));
+        break;
+      default:
+        throw General_exception("unrecognizable message type");
+    }
+    handler->free_recv_buffer(iob);
+
+    stats.record(op, bytes, rdtsc() - start);
+  }
+
+  /* an idle connection does not bank its allowance */
+  if (handler->pending_msg_count() == 0 && deficit > 0) deficit = 0;
+}
+
 void Shard::process_message_pool_request(Connection_handler* handler,
                                          Protocol::Message_pool_request* msg)
 {
   // validate auth id
   assert(msg->op);
 
+  if (msg->op == Dawn::Protocol::OP_STATS) {
+    process_stats_request(handler);
+    return;
+  }
+
   /* allocate response buffer */
-  auto response_iob = handler->allocate();
+  auto response_iob =
+      handler->allocate(sizeof(Protocol::Message_pool_response));
   assert(response_iob);
   assert(response_iob->base());
   memset(response_iob->iov->iov_base, 0, response_iob->iov->iov_len);
@@ -201,31 +462,24 @@ void Shard::process_message_pool_request(Connection_handler* handler,
     const std::string pool_name = msg->path() + std::string(msg->pool_name());
 
     try {
-      Component::IKVStore::pool_t pool;
-
-      if (handler->check_for_open_pool(pool_name, pool)) {
-        handler->add_reference(pool);
-      }
-      else {
-        pool = _i_kvstore->create_pool(msg->path(), msg->pool_name(),
+      /* an open pool is shared, not created again */
+      const auto pool = _pools.acquire(pool_name, [&]() {
+        return _i_kvstore->create_pool(msg->path(), msg->pool_name(),
                                        msg->pool_size,
                                        0,  // flags
                                        msg->expected_object_count);
+      });
+      if (pool == Component::IKVStore::POOL_ERROR)
+        throw General_exception("create_pool failed");
 
-        /* register pool handle */
+      if (handler->is_pool_open(pool))
+        handler->add_reference(pool);
+      else
         handler->register_pool(pool_name, pool);
-      }
 
       if (option_DEBUG > 2) PLOG("OP_CREATE: new pool id: %lx", pool);
 
-      std::vector<::iovec> regions;
-      status_t             rc = _i_kvstore->get_pool_regions(pool, regions);
-      if (rc == S_OK) {
-      }
-
-      // TODO
-      // rc == S_OK ? handler->add_as_open_pool(pool, &regions) :
-      // handler->add_as_open_pool(pool);
+      register_pool_regions(handler, pool);
 
       response->pool_id = pool;
       response->status  = S_OK;
@@ -241,27 +495,28 @@ void Shard::process_message_pool_request(Connection_handler* handler,
       PMAJOR("POOL OPEN: path=%s%s", msg->path(), msg->pool_name());
 
     try {
-      Component::IKVStore::pool_t pool;
-
       const std::string pool_name = msg->path() + std::string(msg->pool_name());
 
-      /* check that pool is not already open */
-      if (!handler->check_for_open_pool(pool_name, pool)) {
-        /* pool does not exist yet */
-        pool = _i_kvstore->open_pool(msg->path(), msg->pool_name());
+      /* the backend opens a pool once, for all connections */
+      const auto pool = _pools.acquire(pool_name, [&]() {
+        auto p = _i_kvstore->open_pool(msg->path(), msg->pool_name());
+        PLOG("pool open for first time (%p)", (void*) p);
+        return p;
+      });
+      if (pool == Component::IKVStore::POOL_ERROR)
+        throw General_exception("open_pool failed");
 
-        PLOG("pool open for first time (%p)", (void*) pool);
-        /* register pool handle */
-        handler->register_pool(pool_name, pool);
-      }
-      else {
+      if (handler->is_pool_open(pool)) {
         PLOG("reusing existing open pool (%p)", (void*) pool);
-        /* pool exists */
         handler->add_reference(pool);
       }
+      else
+        handler->register_pool(pool_name, pool);
 
       if (option_DEBUG > 2) PLOG("OP_OPEN: pool id: %lx", pool);
 
+      register_pool_regions(handler, pool);
+
       response->pool_id = pool;
     }
     catch (...) {
@@ -276,9 +531,9 @@ void Shard::process_message_pool_request(Connection_handler* handler,
     try {
       auto pool = msg->pool_id;
 
-      if (handler->release_pool_reference(pool)) {
-        _i_kvstore->close_pool(pool);
-      }
+      if (handler->release_pool_reference(pool))
+        handler->deregister_pool_regions(pool);
+      _pools.release(pool, [&]() { _i_kvstore->close_pool(pool); });
       response->pool_id = pool;
     }
     catch (...) {
@@ -292,17 +547,23 @@ void Shard::process_message_pool_request(Connection_handler* handler,
 
     try {
       auto pool = msg->pool_id;
+      if (!handler->is_pool_open(pool))
+        throw Logic_exception("delete of pool not open by session");
 
-      if (handler->release_pool_reference(pool)) {
-        _i_kvstore->delete_pool(pool);
-        response->pool_id = pool;
-        handler->blitz_pool_reference(pool);
-      }
-      else {
+      response->pool_id = pool;
+      if (!_pools.release_only(pool, [&]() {
+            handler->blitz_pool_reference(pool);
+            handler->deregister_pool_regions(pool);
+            _i_kvstore->delete_pool(pool);
+          })) {
+        /* open by another session (or more than once by this one); the
+           reference is released as by a close */
         if (option_DEBUG > 2)
           PLOG("unable to delete pool that is open by another session");
-        response->pool_id = pool;
-        response->status  = E_INVAL;
+        if (handler->release_pool_reference(pool))
+          handler->deregister_pool_regions(pool);
+        _pools.release(pool, [&]() { _i_kvstore->close_pool(pool); });
+        response->status = E_INVAL;
       }
     }
     catch (...) {
@@ -322,14 +583,98 @@ void Shard::process_message_pool_request(Connection_handler* handler,
   handler->post_response(response_iob);
 }
 
-void Shard::process_message_IO_request(Connection_handler*           handler,
-                                       Protocol::Message_IO_request* msg)
+void Shard::process_stats_request(Connection_handler* handler)
+{
+  Shard_stats stats;
+  for (auto& w : _workers) stats.add(w->stats);
+
+  auto iob = handler->allocate();
+
+  auto response = new (iob->base())
+      Protocol::Message_pool_response(handler->auth_id());
+  response->pool_id = 0;
+
+  /* append per-connection statistics to the shard's */
+  auto report = stats.report(_freq_mhz);
+  report.insert(report.size() - 1, ",\"connections\":" + connection_stats());
+  response->set_data(iob->length(), report);
+
+  iob->set_length(response->msg_len);
+  handler->post_response(iob);
+}
+
+void Shard::dump_stats()
+{
+  Shard_stats stats;
+  for (auto& w : _workers) stats.add(w->stats);
+
+  PINF("shard:%u stats: %s", _core, stats.report(_freq_mhz).c_str());
+  PINF("shard:%u connections: %s", _core, connection_stats().c_str());
+}
+
+std::string Shard::connection_stats()
+{
+  std::stringstream ss;
+  ss << "[";
+  bool first = true;
+  for (auto& w : _workers) {
+    std::lock_guard<std::mutex> g(w->handlers_lock);
+    for (auto handler : w->handlers) {
+      const auto& s   = handler->sched_stats();
+      const auto  ops = s.ops.load(std::memory_order_relaxed);
+
+      if (!first) ss << ",";
+      first = false;
+      ss << "{\"worker\":" << w->core << ",\"auth_id\":"
+         << handler->client_id() << ",\"weight\":" << handler->weight()
+         << ",\"ops\":" << ops << ",\"queue_mean_us\":"
+         << (ops ? s.queue_cycles.load(std::memory_order_relaxed) / ops /
+                       _freq_mhz
+                 : 0)
+         << ",\"queue_max_us\":"
+         << s.queue_max_cycles.load(std::memory_order_relaxed) / _freq_mhz
+         << "}";
+    }
+  }
+  ss << "]";
+  return ss.str();
+}
+
+void Shard::register_pool_regions(Connection_handler* handler, const pool_t pool)
+{
+  std::vector<::iovec> regions;
+  if (_i_kvstore->get_pool_regions(pool, regions) != S_OK) {
+    if (option_DEBUG > 2)
+      PLOG("pool (%lx) has no fixed regions; using on-demand registration",
+           pool);
+    return;
+  }
+
+  try {
+    handler->register_pool_regions(pool, regions);
+  }
+  catch (...) {
+    PWRN("unable to pre-register pool (%lx) regions; using on-demand "
+         "registration",
+         pool);
+    handler->deregister_pool_regions(pool);
+  }
+}
+
+size_t Shard::process_message_IO_request(Connection_handler*           handler,
+                                         Protocol::Message_IO_request* msg)
 {
   using namespace Component;
 
   // if(!_pm->is_pool_open(msg->pool_id))
   //   throw Protocol_exception("invalid pool identifier");
 
+  /* states that we require a response */
+  const auto iob = handler->allocate();
+
+  Protocol::Message_IO_response* response = new (iob->base())
+      Protocol::Message_IO_response(iob->length(), handler->auth_id());
+
   /////////////////////////////////////////////////////////////////////////////
   //   PUT ADVANCE   //
   /////////////////////
@@ -338,54 +683,150 @@ void Shard::process_message_IO_request(Connection_handler*           handler,
       PLOG("PUT_ADVANCE: (%p) key=(%.*s) value_len=%lu request_id=%lu", this,
            (int) msg->key_len, msg->key(), msg->val_len, msg->request_id);
 
-    const auto val_len = msg->val_len;
-
     /* open memory */
     void*  target     = nullptr;
     size_t target_len = msg->val_len;
     assert(target_len > 0);
 
+    response->request_id = msg->request_id;
+
     /* create (if needed) and lock value */
     auto key_handle =
         _i_kvstore->lock(msg->pool_id, msg->key(), IKVStore::STORE_LOCK_WRITE,
                          target, target_len);
 
-    if (key_handle == Component::IKVStore::KEY_NONE)
-      throw Program_exception(
-          "PUT_ADVANCE failed to lock value (lock() returned KEY_NONE) ");
-
-    if (target_len != msg->val_len)
-      throw Logic_exception("locked value length mismatch");
-
-    auto pool_id = msg->pool_id;
-    add_locked_value(pool_id, key_handle, target);
-
-    /* register memory unless pre-registered */
-    Connection_base::memory_region_t region =
-        nullptr;  // TODO handler->get_preregistered(pool_id);
-    // if(!region) {
-    //   if(option_DEBUG || 1)
-    //     PLOG("using ondemand registration");
-    //   region = ondemand_register(handler, target, target_len);
-    // }
-    // else {
-    //   if(option_DEBUG > 2)
-    //     PLOG("using pre-registered region (handle=%p)", region);
-    // }
-    // assert(region);
-    // TODO
-    region = handler->ondemand_register(target, target_len);
-
-    handler->set_pending_value(target, target_len, region);
+    if (key_handle == Component::IKVStore::KEY_NONE) {
+      PWRN("PUT_ADVANCE failed to lock value (lock() returned KEY_NONE)");
+      response->status = E_FAIL;
+    }
+    else if (target_len != msg->val_len) {
+      _i_kvstore->unlock(msg->pool_id, key_handle);
+      response->status = E_INVAL;
+    }
+    else {
+      /* readers cannot lock the value until it is released, so the
+         version may be bumped before the client writes it */
+      _leases.bump(handler->pool_identity(msg->pool_id), msg->key(),
+                   msg->key_len);
+      auto region = handler->get_region(target, target_len);
+      handler->add_locked_value(msg->pool_id, key_handle, target, target_len);
+
+      /* the client writes the value directly into the target and then
+         releases it with OP_RELEASE */
+      response->status = S_OK;
+      response->set_remote_target(target,
+                                  handler->get_memory_remote_key(region));
+    }
 
-    return;
+    iob->set_length(response->msg_len);
+    handler->post_response(iob);
+    return msg->val_len;
   }
 
-  /* states that we require a response */
-  const auto iob = handler->allocate();
+  /////////////////////////////////////////////////////////////////////////////
+  //   ATOMIC UPDATE //
+  /////////////////////
+  if (msg->op == Protocol::OP_ATOMIC_UPDATE) {
+    if (option_DEBUG > 2)
+      PLOG("ATOMIC_UPDATE: (%p) key=(%.*s) request_id=%lu", this,
+           (int) msg->key_len, msg->key(), msg->request_id);
 
-  Protocol::Message_IO_response* response = new (iob->base())
-      Protocol::Message_IO_response(iob->length(), handler->auth_id());
+    response->request_id = msg->request_id;
+    if (unlikely(msg->resvd & Dawn::Protocol::MSG_RESVD_SCBE))
+      response->status = S_OK;
+    else {
+      _leases.bump(handler->pool_identity(msg->pool_id), msg->key(),
+                   msg->key_len);
+      response->status = process_atomic_update(msg, response);
+      _leases.bump(handler->pool_identity(msg->pool_id), msg->key(),
+                   msg->key_len);
+    }
+
+    iob->set_length(response->msg_len);
+    handler->post_response(iob);
+    return msg->val_len;
+  }
+
+  /////////////////////////////////////////////////////////////////////////////
+  //   LOCATE        //
+  /////////////////////
+  if (msg->op == Protocol::OP_LOCATE) {
+    if (option_DEBUG > 2)
+      PLOG("LOCATE: (%p) key=(%.*s) request_id=%lu", this, (int) msg->key_len,
+           msg->key(), msg->request_id);
+
+    response->request_id = msg->request_id;
+    response->status     = process_locate(handler, msg, response);
+
+    iob->set_length(response->msg_len);
+    handler->post_response(iob);
+    return 0;
+  }
+
+  /////////////////////////////////////////////////////////////////////////////
+  //   SCAN          //
+  /////////////////////
+  if (msg->op == Protocol::OP_SCAN) {
+    if (option_DEBUG > 2)
+      PLOG("SCAN: (%p) filter=(%.*s) request_id=%lu", this,
+           (int) msg->key_len, msg->key(), msg->request_id);
+
+    response->request_id = msg->request_id;
+    response->status =
+        process_scan(handler, msg, response, iob->original_length);
+
+    iob->set_length(response->msg_len);
+    handler->post_response(iob);
+    return response->data_length();
+  }
+
+  /////////////////////////////////////////////////////////////////////////////
+  //   PUT SEGMENT   //
+  /////////////////////
+  if (msg->op == Protocol::OP_PUT_SEGMENT) {
+    Protocol::Value_segment segment;
+    if (msg->val_len != sizeof(segment))
+      throw Protocol_exception("OP_PUT_SEGMENT: bad segment length");
+    memcpy(&segment, msg->value(), sizeof(segment));
+
+    if (option_DEBUG > 2)
+      PLOG("PUT_SEGMENT: (%p) target=0x%lx offset=%lu len=%lu request_id=%lu",
+           this, segment.addr, segment.offset, segment.len, msg->request_id);
+
+    response->request_id = msg->request_id;
+    response->status =
+        persist_segment(handler, reinterpret_cast<void*>(segment.addr),
+                        segment.offset, segment.len);
+
+    iob->set_length(response->msg_len);
+    handler->post_response(iob);
+    return segment.len;
+  }
+
+  /////////////////////////////////////////////////////////////////////////////
+  //   RELEASE       //
+  /////////////////////
+  if (msg->op == Protocol::OP_RELEASE) {
+    if (option_DEBUG > 2)
+      PLOG("RELEASE: (%p) key=(%.*s) request_id=%lu", this, (int) msg->key_len,
+           msg->key(), msg->request_id);
+
+    uint64_t target;
+    if (msg->val_len != sizeof(target))
+      throw Protocol_exception("OP_RELEASE: bad target length");
+    memcpy(&target, msg->value(), sizeof(target));
+
+    const auto value_len =
+        handler->locked_value_length(reinterpret_cast<void*>(target));
+
+    response->request_id = msg->request_id;
+    response->status =
+        release_locked_value(handler, reinterpret_cast<void*>(target));
+
+    iob->set_length(response->msg_len);
+    handler->post_response(iob);
+    return value_len;
+  }
 
   int status;
 
@@ -406,7 +847,11 @@ void Shard::process_message_IO_request(Connection_handler*           handler,
     }
     else {
       const std::string k(msg->key(), msg->key_len);
+      _leases.bump(handler->pool_identity(msg->pool_id), msg->key(),
+                   msg->key_len);
       status = _i_kvstore->put(msg->pool_id, k, msg->value(), msg->val_len);
+      _leases.bump(handler->pool_identity(msg->pool_id), msg->key(),
+                   msg->key_len);
 
       if (option_DEBUG > 2) {
         if (status == Component::IKVStore::E_ALREADY_EXISTS)
@@ -424,6 +869,8 @@ void Shard::process_message_IO_request(Connection_handler*           handler,
       PMAJOR("GET: (%p) (request=%lu) key=(%.*s) ", this, msg->request_id,
              (int) msg->key_len, msg->key());
 
+    size_t value_len = 0;
+
     if (msg->resvd & Dawn::Protocol::MSG_RESVD_SCBE) {
       if (option_DEBUG > 2) PLOG("GET: short-circuited backend");
       response->data_len   = 0;
@@ -436,6 +883,25 @@ void Shard::process_message_IO_request(Connection_handler*           handler,
       void*  value_out     = nullptr;
       size_t value_out_len = 0;
 
+      if (msg->resvd & Dawn::Protocol::MSG_RESVD_LEASE) {
+        /* version is read before the value, so that a concurrent write
+           can only make the client's copy appear older than it is */
+        const auto version = _leases.version(
+            handler->pool_identity(msg->pool_id), msg->key(), msg->key_len);
+        response->value_version = version;
+        response->lease_ms      = Lease_table::LEASE_MS;
+
+        if (msg->val_len == version) { /* client copy is current */
+          response->data_len   = 0;
+          response->request_id = msg->request_id;
+          response->status     = S_OK;
+          response->set_not_modified();
+          iob->set_length(response->base_message_size());
+          handler->post_response(iob);
+          return 0;
+        }
+      }
+
       std::string k;
       k.assign(msg->key(), msg->key_len);
 
@@ -447,14 +913,16 @@ void Shard::process_message_IO_request(Connection_handler*           handler,
              value_out, (int) value_out_len, (char*) value_out, value_out_len);
 
       if (key_handle == Component::IKVStore::KEY_NONE) { /* key not found */
-        response->status = E_NOT_FOUND;
+        response->status     = E_NOT_FOUND;
+        response->request_id = msg->request_id;
         iob->set_length(response->base_message_size());
-        handler->post_response(iob, nullptr);
-        return;
+        handler->post_response(iob);
+        return 0;
       }
 
       assert(value_out_len);
       assert(value_out);
+      value_len = value_out_len;
 
       if (value_out_len <
           (iob->original_length - response->base_message_size())) {
@@ -474,75 +942,616 @@ void Shard::process_message_IO_request(Connection_handler*           handler,
         handler->post_response(iob);
       }
       else {
-        iob->set_length(response->base_message_size());
+        /* for large gets we use a two-stage protocol; the response carries
+           the location of the locked value, which the client reads with
+           RDMA and then releases with OP_RELEASE */
 
-        /* register memory on-demand */
-        auto region = handler->ondemand_register(value_out, value_out_len);
+        auto region = handler->get_region(value_out, value_out_len);
         assert(region);
 
+        handler->add_locked_value(msg->pool_id, key_handle, value_out,
+                                  value_out_len);
+
         response->data_len   = value_out_len;
         response->request_id = msg->request_id;
         response->status     = S_OK;
+        response->set_twostage_bit();
+        response->set_remote_target(value_out,
+                                    handler->get_memory_remote_key(region));
 
-        /* create value iob */
-        buffer_t* value_buffer;
+        iob->set_length(response->msg_len);
+        handler->post_response(iob);
+      }
+    }
+    return value_len;
+  }
+  /////////////////////////////////////////////////////////////////////////////
+  //   ERASE         //
+  /////////////////////
+  else if (msg->op == Protocol::OP_ERASE) {
+    if (option_DEBUG > 2)
+      PLOG("ERASE: (%p) key=(%.*s)", this, (int) msg->key_len, msg->key());
 
-        if (response->status == S_OK) {
-          value_buffer         = new buffer_t(value_out_len);
-          value_buffer->iov    = new iovec{(void*) value_out, value_out_len};
-          value_buffer->region = region;
-          value_buffer->desc   = handler->get_memory_descriptor(region);
+    if (unlikely(msg->resvd & Dawn::Protocol::MSG_RESVD_SCBE)) {
+      status = S_OK;
+    }
+    else {
+      const std::string k(msg->key(), msg->key_len);
+      _leases.bump(handler->pool_identity(msg->pool_id), msg->key(),
+                   msg->key_len);
+      status = _i_kvstore->erase(msg->pool_id, k);
+      _leases.bump(handler->pool_identity(msg->pool_id), msg->key(),
+                   msg->key_len);
+    }
+  }
+  else
+    throw Protocol_exception("operation not implemented");
 
-          /* register clean up task for value */
-          add_locked_value(msg->pool_id, key_handle, value_out);
-        }
+  response->request_id = msg->request_id;
+  response->status     = status;
+
+  iob->set_length(response->msg_len);
+  handler->post_response(iob);  // issue IO request response
+
+  return msg->op == Protocol::OP_PUT ? msg->val_len : 0;
+}
 
-        if (value_out_len <=
-            (handler->IO_buffer_size() - response->base_message_size())) {
-          if (option_DEBUG > 2)
-            PLOG("posting response header and value together");
+status_t Shard::process_atomic_update(
+    const Protocol::Message_IO_request* msg,
+    Protocol::Message_IO_response*      response)
+{
+  using namespace Component;
+  using Protocol::Atomic_update_element;
+
+  /* decode operation vector */
+  std::vector<const Atomic_update_element*> elements;
+  size_t                                    result_count = 0;
+  size_t                                    zero_len     = 0;
+
+  for (size_t pos = 0; pos < msg->val_len;) {
+    auto e = reinterpret_cast<const Atomic_update_element*>(msg->value() + pos);
+    if (pos + sizeof(Atomic_update_element) > msg->val_len ||
+        pos + sizeof(Atomic_update_element) + e->operand_len() > msg->val_len)
+      throw Protocol_exception("OP_ATOMIC_UPDATE: truncated element");
+
+    switch (e->op) {
+      case Protocol::ATOMIC_OP_WRITE:
+        break;
+      case Protocol::ATOMIC_OP_ZERO:
+        zero_len = std::max(zero_len, size_t(e->len));
+        break;
+      case Protocol::ATOMIC_OP_INCREMENT_UINT64:
+      case Protocol::ATOMIC_OP_CAS_UINT64:
+        if (e->len != sizeof(uint64_t))
+          throw Protocol_exception("OP_ATOMIC_UPDATE: bad operand length");
+        result_count++;
+        break;
+      default:
+        throw Protocol_exception("OP_ATOMIC_UPDATE: unknown operation (%u)",
+                                 e->op);
+    }
+    elements.push_back(e);
+    pos += e->size();
+  }
+
+  if (elements.empty()) return IKVStore::E_BAD_PARAM;
+
+  const std::string k(msg->key(), msg->key_len);
+  void*             value     = nullptr;
+  size_t            value_len = 0;
+  IKVStore::key_t   key_handle;
+
+  /* some backends throw on lock of a missing key when no size is given */
+  try {
+    key_handle = _i_kvstore->lock(msg->pool_id, k, IKVStore::STORE_LOCK_WRITE,
+                                  value, value_len);
+  }
+  catch (...) {
+    return IKVStore::E_KEY_NOT_FOUND;
+  }
+
+  if (key_handle == IKVStore::KEY_NONE) return E_FAIL;
+
+  for (auto e : elements) {
+    if (e->offset + e->len > value_len) {
+      _i_kvstore->unlock(msg->pool_id, key_handle);
+      return IKVStore::E_BAD_OFFSET;
+    }
+  }
 
-          /* post both buffers together in same response packet */
-          handler->post_response(iob, value_buffer);
+  /* everything becomes a write, so that the backend applies the vector
+     with its own (crash-consistent) atomic update where it has one */
+  std::vector<std::unique_ptr<IKVStore::Operation_write>> writes;
+  std::vector<uint64_t>                                   operands;
+  std::vector<char>                                       zeros(zero_len, 0);
+  bool                                                    compare_ok = true;
+
+  /* turn the vector into writes against a value, writing the prior
+     values of increments and compare-and-swaps into the response */
+  auto plan = [&](const void* base) {
+    writes.clear();
+    operands.clear();
+    operands.reserve(result_count); /* writes point into operands */
+    compare_ok = true;
+
+    /* current value of a field, including earlier writes in the vector */
+    auto current = [&](size_t offset) {
+      char field[sizeof(uint64_t)];
+      memcpy(field, static_cast<const char*>(base) + offset, sizeof(field));
+      for (auto& w : writes) {
+        const size_t begin = std::max(offset, w->offset());
+        const size_t end =
+            std::min(offset + sizeof(field), w->offset() + w->size());
+        if (begin < end)
+          memcpy(&field[begin - offset],
+                 static_cast<const char*>(w->data()) + (begin - w->offset()),
+                 end - begin);
+      }
+      uint64_t result;
+      memcpy(&result, field, sizeof(result));
+      return result;
+    };
+
+    char* results = response->data;
+
+    for (auto e : elements) {
+      switch (e->op) {
+        case Protocol::ATOMIC_OP_WRITE:
+          writes.emplace_back(
+              new IKVStore::Operation_write(e->offset, e->len, e->data));
+          break;
+        case Protocol::ATOMIC_OP_ZERO:
+          writes.emplace_back(
+              new IKVStore::Operation_write(e->offset, e->len, zeros.data()));
+          break;
+        case Protocol::ATOMIC_OP_INCREMENT_UINT64: {
+          uint64_t addend;
+          memcpy(&addend, e->data, sizeof(addend));
+          const uint64_t old = current(e->offset);
+          operands.push_back(old + addend);
+          writes.emplace_back(new IKVStore::Operation_write(
+              e->offset, sizeof(uint64_t), &operands.back()));
+          memcpy(results, &old, sizeof(old));
+          results += sizeof(old);
+          break;
         }
-        else {
-          /* for large gets we use a two-stage protocol sending
-             response message and value separately
-          */
-          response->set_twostage_bit();
+        case Protocol::ATOMIC_OP_CAS_UINT64: {
+          uint64_t expected_desired[2];
+          memcpy(expected_desired, e->data, sizeof(expected_desired));
+          const uint64_t old = current(e->offset);
+          if (old != expected_desired[0]) compare_ok = false;
+          operands.push_back(expected_desired[1]);
+          writes.emplace_back(new IKVStore::Operation_write(
+              e->offset, sizeof(uint64_t), &operands.back()));
+          memcpy(results, &old, sizeof(old));
+          results += sizeof(old);
+          break;
+        }
+      }
+    }
+  };
 
-          /* send two separate packets */
-          handler->post_response(iob);
+  plan(value);
+  response->set_data_length(result_count * sizeof(uint64_t));
+
+  if (!compare_ok) {
+    if (option_DEBUG > 2) PLOG("ATOMIC_UPDATE: compare failed");
+    _i_kvstore->unlock(msg->pool_id, key_handle);
+    return S_OK;
+  }
 
-          /* the client is allocating the recv buffer only after
-             receiving the response advance. this could timeout if
-             this side issues before the remote buffer is ready */
-          handler->post_send_value_buffer(value_buffer);
+  std::vector<IKVStore::Operation*> op_vector;
+  for (auto& w : writes) op_vector.push_back(w.get());
+
+  status_t status = _i_kvstore->atomic_update(msg->pool_id, k, op_vector, false);
+  _i_kvstore->unlock(msg->pool_id, key_handle);
+  if (status != IKVStore::E_NOT_SUPPORTED) return status;
+
+  /* backend has no atomic update.  Writing into the live value would
+     tear it on a crash, so have the backend run the vector in its own
+     transaction instead (apply takes the write lock itself; the vector
+     is planned again since the value may have changed once unlocked) */
+  bool bad_offset = false;
+  status          = _i_kvstore->apply(
+      msg->pool_id, k,
+      [&](void* base, const size_t len) {
+        for (auto e : elements)
+          if (e->offset + e->len > len) {
+            bad_offset = true;
+            return;
+          }
+        plan(base);
+        if (compare_ok)
+          for (auto& w : writes)
+            memcpy(static_cast<char*>(base) + w->offset(), w->data(),
+                   w->size());
+      },
+      value_len, true);
+  if (status == S_OK && bad_offset) return IKVStore::E_BAD_OFFSET;
+  if (status != IKVStore::E_NOT_SUPPORTED) return status;
+
+  /* neither; only volatile backends (e.g. mapstore) get here, for which
+     an in-place update under the write lock is consistent */
+  try {
+    key_handle = _i_kvstore->lock(msg->pool_id, k, IKVStore::STORE_LOCK_WRITE,
+                                  value, value_len);
+  }
+  catch (...) {
+    return IKVStore::E_KEY_NOT_FOUND;
+  }
+  if (key_handle == IKVStore::KEY_NONE) return E_FAIL;
+
+  status = S_OK;
+  for (auto e : elements)
+    if (e->offset + e->len > value_len) status = IKVStore::E_BAD_OFFSET;
+
+  if (status == S_OK) {
+    plan(value);
+    if (compare_ok)
+      for (auto& w : writes)
+        memcpy(static_cast<char*>(value) + w->offset(), w->data(), w->size());
+  }
+
+  _i_kvstore->unlock(msg->pool_id, key_handle);
+  return status;
+}
+
+status_t Shard::process_locate(Connection_handler*                 handler,
+                               const Protocol::Message_IO_request* msg,
+                               Protocol::Message_IO_response*      response)
+{
+  using namespace Component;
+
+  const std::string k(msg->key(), msg->key_len);
+  void*             value     = nullptr;
+  size_t            value_len = 0;
+  IKVStore::key_t   key_handle;
+
+  try {
+    key_handle = _i_kvstore->lock(msg->pool_id, k, IKVStore::STORE_LOCK_READ,
+                                  value, value_len);
+  }
+  catch (...) {
+    return IKVStore::E_KEY_NOT_FOUND;
+  }
+
+  if (key_handle == IKVStore::KEY_NONE) return E_FAIL;
+
+  status_t status = S_OK;
+  if (value_len == 0) {
+    status = IKVStore::E_KEY_NOT_FOUND;
+  }
+  else {
+    auto region = handler->get_preregistered(value, value_len);
+    if (region == nullptr) {
+      status = IKVStore::E_NOT_SUPPORTED;
+    }
+    else {
+      /* writers bump the version before touching the value, so a reader
+         that finds it unchanged after reading the value read it whole */
+      auto version_region = handler->get_pinned(_leases.base(), _leases.size());
+      const auto identity = handler->pool_identity(msg->pool_id);
+      auto location =
+          reinterpret_cast<Protocol::Value_location*>(response->data);
+      location->addr     = reinterpret_cast<uint64_t>(value);
+      location->key      = handler->get_memory_remote_key(region);
+      location->len      = value_len;
+      location->checksum = Protocol::value_checksum(value, value_len);
+      location->version_addr = reinterpret_cast<uint64_t>(
+          _leases.version_addr(identity, msg->key(), msg->key_len));
+      location->version_key =
+          handler->get_memory_remote_key(version_region);
+      location->version = _leases.version(identity, msg->key(), msg->key_len);
+      response->set_data_length(sizeof(Protocol::Value_location));
+    }
+  }
+
+  _i_kvstore->unlock(msg->pool_id, key_handle);
+  return status;
+}
+
+status_t Shard::process_scan(Connection_handler*                 handler,
+                             const Protocol::Message_IO_request* msg,
+                             Protocol::Message_IO_response*      response,
+                             const size_t                        buffer_size)
+{
+  using namespace Component;
+
+  Protocol::Scan_request request;
+  if (msg->val_len != sizeof(request))
+    throw Protocol_exception("OP_SCAN: bad request length");
+  memcpy(&request, msg->value(), sizeof(request));
+
+  if (request.max_keys == 0) return E_INVAL;
+
+  const uint32_t id = (request.cursor >> Protocol::SCAN_CURSOR_ID_SHIFT) &
+                      Protocol::SCAN_CURSOR_ID_MASK;
+  std::string* position = nullptr; /* last key returned, if resuming */
+  if (request.cursor != 0) {
+    position = handler->scan_position(id, msg->pool_id);
+    if (position == nullptr) return E_INVAL;
+  }
+
+  const std::string expression(msg->key(), msg->key_len);
+  std::regex        r;
+  if (request.filter == IKVIndex::FIND_TYPE_REGEX) {
+    try {
+      r.assign(expression);
+    }
+    catch (const std::regex_error&) {
+      return E_INVAL;
+    }
+  }
+
+  /* each key takes at least its length word, which bounds the page */
+  const auto   space = buffer_size - response->base_message_size();
+  const size_t limit = std::min<size_t>(
+      request.max_keys, (space - sizeof(Protocol::Scan_page)) / sizeof(uint32_t));
+  if (limit == 0) return E_INVAL;
+
+  /* the smallest matching keys after the position; at most a page is
+     held, whatever the size of the pool */
+  std::set<std::string> keys;
+  const auto            status = _i_kvstore->map(
+      msg->pool_id, [&](const std::string& key, const void*, const size_t) {
+        if (position && key <= *position) return 0;
+        if (keys.size() == limit && key >= *keys.rbegin()) return 0;
+
+        bool match;
+        switch (request.filter) {
+          case IKVIndex::FIND_TYPE_EXACT:
+            match = key == expression;
+            break;
+          case IKVIndex::FIND_TYPE_PREFIX:
+            match = key.compare(0, expression.size(), expression) == 0;
+            break;
+          case IKVIndex::FIND_TYPE_REGEX:
+            match = std::regex_match(key, r);
+            break;
+          default:
+            match = true;
         }
+        if (!match) return 0;
+
+        keys.insert(key);
+        if (keys.size() > limit) keys.erase(std::prev(keys.end()));
+        return 0;
+      });
+  if (status != S_OK) return status;
+
+  /* pack as many keys as fit in the response */
+  auto     page  = reinterpret_cast<Protocol::Scan_page*>(response->data);
+  size_t   len   = sizeof(Protocol::Scan_page);
+  uint32_t count = 0;
+  auto     i     = keys.begin();
+
+  for (; i != keys.end(); ++i) {
+    const uint32_t key_len = i->size();
+    if (len + sizeof(key_len) + key_len > space) break;
+
+    memcpy(response->data + len, &key_len, sizeof(key_len));
+    memcpy(response->data + len + sizeof(key_len), i->data(), key_len);
+    len += sizeof(key_len) + key_len;
+    count++;
+  }
+
+  page->count = count;
+  page->pad   = 0;
+  if (i == keys.end() && keys.size() < limit) {
+    /* nothing after this page */
+    if (position) handler->remove_scan(id);
+    page->cursor = 0;
+  }
+  else {
+    if (count == 0) return E_INVAL; /* key does not fit in a message */
+
+    if (position == nullptr) {
+      const auto new_id = handler->add_scan(msg->pool_id);
+      position          = handler->scan_position(new_id, msg->pool_id);
+      page->cursor      = uint64_t(new_id) << Protocol::SCAN_CURSOR_ID_SHIFT;
+    }
+    else {
+      page->cursor = request.cursor;
+    }
+    *position = *std::prev(i);
+  }
+
+  if (option_DEBUG > 2)
+    PLOG("SCAN: %u keys (next cursor=0x%lx)", count, page->cursor);
+
+  response->set_data_length(len);
+  return S_OK;
+}
+
+size_t Shard::process_message_IO_batch_request(
+    Connection_handler*                 handler,
+    Protocol::Message_IO_batch_request* msg)
+{
+  using namespace Component;
+
+  if (option_DEBUG > 2)
+    PLOG("BATCH: (%p) count=%lu request_id=%lu", this, msg->count,
+         msg->request_id);
+
+  /* before executing any, so that a bad batch has no effect */
+  msg->check_elements();
+
+  const auto iob         = handler->allocate();
+  const auto buffer_size = iob->original_length;
+
+  Protocol::Message_IO_batch_response* response =
+      new (iob->base()) Protocol::Message_IO_batch_response(
+          buffer_size, handler->auth_id(), msg->request_id);
+
+  const bool short_circuit = msg->resvd & Dawn::Protocol::MSG_RESVD_SCBE;
+  const auto max_value_len =
+      Protocol::Message_IO_batch_response::max_value_len(buffer_size);
+
+  /* execute elements in order, in a single pass, packing results
+     into one response; stop early if the response buffer fills */
+  size_t bytes   = 0;
+  auto   element = msg->first_element();
+  for (uint64_t i = 0; i < msg->count;
+       i++, element = msg->next_element(element)) {
+    if (element->op == Protocol::OP_PUT) {
+      if (response->msg_len + sizeof(Protocol::Batch_response_element) >
+          buffer_size)
+        break;
+
+      status_t status = S_OK;
+      if (!short_circuit) {
+        const std::string k(element->key(), element->key_len);
+        _leases.bump(handler->pool_identity(msg->pool_id), element->key(),
+                     element->key_len);
+        status = _i_kvstore->put(msg->pool_id, k, element->value(),
+                                 element->val_len);
+        _leases.bump(handler->pool_identity(msg->pool_id), element->key(),
+                     element->key_len);
       }
+      response->append_element(buffer_size, status);
+      bytes += element->val_len;
     }
-    return;
+    else if (element->op == Protocol::OP_GET) {
+      if (short_circuit) {
+        if (!response->append_element(buffer_size, S_OK)) break;
+        continue;
+      }
+
+      void*  value_out     = nullptr;
+      size_t value_out_len = 0;
+
+      const std::string k(element->key(), element->key_len);
+      auto              key_handle = _i_kvstore->lock(
+          msg->pool_id, k, IKVStore::STORE_LOCK_READ, value_out, value_out_len);
+
+      if (key_handle == IKVStore::KEY_NONE) { /* key not found */
+        if (!response->append_element(buffer_size, E_NOT_FOUND)) break;
+        continue;
+      }
+
+      if (value_out_len > max_value_len) {
+        /* value can never fit in a batch response; client must use GET */
+        _i_kvstore->unlock(msg->pool_id, key_handle);
+        if (!response->append_element(buffer_size, IKVStore::E_TOO_LARGE))
+          break;
+        continue;
+      }
+
+      auto e = response->append_element(buffer_size, S_OK, value_out_len);
+      if (e) {
+        memcpy(e->data, value_out, value_out_len);
+        bytes += value_out_len;
+      }
+
+      _i_kvstore->unlock(msg->pool_id, key_handle);
+
+      if (!e) break; /* remaining elements are re-issued by the client */
+    }
+    else
+      throw Protocol_exception("batch element operation not implemented (%u)",
+                               element->op);
   }
-  else
-    throw Protocol_exception("operation not implemented");
 
-  response->request_id = msg->request_id;
-  response->status     = status;
+  if (option_DEBUG > 2)
+    PLOG("BATCH: executed %lu of %lu elements", response->count, msg->count);
 
   iob->set_length(response->msg_len);
-  handler->post_response(iob);  // issue IO request response
+  handler->post_response(iob);
+
+  return bytes;
 }
 
-void Shard::check_for_new_connections()
+void Shard::accept_loop()
 {
-  /* new connections are transferred from the connection handler
-     to the shard thread */
-  Connection_handler* handler;
+  /* connection buffers are allocated on the shard's node, or on the
+     node of the calling thread if it is unknown, so accept on the
+     shard's first core */
+  if (set_cpu_affinity(1UL << _core) != 0)
+    throw General_exception("unable to set cpu affinity (%u)", _core);
 
-  while ((handler = get_new_connection()) != nullptr) {
-    if (option_DEBUG > 1)
-      PMAJOR("Shard: processing new connection (%p)", handler);
-    _handlers.push_back(handler);
+  Numa::prefer_node(numa_node());
+
+  unsigned stats_dump_request = Global::stats_dump_request;
+
+  while (_thread_exit == false) {
+    /* new connections are transferred from the connection handler
+       to the least loaded worker */
+    auto handler =
+        wait_for_new_connection(std::chrono::milliseconds(ACCEPT_WAIT_MS));
+
+    if (handler) {
+      Worker* target = _workers[0].get();
+      for (auto& w : _workers)
+        if (w->connection_count < target->connection_count) target = w.get();
+
+      if (option_DEBUG > 1)
+        PMAJOR("Shard: processing new connection (%p) on worker %u", handler,
+               target->core);
+
+      give_connection(target, handler);
+    }
+
+    /* dump statistics on request (SIGUSR1) */
+    if (Global::stats_dump_request.load(std::memory_order_relaxed) !=
+        stats_dump_request) {
+      stats_dump_request = Global::stats_dump_request;
+      dump_stats();
+    }
+  }
+
+  if (option_DEBUG > 2) PLOG("shard:%u acceptor exited.", _core);
+}
+
+void Shard::idle_wait(Worker* worker)
+{
+  {
+    std::lock_guard<std::mutex> g(worker->incoming_lock);
+    if (!worker->incoming.empty()) return;
+  }
+
+  /* a connection handed over after the check above leaves the wakeup
+     descriptor readable, so it is not missed */
+  std::vector<int> fds{worker->wakeup_fd};
+  for (auto handler : worker->handlers)
+    if (!handler->prepare_wait(fds)) return; /* completions pending */
+
+  std::vector<::pollfd> pfds;
+  for (auto fd : fds) pfds.push_back(::pollfd{fd, POLLIN | POLLPRI, 0});
+
+  if (::poll(pfds.data(), pfds.size(), IDLE_WAIT_MS) == -1 && errno != EINTR)
+    throw General_exception("idle_wait: poll failed (%d)", errno);
+
+  if (pfds[0].revents & POLLIN) {
+    uint64_t count;
+    if (::read(worker->wakeup_fd, &count, sizeof(count)) != sizeof(count))
+      PWRN("idle_wait: unable to reset wakeup descriptor");
+  }
+}
+
+void Shard::give_connection(Worker* worker, Connection_handler* handler)
+{
+  std::lock_guard<std::mutex> g(worker->incoming_lock);
+  worker->incoming.push_back(handler);
+  worker->connection_count++;
+
+  /* wake the worker if it is blocked in idle_wait */
+  const uint64_t one = 1;
+  if (::write(worker->wakeup_fd, &one, sizeof(one)) != sizeof(one))
+    PWRN("give_connection: unable to wake worker %u", worker->core);
+}
+
+void Shard::request_steal(Worker* thief)
+{
+  Worker* victim = nullptr;
+  for (auto& w : _workers) {
+    if (w.get() == thief) continue;
+    if (!victim || w->connection_count > victim->connection_count)
+      victim = w.get();
+  }
+
+  if (victim && victim->connection_count > thief->connection_count + 1) {
+    Worker* expected = nullptr;
+    victim->thief.compare_exchange_strong(expected, thief);
   }
 }
 
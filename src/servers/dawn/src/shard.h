@@ -10,12 +10,21 @@
 #include <common/cpu.h>
 #include <common/exceptions.h>
 #include <common/logging.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include "connection_handler.h"
 #include "dawn_config.h"
 #include "fabric_transport.h"
+#include "lease_table.h"
+#include "numa_topology.h"
 #include "pool_manager.h"
+#include "shard_stats.h"
 #include "types.h"
 
 namespace Dawn
@@ -34,6 +43,7 @@ class Shard : public Shard_transport {
 
  public:
   Shard(int               core,
+        const std::string cores,
         unsigned int      port,
         const std::string provider,
         const std::string device,
@@ -42,15 +52,18 @@ class Shard : public Shard_transport {
         const std::string pci_addr,
         const std::string pm_path,
         const std::string dax_config,
+        int               numa_node,
+        const std::map<uint64_t, unsigned>& client_weights,
         unsigned          debug_level,
         bool              forced_exit)
-      : Shard_transport(provider, net, port), _core(core),
-        _forced_exit(forced_exit), _thread(&Shard::thread_entry,
-                                           this,
-                                           backend,
-                                           pci_addr,
-                                           dax_config,
-                                           debug_level)
+      : Shard_transport(provider, net, port, numa_node),
+        _forced_exit(forced_exit), _client_weights(client_weights),
+        _core(core), _cores(cores), _thread(&Shard::thread_entry,
+                                            this,
+                                            backend,
+                                            pci_addr,
+                                            dax_config,
+                                            debug_level)
   {
     option_DEBUG = Dawn::Global::debug_level = debug_level;
   }
@@ -58,7 +71,8 @@ class Shard : public Shard_transport {
   ~Shard()
   {
     _thread_exit = true;
-    /* TODO: unblock */
+    /* idle workers and the acceptor wake up at least every
+       IDLE_WAIT_MS and ACCEPT_WAIT_MS respectively */
     _thread.join();
     _i_kvstore->release_ref();
   }
@@ -66,70 +80,251 @@ class Shard : public Shard_transport {
   bool exited() const { return _thread_exit; }
 
  private:
-  void thread_entry(const std::string& backend,
-                    const std::string& pci_addr,
-                    const std::string& dax_config,
-                    unsigned           debug_level)
-  {
-    if (option_DEBUG > 2) PLOG("shard:%u worker thread entered.", _core);
+  /* idle back-off: a worker spins while it has traffic, yields its core
+     once idle for SPIN_IDLE_USEC and blocks once idle for
+     BLOCK_IDLE_USEC; it is woken by a completion on any of its
+     connections or by a connection being handed to it */
+  static constexpr uint64_t SPIN_IDLE_USEC  = 50;
+  static constexpr uint64_t BLOCK_IDLE_USEC = 1000;
+  static constexpr uint64_t STEAL_IDLE_USEC = 10000;
+  static constexpr unsigned IDLE_WAIT_MS    = 5;   /*< bound on a block */
+  static constexpr unsigned ACCEPT_WAIT_MS  = 100; /*< bound on accept */
 
-    if (set_cpu_affinity(1UL << _core) != 0)
-      throw General_exception("unable to set cpu affinity (%lu)", _core);
+ public:
+  /* scheduling: each round, a connection may process messages costing
+     up to SCHED_QUANTUM times its weight (deficit round robin; a message
+     costs one, a batch one per element) */
+  static constexpr unsigned SCHED_QUANTUM  = 4;
+  static constexpr unsigned DEFAULT_WEIGHT = 1;
+  static constexpr unsigned MAX_WEIGHT     = 64;
 
-    initialize_components(backend, pci_addr, dax_config, debug_level);
+ private:
 
-    main_loop();
+  /**
+   * Worker thread state.  Each worker is pinned to a core and owns a
+   * subset of the shard's connections.
+   */
+  struct Worker {
+    Worker(unsigned core)
+        : core(core), wakeup_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    {
+      if (wakeup_fd == -1)
+        throw General_exception("unable to create worker wakeup eventfd");
+    }
 
-    if (option_DEBUG > 2) PLOG("shard:%u worker thread exited.", _core);
-  }
+    ~Worker() { ::close(wakeup_fd); }
 
-  void add_locked_value(const pool_t               pool_id,
-                        Component::IKVStore::key_t key,
-                        void*                      target)
-  {
-    if (option_DEBUG > 2) PLOG("shard: locked value (target=%p)", target);
-    _locked_values[target] = std::make_pair(pool_id, key);
-  }
+    const unsigned                   core;
+    std::vector<Connection_handler*> handlers; /*< owned by worker thread */
+    std::mutex handlers_lock; /*< held by owner to change handlers, and by
+                                 others to read them */
+    std::mutex                       incoming_lock;
+    std::vector<Connection_handler*> incoming; /*< handed over to worker */
+    const int wakeup_fd; /*< eventfd; wakes worker blocked in idle_wait */
+    std::atomic<unsigned>            connection_count{0};
+    std::atomic<Worker*>             thief{nullptr}; /*< idle worker */
+    std::thread                      thread;
+    Shard_stats                      stats;
+  };
 
-  void release_locked_value(const void* target)
-  {
-    auto i = _locked_values.find(target);
-    if (i == _locked_values.end())
-      throw Logic_exception("bad target to unlock value");
+  void thread_entry(const std::string& backend,
+                    const std::string& pci_addr,
+                    const std::string& dax_config,
+                    unsigned           debug_level);
 
-    _i_kvstore->unlock(i->second.first, i->second.second);
+  void worker_entry(Worker* worker);
 
-    if (option_DEBUG > 2) PLOG("unlocked value: %p", target);
+  status_t release_locked_value(Connection_handler* handler,
+                                const void*         target);
 
-    _locked_values.erase(i);
-  }
+  void release_all_locked_values(Connection_handler* handler);
+
+  status_t persist_segment(Connection_handler* handler,
+                           const void*         target,
+                           const uint64_t      offset,
+                           const uint64_t      len);
 
   void initialize_components(const std::string& backend,
                              const std::string& pci_addr,
                              const std::string& dax_config,
                              unsigned           debug_level);
 
-  void check_for_new_connections();
+  /**
+   * Acceptor thread; waits for new connections, placing each on the
+   * least loaded worker, and services statistics dump requests
+   *
+   */
+  void accept_loop();
+
+  /**
+   * Block an idle worker until there is work for it or IDLE_WAIT_MS
+   * expires.  The worker blocks in one poll on the completion
+   * descriptors of all its connections and its wakeup descriptor.
+   *
+   * @param worker Idle worker
+   */
+  void idle_wait(Worker* worker);
 
-  void main_loop();
+  /**
+   * Hand a connection over to a worker
+   *
+   * @param worker Worker to take ownership
+   * @param handler Connection handler
+   */
+  void give_connection(Worker* worker, Connection_handler* handler);
+
+  /**
+   * Ask the most loaded worker to give up one of its connections
+   *
+   * @param thief Idle worker
+   */
+  void request_steal(Worker* thief);
+
+  void main_loop(Worker* worker);
 
   void process_message_pool_request(Connection_handler*             handler,
                                     Protocol::Message_pool_request* msg);
 
-  void process_message_IO_request(Connection_handler*           handler,
-                                  Protocol::Message_IO_request* msg);
+  /**
+   * Register a pool's memory with the connection for direct IO, if the
+   * backend exposes fixed pool regions
+   *
+   * @param handler Connection handler
+   * @param pool Pool identifier
+   */
+  void register_pool_regions(Connection_handler* handler, const pool_t pool);
+
+  /**
+   * Send statistics of all the shard's workers in response to OP_STATS
+   *
+   * @param handler Connection handler
+   */
+  void process_stats_request(Connection_handler* handler);
+
+  /**
+   * Aggregate and log statistics of all the shard's workers
+   *
+   */
+  void dump_stats();
+
+  /**
+   * Format scheduling statistics of all the shard's connections
+   *
+   * @return JSON text
+   */
+  std::string connection_stats();
+
+  /**
+   * Scheduling weight of a client
+   *
+   * @param client_id Auth id the client presented in the handshake
+   *
+   * @return Configured weight, or DEFAULT_WEIGHT
+   */
+  unsigned client_weight(uint64_t client_id) const
+  {
+    auto i = _client_weights.find(client_id);
+    return i == _client_weights.end() ? DEFAULT_WEIGHT : i->second;
+  }
+
+  /**
+   * Process up to a connection's deficit round robin allowance of its
+   * pending messages
+   *
+   * @param worker Worker owning the connection
+   * @param handler Connection handler
+   */
+  void process_pending_msgs(Worker* worker, Connection_handler* handler);
+
+  /**
+   * Process IO request
+   *
+   * @param handler Connection handler
+   * @param msg Request message
+   *
+   * @return Value bytes transferred (for statistics)
+   */
+  size_t process_message_IO_request(Connection_handler*           handler,
+                                    Protocol::Message_IO_request* msg);
+
+  /**
+   * Process batch IO request
+   *
+   * @param handler Connection handler
+   * @param msg Request message
+   *
+   * @return Value bytes transferred (for statistics)
+   */
+  size_t process_message_IO_batch_request(
+      Connection_handler*                 handler,
+      Protocol::Message_IO_batch_request* msg);
+
+  /**
+   * Apply the operation vector of an OP_ATOMIC_UPDATE request to an
+   * existing value, with the backend's atomic_update or, failing that,
+   * inside a backend transaction (apply)
+   *
+   * @param msg Request message
+   * @param response Response; prior values of increment and
+   * compare-and-swap operations are written into its data
+   *
+   * @return S_OK or error code
+   */
+  status_t process_atomic_update(const Protocol::Message_IO_request* msg,
+                                 Protocol::Message_IO_response*      response);
+
+  /**
+   * Get location of a value for one-sided (RDMA read) access.  Only
+   * values in pre-registered pool memory can be located, since on-demand
+   * registrations do not outlive the request.
+   *
+   * @param handler Connection handler
+   * @param msg Request message
+   * @param response Response; location is written into its data
+   *
+   * @return S_OK, IKVStore::E_NOT_SUPPORTED if the value is not in a
+   * pre-registered region, or other error code
+   */
+  status_t process_locate(Connection_handler*                 handler,
+                          const Protocol::Message_IO_request* msg,
+                          Protocol::Message_IO_response*      response);
+
+  /**
+   * Return a page of the keys matching an OP_SCAN filter.  Each page
+   * walks the pool (IKVStore::map) keeping only the smallest matching
+   * keys after the scan position, so at most a page is held; the
+   * session keeps just the last key returned.
+   *
+   * @param handler Connection handler
+   * @param msg Request message
+   * @param response Response; page is written into its data
+   * @param buffer_size Size of response buffer
+   *
+   * @return S_OK, E_INVAL for a bad cursor or expression (or a key too
+   * large for a message), or IKVStore::E_NOT_SUPPORTED if the backend
+   * cannot enumerate keys
+   */
+  status_t process_scan(Connection_handler*                 handler,
+                        const Protocol::Message_IO_request* msg,
+                        Protocol::Message_IO_response*      response,
+                        const size_t                        buffer_size);
 
  private:
-  bool                             _thread_exit = false;
-  bool                             _forced_exit;
-  unsigned                         _core;
-  std::thread                      _thread;
-  size_t                           _max_message_size;
-  Component::IKVStore*             _i_kvstore;
-  std::vector<Connection_handler*> _handlers;
-
-  std::map<const void*, std::pair<pool_t, Component::IKVStore::key_t>>
-      _locked_values;
+  std::atomic<bool>                    _thread_exit{false};
+  bool                                 _forced_exit;
+  const std::map<uint64_t, unsigned>   _client_weights; /*< by auth id */
+  unsigned                             _core;
+  const std::string                    _cores;
+  std::thread                          _acceptor;
+  size_t                               _max_message_size;
+  float                                _freq_mhz;
+  Component::IKVStore*                 _i_kvstore;
+  std::vector<std::unique_ptr<Worker>> _workers;
+  Lease_table                          _leases; /*< versions for read leases */
+  Pool_registry                        _pools; /*< open by any connection */
+
+  /* last, so that the state thread_entry uses is constructed first */
+  std::thread                          _thread;
 };
 
 }  // namespace Dawn
@@ -0,0 +1,242 @@
+#ifndef __DAWN_SHARD_STATS_H__
+#define __DAWN_SHARD_STATS_H__
+
+#include <common/cycles.h>
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "buffer_manager.h"
+#include "protocol.h"
+
+namespace Dawn
+{
+/**
+ * Always-on request statistics for one shard worker.  Counters are
+ * only written by the owning worker thread (relaxed load/store, no
+ * read-modify-write) and may be read at any time by others, e.g. to
+ * answer OP_STATS or on SIGUSR1.  Latency is in TSC cycles, bucketed
+ * by power of two, and split by operation and value size class.
+ */
+class Shard_stats {
+ public:
+  static constexpr unsigned OP_COUNT        = 17; /*< protocol op codes */
+  static constexpr unsigned LATENCY_BUCKETS = 48; /*< log2(cycles) */
+  static constexpr unsigned DEPTH_BUCKETS =
+      Protocol::MAX_OUTSTANDING_REQUESTS + 1;
+
+  enum Size_class {
+    SIZE_SMALL,  /*< up to 4KiB */
+    SIZE_MEDIUM, /*< up to 64KiB */
+    SIZE_LARGE,  /*< up to an IO buffer */
+    SIZE_HUGE,   /*< two-stage */
+    SIZE_CLASS_COUNT,
+  };
+
+  static const char* size_class_name(unsigned sc)
+  {
+    static const char* names[] = {"4KiB", "64KiB", "2MiB", "huge"};
+    return names[sc];
+  }
+
+  static const char* op_name(unsigned op)
+  {
+    static const char* names[] = {
+        "none",    "create",  "open",   "close",         "put",
+        "get",     "put_adv", "put_seg", "delete",       "prepare",
+        "batch",   "release", "erase",  "atomic_update", "locate",
+        "stats",   "scan"};
+    return op < OP_COUNT ? names[op] : "?";
+  }
+
+  static inline unsigned size_class(uint64_t bytes)
+  {
+    if (bytes <= KiB(4)) return SIZE_SMALL;
+    if (bytes <= KiB(64)) return SIZE_MEDIUM;
+    if (bytes <= Buffer_manager<Component::IFabric_server>::BUFFER_LEN)
+      return SIZE_LARGE;
+    return SIZE_HUGE;
+  }
+
+  static inline unsigned latency_bucket(uint64_t cycles)
+  {
+    const unsigned b = cycles ? 64 - __builtin_clzll(cycles) : 0;
+    return b < LATENCY_BUCKETS ? b : LATENCY_BUCKETS - 1;
+  }
+
+  /**
+   * Record a completed request
+   *
+   * @param op Protocol operation
+   * @param bytes Value bytes transferred
+   * @param cycles Service time in TSC cycles
+   */
+  inline void record(unsigned op, uint64_t bytes, uint64_t cycles)
+  {
+    if (unlikely(op >= OP_COUNT)) return;
+    auto& e = _ops[op][size_class(bytes)];
+    bump(e.count, 1);
+    bump(e.bytes, bytes);
+    bump(e.cycles, cycles);
+    bump(e.latency[latency_bucket(cycles)], 1);
+  }
+
+  /**
+   * Record number of requests found waiting on a connection
+   *
+   * @param depth Queue depth
+   */
+  inline void record_queue_depth(size_t depth)
+  {
+    bump(_queue_depth[depth < DEPTH_BUCKETS ? depth : DEPTH_BUCKETS - 1], 1);
+  }
+
+  /**
+   * Record time a request waited on its connection before processing
+   *
+   * @param cycles Queue delay in TSC cycles
+   */
+  inline void record_queue_delay(uint64_t cycles)
+  {
+    bump(_queue_delay[latency_bucket(cycles)], 1);
+  }
+
+  /**
+   * Record IO buffers held by the worker's connections
+   *
+   * @param in_use Buffers allocated (posted or being processed)
+   */
+  inline void record_buffers(size_t in_use)
+  {
+    _buffers_in_use.store(in_use, std::memory_order_relaxed);
+    if (in_use > _buffers_max.load(std::memory_order_relaxed))
+      _buffers_max.store(in_use, std::memory_order_relaxed);
+  }
+
+  /**
+   * Sum statistics into this object (used to aggregate workers)
+   *
+   * @param other Statistics to add
+   */
+  void add(const Shard_stats& other)
+  {
+    for (unsigned op = 0; op < OP_COUNT; op++) {
+      for (unsigned sc = 0; sc < SIZE_CLASS_COUNT; sc++) {
+        auto&       e = _ops[op][sc];
+        const auto& o = other._ops[op][sc];
+        bump(e.count, read(o.count));
+        bump(e.bytes, read(o.bytes));
+        bump(e.cycles, read(o.cycles));
+        for (unsigned b = 0; b < LATENCY_BUCKETS; b++)
+          bump(e.latency[b], read(o.latency[b]));
+      }
+    }
+    for (unsigned d = 0; d < DEPTH_BUCKETS; d++)
+      bump(_queue_depth[d], read(other._queue_depth[d]));
+    for (unsigned b = 0; b < LATENCY_BUCKETS; b++)
+      bump(_queue_delay[b], read(other._queue_delay[b]));
+    bump(_buffers_in_use, read(other._buffers_in_use));
+    bump(_buffers_max, read(other._buffers_max));
+  }
+
+  /**
+   * Format statistics as JSON.  Latencies are reported in microseconds;
+   * percentiles are the upper bound of the histogram bucket they fall in.
+   *
+   * @param freq_mhz TSC frequency
+   *
+   * @return JSON text
+   */
+  std::string report(float freq_mhz) const
+  {
+    std::stringstream ss;
+    ss << "{\"ops\":[";
+    bool first = true;
+    for (unsigned op = 0; op < OP_COUNT; op++) {
+      for (unsigned sc = 0; sc < SIZE_CLASS_COUNT; sc++) {
+        const auto& e     = _ops[op][sc];
+        const auto  count = read(e.count);
+        if (count == 0) continue;
+
+        if (!first) ss << ",";
+        first = false;
+        ss << "{\"op\":\"" << op_name(op) << "\",\"size\":\""
+           << size_class_name(sc) << "\",\"count\":" << count
+           << ",\"bytes\":" << read(e.bytes)
+           << ",\"mean_us\":" << read(e.cycles) / count / freq_mhz
+           << ",\"p50_us\":" << percentile(e, 0.5) / freq_mhz
+           << ",\"p99_us\":" << percentile(e, 0.99) / freq_mhz
+           << ",\"p999_us\":" << percentile(e, 0.999) / freq_mhz
+           << ",\"hist\":[";
+        for (unsigned b = 0; b < LATENCY_BUCKETS; b++)
+          ss << (b ? "," : "") << read(e.latency[b]);
+        ss << "]}";
+      }
+    }
+    ss << "],\"queue_depth\":[";
+    for (unsigned d = 0; d < DEPTH_BUCKETS; d++)
+      ss << (d ? "," : "") << read(_queue_depth[d]);
+    ss << "],\"queue_delay\":{\"p50_us\":"
+       << percentile(_queue_delay, 0.5) / freq_mhz
+       << ",\"p99_us\":" << percentile(_queue_delay, 0.99) / freq_mhz
+       << ",\"p999_us\":" << percentile(_queue_delay, 0.999) / freq_mhz
+       << ",\"hist\":[";
+    for (unsigned b = 0; b < LATENCY_BUCKETS; b++)
+      ss << (b ? "," : "") << read(_queue_delay[b]);
+    ss << "]},\"buffers_in_use\":" << read(_buffers_in_use)
+       << ",\"buffers_max\":" << read(_buffers_max) << "}";
+    return ss.str();
+  }
+
+ private:
+  using counter_t = std::atomic<uint64_t>;
+
+  struct Entry {
+    counter_t count{0};
+    counter_t bytes{0};
+    counter_t cycles{0};
+    counter_t latency[LATENCY_BUCKETS] = {};
+  };
+
+  static inline uint64_t read(const counter_t& c)
+  {
+    return c.load(std::memory_order_relaxed);
+  }
+
+  /* single writer; avoids a locked instruction on the fast path */
+  static inline void bump(counter_t& c, uint64_t n)
+  {
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  static uint64_t percentile(const counter_t (&hist)[LATENCY_BUCKETS],
+                             double p)
+  {
+    uint64_t count = 0;
+    for (unsigned b = 0; b < LATENCY_BUCKETS; b++) count += read(hist[b]);
+    if (count == 0) return 0;
+
+    const uint64_t target = static_cast<uint64_t>(count * p);
+    uint64_t       sum    = 0;
+    for (unsigned b = 0; b < LATENCY_BUCKETS; b++) {
+      sum += read(hist[b]);
+      if (sum > target) return b ? (1ULL << b) - 1 : 0;
+    }
+    return ~0ULL;
+  }
+
+  static uint64_t percentile(const Entry& e, double p)
+  {
+    return percentile(e.latency, p);
+  }
+
+  Entry     _ops[OP_COUNT][SIZE_CLASS_COUNT];
+  counter_t _queue_depth[DEPTH_BUCKETS] = {};
+  counter_t _queue_delay[LATENCY_BUCKETS] = {};
+  counter_t _buffers_in_use{0};
+  counter_t _buffers_max{0};
+};
+
+}  // namespace Dawn
+
+#endif  // __DAWN_SHARD_STATS_H__
@@ -0,0 +1,801 @@
+/* note: we do not include component source, only the API definition */
+#include <api/components.h>
+#include <api/dawn_itf.h>
+#include <api/kvstore_itf.h>
+#include <common/cpu.h>
+#include <common/cycles.h>
+#include <common/exceptions.h>
+#include <common/logging.h>
+#include <common/utils.h>
+#include <rapidjson/document.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+/*
+ * Loopback end-to-end benchmark: launches a Dawn server with N shards
+ * on this machine over the sockets or tcp libfabric provider, and runs
+ * put/get/batch/async workloads from M client threads.  Latency is
+ * reported per layer: "backend" (the store component in-process),
+ * "shard" (service time measured by the shards, from OP_STATS) and
+ * "client" (end to end).
+ */
+
+using namespace Component;
+
+struct {
+  std::string              server;
+  std::string              provider;
+  std::string              device;
+  std::string              addr;
+  unsigned                 port;
+  unsigned                 shards;
+  unsigned                 server_core;
+  int                      client_core;
+  unsigned                 threads;
+  std::vector<std::string> backends;
+  std::vector<std::string> workloads;
+  unsigned                 count;
+  unsigned                 key_length;
+  unsigned                 value_length;
+  unsigned                 batch_size;
+  unsigned                 async_depth;
+  size_t                   pool_size;
+  std::string              dax_device;
+  uint64_t                 dax_addr;
+  std::string              json;
+  unsigned                 debug_level;
+} Options;
+
+static float g_freq_mhz;
+
+/* layer results, in order */
+struct Result {
+  std::string backend;
+  std::string workload;
+  std::string layer;
+  std::string op;
+  uint64_t    count;
+  double      seconds; /*< zero if throughput is not measured */
+  double      mean_us;
+  double      p50_us;
+  double      p99_us;
+  double      p999_us;
+};
+
+static std::vector<Result> g_results;
+
+static std::vector<std::string> split(const std::string& s)
+{
+  std::vector<std::string> v;
+  std::stringstream        ss(s);
+  std::string              item;
+  while (std::getline(ss, item, ','))
+    if (!item.empty()) v.push_back(item);
+  return v;
+}
+
+static std::string make_key(unsigned thread, unsigned i)
+{
+  std::string key = std::to_string(thread) + "-" + std::to_string(i);
+  if (key.size() < Options.key_length)
+    key.insert(0, Options.key_length - key.size(), '0');
+  return key;
+}
+
+static std::string dax_path(unsigned shard)
+{
+  return Options.dax_device + std::to_string(shard);
+}
+
+static std::string dax_json(unsigned shard)
+{
+  std::stringstream ss;
+  ss << "[{\"region_id\":0,\"path\":\"" << dax_path(shard) << "\",\"addr\":\"0x"
+     << std::hex << Options.dax_addr + (shard * 0x1000000000ULL) << "\"}]";
+  return ss.str();
+}
+
+/**
+ * Latency samples of one operation type, in TSC cycles
+ */
+class Samples {
+ public:
+  void add(uint64_t cycles) { _cycles.push_back(cycles); }
+
+  void add(const Samples& other)
+  {
+    _cycles.insert(_cycles.end(), other._cycles.begin(), other._cycles.end());
+  }
+
+  /**
+   * Add a result for these samples
+   *
+   * @param backend Backend name
+   * @param workload Workload name
+   * @param layer Layer name
+   * @param op Operation name
+   * @param seconds Elapsed wall-clock time
+   */
+  void report(const std::string& backend,
+              const std::string& workload,
+              const std::string& layer,
+              const std::string& op,
+              double             seconds)
+  {
+    if (_cycles.empty()) return;
+    std::sort(_cycles.begin(), _cycles.end());
+
+    double sum = 0;
+    for (auto c : _cycles) sum += c;
+
+    g_results.push_back(Result{backend, workload, layer, op, _cycles.size(),
+                               seconds, sum / _cycles.size() / g_freq_mhz,
+                               percentile(0.5), percentile(0.99),
+                               percentile(0.999)});
+  }
+
+ private:
+  double percentile(double p) const
+  {
+    size_t i = static_cast<size_t>(p * _cycles.size());
+    return _cycles[std::min(i, _cycles.size() - 1)] / g_freq_mhz;
+  }
+
+  std::vector<uint64_t> _cycles;
+};
+
+/**
+ * Per-thread results of a workload
+ */
+struct Thread_result {
+  std::map<std::string, Samples> samples; /*< by operation */
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point end;
+};
+
+/**
+ * Run a workload on M threads and add its results
+ *
+ * @param backend Backend name
+ * @param workload Workload name
+ * @param layer Layer name
+ * @param fn Per-thread function (thread index, results)
+ */
+template <typename F>
+static void run_threads(const std::string& backend,
+                        const std::string& workload,
+                        const std::string& layer,
+                        F                  fn)
+{
+  std::vector<Thread_result>      results(Options.threads);
+  std::vector<std::exception_ptr> errors(Options.threads);
+  std::vector<std::thread>        threads;
+  std::atomic<unsigned>           ready{0};
+
+  for (unsigned t = 0; t < Options.threads; t++) {
+    threads.emplace_back([&, t]() {
+      if (Options.client_core >= 0)
+        set_cpu_affinity(1UL << (Options.client_core + t));
+
+      /* start together */
+      ready++;
+      while (ready < Options.threads) std::this_thread::yield();
+
+      results[t].start = std::chrono::steady_clock::now();
+      try {
+        fn(t, results[t]);
+      }
+      catch (...) {
+        errors[t] = std::current_exception();
+      }
+      results[t].end = std::chrono::steady_clock::now();
+    });
+  }
+  for (auto& t : threads) t.join();
+  for (auto& e : errors)
+    if (e) std::rethrow_exception(e);
+
+  auto start = results[0].start;
+  auto end   = results[0].end;
+  std::map<std::string, Samples> merged;
+  for (auto& r : results) {
+    start = std::min(start, r.start);
+    end   = std::max(end, r.end);
+    for (auto& s : r.samples) merged[s.first].add(s.second);
+  }
+
+  const double seconds = std::chrono::duration<double>(end - start).count();
+  for (auto& s : merged)
+    s.second.report(backend, workload, layer, s.first, seconds);
+}
+
+/**
+ * Time puts or gets of the thread's keys
+ *
+ * @param kv Store (backend or client)
+ * @param pool Pool
+ * @param t Thread index
+ * @param r Results
+ * @param value Value to put
+ * @param workload "put" or "get"
+ */
+static void put_get(IKVStore*           kv,
+                    IKVStore::pool_t    pool,
+                    unsigned            t,
+                    Thread_result&      r,
+                    const std::string&  value,
+                    const std::string&  workload)
+{
+  if (workload == "put") {
+    for (unsigned i = 0; i < Options.count; i++) {
+      const auto key   = make_key(t, i);
+      const auto start = rdtsc();
+      if (kv->put(pool, key, value.data(), value.size()) != S_OK)
+        throw General_exception("put failed");
+      r.samples["put"].add(rdtsc() - start);
+    }
+  }
+  else {
+    for (unsigned i = 0; i < Options.count; i++) {
+      const auto key   = make_key(t, i);
+      void*      out   = nullptr;
+      size_t     len   = 0;
+      const auto start = rdtsc();
+      if (kv->get(pool, key, out, len) != S_OK)
+        throw General_exception("get failed");
+      r.samples["get"].add(rdtsc() - start);
+      kv->free_memory(out);
+    }
+  }
+}
+
+/**
+ * Time batches of puts, then of gets
+ *
+ */
+static void batch(IDawn*             dawn,
+                  IKVStore::pool_t   pool,
+                  unsigned           t,
+                  Thread_result&     r,
+                  const std::string& value)
+{
+  for (auto type : {IDawn::Batch_op_type::PUT, IDawn::Batch_op_type::GET}) {
+    for (unsigned i = 0; i < Options.count; i += Options.batch_size) {
+      std::vector<IDawn::Batch_op> ops;
+      for (unsigned j = i; j < std::min(Options.count, i + Options.batch_size);
+           j++)
+        ops.push_back(IDawn::Batch_op{
+            type, make_key(t, j),
+            type == IDawn::Batch_op_type::PUT ? value : std::string(), E_FAIL});
+
+      const auto start = rdtsc();
+      if (dawn->batch(pool, ops) != S_OK)
+        throw General_exception("batch failed");
+      r.samples[type == IDawn::Batch_op_type::PUT ? "batch_put" : "batch_get"]
+          .add(rdtsc() - start);
+    }
+  }
+}
+
+/**
+ * Time asynchronous puts, then gets, with up to async_depth in flight.
+ * Latency is from issue to completion.
+ *
+ */
+static void async(IDawn*             dawn,
+                  IKVStore::pool_t   pool,
+                  unsigned           t,
+                  Thread_result&     r,
+                  const std::string& value)
+{
+  struct Slot {
+    IDawn::async_handle_t handle = IDawn::ASYNC_HANDLE_INIT;
+    uint64_t              start;
+    void*                 out_value = nullptr;
+    size_t                out_len   = 0;
+  };
+
+  for (const std::string op : {"async_put", "async_get"}) {
+    std::vector<Slot> slots(Options.async_depth);
+    auto&             samples = r.samples[op];
+
+    auto complete = [&](Slot& s) {
+      if (dawn->async_wait(s.handle) != S_OK)
+        throw General_exception("%s failed", op.c_str());
+      samples.add(rdtsc() - s.start);
+      if (s.out_value) {
+        dawn->free_memory(s.out_value);
+        s.out_value = nullptr;
+      }
+    };
+
+    for (unsigned i = 0; i < Options.count; i++) {
+      auto& s = slots[i % slots.size()];
+      if (s.handle != IDawn::ASYNC_HANDLE_INIT) complete(s);
+
+      s.start = rdtsc();
+      const auto key = make_key(t, i);
+      status_t   rc =
+          (op == "async_put")
+              ? dawn->async_put(pool, key, value.data(), value.size(), s.handle)
+              : dawn->async_get(pool, key, s.out_value, s.out_len, s.handle);
+      if (rc != S_OK) throw General_exception("%s failed", op.c_str());
+    }
+    for (auto& s : slots)
+      if (s.handle != IDawn::ASYNC_HANDLE_INIT) complete(s);
+  }
+}
+
+/**
+ * Backend layer: the store component in-process (put and get only)
+ *
+ * @param backend Backend name
+ */
+static void run_backend_layer(const std::string& backend)
+{
+  IBase* comp;
+  if (backend == "dummystore")
+    comp = load_component("libcomanche-dummystore.so", dummystore_factory);
+  else if (backend == "mapstore")
+    comp = load_component("libcomanche-storemap.so", mapstore_factory);
+  else if (backend == "hstore")
+    comp = load_component("libcomanche-hstore.so", hstore_factory);
+  else
+    throw General_exception("unsupported backend (%s)", backend.c_str());
+
+  if (!comp) throw General_exception("unable to load %s", backend.c_str());
+
+  auto fact =
+      static_cast<IKVStore_factory*>(comp->query_interface(IKVStore_factory::iid()));
+  IKVStore* kv = (backend == "hstore")
+                     ? fact->create("owner", "name0", dax_json(0))
+                     : fact->create("owner", "name");
+  fact->release_ref();
+
+  const std::string        value(Options.value_length, 'v');
+  std::vector<IKVStore::pool_t> pools;
+  for (unsigned t = 0; t < Options.threads; t++)
+    pools.push_back(kv->create_pool("", "bench-" + std::to_string(t),
+                                    Options.pool_size, 0, Options.count));
+
+  for (const std::string workload : {"put", "get"}) {
+    if (std::find(Options.workloads.begin(), Options.workloads.end(),
+                  workload) == Options.workloads.end())
+      continue;
+    run_threads(backend, workload, "backend",
+                [&](unsigned t, Thread_result& r) {
+                  put_get(kv, pools[t], t, r, value, workload);
+                });
+  }
+
+  for (auto pool : pools) kv->delete_pool(pool);
+  kv->release_ref();
+}
+
+/**
+ * Write the server configuration for a backend
+ *
+ * @param backend Backend name
+ *
+ * @return Configuration file path
+ */
+static std::string write_config(const std::string& backend)
+{
+  char path[] = "/tmp/dawn-bench-XXXXXX";
+  int  fd     = mkstemp(path);
+  if (fd < 0) throw General_exception("unable to create configuration file");
+  close(fd);
+
+  std::ofstream conf(path);
+  conf << "{ \"shards\" : [";
+  for (unsigned i = 0; i < Options.shards; i++) {
+    conf << (i ? "," : "") << "{ \"core\" : " << Options.server_core + i
+         << ", \"port\" : " << Options.port + i << ", \"net\" : \""
+         << Options.device << "\", \"provider\" : \"" << Options.provider
+         << "\", \"default_backend\" : \"" << backend << "\"";
+    if (backend == "hstore")
+      conf << ", \"dax_config\" : [{ \"region_id\" : 0, \"path\" : \""
+           << dax_path(i) << "\", \"addr\" : \"0x" << std::hex
+           << Options.dax_addr + (i * 0x1000000000ULL) << std::dec << "\" }]";
+    conf << " }";
+  }
+  conf << "] }\n";
+  return path;
+}
+
+/**
+ * Launch the Dawn server
+ *
+ * @param config Configuration file
+ *
+ * @return Server process id
+ */
+static pid_t launch_server(const std::string& config)
+{
+  const std::string debug = std::to_string(Options.debug_level);
+
+  pid_t pid = fork();
+  if (pid < 0) throw General_exception("fork failed");
+  if (pid == 0) {
+    execl(Options.server.c_str(), "dawn", "--config", config.c_str(),
+          "--debug", debug.c_str(), nullptr);
+    PERR("unable to exec Dawn server (%s)", Options.server.c_str());
+    _exit(1);
+  }
+  return pid;
+}
+
+/**
+ * Connect a client to the server
+ *
+ * @param server Server process (to detect early exit), or 0
+ *
+ * @return Client
+ */
+static IKVStore* connect(pid_t server)
+{
+  static IKVStore_factory* fact = nullptr;
+  if (!fact) {
+    IBase* comp =
+        load_component("libcomanche-dawn-client.so", dawn_client_factory);
+    if (!comp) throw General_exception("unable to load Dawn client");
+    fact = static_cast<IKVStore_factory*>(
+        comp->query_interface(IKVStore_factory::iid()));
+  }
+
+  std::stringstream addr;
+  addr << Options.addr << ":" << Options.port;
+  if (Options.shards > 1) addr << "-" << Options.port + Options.shards - 1;
+  addr << ":" << Options.provider;
+
+  /* the server may still be starting */
+  for (unsigned attempt = 0;; attempt++) {
+    try {
+      return fact->create(Options.debug_level, "owner", addr.str(),
+                          Options.device);
+    }
+    catch (...) {
+      int status;
+      if (server && waitpid(server, &status, WNOHANG) == server)
+        throw General_exception("Dawn server exited");
+      if (attempt == 100)
+        throw General_exception("unable to connect to Dawn server (%s)",
+                                addr.str().c_str());
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+}
+
+/**
+ * Service time histograms of the shards, summed over shards and value
+ * size classes
+ */
+struct Shard_snapshot {
+  std::map<std::string, std::vector<uint64_t>> hist;   /*< by op */
+  std::map<std::string, double>                cycles; /*< by op */
+};
+
+static Shard_snapshot shard_snapshot(IDawn* dawn)
+{
+  std::string stats;
+  if (dawn->get_statistics(stats) != S_OK)
+    throw General_exception("get_statistics failed");
+
+  rapidjson::Document doc;
+  doc.Parse(stats.c_str());
+  if (doc.HasParseError()) throw General_exception("bad shard statistics");
+
+  Shard_snapshot snap;
+  auto add = [&](const rapidjson::Value& shard) {
+    for (auto& e : shard["ops"].GetArray()) {
+      const std::string op = e["op"].GetString();
+      auto&             h  = snap.hist[op];
+      auto              src = e["hist"].GetArray();
+      h.resize(src.Size());
+      for (rapidjson::SizeType b = 0; b < src.Size(); b++)
+        h[b] += src[b].GetUint64();
+      snap.cycles[op] +=
+          e["mean_us"].GetDouble() * e["count"].GetUint64() * g_freq_mhz;
+    }
+  };
+
+  if (doc.IsArray())
+    for (auto& shard : doc.GetArray()) add(shard);
+  else
+    add(doc);
+  return snap;
+}
+
+/**
+ * Shard layer: service time of the requests of a workload, from the
+ * difference of shard statistics before and after it
+ *
+ */
+static void report_shard_layer(const std::string&    backend,
+                               const std::string&    workload,
+                               const Shard_snapshot& before,
+                               const Shard_snapshot& after)
+{
+  for (auto& a : after.hist) {
+    const auto& op = a.first;
+    if (op == "stats") continue;
+
+    std::vector<uint64_t> h = a.second;
+    auto                  b = before.hist.find(op);
+    if (b != before.hist.end())
+      for (size_t i = 0; i < b->second.size(); i++) h[i] -= b->second[i];
+
+    uint64_t count = 0;
+    for (auto n : h) count += n;
+    if (count == 0) continue;
+
+    auto percentile = [&](double p) -> double {
+      const uint64_t target = static_cast<uint64_t>(count * p);
+      uint64_t       sum    = 0;
+      for (size_t i = 0; i < h.size(); i++) {
+        sum += h[i];
+        if (sum > target) return (i ? (1ULL << i) - 1 : 0) / g_freq_mhz;
+      }
+      return 0.0;
+    };
+
+    auto   c      = before.cycles.find(op);
+    double cycles = after.cycles.at(op) - (c == before.cycles.end() ? 0 : c->second);
+
+    /* percentiles are histogram bucket upper bounds */
+    g_results.push_back(Result{backend, workload, "shard", op, count, 0,
+                               cycles / count / g_freq_mhz, percentile(0.5),
+                               percentile(0.99), percentile(0.999)});
+  }
+}
+
+/**
+ * Shard and client layers: workloads against a Dawn server
+ *
+ * @param backend Backend name
+ */
+static void run_server_layers(const std::string& backend)
+{
+  const auto config = write_config(backend);
+  const auto server = launch_server(config);
+
+  try {
+    auto control = connect(server);
+    auto control_dawn =
+        static_cast<IDawn*>(control->query_interface(IDawn::iid()));
+
+    std::vector<IKVStore*>        clients;
+    std::vector<IKVStore::pool_t> pools;
+    for (unsigned t = 0; t < Options.threads; t++) {
+      clients.push_back(connect(server));
+      pools.push_back(clients[t]->create_pool("", "bench-" + std::to_string(t),
+                                              Options.pool_size, 0,
+                                              Options.count));
+    }
+
+    const std::string value(Options.value_length, 'v');
+    for (const auto& workload : Options.workloads) {
+      const auto before = shard_snapshot(control_dawn);
+
+      run_threads(backend, workload, "client",
+                  [&](unsigned t, Thread_result& r) {
+                    auto dawn = static_cast<IDawn*>(
+                        clients[t]->query_interface(IDawn::iid()));
+                    if (workload == "put" || workload == "get")
+                      put_get(clients[t], pools[t], t, r, value, workload);
+                    else if (workload == "batch")
+                      batch(dawn, pools[t], t, r, value);
+                    else if (workload == "async")
+                      async(dawn, pools[t], t, r, value);
+                  });
+
+      report_shard_layer(backend, workload, before,
+                         shard_snapshot(control_dawn));
+    }
+
+    for (unsigned t = 0; t < Options.threads; t++) {
+      clients[t]->delete_pool(pools[t]);
+      clients[t]->release_ref();
+    }
+    control->release_ref();
+  }
+  catch (...) {
+    kill(server, SIGTERM);
+    waitpid(server, nullptr, 0);
+    unlink(config.c_str());
+    throw;
+  }
+
+  kill(server, SIGTERM);
+  waitpid(server, nullptr, 0);
+  unlink(config.c_str());
+}
+
+static void print_results()
+{
+  std::cout << std::left << std::setw(12) << "backend" << std::setw(8)
+            << "workload" << std::setw(9) << "layer" << std::setw(11) << "op"
+            << std::right << std::setw(10) << "ops" << std::setw(12)
+            << "kops/s" << std::setw(10) << "mean_us" << std::setw(10)
+            << "p50_us" << std::setw(10) << "p99_us" << std::setw(10)
+            << "p999_us" << "\n";
+
+  std::cout << std::fixed << std::setprecision(2);
+  for (auto& r : g_results) {
+    std::cout << std::left << std::setw(12) << r.backend << std::setw(8)
+              << r.workload << std::setw(9) << r.layer << std::setw(11) << r.op
+              << std::right << std::setw(10) << r.count << std::setw(12);
+    if (r.seconds > 0)
+      std::cout << r.count / r.seconds / 1000;
+    else
+      std::cout << "-";
+    std::cout << std::setw(10) << r.mean_us << std::setw(10) << r.p50_us
+              << std::setw(10) << r.p99_us << std::setw(10) << r.p999_us
+              << "\n";
+  }
+}
+
+static void write_json(const std::string& path)
+{
+  std::ofstream out(path);
+  out << "[";
+  for (size_t i = 0; i < g_results.size(); i++) {
+    auto& r = g_results[i];
+    out << (i ? ",\n" : "\n") << "{\"backend\":\"" << r.backend
+        << "\",\"workload\":\"" << r.workload << "\",\"layer\":\"" << r.layer
+        << "\",\"op\":\"" << r.op << "\",\"count\":" << r.count
+        << ",\"ops_per_sec\":" << (r.seconds > 0 ? r.count / r.seconds : 0)
+        << ",\"mean_us\":" << r.mean_us << ",\"p50_us\":" << r.p50_us
+        << ",\"p99_us\":" << r.p99_us << ",\"p999_us\":" << r.p999_us << "}";
+  }
+  out << "\n]\n";
+}
+
+int main(int argc, char* argv[])
+{
+  namespace po = boost::program_options;
+
+  try {
+    po::options_description desc("Options");
+    desc.add_options()("help", "Show help")                               //
+        ("server", po::value<std::string>()->default_value(DAWN_SERVER_PATH),
+         "Dawn server executable")  //
+        ("provider", po::value<std::string>()->default_value("sockets"),
+         "libfabric provider <sockets|tcp>")  //
+        ("device", po::value<std::string>()->default_value("lo"),
+         "Network device")  //
+        ("addr", po::value<std::string>()->default_value("127.0.0.1"),
+         "Server address")  //
+        ("port", po::value<unsigned>()->default_value(11911),
+         "First shard port")  //
+        ("shards", po::value<unsigned>()->default_value(1),
+         "Number of shards")  //
+        ("server-core", po::value<unsigned>()->default_value(0),
+         "Core of first shard (shards use consecutive cores)")  //
+        ("client-core", po::value<int>()->default_value(-1),
+         "Core of first client thread (-1 to not pin)")  //
+        ("threads", po::value<unsigned>()->default_value(1),
+         "Client threads")  //
+        ("backends",
+         po::value<std::string>()->default_value("mapstore"),
+         "Backends <dummystore,mapstore,hstore>")  //
+        ("workloads",
+         po::value<std::string>()->default_value("put,get,batch,async"),
+         "Workloads <put,get,batch,async>")  //
+        ("count", po::value<unsigned>()->default_value(10000),
+         "Keys per client thread")  //
+        ("key-length", po::value<unsigned>()->default_value(8),
+         "Key length")  //
+        ("value-length", po::value<unsigned>()->default_value(64),
+         "Value length")  //
+        ("batch-size", po::value<unsigned>()->default_value(32),
+         "Operations per batch")  //
+        ("async-depth", po::value<unsigned>()->default_value(16),
+         "Asynchronous operations in flight per thread")  //
+        ("pool-size", po::value<size_t>()->default_value(MB(64)),
+         "Pool size per client thread")  //
+        ("dax-device", po::value<std::string>()->default_value(""),
+         "Device DAX prefix for hstore; shard i uses <prefix>i "
+         "(e.g. /dev/dax0.)")  //
+        ("dax-addr", po::value<std::string>()->default_value("0x9000000000"),
+         "Mapping address of first DAX device")  //
+        ("json", po::value<std::string>(), "Write results as JSON")  //
+        ("debug", po::value<unsigned>()->default_value(0), "Debug level 0-3");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+
+    if (vm.count("help") > 0) {
+      std::cout << desc;
+      return -1;
+    }
+
+    Options.server       = vm["server"].as<std::string>();
+    Options.provider     = vm["provider"].as<std::string>();
+    Options.device       = vm["device"].as<std::string>();
+    Options.addr         = vm["addr"].as<std::string>();
+    Options.port         = vm["port"].as<unsigned>();
+    Options.shards       = vm["shards"].as<unsigned>();
+    Options.server_core  = vm["server-core"].as<unsigned>();
+    Options.client_core  = vm["client-core"].as<int>();
+    Options.threads      = vm["threads"].as<unsigned>();
+    Options.backends     = split(vm["backends"].as<std::string>());
+    Options.workloads    = split(vm["workloads"].as<std::string>());
+    Options.count        = vm["count"].as<unsigned>();
+    Options.key_length   = vm["key-length"].as<unsigned>();
+    Options.value_length = vm["value-length"].as<unsigned>();
+    Options.batch_size   = vm["batch-size"].as<unsigned>();
+    Options.async_depth  = vm["async-depth"].as<unsigned>();
+    Options.pool_size    = vm["pool-size"].as<size_t>();
+    Options.dax_device   = vm["dax-device"].as<std::string>();
+    Options.dax_addr =
+        std::strtoull(vm["dax-addr"].as<std::string>().c_str(), nullptr, 0);
+    Options.debug_level = vm["debug"].as<unsigned>();
+    if (vm.count("json")) Options.json = vm["json"].as<std::string>();
+
+    if (Options.shards < 1 || Options.threads < 1 || Options.count < 1 ||
+        Options.batch_size < 1 || Options.async_depth < 1) {
+      std::cout << "shards, threads, count, batch-size and async-depth should "
+                   "be at least 1\n";
+      return -1;
+    }
+    for (auto& w : Options.workloads)
+      if (w != "put" && w != "get" && w != "batch" && w != "async") {
+        std::cout << "unknown workload (" << w << ")\n";
+        return -1;
+      }
+  }
+  catch (const po::error& e) {
+    printf("bad command line option\n");
+    return -1;
+  }
+
+  g_freq_mhz = Common::get_rdtsc_frequency_mhz();
+
+  /* server children inherit stdout; do not let them repeat our output */
+  std::cout.flush();
+
+  int rc = 0;
+  for (auto& backend : Options.backends) {
+    if (backend == "hstore" && Options.dax_device.empty()) {
+      PWRN("skipping hstore: no --dax-device");
+      continue;
+    }
+
+    try {
+      PMAJOR("dawn-bench: %s backend layer", backend.c_str());
+      run_backend_layer(backend);
+
+      PMAJOR("dawn-bench: %s shard and client layers (%u shards, %u threads)",
+             backend.c_str(), Options.shards, Options.threads);
+      run_server_layers(backend);
+    }
+    catch (const Exception& e) {
+      PERR("dawn-bench: %s failed: %s", backend.c_str(), e.cause());
+      rc = 1;
+    }
+    catch (const std::exception& e) {
+      PERR("dawn-bench: %s failed: %s", backend.c_str(), e.what());
+      rc = 1;
+    }
+  }
+
+  print_results();
+  if (!Options.json.empty()) write_json(Options.json);
+
+  return rc;
+}